@@ -0,0 +1,144 @@
+#ifndef ACTIVE_SCAN_POLICY_H
+#define ACTIVE_SCAN_POLICY_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Decides whether the next BLE window scans actively. An active scan sends
+// a SCAN_REQ to every scannable advertiser and each answers with a SCAN_RSP,
+// every window, although after the first pair there is seldom anything new
+// in it. Windows are passive unless some device is still unresolved (no
+// name yet), and the active ones are aimed at those devices through the
+// controller whitelist, alternating with passive windows so new advertisers
+// are still found. With more unresolved devices than whitelist entries the
+// window is active for everyone. What a scan response told us is kept per
+// device, so a passive window can still show the name.
+
+#define BLE_META_CACHE_SIZE 64
+#define BLE_META_NAME_LEN 32
+#define BLE_META_TTL_MS (30 * 60 * 1000UL)   // forget devices unseen this long
+#define ACTIVE_ATTEMPTS_MAX 3    // active windows a device may stay silent in
+#define ACTIVE_WHITELIST_MAX 8   // well within the controller's list
+
+struct BLEMeta {
+  uint8_t id[6];
+  uint8_t addrType;     // esp_ble_addr_type_t, for the whitelist
+  bool used;
+  bool resolved;        // named, answered without a name, or gave up
+  uint8_t attempts;     // active windows seen in without a scan response
+  char name[BLE_META_NAME_LEN];
+  uint32_t lastSeenMs;
+};
+
+struct ScanPlan {
+  bool active;
+  int whitelistCount;   // 0: every advertiser
+  const BLEMeta* whitelist[ACTIVE_WHITELIST_MAX];
+};
+
+struct ActiveScanStats {
+  uint32_t windows;
+  uint32_t activeWindows;
+  uint32_t targetedWindows;   // active, limited to the whitelist
+  uint32_t resolved;
+  uint32_t gaveUp;
+};
+
+class ActiveScanPolicy {
+public:
+  ActiveScanPolicy() : lastActive(false) { clear(); }
+
+  void clear() {
+    memset(cache, 0, sizeof(cache));
+    memset(&counters, 0, sizeof(counters));
+    lastActive = false;
+  }
+
+  // The next window: active only with unresolved devices, and targeted ones
+  // never twice in a row
+  ScanPlan plan(uint32_t nowMs) {
+    ScanPlan p;
+    memset(&p, 0, sizeof(p));
+    int unresolved = 0;
+    for (int i = 0; i < BLE_META_CACHE_SIZE; i++) {
+      BLEMeta& m = cache[i];
+      if (!m.used) continue;
+      if (nowMs - m.lastSeenMs > BLE_META_TTL_MS) {
+        m.used = false;
+        continue;
+      }
+      if (m.resolved) continue;
+      if (unresolved < ACTIVE_WHITELIST_MAX) p.whitelist[unresolved] = &m;
+      unresolved++;
+    }
+    counters.windows++;
+    if (unresolved == 0 || lastActive) {
+      lastActive = false;
+      return p;
+    }
+    p.active = true;
+    p.whitelistCount = unresolved <= ACTIVE_WHITELIST_MAX ? unresolved : 0;
+    counters.activeWindows++;
+    if (p.whitelistCount > 0) {
+      counters.targetedWindows++;
+      lastActive = true;    // the whitelist hides new devices: pass next time
+    }
+    return p;
+  }
+
+  // One device from the window that just ran. scanResponse: a SCAN_RSP
+  // came with its advertisement; name may be null
+  const BLEMeta* observe(const uint8_t id[6], uint8_t addrType, bool activeWindow, bool scanResponse,
+                         const char* name, uint32_t nowMs) {
+    BLEMeta* m = find(id, nowMs);
+    m->addrType = addrType;
+    m->lastSeenMs = nowMs;
+    if (name && name[0]) {
+      strncpy(m->name, name, BLE_META_NAME_LEN - 1);
+      m->name[BLE_META_NAME_LEN - 1] = 0;
+    }
+    if (m->resolved) return m;
+    if (m->name[0] || scanResponse) {
+      m->resolved = true;
+      counters.resolved++;
+    } else if (activeWindow && ++m->attempts >= ACTIVE_ATTEMPTS_MAX) {
+      m->resolved = true;   // not scannable, or out of range of our requests
+      counters.gaveUp++;
+    }
+    return m;
+  }
+
+  const BLEMeta* lookup(const uint8_t id[6]) const {
+    for (int i = 0; i < BLE_META_CACHE_SIZE; i++) {
+      if (cache[i].used && memcmp(cache[i].id, id, 6) == 0) return &cache[i];
+    }
+    return nullptr;
+  }
+
+  const ActiveScanStats& stats() const { return counters; }
+
+private:
+  // The device's entry, else a free one, else the one unseen longest
+  BLEMeta* find(const uint8_t id[6], uint32_t nowMs) {
+    BLEMeta* slot = nullptr;
+    for (int i = 0; i < BLE_META_CACHE_SIZE; i++) {
+      BLEMeta& m = cache[i];
+      if (m.used && memcmp(m.id, id, 6) == 0) return &m;
+      if (!m.used) {
+        if (!slot || slot->used) slot = &m;
+      } else if (!slot || (slot->used && nowMs - m.lastSeenMs > nowMs - slot->lastSeenMs)) {
+        slot = &m;
+      }
+    }
+    memset(slot, 0, sizeof(*slot));
+    memcpy(slot->id, id, 6);
+    slot->used = true;
+    return slot;
+  }
+
+  BLEMeta cache[BLE_META_CACHE_SIZE];
+  ActiveScanStats counters;
+  bool lastActive;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "AdvData.h"
+#include <stdio.h>
+#include <string.h>
+
+// AD types (Core Supplement Part A)
+#define AD_16SRV_PART 0x02
+#define AD_16SRV_CMPL 0x03
+#define AD_32SRV_PART 0x04
+#define AD_32SRV_CMPL 0x05
+#define AD_128SRV_PART 0x06
+#define AD_128SRV_CMPL 0x07
+#define AD_NAME_CMPL 0x09
+#define AD_TX_PWR 0x0A
+
+static const char BASE_UUID_TAIL[] = "-0000-1000-8000-00805f9b34fb";
+
+static uint32_t readLe(const uint8_t* p, int n) {
+  uint32_t v = 0;
+  for (int i = n - 1; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+// 16 and 32 bit UUIDs on the Bluetooth base UUID; 128 bit ones are sent
+// least significant byte first
+static void formatUuid(const uint8_t* p, int n, char* out) {
+  if (n < 16) {
+    snprintf(out, ADV_UUID_LEN, "%08x%s", (unsigned)readLe(p, n), BASE_UUID_TAIL);
+    return;
+  }
+  snprintf(out, ADV_UUID_LEN, "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+           p[15], p[14], p[13], p[12], p[11], p[10], p[9], p[8], p[7], p[6], p[5], p[4], p[3], p[2],
+           p[1], p[0]);
+}
+
+void advParse(const uint8_t* data, size_t len, AdvFields& out) {
+  size_t pos = 0;
+  while (pos < len) {
+    uint8_t length = data[pos];
+    if (length == 0 || pos + 1 + length > len) break;
+    uint8_t type = data[pos + 1];
+    const uint8_t* value = data + pos + 2;
+    int n = length - 1;
+    switch (type) {
+      case AD_NAME_CMPL: {
+        int copy = n < ADV_NAME_LEN - 1 ? n : ADV_NAME_LEN - 1;
+        memcpy(out.name, value, copy);
+        out.name[copy] = 0;
+        break;
+      }
+      case AD_TX_PWR:
+        if (n >= 1) {
+          out.txPower = (int8_t)value[0];
+          out.haveTxPower = true;
+        }
+        break;
+      case AD_16SRV_PART:
+      case AD_16SRV_CMPL:
+        if (!out.serviceUUID[0] && n >= 2) formatUuid(value, 2, out.serviceUUID);
+        break;
+      case AD_32SRV_PART:
+      case AD_32SRV_CMPL:
+        if (!out.serviceUUID[0] && n >= 4) formatUuid(value, 4, out.serviceUUID);
+        break;
+      case AD_128SRV_PART:
+      case AD_128SRV_CMPL:
+        if (!out.serviceUUID[0] && n >= 16) formatUuid(value, 16, out.serviceUUID);
+        break;
+    }
+    pos += 1 + length;
+  }
+}
+
+static const uint32_t PRIME1 = 2654435761U;
+static const uint32_t PRIME2 = 2246822519U;
+static const uint32_t PRIME3 = 3266489917U;
+static const uint32_t PRIME4 = 668265263U;
+static const uint32_t PRIME5 = 374761393U;
+
+static inline uint32_t rotl(uint32_t x, int r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t round32(uint32_t acc, uint32_t input) {
+  return rotl(acc + input * PRIME2, 13) * PRIME1;
+}
+
+uint32_t advHash(const uint8_t* data, size_t len, uint32_t seed) {
+  const uint8_t* p = data;
+  const uint8_t* end = data + len;
+  uint32_t h;
+  if (len >= 16) {
+    uint32_t v1 = seed + PRIME1 + PRIME2;
+    uint32_t v2 = seed + PRIME2;
+    uint32_t v3 = seed;
+    uint32_t v4 = seed - PRIME1;
+    for (; p + 16 <= end; p += 16) {
+      v1 = round32(v1, readLe(p, 4));
+      v2 = round32(v2, readLe(p + 4, 4));
+      v3 = round32(v3, readLe(p + 8, 4));
+      v4 = round32(v4, readLe(p + 12, 4));
+    }
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+  } else {
+    h = seed + PRIME5;
+  }
+  h += (uint32_t)len;
+  for (; p + 4 <= end; p += 4) h = rotl(h + readLe(p, 4) * PRIME3, 17) * PRIME4;
+  for (; p < end; p++) h = rotl(h + *p * PRIME5, 11) * PRIME1;
+  h ^= h >> 15;
+  h *= PRIME2;
+  h ^= h >> 13;
+  h *= PRIME3;
+  h ^= h >> 16;
+  return h;
+}
+
+AdvParseCache::AdvParseCache() {
+  clear();
+}
+
+void AdvParseCache::clear() {
+  memset(slots, 0, sizeof(slots));
+  memset(&counters, 0, sizeof(counters));
+}
+
+const AdvFields& AdvParseCache::parse(const uint8_t bda[6], const uint8_t* data, size_t len, uint32_t nowMs) {
+  uint32_t hash = advHash(data, len);
+  Slot* slot = nullptr;
+  for (int i = 0; i < ADV_CACHE_SLOTS; i++) {
+    Slot& s = slots[i];
+    if (s.used && memcmp(s.bda, bda, 6) == 0) {
+      slot = &s;
+      break;
+    }
+    if (!slot || (slot->used && (!s.used || (int32_t)(s.lastMs - slot->lastMs) < 0))) slot = &s;
+  }
+  slot->lastMs = nowMs;
+  if (slot->used && memcmp(slot->bda, bda, 6) == 0) {
+    if (slot->hash == hash && slot->len == len) {
+      counters.hits++;
+      return slot->fields;
+    }
+  } else {
+    if (slot->used) counters.evictions++;
+    memcpy(slot->bda, bda, 6);
+    slot->used = true;
+  }
+  counters.misses++;
+  slot->hash = hash;
+  slot->len = len;
+  memset(&slot->fields, 0, sizeof(slot->fields));
+  advParse(data, len, slot->fields);
+  return slot->fields;
+}
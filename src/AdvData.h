@@ -0,0 +1,67 @@
+#ifndef ADV_DATA_H
+#define ADV_DATA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The advertising data fields the BLE list shows, read straight out of the
+// AD structures of a (merged) scan report: complete local name, TX power
+// level and the first service UUID, formatted the way BLEUUID::toString()
+// does (128-bit form, lowercase). No allocation, so it can run in the GAP
+// callback. A truncated structure ends the parse.
+
+#define ADV_NAME_LEN 32
+#define ADV_UUID_LEN 37
+#define ADV_CACHE_SLOTS 64   // one window's worth of devices (BLE_SCAN_MAX)
+
+struct AdvFields {
+  char name[ADV_NAME_LEN];        // "" if none
+  char serviceUUID[ADV_UUID_LEN]; // "" if none
+  int8_t txPower;
+  bool haveTxPower;
+};
+
+// Fills the fields found in data and leaves the others as they are, so a
+// scan response parsed later adds to its advertisement
+void advParse(const uint8_t* data, size_t len, AdvFields& out);
+
+// 32-bit xxHash (XXH32) of the data: no tables, a few multiplies per word
+uint32_t advHash(const uint8_t* data, size_t len, uint32_t seed = 0);
+
+struct AdvCacheStats {
+  uint32_t hits;        // payload unchanged, parse skipped
+  uint32_t misses;      // parsed: a new device or a changed payload
+  uint32_t evictions;
+};
+
+// The fields last parsed per advertiser, keyed by the hash and length of
+// the payload they came from. Most advertisers repeat the same bytes for
+// minutes, so a report costs one hash instead of a parse; a payload that
+// changes at all (a rotating TLM counter) is parsed again. The least
+// recently seen address gives up its slot. Fixed storage; not thread safe.
+class AdvParseCache {
+public:
+  AdvParseCache();
+  void clear();
+
+  // The fields of this payload alone, as advParse() would give them from
+  // empty; valid until the next call
+  const AdvFields& parse(const uint8_t bda[6], const uint8_t* data, size_t len, uint32_t nowMs);
+
+  const AdvCacheStats& stats() const { return counters; }
+
+private:
+  struct Slot {
+    uint8_t bda[6];
+    bool used;
+    uint8_t len;
+    uint32_t hash;
+    uint32_t lastMs;
+    AdvFields fields;
+  };
+
+  Slot slots[ADV_CACHE_SLOTS];
+  AdvCacheStats counters;
+};
+
+#endif
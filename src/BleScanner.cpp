@@ -0,0 +1,160 @@
+#include "BleScanner.h"
+#include <BLEDevice.h>
+#include <esp_gap_ble_api.h>
+#include <mutex>
+#include "ScanMerge.h"
+#include "RadioStats.h"
+#include "Latency.h"
+
+// Written by the GAP callback while a scan runs, read by the scanner task
+// once it has ended
+static std::mutex lock;
+static ScanMerge merge;
+static AdvParseCache parseCache;   // across windows: most payloads never change
+static BleSighting found[BLE_SCAN_MAX];
+static int foundCount = 0;
+static volatile bool scanning = false;
+static volatile BleReportFn follower = nullptr;
+static SemaphoreHandle_t scanEnded = nullptr;
+
+static BleSighting* sightingFor(const uint8_t bda[6]) {
+  for (int i = 0; i < foundCount; i++) {
+    if (memcmp(found[i].id, bda, 6) == 0) return &found[i];
+  }
+  if (foundCount >= BLE_SCAN_MAX) return nullptr;
+  BleSighting* s = &found[foundCount++];
+  memset(s, 0, sizeof(*s));
+  memcpy(s->id, bda, 6);
+  s->ingestUs = ingestTimestamp();
+  return s;
+}
+
+// A merged report; a late scan response adds to the device's first one.
+// The first report of a window is looked up in the parse cache.
+static void take(const ScanReport& r, uint32_t nowMs) {
+  int before = foundCount;
+  BleSighting* s = sightingFor(r.bda);
+  if (!s) return;
+  s->addrType = r.addrType;
+  s->rssi = r.rssi;
+  if (r.advLen > 0) s->connectable = advConnectable(r.evtType);
+  if (r.rspLen > 0) s->scanResponse = true;
+  if (foundCount > before) s->adv = parseCache.parse(r.bda, r.payload, r.advLen + r.rspLen, nowMs);
+  else advParse(r.payload, r.advLen + r.rspLen, s->adv);
+}
+
+static void onScanResult(esp_ble_gap_cb_param_t::ble_scan_result_evt_param& res) {
+  switch (res.search_evt) {
+    case ESP_GAP_SEARCH_INQ_RES_EVT: {
+      if (!scanning) break;
+      radioCounters[SRC_BLE].reports++;
+      BleReportFn fn = follower;
+      if (fn) {
+        fn(res.bda, res.rssi);   // follow mode only wants the RSSI, nothing to parse
+        break;
+      }
+      uint32_t now = millis();
+      std::lock_guard<std::mutex> guard(lock);
+      merge.add(res.bda, res.ble_addr_type, res.ble_evt_type, res.rssi, res.ble_adv,
+                res.adv_data_len, res.scan_rsp_len, now);
+      for (const ScanReport* r = merge.next(now); r; r = merge.next(now)) take(*r, now);
+      break;
+    }
+    case ESP_GAP_SEARCH_INQ_CMPL_EVT: {
+      {
+        // Whatever still waits for a scan response goes out as it is
+        std::lock_guard<std::mutex> guard(lock);
+        uint32_t now = millis();
+        for (const ScanReport* r = merge.next(now, true); r; r = merge.next(now, true)) take(*r, now);
+      }
+      scanning = false;
+      xSemaphoreGive(scanEnded);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static void gapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  switch (event) {
+    case ESP_GAP_BLE_SCAN_RESULT_EVT:
+      onScanResult(param->scan_rst);
+      break;
+    case ESP_GAP_BLE_SCAN_START_COMPLETE_EVT:
+      if (param->scan_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+        scanning = false;
+        xSemaphoreGive(scanEnded);
+      }
+      break;
+    case ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT:
+      scanning = false;
+      xSemaphoreGive(scanEnded);
+      break;
+    default:
+      break;
+  }
+}
+
+void bleScannerBegin() {
+  scanEnded = xSemaphoreCreateBinary();
+  BLEDevice::setCustomGapHandler(gapHandler);
+}
+
+static bool startScan(uint32_t seconds, bool active, bool whitelistOnly) {
+  esp_ble_scan_params_t params = {};
+  params.scan_type = active ? BLE_SCAN_TYPE_ACTIVE : BLE_SCAN_TYPE_PASSIVE;
+  params.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+  params.scan_filter_policy = whitelistOnly ? BLE_SCAN_FILTER_ALLOW_ONLY_WLST : BLE_SCAN_FILTER_ALLOW_ALL;
+  params.scan_interval = BLE_SCAN_INTERVAL;
+  params.scan_window = BLE_SCAN_WINDOW;
+  params.scan_duplicate = BLE_SCAN_DUPLICATE_DISABLE;
+  xSemaphoreTake(scanEnded, 0);   // a stale end from a timed out scan
+  scanning = true;
+  // The stack runs the two in order and reports a failed start as an event
+  if (esp_ble_gap_set_scan_params(&params) != ESP_OK || esp_ble_gap_start_scanning(seconds) != ESP_OK) {
+    scanning = false;
+    return false;
+  }
+  return true;
+}
+
+// Stops the scan unless it already ended, and waits for the event
+static void stopScan(uint32_t waitMs) {
+  if (xSemaphoreTake(scanEnded, pdMS_TO_TICKS(waitMs)) == pdTRUE) return;
+  if (esp_ble_gap_stop_scanning() == ESP_OK) xSemaphoreTake(scanEnded, pdMS_TO_TICKS(BLE_SCAN_GRACE_MS));
+  scanning = false;
+}
+
+int bleScan(uint32_t seconds, bool active, bool whitelistOnly, BleSighting* out, int max) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    merge.clear();
+    merge.configure(active, false);
+    foundCount = 0;
+  }
+  if (!startScan(seconds, active, whitelistOnly)) return -1;
+  stopScan(seconds * 1000 + BLE_SCAN_GRACE_MS);
+
+  std::lock_guard<std::mutex> guard(lock);
+  int n = foundCount < max ? foundCount : max;
+  memcpy(out, found, n * sizeof(BleSighting));
+  return n;
+}
+
+bool bleFollowStart(BleReportFn fn) {
+  follower = fn;
+  if (startScan(0, false, true)) return true;   // 0: until stopped
+  follower = nullptr;
+  return false;
+}
+
+void bleFollowStop() {
+  stopScan(0);
+  follower = nullptr;
+}
+
+AdvCacheStats bleParseCacheStats() {
+  std::lock_guard<std::mutex> guard(lock);
+  return parseCache.stats();
+}
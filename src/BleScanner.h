@@ -0,0 +1,46 @@
+#ifndef BLE_SCANNER_H
+#define BLE_SCANNER_H
+
+#include <Arduino.h>
+#include "AdvData.h"
+
+// BLE scanning on the GAP API, next to the stock BLE library rather than
+// through BLEScan: each window sets its own scan type and filter policy
+// (whitelist only, see ActiveScanPolicy.h), scan responses are merged
+// with their advertisements (ScanMerge.h) before the AD structures are
+// read, and the event type tells whether a device is connectable. Reports
+// arrive through BLEDevice's custom GAP handler; BLEDevice::getScan() is
+// never called, so the library's own scan handler stays out of the way.
+// BLEClient connections (Harvest.h) are unaffected.
+
+#define BLE_SCAN_MAX 64           // devices kept per window
+#define BLE_SCAN_INTERVAL 160     // 100 ms, in 0.625 ms units
+#define BLE_SCAN_WINDOW 158       // 99 ms
+#define BLE_SCAN_GRACE_MS 1000    // beyond the duration, for the complete event
+
+// One device of a window, both halves of its advertising merged
+struct BleSighting {
+  uint8_t id[6];
+  uint8_t addrType;     // esp_ble_addr_type_t
+  int rssi;
+  bool connectable;     // ADV_IND or ADV_DIRECT_IND
+  bool scanResponse;    // answered a scan request
+  AdvFields adv;
+  uint32_t ingestUs;    // micros() when the GAP callback delivered it
+};
+
+typedef void (*BleReportFn)(const uint8_t bda[6], int rssi);
+
+// After BLEDevice::init()
+void bleScannerBegin();
+// Scans for the given seconds and copies out the devices found (at most
+// max), or -1 if the scan did not run. whitelistOnly limits the reports,
+// and the scan requests of an active window, to the controller whitelist.
+int bleScan(uint32_t seconds, bool active, bool whitelistOnly, BleSighting* out, int max);
+// Passive, whitelist-only scan until bleFollowStop(); fn gets the address
+// and RSSI of every advertisement, from the GAP callback
+bool bleFollowStart(BleReportFn fn);
+void bleFollowStop();
+AdvCacheStats bleParseCacheStats();
+
+#endif
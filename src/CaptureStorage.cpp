@@ -0,0 +1,411 @@
+#include "CaptureStorage.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "FlashRegion.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <FS.h>
+#if CAPTURE_STORAGE == CAPTURE_STORAGE_LITTLEFS
+#include <LittleFS.h>
+#elif CAPTURE_STORAGE == CAPTURE_STORAGE_FFAT
+#include <FFat.h>
+#elif CAPTURE_STORAGE == CAPTURE_STORAGE_SD
+#include <SD.h>
+#elif CAPTURE_STORAGE == CAPTURE_STORAGE_SD_MMC
+#include <SD_MMC.h>
+#endif
+#endif
+
+#define CAPTURE_SCAN_MAX 64
+
+// =================================================================
+// COMMON SEGMENT LOGIC
+// =================================================================
+
+bool CaptureStorage::begin() {
+  std::lock_guard<std::mutex> guard(lock);
+  mounted = mount();
+  if (!mounted) return false;
+
+  // Continue numbering after the newest segment already on the medium
+  SegmentScan scan;
+  scanSegments(nullptr, 0, scan);
+  currentId = scan.newest + 1;
+  currentSize = 0;
+  batchLen = 0;
+  if (!openSegment(currentId) && !(dropOldestLocked() && openSegment(currentId))) {
+    mounted = false;
+  }
+  return mounted;
+}
+
+bool CaptureStorage::append(const void* data, size_t len) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!mounted) return false;
+
+  if (currentSize + batchLen + len > segmentLimit() && !rotateLocked()) return false;
+  if (batchLen + len > CAPTURE_BATCH_BYTES && !flushLocked()) return false;
+  // Oversized records bypass the batch
+  if (len > CAPTURE_BATCH_BYTES) return writeRecordLocked((const uint8_t*)data, len);
+  memcpy(batch + batchLen, data, len);
+  batchLen += len;
+  return true;
+}
+
+bool CaptureStorage::appendBlock(const void* data, size_t len) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!mounted) return false;
+
+  if (currentSize + batchLen + len > segmentLimit() && !rotateLocked()) return false;
+  if (!flushLocked()) return false;
+  return writeRecordLocked((const uint8_t*)data, len);
+}
+
+bool CaptureStorage::flush() {
+  std::lock_guard<std::mutex> guard(lock);
+  return mounted && flushLocked();
+}
+
+bool CaptureStorage::rotate() {
+  std::lock_guard<std::mutex> guard(lock);
+  return mounted && rotateLocked();
+}
+
+// Out of space: make room by dropping the oldest closed segment, then
+// carry on from where the write stopped so no byte is written twice
+size_t CaptureStorage::writeLocked(const uint8_t* data, size_t len) {
+  size_t done = writeSegment(data, len);
+  if (done < len && dropOldestLocked()) done += writeSegment(data + done, len - done);
+  currentSize += done;
+  totalBytes += done;
+  return done;
+}
+
+// Records passed by the caller; one written only in part ends its
+// segment, so nothing is appended behind a torn record
+bool CaptureStorage::writeRecordLocked(const uint8_t* data, size_t len) {
+  size_t done = writeLocked(data, len);
+  if (done == len) return true;
+  if (done > 0) rotateLocked();
+  return false;
+}
+
+// The part of the batch that did not fit stays queued and goes out first
+// on the next flush
+bool CaptureStorage::flushLocked() {
+  if (batchLen == 0) return true;
+  size_t done = writeLocked(batch, batchLen);
+  batchLen -= done;
+  memmove(batch, batch + done, batchLen);
+  return batchLen == 0;
+}
+
+bool CaptureStorage::rotateLocked() {
+  bool ok = flushLocked();
+  closeSegment();
+  currentId++;
+  currentSize = 0;
+  batchLen = 0;
+  if (!openSegment(currentId) && !(dropOldestLocked() && openSegment(currentId))) {
+    mounted = false;
+    return false;
+  }
+  return ok;
+}
+
+bool CaptureStorage::dropOldestLocked() {
+  SegmentInfo segs[CAPTURE_SCAN_MAX];
+  SegmentScan scan;
+  int n = scanSegments(segs, CAPTURE_SCAN_MAX, scan);
+  for (int i = 0; i < n; i++) {
+    if (segs[i].id != currentId) return removeClosed(segs[i].id);
+  }
+  return false;
+}
+
+int CaptureStorage::listSegments(uint32_t after, SegmentInfo* out, int max) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!mounted) return 0;
+  SegmentInfo segs[CAPTURE_SCAN_MAX];
+  SegmentScan scan;
+  scan.after = after;
+  int n = scanSegments(segs, CAPTURE_SCAN_MAX, scan);
+  int count = 0;
+  for (int i = 0; i < n && count < max; i++) {
+    if (segs[i].id != currentId) out[count++] = segs[i];
+  }
+  return count;
+}
+
+// The open segment is the newest one on the medium: scan one more than
+// asked for and leave it out
+int CaptureStorage::listNewestSegments(SegmentInfo* out, int max, uint32_t* total) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (total) *total = 0;
+  if (!mounted) return 0;
+  SegmentInfo segs[CAPTURE_SCAN_MAX + 1];
+  SegmentScan scan;
+  scan.keepNewest = true;
+  if (max > CAPTURE_SCAN_MAX) max = CAPTURE_SCAN_MAX;
+  int n = scanSegments(segs, max + 1, scan);
+  if (n > 0 && segs[n - 1].id == currentId) {
+    n--;
+    scan.total--;
+  }
+  int skip = n > max ? n - max : 0;
+  memcpy(out, segs + skip, (n - skip) * sizeof(SegmentInfo));
+  if (total) *total = scan.total;
+  return n - skip;
+}
+
+size_t CaptureStorage::readSegment(uint32_t id, uint32_t offset, void* dst, size_t len) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!mounted || id == currentId) return 0;
+  return readClosed(id, offset, dst, len);
+}
+
+bool CaptureStorage::removeSegment(uint32_t id) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!mounted || id == currentId) return false;
+  return removeClosed(id);
+}
+
+void CaptureStorage::insertSorted(SegmentInfo* segs, int& n, int max, const SegmentInfo& s,
+                                  SegmentScan& scan) {
+  if (s.id > scan.newest) scan.newest = s.id;
+  if (s.id <= scan.after) return;
+  scan.total++;
+  if (max == 0) return;
+  int pos = n;
+  while (pos > 0 && segs[pos - 1].id > s.id) pos--;
+  if (n < max) {
+    memmove(&segs[pos + 1], &segs[pos], (n - pos) * sizeof(SegmentInfo));
+    segs[pos] = s;
+    n++;
+  } else if (!scan.keepNewest) {
+    // Full: the newest one falls off the end
+    if (pos >= max) return;
+    memmove(&segs[pos + 1], &segs[pos], (max - 1 - pos) * sizeof(SegmentInfo));
+    segs[pos] = s;
+  } else {
+    // Full: the oldest one falls off the front
+    if (pos == 0) return;
+    memmove(&segs[0], &segs[1], (pos - 1) * sizeof(SegmentInfo));
+    segs[pos - 1] = s;
+  }
+}
+
+// =================================================================
+// RAW RING BACKEND
+// =================================================================
+// The "capture" partition is cut into fixed slots of CAPTURE_SEGMENT_BYTES;
+// segment N lives in slot N % slots. Sectors are erased just ahead of the
+// write position, and the slot header's size field is programmed on close
+// (erased flash reads 0xFFFFFFFF, so it can be written once in place).
+
+#define RAW_SLOT_MAGIC 0x50414357  // "WCAP"
+
+struct RawSlotHeader {
+  uint32_t magic;
+  uint32_t id;
+  uint32_t size;      // 0xFFFFFFFF while the segment is open
+  uint32_t reserved;
+};
+
+class RawCaptureStorage : public CaptureStorage {
+public:
+  RawCaptureStorage(const char* hostPath = nullptr, size_t hostSize = 0)
+    : hostPath(hostPath), hostSize(hostSize) {}
+  const char* name() const override { return "raw"; }
+
+protected:
+  bool mount() override {
+    if (!region.open(CAPTURE_PARTITION_LABEL, hostPath, hostSize)) return false;
+    slots = region.length() / CAPTURE_SEGMENT_BYTES;
+    return slots >= 2;
+  }
+
+  size_t segmentLimit() const override { return CAPTURE_SEGMENT_BYTES - sizeof(RawSlotHeader); }
+
+  int scanSegments(SegmentInfo* out, int max, SegmentScan& scan) override {
+    int n = 0;
+    for (uint32_t s = 0; s < slots; s++) {
+      RawSlotHeader h;
+      if (!region.read(s * CAPTURE_SEGMENT_BYTES, &h, sizeof(h)) || h.magic != RAW_SLOT_MAGIC) continue;
+      SegmentInfo info = {h.id, h.size == 0xFFFFFFFF ? 0 : h.size};
+      insertSorted(out, n, max, info, scan);
+    }
+    return n;
+  }
+
+  bool openSegment(uint32_t id) override {
+    slotBase = (id % slots) * CAPTURE_SEGMENT_BYTES;
+    if (!region.erase(slotBase, FLASH_SECTOR_SIZE)) return false;
+    RawSlotHeader h = {RAW_SLOT_MAGIC, id, 0xFFFFFFFF, 0xFFFFFFFF};
+    writePos = sizeof(h);
+    erasedTo = FLASH_SECTOR_SIZE;
+    return region.write(slotBase, &h, sizeof(h));
+  }
+
+  size_t writeSegment(const uint8_t* data, size_t len) override {
+    if (writePos + len > CAPTURE_SEGMENT_BYTES) return 0;
+    while (erasedTo < writePos + len) {
+      if (!region.erase(slotBase + erasedTo, FLASH_SECTOR_SIZE)) return 0;
+      erasedTo += FLASH_SECTOR_SIZE;
+    }
+    if (!region.write(slotBase + writePos, data, len)) return 0;
+    writePos += len;
+    return len;
+  }
+
+  void closeSegment() override {
+    uint32_t size = writePos - sizeof(RawSlotHeader);
+    region.write(slotBase + offsetof(RawSlotHeader, size), &size, sizeof(size));
+  }
+
+  size_t readClosed(uint32_t id, uint32_t offset, void* dst, size_t len) override {
+    RawSlotHeader h;
+    size_t base = (id % slots) * CAPTURE_SEGMENT_BYTES;
+    if (!region.read(base, &h, sizeof(h)) || h.magic != RAW_SLOT_MAGIC || h.id != id) return 0;
+    uint32_t size = h.size == 0xFFFFFFFF ? 0 : h.size;
+    if (offset >= size) return 0;
+    if (len > size - offset) len = size - offset;
+    return region.read(base + sizeof(h) + offset, dst, len) ? len : 0;
+  }
+
+  bool removeClosed(uint32_t id) override {
+    return region.erase((id % slots) * CAPTURE_SEGMENT_BYTES, FLASH_SECTOR_SIZE);
+  }
+
+private:
+  const char* hostPath;
+  size_t hostSize;
+  FlashRegion region;
+  uint32_t slots = 0;
+  size_t slotBase = 0;
+  size_t writePos = 0;
+  size_t erasedTo = 0;
+};
+
+// =================================================================
+// FILESYSTEM BACKEND (LittleFS, FFat, SD, SD_MMC)
+// =================================================================
+#ifdef ARDUINO
+
+#define CAPTURE_DIR "/cap"
+
+class FsCaptureStorage : public CaptureStorage {
+public:
+  FsCaptureStorage(const char* name, fs::FS& fs, bool (*mountFs)(), uint64_t (*volumeBytes)())
+    : label(name), fs(fs), mountFs(mountFs), volumeBytes(volumeBytes) {}
+  const char* name() const override { return label; }
+
+protected:
+  bool mount() override {
+    if (!mountFs()) return false;
+    if (!fs.exists(CAPTURE_DIR)) fs.mkdir(CAPTURE_DIR);
+    // Small volumes (4 MB layout) still hold a few segments, so dropping
+    // the oldest one frees room
+    uint64_t quarter = volumeBytes() / 4;
+    limit = quarter < CAPTURE_SEGMENT_BYTES ? (size_t)quarter : CAPTURE_SEGMENT_BYTES;
+    if (limit < 2 * CAPTURE_BATCH_BYTES) limit = 2 * CAPTURE_BATCH_BYTES;
+    return true;
+  }
+
+  size_t segmentLimit() const override { return limit; }
+
+  int scanSegments(SegmentInfo* out, int max, SegmentScan& scan) override {
+    int n = 0;
+    File dir = fs.open(CAPTURE_DIR);
+    if (!dir) return 0;
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+      const char* base = strrchr(f.name(), '/');
+      base = base ? base + 1 : f.name();
+      char* end;
+      unsigned long id = strtoul(base, &end, 10);
+      if (end != base && strcmp(end, ".bin") == 0) {
+        SegmentInfo info = {(uint32_t)id, (uint32_t)f.size()};
+        insertSorted(out, n, max, info, scan);
+      }
+    }
+    return n;
+  }
+
+  bool openSegment(uint32_t id) override {
+    char path[32];
+    segmentPath(id, path, sizeof(path));
+    file = fs.open(path, FILE_WRITE);
+    return (bool)file;
+  }
+
+  size_t writeSegment(const uint8_t* data, size_t len) override {
+    return file ? file.write(data, len) : 0;
+  }
+
+  void closeSegment() override {
+    if (file) file.close();
+  }
+
+  size_t readClosed(uint32_t id, uint32_t offset, void* dst, size_t len) override {
+    char path[32];
+    segmentPath(id, path, sizeof(path));
+    File f = fs.open(path, FILE_READ);
+    if (!f || !f.seek(offset)) return 0;
+    return f.read((uint8_t*)dst, len);
+  }
+
+  bool removeClosed(uint32_t id) override {
+    char path[32];
+    segmentPath(id, path, sizeof(path));
+    return fs.remove(path);
+  }
+
+private:
+  static void segmentPath(uint32_t id, char* buf, size_t len) {
+    snprintf(buf, len, CAPTURE_DIR "/%08lu.bin", (unsigned long)id);
+  }
+
+  const char* label;
+  fs::FS& fs;
+  bool (*mountFs)();
+  uint64_t (*volumeBytes)();
+  size_t limit = CAPTURE_SEGMENT_BYTES;
+  File file;
+};
+
+#endif
+
+#ifndef ARDUINO
+CaptureStorage* newHostCaptureStorage(const char* path, size_t size) {
+  return new RawCaptureStorage(path, size);
+}
+#endif
+
+// =================================================================
+// ENGINE SELECTION
+// =================================================================
+
+CaptureStorage& captureStorage() {
+#if !defined(ARDUINO) || CAPTURE_STORAGE == CAPTURE_STORAGE_RAW
+  static RawCaptureStorage storage;
+#elif CAPTURE_STORAGE == CAPTURE_STORAGE_LITTLEFS
+  static FsCaptureStorage storage("littlefs", LittleFS, [] {
+    return LittleFS.begin(true, "/littlefs", 4, CAPTURE_PARTITION_LABEL);
+  }, [] { return (uint64_t)LittleFS.totalBytes(); });
+#elif CAPTURE_STORAGE == CAPTURE_STORAGE_FFAT
+  static FsCaptureStorage storage("ffat", FFat, [] {
+    return FFat.begin(true, "/ffat", 4, CAPTURE_PARTITION_LABEL);
+  }, [] { return (uint64_t)FFat.totalBytes(); });
+#elif CAPTURE_STORAGE == CAPTURE_STORAGE_SD
+  static FsCaptureStorage storage("sd", SD, [] { return SD.begin(); },
+                                  [] { return SD.totalBytes(); });
+#elif CAPTURE_STORAGE == CAPTURE_STORAGE_SD_MMC
+  static FsCaptureStorage storage("sd_mmc", SD_MMC, [] { return SD_MMC.begin(); },
+                                  [] { return SD_MMC.totalBytes(); });
+#else
+#error "unknown CAPTURE_STORAGE"
+#endif
+  return storage;
+}
@@ -0,0 +1,191 @@
+#ifndef CAPTURE_STORAGE_H
+#define CAPTURE_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+// Capture storage engines, selected per build profile with
+// -D CAPTURE_STORAGE=CAPTURE_STORAGE_xxx (see platformio.ini)
+#define CAPTURE_STORAGE_LITTLEFS 1   // "capture" partition, subtype spiffs
+#define CAPTURE_STORAGE_FFAT 2       // "capture" partition, subtype fat
+#define CAPTURE_STORAGE_SD 3         // SD card over SPI
+#define CAPTURE_STORAGE_SD_MMC 4     // SD card over SDMMC
+#define CAPTURE_STORAGE_RAW 5        // raw ring of segment slots in "capture"
+
+#ifndef CAPTURE_STORAGE
+#define CAPTURE_STORAGE CAPTURE_STORAGE_LITTLEFS
+#endif
+
+#define CAPTURE_PARTITION_LABEL "capture"
+#define CAPTURE_BATCH_BYTES 4096
+#define CAPTURE_SEGMENT_BYTES (256 * 1024)
+
+// --- Record format ---
+// Every record in a segment starts with this header; len includes it.
+enum CaptureRecordType {
+  CAPTURE_WIFI_SURVEY = 1,
+  CAPTURE_BLE_SURVEY = 2,
+  CAPTURE_BTC_SURVEY = 3,
+  CAPTURE_WIFI_FRAME = 4,
+  CAPTURE_CODEC_BLOCK = 5,  // export stream only: records packed by ScanCodec.h
+  CAPTURE_RULE_EVENT = 6,   // export stream only: a rule fired (Rules.h)
+  CAPTURE_FLIGHT_EVENT = 7, // flight recorder dump; its records follow (FlightRecorder.h)
+  CAPTURE_RF_SUMMARY = 8    // export stream only: one channel's RF environment (RfTracker.h)
+};
+
+struct __attribute__((packed)) CaptureRecordHeader {
+  uint16_t len;
+  uint8_t type;
+  uint8_t reserved;
+  uint32_t timeMs;
+};
+
+// One device sighting from a completed scan
+struct __attribute__((packed)) SurveyRecord {
+  CaptureRecordHeader hdr;
+  uint8_t id[6];
+  int8_t rssi;
+  int8_t extra;   // WiFi channel, BLE TX power or BT major device class
+};
+
+// Longest 802.11 data MAC header: 24 bytes, a fourth address (6), QoS
+// control (2) and HT control (4, when the order bit is set)
+#define FRAME_MAC_HEADER_MAX 36
+
+// One 802.11 frame from promiscuous mode; the first bytes of the frame
+// (up to the snaplen) follow the record
+struct __attribute__((packed)) FrameRecord {
+  CaptureRecordHeader hdr;
+  uint8_t channel;
+  int8_t rssi;
+  uint8_t rate;
+  uint8_t frameType;   // wifi_promiscuous_pkt_type_t
+  uint16_t origLen;    // on-air length without FCS
+  uint16_t reserved;
+};
+
+// A rule with the export action fired on this report
+struct __attribute__((packed)) RuleEventRecord {
+  CaptureRecordHeader hdr;
+  uint8_t id[6];
+  int8_t rssi;
+  uint8_t source;      // RuleSource bit
+  char rule[12];       // rule name, NUL padded
+};
+
+// Heads a flight recorder dump: `bytes` of records timed fromMs to toMs
+// follow in order. Live records written meanwhile may sit between them;
+// those are newer than toMs. hdr.timeMs is the trigger time
+struct __attribute__((packed)) FlightEventRecord {
+  CaptureRecordHeader hdr;
+  uint32_t fromMs;
+  uint32_t toMs;
+  uint32_t bytes;
+  uint8_t reason;      // FlightTrigger
+  uint8_t truncated;   // the window was cut short to keep live capture going
+  uint16_t reserved;
+  char note[12];       // rule name, NUL padded
+};
+
+// Noise floor and RSSI quantiles in dBm and the PHY mix of one channel,
+// faded over RF_HALF_LIFE_MS
+struct __attribute__((packed)) RfSummaryRecord {
+  CaptureRecordHeader hdr;
+  uint8_t channel;
+  int8_t noiseP50;     // 0 if the radio reported none
+  int8_t noiseP90;
+  int8_t rssiP10;
+  int8_t rssiP50;
+  int8_t rssiP90;
+  uint8_t mixPct[5];   // 11b, 11g, HT20, HT40, other
+  uint8_t legacyRate;  // median non-HT rate in 500 kbps units
+  int8_t mcs;          // median HT MCS, -1 if none
+  uint8_t reserved;
+  uint32_t frames;     // since boot
+};
+
+struct SegmentInfo {
+  uint32_t id;
+  uint32_t size;
+};
+
+// Append-only capture log split into numbered segments. Writes are
+// batched in RAM and handed to the backend CAPTURE_BATCH_BYTES at a time;
+// a segment is closed once it reaches the backend's segment limit and the
+// oldest closed segment is dropped when the medium is full. Closed
+// segments can be listed and read back by offset (USB, upload, export).
+class CaptureStorage {
+public:
+  virtual ~CaptureStorage() {}
+  virtual const char* name() const = 0;
+
+  bool begin();
+  bool ready() const { return mounted; }
+
+  bool append(const void* data, size_t len);
+  // Whole records written from the caller's memory, past the batch
+  bool appendBlock(const void* data, size_t len);
+  bool flush();
+  bool rotate();
+
+  uint32_t currentSegment() const { return currentId; }
+  uint64_t bytesWritten() const { return totalBytes; }
+
+  // Closed segments, oldest first; returns the number filled in. With
+  // after, only those with a higher id: walking a large medium in pages
+  int listSegments(SegmentInfo* out, int max) { return listSegments(0, out, max); }
+  int listSegments(uint32_t after, SegmentInfo* out, int max);
+  // The newest max closed segments, oldest first; total, if given, gets
+  // the number of closed segments on the medium
+  int listNewestSegments(SegmentInfo* out, int max, uint32_t* total = nullptr);
+  size_t readSegment(uint32_t id, uint32_t offset, void* dst, size_t len);
+  bool removeSegment(uint32_t id);
+
+protected:
+  struct SegmentScan {
+    uint32_t after = 0;        // only ids above this
+    bool keepNewest = false;   // keep the newest max rather than the oldest
+    uint32_t newest = 0;       // out: highest id seen
+    uint32_t total = 0;        // out: segments with an id above after
+  };
+
+  virtual bool mount() = 0;
+  virtual size_t segmentLimit() const { return CAPTURE_SEGMENT_BYTES; }
+  // Every segment on the medium that scan selects, including a stale open
+  // one, oldest first (max of them, see SegmentScan)
+  virtual int scanSegments(SegmentInfo* out, int max, SegmentScan& scan) = 0;
+  // For scanSegments: files one segment found on the medium
+  static void insertSorted(SegmentInfo* segs, int& n, int max, const SegmentInfo& s, SegmentScan& scan);
+  virtual bool openSegment(uint32_t id) = 0;
+  // Appends to the open segment; returns the bytes written, short when full
+  virtual size_t writeSegment(const uint8_t* data, size_t len) = 0;
+  virtual void closeSegment() = 0;
+  virtual size_t readClosed(uint32_t id, uint32_t offset, void* dst, size_t len) = 0;
+  virtual bool removeClosed(uint32_t id) = 0;
+
+private:
+  size_t writeLocked(const uint8_t* data, size_t len);
+  bool writeRecordLocked(const uint8_t* data, size_t len);
+  bool flushLocked();
+  bool rotateLocked();
+  bool dropOldestLocked();
+
+  std::mutex lock;
+  bool mounted = false;
+  uint8_t batch[CAPTURE_BATCH_BYTES];
+  size_t batchLen = 0;
+  uint32_t currentId = 0;
+  size_t currentSize = 0;
+  uint64_t totalBytes = 0;
+};
+
+// The engine chosen by CAPTURE_STORAGE (not yet mounted)
+CaptureStorage& captureStorage();
+
+#ifndef ARDUINO
+// Host stand-in: the raw ring engine over a file of the given size
+CaptureStorage* newHostCaptureStorage(const char* path, size_t size);
+#endif
+
+#endif
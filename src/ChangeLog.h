@@ -0,0 +1,130 @@
+#ifndef CHANGE_LOG_H
+#define CHANGE_LOG_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+enum ChangeKind {
+  CHANGE_INSERT,
+  CHANGE_UPDATE,
+  CHANGE_EVICT
+};
+
+// Fixed-size ring of device table changes, numbered by a monotonically
+// increasing sequence (1, 2, ...). Written by the single scanner task and
+// read concurrently by exporters: every slot is a small seqlock, so a
+// reader detects an entry that was overwritten while it was reading.
+template <int N>
+class ChangeLog {
+public:
+  ChangeLog() : last(0) {
+    for (int i = 0; i < N; i++) slots[i].seq.store(0);
+  }
+
+  uint32_t lastSeq() const { return last.load(); }
+
+  // Oldest sequence number still retained
+  uint32_t firstSeq() const {
+    uint32_t l = last.load();
+    return l > (uint32_t)N ? l - N + 1 : 1;
+  }
+
+  uint32_t append(ChangeKind kind, const uint8_t id[6]) {
+    uint32_t seq = last.load() + 1;
+    Slot& s = slots[seq % N];
+    s.seq.store(0);
+    s.lo.store((uint32_t)id[0] | (uint32_t)id[1] << 8 | (uint32_t)id[2] << 16 | (uint32_t)id[3] << 24);
+    s.hi.store((uint32_t)id[4] | (uint32_t)id[5] << 8 | (uint32_t)kind << 16);
+    s.seq.store(seq);
+    last.store(seq);
+    return seq;
+  }
+
+  // Copies out the entry with the given sequence number; false once it
+  // has been overwritten (or was never written).
+  bool get(uint32_t seq, ChangeKind& kind, uint8_t id[6]) const {
+    const Slot& s = slots[seq % N];
+    if (s.seq.load() != seq) return false;
+    uint32_t lo = s.lo.load();
+    uint32_t hi = s.hi.load();
+    if (s.seq.load() != seq) return false;
+    id[0] = lo; id[1] = lo >> 8; id[2] = lo >> 16; id[3] = lo >> 24;
+    id[4] = hi; id[5] = hi >> 8;
+    kind = (ChangeKind)((hi >> 16) & 0xFF);
+    return true;
+  }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> lo;
+    std::atomic<uint32_t> hi;
+  };
+  Slot slots[N];
+  std::atomic<uint32_t> last;
+};
+
+// Linear lookup; tables hold a few dozen entries
+template <typename Table>
+const typename Table::Record* findById(const Table& table, const uint8_t id[6]) {
+  for (int i = 0; i < table.count; i++) {
+    if (memcmp(table.items[i].id, id, 6) == 0) return &table.items[i];
+  }
+  return nullptr;
+}
+
+// Diffs a freshly scanned table against the previously published one and
+// stamps every entry with the sequence number of its last significant
+// change. Records need `uint8_t id[6]` and `uint32_t seq`, and a
+// significantChange(old, new) overload decides what counts as an update.
+template <typename Table, int N>
+void stampChanges(const Table& prev, Table& next, ChangeLog<N>& log) {
+  for (int i = 0; i < next.count; i++) {
+    const typename Table::Record* old = findById(prev, next.items[i].id);
+    if (!old) {
+      next.items[i].seq = log.append(CHANGE_INSERT, next.items[i].id);
+    } else if (significantChange(*old, next.items[i])) {
+      next.items[i].seq = log.append(CHANGE_UPDATE, next.items[i].id);
+    } else {
+      next.items[i].seq = old->seq;
+    }
+  }
+  for (int i = 0; i < prev.count; i++) {
+    if (!findById(next, prev.items[i].id)) log.append(CHANGE_EVICT, prev.items[i].id);
+  }
+  next.seq = log.lastSeq();
+}
+
+// Replays the changes in (since, table.seq] against a pinned table version.
+// Inserts/updates are reported once, with the entry's current contents;
+// evictions are reported unless the id was re-inserted afterwards.
+// Returns false when `since` is outside the retained log, in which case
+// the caller must fall back to a full snapshot. Output produced before a
+// late false is harmless: every change is an idempotent upsert/evict.
+template <typename Table, int N, typename Visitor>
+bool forEachChangeSince(const ChangeLog<N>& log, const Table& table, uint32_t since, Visitor& visit) {
+  if (since > table.seq) return false;
+  if (since == table.seq) return true;
+  if (since + 1 < log.firstSeq()) return false;
+
+  for (uint32_t seq = since + 1; seq <= table.seq; seq++) {
+    ChangeKind kind;
+    uint8_t id[6];
+    if (!log.get(seq, kind, id)) return false;
+    const typename Table::Record* rec = findById(table, id);
+    if (kind == CHANGE_EVICT) {
+      if (!rec || rec->seq < seq) visit.evict(seq, id);
+    } else if (rec && rec->seq == seq) {
+      visit.upsert(*rec);
+    }
+  }
+
+  // Slots are overwritten oldest first: if the first one survived, none
+  // of the later ones changed underneath us.
+  ChangeKind kind;
+  uint8_t id[6];
+  return log.get(since + 1, kind, id);
+}
+
+#endif
@@ -0,0 +1,173 @@
+#include "ConfigStore.h"
+#include <string.h>
+#include <stdio.h>
+
+#ifdef ARDUINO
+#include <nvs.h>
+#include <nvs_flash.h>
+#else
+#include <map>
+#include <string>
+
+// Host stand-in for the few NVS calls used here: one namespace in memory,
+// kept for the life of the process
+typedef uint32_t nvs_handle_t;
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+#define NVS_READWRITE 1
+
+static std::map<std::string, std::string> hostNvs;
+static uint32_t hostWrites;
+
+static esp_err_t nvs_open(const char*, int, nvs_handle_t* h) {
+  *h = 1;
+  return ESP_OK;
+}
+
+static esp_err_t hostGet(const char* key, void* dst, size_t len) {
+  auto it = hostNvs.find(key);
+  if (it == hostNvs.end()) return ESP_ERR_NVS_NOT_FOUND;
+  if (it->second.size() != len) return ESP_ERR_NVS_INVALID_LENGTH;
+  memcpy(dst, it->second.data(), len);
+  return ESP_OK;
+}
+
+static esp_err_t hostSet(const char* key, const void* src, size_t len) {
+  hostNvs[key] = std::string((const char*)src, len);
+  hostWrites++;
+  return ESP_OK;
+}
+
+static esp_err_t nvs_get_u8(nvs_handle_t, const char* key, uint8_t* v) { return hostGet(key, v, 1); }
+static esp_err_t nvs_get_u16(nvs_handle_t, const char* key, uint16_t* v) { return hostGet(key, v, 2); }
+static esp_err_t nvs_set_u8(nvs_handle_t, const char* key, uint8_t v) { return hostSet(key, &v, 1); }
+static esp_err_t nvs_set_u16(nvs_handle_t, const char* key, uint16_t v) { return hostSet(key, &v, 2); }
+static esp_err_t nvs_set_str(nvs_handle_t, const char* key, const char* v) {
+  return hostSet(key, v, strlen(v) + 1);
+}
+static esp_err_t nvs_commit(nvs_handle_t) { return ESP_OK; }
+
+static esp_err_t nvs_get_str(nvs_handle_t, const char* key, char* dst, size_t* len) {
+  auto it = hostNvs.find(key);
+  if (it == hostNvs.end()) return ESP_ERR_NVS_NOT_FOUND;
+  if (it->second.size() > *len) return ESP_ERR_NVS_INVALID_LENGTH;
+  memcpy(dst, it->second.data(), it->second.size());
+  *len = it->second.size();
+  return ESP_OK;
+}
+
+uint32_t configStoreHostWrites() {
+  return hostWrites;
+}
+
+void configStoreHostErase() {
+  hostNvs.clear();
+}
+#endif
+
+ConfigStore configStore;
+
+static void loadStr(nvs_handle_t h, const char* key, char* dst, size_t cap) {
+  size_t len = cap;
+  char tmp[CONFIG_RULES_BYTES];
+  if (len > sizeof(tmp)) len = sizeof(tmp);
+  if (nvs_get_str(h, key, tmp, &len) == ESP_OK) snprintf(dst, cap, "%s", tmp);
+}
+
+bool ConfigStore::begin(const Config& defaults) {
+  std::lock_guard<std::mutex> guard(lock);
+  current = defaults;
+  nvs_handle_t h;
+  if (nvs_open(CONFIG_NAMESPACE, NVS_READWRITE, &h) != ESP_OK) {
+    stored = current;
+    return false;
+  }
+  handle = h;
+  uint8_t u8;
+  nvs_get_u16(h, "scan", &current.scanIntervalS);
+  loadStr(h, "stream", current.stream, sizeof(current.stream));
+  if (nvs_get_u8(h, "codec", &u8) == ESP_OK) current.codec = u8;
+  loadStr(h, "chost", current.collectorHost, sizeof(current.collectorHost));
+  nvs_get_u16(h, "cport", &current.collectorPort);
+  loadStr(h, "appass", current.apPassword, sizeof(current.apPassword));
+  loadStr(h, "upurl", current.uploadUrl, sizeof(current.uploadUrl));
+  loadStr(h, "wssid", current.staSsid, sizeof(current.staSsid));
+  loadStr(h, "wpass", current.staPassword, sizeof(current.staPassword));
+  nvs_get_u16(h, "snapm", &current.snapMgmt);
+  nvs_get_u16(h, "snapd", &current.snapData);
+  loadStr(h, "rules", current.rules, sizeof(current.rules));
+  // Defaults are not written until something is edited
+  stored = current;
+  return true;
+}
+
+void ConfigStore::get(Config& out) {
+  std::lock_guard<std::mutex> guard(lock);
+  out = current;
+}
+
+void ConfigStore::update(const Config& next, uint32_t nowMs) {
+  std::lock_guard<std::mutex> guard(lock);
+  current = next;
+  if (!pending) firstEditMs = nowMs;
+  lastEditMs = nowMs;
+  pending = true;
+}
+
+void ConfigStore::tick(uint32_t nowMs) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!pending) return;
+  if (nowMs - lastEditMs < CONFIG_SETTLE_MS && nowMs - firstEditMs < CONFIG_MAX_DELAY_MS) return;
+  writeLocked();
+}
+
+void ConfigStore::flush() {
+  std::lock_guard<std::mutex> guard(lock);
+  if (pending) writeLocked();
+}
+
+// Only changed keys, then one commit
+void ConfigStore::writeLocked() {
+  pending = false;
+  if (!handle) return;
+  nvs_handle_t h = handle;
+  bool changed = false;
+  if (current.scanIntervalS != stored.scanIntervalS) {
+    changed |= nvs_set_u16(h, "scan", current.scanIntervalS) == ESP_OK;
+  }
+  if (strcmp(current.stream, stored.stream) != 0) {
+    changed |= nvs_set_str(h, "stream", current.stream) == ESP_OK;
+  }
+  if (current.codec != stored.codec) changed |= nvs_set_u8(h, "codec", current.codec) == ESP_OK;
+  if (strcmp(current.collectorHost, stored.collectorHost) != 0) {
+    changed |= nvs_set_str(h, "chost", current.collectorHost) == ESP_OK;
+  }
+  if (current.collectorPort != stored.collectorPort) {
+    changed |= nvs_set_u16(h, "cport", current.collectorPort) == ESP_OK;
+  }
+  if (strcmp(current.apPassword, stored.apPassword) != 0) {
+    changed |= nvs_set_str(h, "appass", current.apPassword) == ESP_OK;
+  }
+  if (strcmp(current.uploadUrl, stored.uploadUrl) != 0) {
+    changed |= nvs_set_str(h, "upurl", current.uploadUrl) == ESP_OK;
+  }
+  if (strcmp(current.staSsid, stored.staSsid) != 0) {
+    changed |= nvs_set_str(h, "wssid", current.staSsid) == ESP_OK;
+  }
+  if (strcmp(current.staPassword, stored.staPassword) != 0) {
+    changed |= nvs_set_str(h, "wpass", current.staPassword) == ESP_OK;
+  }
+  if (current.snapMgmt != stored.snapMgmt) {
+    changed |= nvs_set_u16(h, "snapm", current.snapMgmt) == ESP_OK;
+  }
+  if (current.snapData != stored.snapData) {
+    changed |= nvs_set_u16(h, "snapd", current.snapData) == ESP_OK;
+  }
+  if (strcmp(current.rules, stored.rules) != 0) {
+    changed |= nvs_set_str(h, "rules", current.rules) == ESP_OK;
+  }
+  if (changed && nvs_commit(h) == ESP_OK) commitCount++;
+  stored = current;
+}
@@ -0,0 +1,67 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+// Runtime settings, kept in NVS namespace CONFIG_NAMESPACE. Edits (config
+// portal, serial) only change the RAM copy; tick() writes them once they
+// have settled for CONFIG_SETTLE_MS, or at the latest CONFIG_MAX_DELAY_MS
+// after the first one, so a burst of form submits costs one NVS commit
+// and only keys that actually changed are rewritten.
+
+#define CONFIG_NAMESPACE "wscan"
+#define CONFIG_SETTLE_MS 1500
+#define CONFIG_MAX_DELAY_MS 10000
+#define CONFIG_RULES_BYTES 1024
+
+struct Config {
+  uint16_t scanIntervalS;          // list refresh while a scan list is shown
+  char stream[8];                  // export transport, "off" for none
+  bool codec;                      // pack streamed records (ScanCodec.h)
+  char collectorHost[40];          // sensor nodes: until one is discovered
+  uint16_t collectorPort;
+  char apPassword[24];             // config portal; empty = open network
+  char uploadUrl[64];              // segment upload (SegmentUpload.h), empty = off
+  char staSsid[33];                // WiFi backhaul for uploads
+  char staPassword[64];
+  uint16_t snapMgmt;               // sensor nodes: captured bytes per frame type
+  uint16_t snapData;
+  char rules[CONFIG_RULES_BYTES];  // one rule per line (Rules.h)
+};
+
+class ConfigStore {
+public:
+  // Loads every stored key over the given defaults
+  bool begin(const Config& defaults);
+  void get(Config& out);
+  void update(const Config& next, uint32_t nowMs);
+  void tick(uint32_t nowMs);   // from the UI loop
+  void flush();
+
+  uint32_t commits() const { return commitCount; }
+  bool dirty() const { return pending; }
+
+private:
+  void writeLocked();
+
+  std::mutex lock;
+  Config current;
+  Config stored;   // what NVS holds
+  bool pending = false;
+  uint32_t firstEditMs = 0;
+  uint32_t lastEditMs = 0;
+  uint32_t commitCount = 0;
+  uint32_t handle = 0;
+};
+
+extern ConfigStore configStore;
+
+#ifndef ARDUINO
+// Host stand-in for NVS: keys written since start, and wiping them all
+uint32_t configStoreHostWrites();
+void configStoreHostErase();
+#endif
+
+#endif
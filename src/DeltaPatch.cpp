@@ -0,0 +1,197 @@
+#include "DeltaPatch.h"
+#include <string.h>
+#include <stdio.h>
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+DeltaPatcher::DeltaPatcher(PatchSource& source, PatchSink& sink)
+  : source(source), sink(sink), state(HEADER), err(nullptr), need(sizeof(DeltaHeader)),
+    have(0), op(0), outPos(0), windowFill(0) {}
+
+DeltaPatcher::Status DeltaPatcher::fail(const char* message) {
+  state = FAILED;
+  err = message;
+  return PATCH_ERROR;
+}
+
+DeltaPatcher::Status DeltaPatcher::feed(const uint8_t* data, size_t len) {
+  while (len > 0 && state != DONE && state != FAILED) {
+    switch (state) {
+      case HEADER: {
+        size_t n = len < need ? len : need;
+        memcpy((uint8_t*)&hdr + have, data, n);
+        have += n;
+        need -= n;
+        data += n;
+        len -= n;
+        if (need > 0) break;
+        if (memcmp(hdr.magic, DELTA_MAGIC, 4) != 0) return fail("not a delta patch");
+        if (!sink.begin(hdr)) return fail("rejected by target");
+        state = OP;
+        break;
+      }
+
+      case OP:
+        op = *data++;
+        len--;
+        have = 0;
+        if (op == DELTA_OP_END) {
+          if (!flush()) return PATCH_ERROR;
+          if (outPos != hdr.newSize) return fail("patch ended early");
+          state = DONE;
+        } else if (op == DELTA_OP_COPY) {
+          need = 8;
+          state = ARGS;
+        } else if (op == DELTA_OP_ADD) {
+          need = 4;
+          state = ARGS;
+        } else {
+          return fail("bad op");
+        }
+        break;
+
+      case ARGS: {
+        size_t n = len < need ? len : need;
+        memcpy(args + have, data, n);
+        have += n;
+        need -= n;
+        data += n;
+        len -= n;
+        if (need > 0) break;
+        if (op == DELTA_OP_COPY) {
+          if (!runCopy(get32(args), get32(args + 4))) return PATCH_ERROR;
+          state = OP;
+        } else {
+          need = get32(args);
+          if (need > hdr.newSize - outPos) return fail("output overrun");
+          state = need ? LITERAL : OP;
+        }
+        break;
+      }
+
+      case LITERAL: {
+        size_t n = len < need ? len : need;
+        if (!emit(data, n)) return PATCH_ERROR;
+        need -= n;
+        data += n;
+        len -= n;
+        if (need == 0) state = OP;
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+  if (len > 0 && state == DONE) return fail("trailing data");
+  return status();
+}
+
+// Copied ranges go through the window in DELTA_WINDOW pieces
+bool DeltaPatcher::runCopy(uint32_t offset, uint32_t len) {
+  if (offset > hdr.oldSize || len > hdr.oldSize - offset) {
+    fail("copy outside old image");
+    return false;
+  }
+  if (len > hdr.newSize - outPos) {
+    fail("output overrun");
+    return false;
+  }
+  while (len > 0) {
+    if (windowFill == DELTA_WINDOW && !flush()) return false;
+    size_t n = DELTA_WINDOW - windowFill;
+    if (n > len) n = len;
+    if (!source.read(offset, window + windowFill, n)) {
+      fail("old image read failed");
+      return false;
+    }
+    windowFill += n;
+    outPos += n;
+    offset += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool DeltaPatcher::emit(const uint8_t* data, size_t len) {
+  while (len > 0) {
+    if (windowFill == DELTA_WINDOW && !flush()) return false;
+    size_t n = DELTA_WINDOW - windowFill;
+    if (n > len) n = len;
+    memcpy(window + windowFill, data, n);
+    windowFill += n;
+    outPos += n;
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool DeltaPatcher::flush() {
+  if (windowFill > 0 && !sink.write(window, windowFill)) {
+    fail("write failed");
+    return false;
+  }
+  windowFill = 0;
+  return true;
+}
+
+// =================================================================
+// HOST STAND-IN
+// =================================================================
+#ifndef ARDUINO
+
+class FileSource : public PatchSource {
+public:
+  explicit FileSource(FILE* f) : f(f) {}
+  bool read(uint32_t offset, uint8_t* dst, size_t len) override {
+    return fseek(f, offset, SEEK_SET) == 0 && fread(dst, 1, len, f) == len;
+  }
+
+private:
+  FILE* f;
+};
+
+// No MD5 on the host: the base is only checked by size here, the hashes
+// by tools/mkdelta.py apply
+class FileSink : public PatchSink {
+public:
+  FileSink(FILE* f, long oldSize) : f(f), oldSize(oldSize) {}
+  bool begin(const DeltaHeader& header) override { return header.oldSize == (uint32_t)oldSize; }
+  bool write(const uint8_t* data, size_t len) override { return fwrite(data, 1, len, f) == len; }
+
+private:
+  FILE* f;
+  long oldSize;
+};
+
+bool applyPatchFiles(const char* oldPath, const char* patchPath, const char* outPath,
+                     const char** error) {
+  FILE* oldFile = fopen(oldPath, "rb");
+  FILE* patchFile = fopen(patchPath, "rb");
+  FILE* outFile = fopen(outPath, "wb");
+  bool ok = false;
+  *error = "cannot open files";
+  if (oldFile && patchFile && outFile) {
+    FileSource source(oldFile);
+    fseek(oldFile, 0, SEEK_END);
+    FileSink sink(outFile, ftell(oldFile));
+    DeltaPatcher* patcher = new DeltaPatcher(source, sink);
+    uint8_t buf[1000];  // odd size: ops straddle reads
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), patchFile)) > 0) {
+      if (patcher->feed(buf, n) == DeltaPatcher::PATCH_ERROR) break;
+    }
+    ok = patcher->status() == DeltaPatcher::PATCH_DONE;
+    *error = ok ? nullptr : patcher->error() ? patcher->error() : "truncated patch";
+    delete patcher;
+  }
+  if (oldFile) fclose(oldFile);
+  if (patchFile) fclose(patchFile);
+  if (outFile) fclose(outFile);
+  return ok;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Block-level firmware delta, generated on the host by tools/mkdelta.py:
+//
+//   header  "WDP1", u32 oldSize, u32 newSize, u8 oldMd5[16], u8 newMd5[16]
+//   ops     u8 DELTA_OP_COPY, u32 srcOffset, u32 len   bytes of the old image
+//           u8 DELTA_OP_ADD,  u32 len, len bytes       literal bytes
+//           u8 DELTA_OP_END
+//
+// All integers little endian. The patch is applied as it streams in:
+// literal bytes and copied ranges pass through one DELTA_WINDOW buffer,
+// so RAM use does not depend on image or patch size.
+
+#define DELTA_MAGIC "WDP1"
+#define DELTA_WINDOW 4096
+
+enum DeltaOp {
+  DELTA_OP_END = 0,
+  DELTA_OP_COPY = 1,
+  DELTA_OP_ADD = 2
+};
+
+struct __attribute__((packed)) DeltaHeader {
+  char magic[4];
+  uint32_t oldSize;
+  uint32_t newSize;
+  uint8_t oldMd5[16];
+  uint8_t newMd5[16];
+};
+
+// The image the patch was made against (the running firmware)
+class PatchSource {
+public:
+  virtual ~PatchSource() {}
+  virtual bool read(uint32_t offset, uint8_t* dst, size_t len) = 0;
+};
+
+// Where the new image goes (the inactive OTA partition)
+class PatchSink {
+public:
+  virtual ~PatchSink() {}
+  // Called once the header is in; false rejects the patch
+  virtual bool begin(const DeltaHeader& header) = 0;
+  virtual bool write(const uint8_t* data, size_t len) = 0;
+};
+
+class DeltaPatcher {
+public:
+  enum Status {
+    PATCH_MORE,    // feed more bytes
+    PATCH_DONE,    // END seen and every output byte written
+    PATCH_ERROR
+  };
+
+  DeltaPatcher(PatchSource& source, PatchSink& sink);
+
+  Status feed(const uint8_t* data, size_t len);
+  Status status() const { return state == DONE ? PATCH_DONE : state == FAILED ? PATCH_ERROR : PATCH_MORE; }
+  const char* error() const { return err; }
+  uint32_t written() const { return outPos; }
+  const DeltaHeader& header() const { return hdr; }
+
+private:
+  enum State { HEADER, OP, ARGS, LITERAL, DONE, FAILED };
+
+  bool runCopy(uint32_t offset, uint32_t len);
+  bool emit(const uint8_t* data, size_t len);
+  bool flush();
+  Status fail(const char* message);
+
+  PatchSource& source;
+  PatchSink& sink;
+  State state;
+  const char* err;
+  DeltaHeader hdr;
+  uint8_t args[8];
+  size_t need;          // bytes still expected for HEADER/ARGS/LITERAL
+  size_t have;          // bytes collected for HEADER/ARGS
+  uint8_t op;
+  uint32_t outPos;      // output bytes produced so far
+  uint8_t window[DELTA_WINDOW];
+  size_t windowFill;
+};
+
+#ifndef ARDUINO
+// Host stand-in: applies a patch file to an old image file
+bool applyPatchFiles(const char* oldPath, const char* patchPath, const char* outPath,
+                     const char** error);
+#endif
+
+#endif
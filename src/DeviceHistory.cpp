@@ -0,0 +1,358 @@
+#include "DeviceHistory.h"
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#define HISTORY_MAGIC 0x32494857  // "WHI2"
+
+DeviceHistory deviceHistory;
+
+static uint32_t crc32(const uint8_t* p, size_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+  while (len--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+uint32_t historyClockMinutes() {
+  time_t now = time(nullptr);
+  if (now / 60 >= HISTORY_WALL_MINUTES) return (uint32_t)(now / 60);
+#ifdef ARDUINO
+  if (!deviceHistory.ready()) return 0;
+  return deviceHistory.resumeMinutes() + millis() / 60000;
+#else
+  return 0;
+#endif
+}
+
+DeviceHistory::DeviceHistory()
+  : halfBytes(0), logBytes(0), capacity(0), logCapacity(0), activeHalf(0),
+    baseRecords(nullptr), logRecords(nullptr),
+    logCount(0), compactions(0), dropped(0), skipped(0), resumeAt(1), compacting(false),
+    pendingCount(0) {
+  memset(&active, 0, sizeof(active));
+}
+
+bool DeviceHistory::begin(const char* hostPath, size_t hostSize) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!region.open(HISTORY_PARTITION_LABEL, hostPath, hostSize)) return false;
+  if (region.length() < HISTORY_MIN_BYTES) {
+    region.close();
+    return false;
+  }
+
+  logBytes = region.length() / 4 / HISTORY_SECTOR_SIZE * HISTORY_SECTOR_SIZE;
+  if (logBytes > HISTORY_LOG_BYTES) logBytes = HISTORY_LOG_BYTES;
+  halfBytes = (region.length() - logBytes) / 2 / HISTORY_SECTOR_SIZE * HISTORY_SECTOR_SIZE;
+  capacity = (halfBytes - HISTORY_SECTOR_SIZE) / sizeof(HistoryRecord);
+  logCapacity = logBytes / sizeof(HistoryRecord);
+
+  // Newest valid base wins
+  BaseHeader h[2];
+  bool valid[2] = {readHeader(0, h[0]), readHeader(1, h[1])};
+  if (valid[0] && (!valid[1] || h[0].generation >= h[1].generation)) {
+    activeHalf = 0;
+    active = h[0];
+  } else if (valid[1]) {
+    activeHalf = 1;
+    active = h[1];
+  } else {
+    activeHalf = 0;
+    active.magic = HISTORY_MAGIC;
+    active.generation = 0;
+    active.count = 0;
+    active.newest = 0;
+  }
+  logRecords = (const HistoryRecord*)region.mapWindow(1, 2 * halfBytes, logBytes);
+  if (!logRecords || !mapBase(activeHalf)) {
+    region.close();
+    return false;
+  }
+
+  // The log is filled front to back, so its end is the first erased slot
+  const HistoryRecord* logRec = logRecords;
+  uint32_t lo = 0, hi = logCapacity;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (logRec[mid].flags != 0xFF) lo = mid + 1;
+    else hi = mid;
+  }
+  logCount = lo;
+
+  uint32_t newest = active.newest;
+  for (uint32_t i = 0; i < logCount; i++) {
+    if (logRec[i].flags == HISTORY_RECORD_VALID && logRec[i].lastSeen > newest) newest = logRec[i].lastSeen;
+  }
+  resumeAt = newest + 1;
+  return true;
+}
+
+bool DeviceHistory::readHeader(int half, BaseHeader& out) const {
+  region.read(half * halfBytes, &out, sizeof(out));
+  return out.magic == HISTORY_MAGIC &&
+         out.count <= capacity &&
+         out.crc == crc32((const uint8_t*)&out, offsetof(BaseHeader, crc));
+}
+
+bool DeviceHistory::mapBase(int half) {
+  baseRecords = (const HistoryRecord*)region.mapWindow(
+    0, half * halfBytes + HISTORY_SECTOR_SIZE, halfBytes - HISTORY_SECTOR_SIZE);
+  return baseRecords != nullptr;
+}
+
+const HistoryRecord* DeviceHistory::findLocked(const uint8_t mac[6]) const {
+  for (uint32_t i = pendingCount; i-- > 0;) {
+    if (memcmp(pending[i].mac, mac, 6) == 0) return &pending[i];
+  }
+
+  const HistoryRecord* logRec = logRecords;
+  for (uint32_t i = logCount; i-- > 0;) {
+    if (logRec[i].flags == HISTORY_RECORD_VALID && memcmp(logRec[i].mac, mac, 6) == 0) {
+      return &logRec[i];
+    }
+  }
+
+  const HistoryRecord* base = baseRecords;
+  uint32_t lo = 0, hi = active.count;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    int c = memcmp(base[mid].mac, mac, 6);
+    if (c == 0) return &base[mid];
+    if (c < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return nullptr;
+}
+
+bool DeviceHistory::lookup(const uint8_t mac[6], HistoryRecord& out) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!ready()) return false;
+  const HistoryRecord* rec = findLocked(mac);
+  if (!rec) return false;
+  out = *rec;
+  return true;
+}
+
+void DeviceHistory::recordSighting(const uint8_t mac[6], uint32_t nowMinutes) {
+  std::unique_lock<std::mutex> guard(lock);
+  if (!ready() || nowMinutes == 0) return;
+  while (compacting && pendingCount >= HISTORY_PENDING_MAX) {
+    // Wait for the running compaction rather than lose the sighting
+    guard.unlock();
+    { std::lock_guard<std::mutex> wait(compactLock); }
+    guard.lock();
+  }
+
+  // Hour of day only means something on the wall clock
+  bool wall = nowMinutes >= HISTORY_WALL_MINUTES;
+  int hour = (nowMinutes / 60) % 24;
+  uint8_t bit = wall ? 1 << (hour % 8) : 0;
+  HistoryRecord rec;
+  const HistoryRecord* cur = findLocked(mac);
+  if (!cur) {
+    memset(&rec, 0, sizeof(rec));
+    memcpy(rec.mac, mac, 6);
+    rec.flags = HISTORY_RECORD_VALID;
+    rec.hours[hour / 8] = bit;
+    rec.count = 1;
+    rec.firstSeen = nowMinutes;
+    rec.lastSeen = nowMinutes;
+  } else {
+    rec = *cur;
+    bool newHour = (rec.hours[hour / 8] & bit) != bit;
+    // A clock behind the record (set back by SNTP) never moves it back
+    bool touch = nowMinutes > rec.lastSeen && nowMinutes - rec.lastSeen >= HISTORY_TOUCH_MINUTES;
+    if (!newHour && !touch) return;
+    if (touch && rec.count < 0xFFFF) rec.count++;
+    rec.hours[hour / 8] |= bit;
+    if (nowMinutes > rec.lastSeen) rec.lastSeen = nowMinutes;
+  }
+  if (!appendLocked(rec)) return;
+  guard.unlock();
+  compact();
+}
+
+// Returns true once the log is full and a compaction is due
+bool DeviceHistory::appendLocked(const HistoryRecord& rec) {
+  if (!compacting && logCount < logCapacity) {
+    region.write(2 * halfBytes + logCount * sizeof(HistoryRecord), &rec, sizeof(rec));
+    logCount++;
+  } else if (pendingCount < HISTORY_PENDING_MAX) {
+    pending[pendingCount++] = rec;
+  } else {
+    skipped++;
+  }
+  return !compacting && logCount >= logCapacity;
+}
+
+// Moves held sightings into the log as far as it has room
+void DeviceHistory::flushPendingLocked() {
+  uint32_t n = 0;
+  while (n < pendingCount && logCount < logCapacity) {
+    region.write(2 * halfBytes + logCount * sizeof(HistoryRecord), &pending[n], sizeof(HistoryRecord));
+    logCount++;
+    n++;
+  }
+  memmove(pending, pending + n, (pendingCount - n) * sizeof(HistoryRecord));
+  pendingCount -= n;
+}
+
+void DeviceHistory::compact() {
+  std::lock_guard<std::mutex> serial(compactLock);
+  int target;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!ready()) return;
+    compacting = true;   // the log and active base stay as they are until the switch
+    target = 1 - activeHalf;
+  }
+
+  BaseHeader h;
+  uint32_t lost = 0;
+  bool merged = mergeInto(target, h, lost);
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!merged) {
+      compacting = false;
+      flushPendingLocked();
+      return;
+    }
+    region.write(target * halfBytes, &h, sizeof(h));
+    if (!mapBase(target)) {
+      // The new base is on flash and wins at the next begin()
+      region.close();
+      compacting = false;
+      return;
+    }
+    activeHalf = target;
+    active = h;
+    logCount = 0;   // everything in it is in the new base now
+    compactions++;
+    dropped += lost;
+  }
+
+  // Replaying a stale log after a crash here is harmless: newest wins
+  region.erase(2 * halfBytes, logBytes);
+  std::lock_guard<std::mutex> guard(lock);
+  compacting = false;
+  flushPendingLocked();
+}
+
+// Merges the log into the given (inactive) base and fills in the header
+// that makes it active. Runs without the lock; only compact() changes the
+// log length or the active base while compacting is set.
+bool DeviceHistory::mergeInto(int target, BaseHeader& h, uint32_t& lost) {
+  const HistoryRecord* logRec = logRecords;
+  const HistoryRecord* base = baseRecords;
+
+  // Log entries sorted by MAC, newest last, then reduced to the newest
+  uint16_t* order = (uint16_t*)malloc(logCount * sizeof(uint16_t) + 1);
+  uint8_t* buf = (uint8_t*)malloc(HISTORY_SECTOR_SIZE);
+  if (!order || !buf) {
+    free(order);
+    free(buf);
+    return false;
+  }
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < logCount; i++) {
+    if (logRec[i].flags == HISTORY_RECORD_VALID) order[n++] = i;
+  }
+  std::stable_sort(order, order + n, [logRec](uint16_t a, uint16_t b) {
+    return memcmp(logRec[a].mac, logRec[b].mac, 6) < 0;
+  });
+  uint32_t unique = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (i + 1 < n && memcmp(logRec[order[i]].mac, logRec[order[i + 1]].mac, 6) == 0) continue;
+    order[unique++] = order[i];
+  }
+
+  size_t targetBase = target * halfBytes;
+  region.erase(targetBase, HISTORY_SECTOR_SIZE);  // invalidate old header first
+
+  const size_t perBuf = HISTORY_SECTOR_SIZE / sizeof(HistoryRecord);
+  size_t bufCount = 0;
+  size_t writeOffset = targetBase + HISTORY_SECTOR_SIZE;
+  size_t erasedTo = writeOffset;
+  uint32_t out = 0;
+  uint32_t newest = 0;
+  uint32_t freeSlots = capacity - active.count;
+
+  auto emit = [&](const HistoryRecord& rec) {
+    memcpy(buf + bufCount * sizeof(HistoryRecord), &rec, sizeof(HistoryRecord));
+    out++;
+    if (rec.lastSeen > newest) newest = rec.lastSeen;
+    if (++bufCount == perBuf) {
+      size_t len = bufCount * sizeof(HistoryRecord);
+      while (erasedTo < writeOffset + len) {
+        region.erase(erasedTo, HISTORY_SECTOR_SIZE);
+        erasedTo += HISTORY_SECTOR_SIZE;
+      }
+      region.write(writeOffset, buf, len);
+      writeOffset += len;
+      bufCount = 0;
+    }
+  };
+
+  uint32_t i = 0, j = 0;
+  while (i < active.count || j < unique) {
+    int c;
+    if (i >= active.count) c = 1;
+    else if (j >= unique) c = -1;
+    else c = memcmp(base[i].mac, logRec[order[j]].mac, 6);
+
+    if (c < 0) {
+      emit(base[i++]);
+    } else if (c == 0) {
+      emit(logRec[order[j++]]);
+      i++;
+    } else {
+      // Existing devices always survive; new ones only while there is room
+      if (freeSlots > 0) {
+        emit(logRec[order[j]]);
+        freeSlots--;
+      } else {
+        lost++;
+      }
+      j++;
+    }
+  }
+  if (bufCount > 0) {
+    size_t len = bufCount * sizeof(HistoryRecord);
+    while (erasedTo < writeOffset + len) {
+      region.erase(erasedTo, HISTORY_SECTOR_SIZE);
+      erasedTo += HISTORY_SECTOR_SIZE;
+    }
+    region.write(writeOffset, buf, len);
+  }
+
+  h.magic = HISTORY_MAGIC;
+  h.generation = active.generation + 1;
+  h.count = out;
+  h.newest = newest;
+  h.crc = crc32((const uint8_t*)&h, offsetof(BaseHeader, crc));
+
+  free(order);
+  free(buf);
+  return true;
+}
+
+HistoryStats DeviceHistory::stats() {
+  std::lock_guard<std::mutex> guard(lock);
+  HistoryStats s;
+  s.capacity = capacity;
+  s.baseCount = active.count;
+  s.logCount = logCount;
+  s.logCapacity = logCapacity;
+  s.generation = active.generation;
+  s.compactions = compactions;
+  s.dropped = dropped;
+  s.skipped = skipped;
+  return s;
+}
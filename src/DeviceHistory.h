@@ -0,0 +1,124 @@
+#ifndef DEVICE_HISTORY_H
+#define DEVICE_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include "FlashRegion.h"
+
+// Long-term per-device history kept in a raw flash partition ("history")
+// and read in place through esp_partition_mmap, so the data set never has
+// to fit in RAM. Only the active base and the log are mapped, so the
+// partition can be about twice as large as the mapped footprint. On the
+// host a memory-mapped file stands in for the partition (with NOR
+// semantics: writes can only clear bits).
+//
+// Partition layout, all offsets sector aligned:
+//   [ base A: header sector | records sorted by MAC ]
+//   [ base B: header sector | records sorted by MAC ]
+//   [ log: append-only records, newest wins          ]
+// Lookups binary-search the active base and scan the log backwards.
+// When the log fills up it is merged into the inactive base, which then
+// becomes active by carrying a higher generation in its header. The merge
+// runs without the history lock, so lookups keep using the active base
+// and log; sightings arriving meanwhile wait in RAM until the log has
+// been erased (and only block once HISTORY_PENDING_MAX of them queue up).
+
+#define HISTORY_PARTITION_LABEL "history"
+#define HISTORY_SECTOR_SIZE FLASH_SECTOR_SIZE
+#define HISTORY_LOG_BYTES (64 * 1024)   // at most; a quarter of smaller partitions
+#define HISTORY_MIN_BYTES (8 * HISTORY_SECTOR_SIZE)
+#define HISTORY_PENDING_MAX 64   // sightings held while a compaction runs
+
+// A sighting only rewrites a record when the hour bit is new or the last
+// write is older than this many minutes.
+#define HISTORY_TOUCH_MINUTES 15
+// Minutes at or above this are wall-clock time (September 2020); below it
+// they are a clock that was never set, counting only uptime
+#define HISTORY_WALL_MINUTES (1600000000 / 60)
+
+struct HistoryRecord {
+  uint8_t mac[6];
+  uint8_t flags;       // HISTORY_RECORD_VALID, 0xFF = erased flash
+  uint8_t hours[3];    // hour-of-day presence bitmap (bit n = hour n), wall clock only
+  uint16_t count;      // touch intervals the device was seen in
+  uint32_t firstSeen;  // minutes, see historyClockMinutes()
+  uint32_t lastSeen;
+};
+
+#define HISTORY_RECORD_VALID 0x5A
+
+struct HistoryStats {
+  uint32_t capacity;     // records per base
+  uint32_t baseCount;
+  uint32_t logCount;
+  uint32_t logCapacity;
+  uint32_t generation;
+  uint32_t compactions;
+  uint32_t dropped;      // new devices not stored because the base was full
+  uint32_t skipped;      // sightings lost while the log could not be compacted
+};
+
+class DeviceHistory {
+public:
+  DeviceHistory();
+
+  // Maps the "history" partition (or the given host file) and recovers
+  // the active base and log tail. Returns false if there is no storage.
+  bool begin(const char* hostPath = nullptr, size_t hostSize = 0);
+  bool ready() const { return region.isOpen(); }
+
+  // nowMinutes 0 (no clock yet) records nothing
+  void recordSighting(const uint8_t mac[6], uint32_t nowMinutes);
+  bool lookup(const uint8_t mac[6], HistoryRecord& out);
+  void compact();
+  HistoryStats stats();
+  // One past the newest time stored when begin() ran: where a clock that
+  // was never set carries on after a reboot
+  uint32_t resumeMinutes() const { return resumeAt; }
+
+private:
+  struct BaseHeader {
+    uint32_t magic;
+    uint32_t generation;
+    uint32_t count;
+    uint32_t newest;   // latest lastSeen in the base
+    uint32_t crc;
+  };
+
+  const HistoryRecord* findLocked(const uint8_t mac[6]) const;
+  bool mapBase(int half);
+  bool readHeader(int half, BaseHeader& out) const;
+  bool appendLocked(const HistoryRecord& rec);
+  void flushPendingLocked();
+  bool mergeInto(int target, BaseHeader& out, uint32_t& lost);
+
+  FlashRegion region;
+  std::mutex lock;
+  std::mutex compactLock;   // one compaction at a time, taken before lock
+  size_t halfBytes;
+  size_t logBytes;
+  uint32_t capacity;
+  uint32_t logCapacity;
+  int activeHalf;
+  BaseHeader active;
+  const HistoryRecord* baseRecords;   // active base, window 0
+  const HistoryRecord* logRecords;    // window 1
+  uint32_t logCount;
+  uint32_t compactions;
+  uint32_t dropped;
+  uint32_t skipped;
+  uint32_t resumeAt;
+  bool compacting;
+  HistoryRecord pending[HISTORY_PENDING_MAX];
+  uint32_t pendingCount;
+};
+
+extern DeviceHistory deviceHistory;
+
+// Minutes since the Unix epoch once SNTP has set the clock. Until then
+// the history's own clock: resumeMinutes() plus uptime, so stored times
+// never run backwards across a reboot. 0 while neither is available.
+uint32_t historyClockMinutes();
+
+#endif
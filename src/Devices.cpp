@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Devices.h"
+
+EpochSnapshot<WiFiTable> wifiSnapshot;
+EpochSnapshot<BLETable> bleSnapshot;
+EpochSnapshot<BTClassicTable> btcSnapshot;
+ChangeLog<CHANGE_LOG_SIZE> wifiChanges;
+ChangeLog<CHANGE_LOG_SIZE> bleChanges;
+ChangeLog<CHANGE_LOG_SIZE> btcChanges;
+
+bool significantChange(const WiFiDeviceInfo& prev, const WiFiDeviceInfo& next) {
+  return abs(prev.rssi - next.rssi) >= RSSI_CHANGE_THRESHOLD ||
+         prev.channel != next.channel ||
+         prev.security != next.security ||
+         strcmp(prev.ssid, next.ssid) != 0;
+}
+
+bool significantChange(const BLEDeviceInfo& prev, const BLEDeviceInfo& next) {
+  return abs(prev.rssi - next.rssi) >= RSSI_CHANGE_THRESHOLD ||
+         prev.txPower != next.txPower ||
+         strcmp(prev.name, next.name) != 0 ||
+         strcmp(prev.serviceUUID, next.serviceUUID) != 0;
+}
+
+bool significantChange(const BTClassicDeviceInfo& prev, const BTClassicDeviceInfo& next) {
+  return abs(prev.rssi - next.rssi) >= RSSI_CHANGE_THRESHOLD ||
+         prev.cod != next.cod ||
+         strcmp(prev.name, next.name) != 0;
+}
+
+const char* codMajorClassName(uint32_t cod) {
+  switch ((cod >> 8) & 0x1F) {
+    case 0x00:
+      return "Misc";
+    case 0x01:
+      return "Computer";
+    case 0x02:
+      return "Phone";
+    case 0x03:
+      return "Network";
+    case 0x04:
+      return "Audio/Video";
+    case 0x05:
+      return "Peripheral";
+    case 0x06:
+      return "Imaging";
+    case 0x07:
+      return "Wearable";
+    case 0x08:
+      return "Toy";
+    case 0x09:
+      return "Health";
+    default:
+      return "Unknown";
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef DEVICES_H
+#define DEVICES_H
+
+#include <stdint.h>
+#include <esp_wifi_types.h>
+#include "EpochSnapshot.h"
+#include "ChangeLog.h"
+
+// Device Limits
+#define MAX_WIFI_DEVICES 25
+#define MAX_BLE_DEVICES 25
+#define MAX_BTC_DEVICES 25
+#define CHANGE_LOG_SIZE 256
+
+// RSSI movement (dB) below which a device is not reported as updated
+#define RSSI_CHANGE_THRESHOLD 4
+
+// --- Structures for Device Information ---
+// Fixed-size fields so table versions can be copied without touching the heap.
+struct WiFiDeviceInfo {
+  uint8_t id[6];       // BSSID
+  uint32_t seq;        // change-log sequence of the last significant change
+  char ssid[33];
+  char mac[18];
+  int channel;
+  int rssi;
+  wifi_auth_mode_t security;
+  uint32_t ingestUs;   // micros() at scan-done, for latency tracking
+};
+
+struct BLEDeviceInfo {
+  uint8_t id[6];       // advertiser address
+  uint32_t seq;
+  char name[32];
+  char address[18];
+  int rssi;
+  int txPower;
+  char serviceUUID[37];
+  uint32_t ingestUs;   // micros() at first GAP report
+};
+
+// Classic Bluetooth (BR/EDR) device from an inquiry
+struct BTClassicDeviceInfo {
+  uint8_t id[6];       // BD_ADDR
+  uint32_t seq;
+  char name[32];
+  char address[18];
+  uint32_t cod;        // Class of Device, 0 if not reported
+  int rssi;
+  uint32_t ingestUs;   // micros() at the inquiry result
+};
+
+// One immutable version of a scan result list
+template <typename T, int N>
+struct DeviceTable {
+  typedef T Record;
+  static const int CAPACITY = N;
+  T items[N];
+  int count = 0;
+  uint32_t version = 0;   // publish counter, 0 = never scanned
+  uint32_t seq = 0;       // last change-log sequence reflected in items
+};
+
+typedef DeviceTable<WiFiDeviceInfo, MAX_WIFI_DEVICES> WiFiTable;
+typedef DeviceTable<BLEDeviceInfo, MAX_BLE_DEVICES> BLETable;
+typedef DeviceTable<BTClassicDeviceInfo, MAX_BTC_DEVICES> BTClassicTable;
+
+// Published by the scanner task, read by the LCD and exporters
+extern EpochSnapshot<WiFiTable> wifiSnapshot;
+extern EpochSnapshot<BLETable> bleSnapshot;
+extern EpochSnapshot<BTClassicTable> btcSnapshot;
+extern ChangeLog<CHANGE_LOG_SIZE> wifiChanges;
+extern ChangeLog<CHANGE_LOG_SIZE> bleChanges;
+extern ChangeLog<CHANGE_LOG_SIZE> btcChanges;
+
+bool significantChange(const WiFiDeviceInfo& prev, const WiFiDeviceInfo& next);
+bool significantChange(const BLEDeviceInfo& prev, const BLEDeviceInfo& next);
+bool significantChange(const BTClassicDeviceInfo& prev, const BTClassicDeviceInfo& next);
+
+// Major device class from a Class of Device, e.g. "Phone"
+const char* codMajorClassName(uint32_t cod);
+
+#endif
@@ -0,0 +1,204 @@
+#include "DisHarvest.h"
+#include <string.h>
+
+static const uint16_t FIELD_UUIDS[DIS_FIELD_COUNT] = {0x2A29, 0x2A24, 0x2A25, 0x2A27, 0x2A26, 0x2A28};
+
+const char* disFieldName(DisField field) {
+  static const char* const names[DIS_FIELD_COUNT] = {"manufacturer", "model", "serial",
+                                                     "hardware", "firmware", "software"};
+  return field < DIS_FIELD_COUNT ? names[field] : "?";
+}
+
+const char* disStateName(DisState state) {
+  switch (state) {
+    case DIS_QUEUED: return "queued";
+    case DIS_RUNNING: return "connecting";
+    case DIS_DONE: return "done";
+    case DIS_NO_SERVICE: return "no DIS";
+    case DIS_FAILED: return "failed";
+  }
+  return "?";
+}
+
+DisHarvester::DisHarvester() : running(0) {
+  memset(cache, 0, sizeof(cache));
+  memset(&counters, 0, sizeof(counters));
+}
+
+DisRecord* DisHarvester::find(const uint8_t id[6]) {
+  for (int i = 0; i < DIS_CACHE_SIZE; i++) {
+    if (cache[i].used && memcmp(cache[i].id, id, 6) == 0) return &cache[i];
+  }
+  return nullptr;
+}
+
+// A free slot, else the idle record seen longest ago
+DisRecord* DisHarvester::claim(uint32_t nowMs) {
+  DisRecord* slot = nullptr;
+  for (int i = 0; i < DIS_CACHE_SIZE; i++) {
+    DisRecord& r = cache[i];
+    if (!r.used) return &r;
+    if (r.state == DIS_QUEUED || r.state == DIS_RUNNING) continue;
+    if (!slot || nowMs - r.seenMs > nowMs - slot->seenMs) slot = &r;
+  }
+  if (slot) counters.evicted++;
+  return slot;
+}
+
+// Only an address that went quiet before this one was queued: two devices
+// seen side by side are two assets, whatever their serial numbers say
+DisRecord* DisHarvester::sameAsset(const DisRecord& rec, uint32_t queuedMs) {
+  if (!rec.fields[DIS_MODEL][0] || !rec.fields[DIS_SERIAL][0]) return nullptr;
+  for (int i = 0; i < DIS_CACHE_SIZE; i++) {
+    DisRecord& r = cache[i];
+    if (&r == &rec || !r.used || r.state != DIS_DONE) continue;
+    if ((int32_t)(r.seenMs - queuedMs) >= 0) continue;
+    if (strcmp(r.fields[DIS_MODEL], rec.fields[DIS_MODEL]) == 0 &&
+        strcmp(r.fields[DIS_SERIAL], rec.fields[DIS_SERIAL]) == 0) {
+      return &r;
+    }
+  }
+  return nullptr;
+}
+
+bool DisHarvester::offer(const uint8_t id[6], uint8_t addrType, uint32_t nowMs) {
+  std::lock_guard<std::mutex> guard(lock);
+  counters.offered++;
+  DisRecord* r = find(id);
+  if (r) {
+    r->seenMs = nowMs;
+    r->addrType = addrType;
+    if (r->state == DIS_QUEUED || r->state == DIS_RUNNING) return false;
+    if ((int32_t)(nowMs - r->nextMs) < 0) return false;   // cooling down
+  } else {
+    int queued = 0;
+    for (int i = 0; i < DIS_CACHE_SIZE; i++) {
+      if (cache[i].used && cache[i].state == DIS_QUEUED) queued++;
+    }
+    if (queued >= DIS_QUEUE_SIZE) return false;
+    r = claim(nowMs);
+    if (!r) return false;
+    memset(r, 0, sizeof(*r));
+    memcpy(r->id, id, 6);
+    r->addrType = addrType;
+    r->used = true;
+    r->seenMs = nowMs;
+  }
+  r->state = DIS_QUEUED;
+  r->nextMs = nowMs;
+  counters.queued++;
+  return true;
+}
+
+bool DisHarvester::take(DisJob& job, uint32_t nowMs) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (running >= DIS_MAX_CONCURRENT) return false;
+  DisRecord* oldest = nullptr;
+  for (int i = 0; i < DIS_CACHE_SIZE; i++) {
+    DisRecord& r = cache[i];
+    if (r.used && r.state == DIS_QUEUED && (!oldest || (int32_t)(r.nextMs - oldest->nextMs) < 0)) {
+      oldest = &r;
+    }
+  }
+  if (!oldest) return false;
+  oldest->state = DIS_RUNNING;
+  job.slot = oldest - cache;
+  memcpy(job.id, oldest->id, 6);
+  job.addrType = oldest->addrType;
+  running++;
+  if ((uint32_t)running > counters.peakInFlight) counters.peakInFlight = running;
+  counters.connects++;
+  return true;
+}
+
+void DisHarvester::finish(const DisJob& job, const DisResult& result, uint32_t nowMs) {
+  std::lock_guard<std::mutex> guard(lock);
+  running--;
+  DisRecord& r = cache[job.slot];   // running records are never evicted
+  uint32_t queuedMs = r.nextMs;
+  r.state = result.state;
+  switch (result.state) {
+    case DIS_DONE:
+      memcpy(r.fields, result.fields, sizeof(r.fields));
+      r.attempts = 0;
+      r.nextMs = nowMs + DIS_COOLDOWN_MS;
+      counters.harvested++;
+      if (DisRecord* old = sameAsset(r, queuedMs)) {
+        old->used = false;   // the asset now answers at this address
+        counters.merged++;
+      }
+      break;
+    case DIS_NO_SERVICE:
+      r.nextMs = nowMs + DIS_COOLDOWN_MS;
+      counters.noService++;
+      break;
+    default:
+      r.state = DIS_FAILED;
+      r.nextMs = nowMs + (++r.attempts >= DIS_ATTEMPTS_MAX ? DIS_COOLDOWN_MS : DIS_RETRY_MS);
+      counters.failures++;
+      break;
+  }
+}
+
+void DisHarvester::run(DisClient& client, const DisJob& job, DisResult& out) {
+  memset(&out, 0, sizeof(out));
+  out.state = DIS_FAILED;
+  if (!client.connect(job.id, job.addrType, DIS_CONNECT_TIMEOUT_MS)) return;
+  if (!client.hasService()) {
+    out.state = DIS_NO_SERVICE;
+  } else {
+    for (int f = 0; f < DIS_FIELD_COUNT; f++) {
+      char* text = out.fields[f];
+      int n = client.read(FIELD_UUIDS[f], text, DIS_FIELD_LEN);
+      if (n < 0) n = 0;
+      if (n > DIS_FIELD_LEN - 1) n = DIS_FIELD_LEN - 1;
+      text[n] = 0;
+      // Strings in the wild carry NUL padding and stray bytes
+      n = strlen(text);
+      for (int i = 0; i < n; i++) {
+        if (text[i] < 0x20 || text[i] > 0x7e) text[i] = '?';
+      }
+      while (n > 0 && text[n - 1] == ' ') text[--n] = 0;
+    }
+    out.state = DIS_DONE;
+  }
+  client.disconnect();
+}
+
+bool DisHarvester::lookup(const uint8_t id[6], DisRecord& out) {
+  std::lock_guard<std::mutex> guard(lock);
+  DisRecord* r = find(id);
+  if (!r) return false;
+  out = *r;
+  return true;
+}
+
+int DisHarvester::records(DisRecord* out, int max) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (max <= 0) return 0;
+  int n = 0;
+  for (int i = 0; i < DIS_CACHE_SIZE; i++) {
+    const DisRecord& r = cache[i];
+    if (!r.used || r.state != DIS_DONE) continue;
+    // Insertion by last sighting, newest first
+    int at = n < max ? n : max - 1;
+    if (n >= max && (int32_t)(r.seenMs - out[at].seenMs) <= 0) continue;
+    while (at > 0 && (int32_t)(r.seenMs - out[at - 1].seenMs) > 0) {
+      out[at] = out[at - 1];
+      at--;
+    }
+    out[at] = r;
+    if (n < max) n++;
+  }
+  return n;
+}
+
+int DisHarvester::inFlight() {
+  std::lock_guard<std::mutex> guard(lock);
+  return running;
+}
+
+DisStats DisHarvester::stats() {
+  std::lock_guard<std::mutex> guard(lock);
+  return counters;
+}
@@ -0,0 +1,127 @@
+#ifndef DIS_HARVEST_H
+#define DIS_HARVEST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+// Device Information Service (0x180A) harvesting for asset audits. The
+// scanner offers connectable advertisers; up to DIS_MAX_CONCURRENT workers
+// each take one, connect, read the fixed characteristic set below and
+// disconnect. Results are kept per device, and a device is not connected
+// to again before its cool-down runs out: hours after it answered, minutes
+// after a failed attempt. Records that report the same model and serial
+// number are one asset: a device whose private address rotated takes over
+// its old record instead of filling a new one, once the old address has
+// gone quiet. Scheduling, the cache and the read sequence are pure logic;
+// the GATT client is behind DisClient so it runs on host.
+
+#define DIS_MAX_CONCURRENT 2      // Bluedroid allows 3 links; one stays free
+#define DIS_QUEUE_SIZE 16
+#define DIS_CACHE_SIZE 24
+#define DIS_FIELD_LEN 24
+#define DIS_CONNECT_TIMEOUT_MS 4000
+#define DIS_COOLDOWN_MS (6 * 60 * 60 * 1000UL)   // after a harvest
+#define DIS_RETRY_MS (10 * 60 * 1000UL)          // after a failed attempt
+#define DIS_ATTEMPTS_MAX 3        // failed attempts before the long cool-down
+
+enum DisField {
+  DIS_MANUFACTURER,   // 0x2A29
+  DIS_MODEL,          // 0x2A24
+  DIS_SERIAL,         // 0x2A25
+  DIS_HARDWARE,       // 0x2A27
+  DIS_FIRMWARE,       // 0x2A26
+  DIS_SOFTWARE,       // 0x2A28
+  DIS_FIELD_COUNT
+};
+
+enum DisState : uint8_t {
+  DIS_QUEUED,
+  DIS_RUNNING,
+  DIS_DONE,           // read; fields hold whatever the device has
+  DIS_NO_SERVICE,     // connected, but there is no 0x180A
+  DIS_FAILED          // could not connect; retried after DIS_RETRY_MS
+};
+
+const char* disFieldName(DisField field);
+const char* disStateName(DisState state);
+
+// One GATT connection (BLEClient on the device)
+class DisClient {
+public:
+  virtual ~DisClient() {}
+  virtual bool connect(const uint8_t id[6], uint8_t addrType, uint32_t timeoutMs) = 0;
+  virtual bool hasService() = 0;   // 0x180A, after service discovery
+  // The characteristic's value as text into out; -1 if the device lacks it
+  virtual int read(uint16_t uuid, char* out, size_t cap) = 0;
+  virtual void disconnect() = 0;
+};
+
+struct DisRecord {
+  uint8_t id[6];
+  uint8_t addrType;
+  bool used;
+  DisState state;
+  uint8_t attempts;
+  uint32_t nextMs;      // not before then: queued time or cool-down end
+  uint32_t seenMs;
+  char fields[DIS_FIELD_COUNT][DIS_FIELD_LEN];
+};
+
+struct DisJob {
+  int slot;
+  uint8_t id[6];
+  uint8_t addrType;
+};
+
+struct DisResult {
+  DisState state;
+  char fields[DIS_FIELD_COUNT][DIS_FIELD_LEN];
+};
+
+struct DisStats {
+  uint32_t offered;
+  uint32_t queued;
+  uint32_t connects;
+  uint32_t harvested;
+  uint32_t noService;
+  uint32_t failures;
+  uint32_t merged;      // same asset under a new address
+  uint32_t evicted;
+  uint32_t peakInFlight;
+};
+
+class DisHarvester {
+public:
+  DisHarvester();
+
+  // Scanner side: a connectable advertiser; false if it is not due
+  bool offer(const uint8_t id[6], uint8_t addrType, uint32_t nowMs);
+
+  // Worker side: the oldest due device, if fewer than DIS_MAX_CONCURRENT
+  // connections are up
+  bool take(DisJob& job, uint32_t nowMs);
+  void finish(const DisJob& job, const DisResult& result, uint32_t nowMs);
+
+  // Connects, reads every field and disconnects; no lock held
+  static void run(DisClient& client, const DisJob& job, DisResult& out);
+
+  // Copy of the device's record; false if there is none
+  bool lookup(const uint8_t id[6], DisRecord& out);
+  // Copies of harvested records, most recent first
+  int records(DisRecord* out, int max);
+  int inFlight();
+  DisStats stats();
+
+private:
+  DisRecord* find(const uint8_t id[6]);
+  DisRecord* claim(uint32_t nowMs);
+  DisRecord* sameAsset(const DisRecord& rec, uint32_t queuedMs);
+
+  std::mutex lock;
+  DisRecord cache[DIS_CACHE_SIZE];
+  int running;
+  DisStats counters;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "Discovery.h"
+#include "Uplink.h"
+
+#if SENSOR_NODE
+
+#include <ESPmDNS.h>
+#include <mdns.h>
+#include "Sniffer.h"
+#include "Version.h"
+
+ServiceCache serviceCache;
+static char hostName[20];
+
+// Current load for the TXT record: captured frames per second
+static void updateLoad() {
+  static uint32_t lastFrames = 0;
+  static uint32_t lastMs = 0;
+  uint32_t now = millis();
+  uint32_t frames = snifferStats().frames;
+  if (lastMs && now != lastMs) {
+    char load[12];
+    snprintf(load, sizeof(load), "%lu", (unsigned long)((frames - lastFrames) * 1000UL / (now - lastMs)));
+    MDNS.addServiceTxt(DISCOVERY_SERVICE, DISCOVERY_PROTO, "load", load);
+  }
+  lastFrames = frames;
+  lastMs = now;
+}
+
+// Blocks for up to DISCOVERY_QUERY_MS; only ever called from the task
+static void queryServices() {
+  mdns_result_t* results = NULL;
+  if (mdns_query_ptr("_" DISCOVERY_SERVICE, "_" DISCOVERY_PROTO, DISCOVERY_QUERY_MS,
+                     SERVICE_CACHE_SIZE, &results) != ESP_OK) {
+    return;
+  }
+  uint32_t now = millis();
+  for (mdns_result_t* r = results; r; r = r->next) {
+    if (!r->instance_name) continue;
+    const char* roleTxt = nullptr;
+    for (size_t i = 0; i < r->txt_count; i++) {
+      if (strcmp(r->txt[i].key, "role") == 0) roleTxt = r->txt[i].value;
+    }
+    ServiceRole role = serviceRole(roleTxt);
+    for (mdns_ip_addr_t* a = r->addr; a; a = a->next) {
+      if (a->addr.type == ESP_IPADDR_TYPE_V4) {
+        serviceCache.update(r->instance_name, a->addr.u_addr.ip4.addr, r->port, role,
+                            r->ttl ? r->ttl : DISCOVERY_DEFAULT_TTL, now);
+        break;
+      }
+    }
+  }
+  mdns_query_results_free(results);
+}
+
+static void discoveryTask(void* param) {
+  DiscoverySchedule schedule(DISCOVERY_RETRY_MS);
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(DISCOVERY_PERIOD_MS));
+    if (!uplinkReady()) continue;
+    updateLoad();
+    if (schedule.due(serviceCache, millis())) queryServices();
+    ServiceEntry collector;
+    if (serviceCache.find(ROLE_COLLECTOR, millis(), collector)) {
+      udpTransport.setTarget(IPAddress(collector.ip), collector.port);
+    }
+  }
+}
+
+void discoveryBegin() {
+  uint64_t mac = ESP.getEfuseMac();
+  char id[13];
+  snprintf(id, sizeof(id), "%012llx", (unsigned long long)mac);
+  snprintf(hostName, sizeof(hostName), "wscan-%s", id + 6);
+  if (!MDNS.begin(hostName)) return;
+
+  MDNS.addService(DISCOVERY_SERVICE, DISCOVERY_PROTO, NODE_PORT);
+  MDNS.addServiceTxt(DISCOVERY_SERVICE, DISCOVERY_PROTO, "role", "node");
+  MDNS.addServiceTxt(DISCOVERY_SERVICE, DISCOVERY_PROTO, "id", id);
+  MDNS.addServiceTxt(DISCOVERY_SERVICE, DISCOVERY_PROTO, "fw", FIRMWARE_VERSION);
+  MDNS.addServiceTxt(DISCOVERY_SERVICE, DISCOVERY_PROTO, "caps", "wifi,ble,btc,sniff");
+  MDNS.addServiceTxt(DISCOVERY_SERVICE, DISCOVERY_PROTO, "load", "0");
+  xTaskCreatePinnedToCore(discoveryTask, "discovery", 4096, NULL, 1, NULL, 1);
+}
+
+void printDiscovery(Print& out) {
+  out.printf("mdns: %s.local, collector %s:%u\n", hostName,
+             udpTransport.target().toString().c_str(), udpTransport.targetPort());
+  ServiceEntry entries[SERVICE_CACHE_SIZE];
+  uint32_t now = millis();
+  int n = serviceCache.snapshot(entries, SERVICE_CACHE_SIZE, now);
+  for (int i = 0; i < n; i++) {
+    out.printf("  %-9s %s %s:%u ttl %lus\n", entries[i].role == ROLE_COLLECTOR ? "collector" : "node",
+               entries[i].instance, IPAddress(entries[i].ip).toString().c_str(), entries[i].port,
+               (unsigned long)((entries[i].expiresMs - now) / 1000));
+  }
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef DISCOVERY_H
+#define DISCOVERY_H
+
+#include <Arduino.h>
+#include "ServiceCache.h"
+
+// Zero-configuration fleet discovery over mDNS (sensor nodes only).
+// Nodes advertise _wscan._udp with TXT records
+//   role=node id=<efuse MAC> fw=<version> caps=<sources> load=<frames/s>
+// and collectors advertise the same service type with role=collector.
+// A background task re-queries before cached answers expire and points
+// the UDP export at the first live collector; COLLECTOR_HOST is only
+// the fallback until one has been found.
+
+#define DISCOVERY_SERVICE "wscan"
+#define DISCOVERY_PROTO "udp"
+#define DISCOVERY_PERIOD_MS 5000      // TXT refresh and cache check
+#define DISCOVERY_QUERY_MS 2000       // browse window per query
+#define DISCOVERY_RETRY_MS 15000      // between queries while nothing is found
+#define DISCOVERY_DEFAULT_TTL 120     // seconds, if a result carries none
+
+extern ServiceCache serviceCache;
+
+void discoveryBegin();
+void printDiscovery(Print& out);
+
+#endif
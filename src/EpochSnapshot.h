@@ -0,0 +1,103 @@
+#ifndef EPOCH_SNAPSHOT_H
+#define EPOCH_SNAPSHOT_H
+
+#include <stdint.h>
+#include <atomic>
+
+// RCU-style snapshot publication for a single writer and many readers.
+//
+// The writer fills a free version from a fixed pool and publishes it; the
+// previous version is retired with the current epoch. Readers pin the
+// current epoch in a free reader slot before loading the version pointer,
+// so a retired version is only reused once every active reader pinned a
+// later epoch. Readers never block the writer and never take a lock; if
+// every spare version is still pinned, beginWrite() returns nullptr and
+// the writer simply publishes later. No heap is used.
+template <typename T, int VERSIONS = 3, int READERS = 8>
+class EpochSnapshot {
+public:
+  class ReadGuard {
+  public:
+    ReadGuard(EpochSnapshot* owner, int slot, const T* value)
+      : owner(owner), slot(slot), value(value) {}
+    ReadGuard(ReadGuard&& other) : owner(other.owner), slot(other.slot), value(other.value) {
+      other.owner = nullptr;
+    }
+    ~ReadGuard() {
+      if (owner) owner->unpin(slot);
+    }
+    const T* get() const { return value; }
+    const T* operator->() const { return value; }
+    const T& operator*() const { return *value; }
+    explicit operator bool() const { return value != nullptr; }
+
+  private:
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+    EpochSnapshot* owner;
+    int slot;
+    const T* value;
+  };
+
+  EpochSnapshot() : current(&versions[0]), epoch(1) {
+    for (int i = 0; i < VERSIONS; i++) retiredAt[i] = 0;
+    for (int i = 0; i < READERS; i++) readerEpoch[i].store(0);
+  }
+
+  // --- Reader side ---
+
+  // Pins the current version until the guard goes out of scope. If all
+  // reader slots are busy the guard is empty (check with operator bool).
+  ReadGuard read() {
+    uint32_t e = epoch.load();
+    for (int i = 0; i < READERS; i++) {
+      uint32_t idle = 0;
+      if (readerEpoch[i].compare_exchange_strong(idle, e)) {
+        return ReadGuard(this, i, current.load());
+      }
+    }
+    return ReadGuard(nullptr, -1, nullptr);
+  }
+
+  // --- Writer side (single writer only) ---
+
+  // The published version; only safe to use from the writer itself.
+  const T* latest() const { return current.load(); }
+
+  // Returns a version that no reader can observe, or nullptr if all spare
+  // versions are still pinned.
+  T* beginWrite() {
+    T* cur = current.load();
+    for (int i = 0; i < VERSIONS; i++) {
+      if (&versions[i] != cur && reclaimable(i)) return &versions[i];
+    }
+    return nullptr;
+  }
+
+  void publish(T* next) {
+    T* prev = current.exchange(next);
+    uint32_t e = epoch.load();
+    retiredAt[prev - versions] = e;
+    epoch.store(e + 1);
+  }
+
+private:
+  bool reclaimable(int version) const {
+    uint32_t retired = retiredAt[version];
+    for (int i = 0; i < READERS; i++) {
+      uint32_t e = readerEpoch[i].load();
+      if (e != 0 && e <= retired) return false;
+    }
+    return true;
+  }
+
+  void unpin(int slot) { readerEpoch[slot].store(0); }
+
+  T versions[VERSIONS];
+  uint32_t retiredAt[VERSIONS];
+  std::atomic<T*> current;
+  std::atomic<uint32_t> epoch;
+  std::atomic<uint32_t> readerEpoch[READERS];
+};
+
+#endif
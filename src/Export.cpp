@@ -0,0 +1,127 @@
+#include "Export.h"
+#include "Devices.h"
+#include "Latency.h"
+#include <esp_random.h>
+
+static void printMac(Print& out, const uint8_t id[6]) {
+  out.printf("%02X:%02X:%02X:%02X:%02X:%02X", id[0], id[1], id[2], id[3], id[4], id[5]);
+}
+
+struct WiFiLineWriter {
+  Print& out;
+  void upsert(const WiFiDeviceInfo& dev) {
+    out.printf("+ %u ", dev.seq);
+    printMac(out, dev.id);
+    out.printf(" %d %d %d %s\n", dev.channel, dev.rssi, (int)dev.security, dev.ssid);
+    recordLatency(LAT_EXPORT, dev.ingestUs);
+  }
+  void evict(uint32_t seq, const uint8_t id[6]) {
+    out.printf("- %u ", seq);
+    printMac(out, id);
+    out.println();
+  }
+};
+
+struct BLELineWriter {
+  Print& out;
+  void upsert(const BLEDeviceInfo& dev) {
+    out.printf("+ %u ", dev.seq);
+    printMac(out, dev.id);
+    out.printf(" %d %d %s %s\n", dev.rssi, dev.txPower, dev.serviceUUID, dev.name);
+    recordLatency(LAT_EXPORT, dev.ingestUs);
+  }
+  void evict(uint32_t seq, const uint8_t id[6]) {
+    out.printf("- %u ", seq);
+    printMac(out, id);
+    out.println();
+  }
+};
+
+struct BTClassicLineWriter {
+  Print& out;
+  void upsert(const BTClassicDeviceInfo& dev) {
+    out.printf("+ %u ", dev.seq);
+    printMac(out, dev.id);
+    out.printf(" %d %06X %s\n", dev.rssi, dev.cod, dev.name);
+    recordLatency(LAT_EXPORT, dev.ingestUs);
+  }
+  void evict(uint32_t seq, const uint8_t id[6]) {
+    out.printf("- %u ", seq);
+    printMac(out, id);
+    out.println();
+  }
+};
+
+ExportCursor parseExportCursor(const char* text) {
+  ExportCursor c = {0, 0};
+  char* end;
+  uint32_t epoch = strtoul(text, &end, 16);
+  if (*end != ':') return c;
+  c.epoch = epoch;
+  c.seq = strtoul(end + 1, NULL, 10);
+  return c;
+}
+
+// Drawn once per boot; never 0, so a bare "0" cursor never matches
+uint32_t exportEpoch() {
+  static uint32_t epoch = 0;
+  while (epoch == 0) epoch = esp_random();
+  return epoch;
+}
+
+template <typename Table, typename Writer>
+static ExportCursor exportChanges(Print& out, EpochSnapshot<Table>& snapshot,
+                                  const ChangeLog<CHANGE_LOG_SIZE>& log, const ExportCursor& since) {
+  typename EpochSnapshot<Table>::ReadGuard table = snapshot.read();
+  if (!table) return since;
+
+  ExportCursor next = {exportEpoch(), table->seq};
+  Writer writer{out};
+  // A cursor from another boot names sequence numbers of another log
+  if (since.epoch != next.epoch || !forEachChangeSince(log, *table, since.seq, writer)) {
+    out.printf("! full %08x:%u\n", next.epoch, next.seq);
+    for (int i = 0; i < table->count; i++) writer.upsert(table->items[i]);
+  }
+  out.printf("= %08x:%u\n", next.epoch, next.seq);
+  return next;
+}
+
+ExportCursor exportWifiChanges(Print& out, const ExportCursor& since) {
+  return exportChanges<WiFiTable, WiFiLineWriter>(out, wifiSnapshot, wifiChanges, since);
+}
+
+ExportCursor exportBleChanges(Print& out, const ExportCursor& since) {
+  return exportChanges<BLETable, BLELineWriter>(out, bleSnapshot, bleChanges, since);
+}
+
+ExportCursor exportBtClassicChanges(Print& out, const ExportCursor& since) {
+  return exportChanges<BTClassicTable, BTClassicLineWriter>(out, btcSnapshot, btcChanges, since);
+}
+
+// Counts what did not fit, so the caller can tell a cut-off batch
+class BufferPrint : public Print {
+public:
+  BufferPrint(char* buf, size_t cap) : buf(buf), cap(cap), len(0) {}
+  size_t write(uint8_t c) override {
+    if (len + 1 < cap) buf[len] = c;
+    len++;
+    return 1;
+  }
+  size_t length() const { return len; }
+
+private:
+  char* buf;
+  size_t cap;
+  size_t len;
+};
+
+size_t exportChangesText(const char* table, const char* since, char* out, size_t cap) {
+  BufferPrint text(out, cap);
+  ExportCursor cursor = parseExportCursor(since);
+  if (strcmp(table, "wifi") == 0) exportWifiChanges(text, cursor);
+  else if (strcmp(table, "ble") == 0) exportBleChanges(text, cursor);
+  else if (strcmp(table, "btc") == 0) exportBtClassicChanges(text, cursor);
+  else return 0;
+  if (text.length() < cap) out[text.length()] = 0;
+  return text.length();
+}
@@ -0,0 +1,39 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <Arduino.h>
+
+// Incremental device-table export. A client remembers the cursor returned
+// by the previous call and asks for everything after it; only inserts,
+// updates and evictions since then are written. When the cursor is older
+// than the retained change log, or from a previous boot, a full snapshot
+// is sent instead, prefixed by a reset marker.
+//
+// Sequence numbers start over at every boot, so a cursor is
+// <epoch>:<seq>, the epoch being a random number drawn at boot. A cursor
+// with another epoch (or none, e.g. "0") always gets a full snapshot.
+//
+// Line format:
+//   ! full <epoch>:<seq>          client must drop its table
+//   + <seq> <mac> <fields...>     insert or update
+//   - <seq> <mac>                 eviction
+//   = <epoch>:<seq>               end of batch, next cursor
+struct ExportCursor {
+  uint32_t epoch;
+  uint32_t seq;
+};
+
+// "<epoch hex>:<seq>"; anything else parses as epoch 0, seq 0
+ExportCursor parseExportCursor(const char* text);
+uint32_t exportEpoch();
+
+ExportCursor exportWifiChanges(Print& out, const ExportCursor& since);
+ExportCursor exportBleChanges(Print& out, const ExportCursor& since);
+ExportCursor exportBtClassicChanges(Print& out, const ExportCursor& since);
+
+// The same batch for table "wifi", "ble" or "btc" into a buffer, for the
+// portal's /api/sync route. Returns its length: cap or more when it did
+// not fit, 0 for an unknown table.
+size_t exportChangesText(const char* table, const char* since, char* out, size_t cap);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef EXPORT_RING_H
+#define EXPORT_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+// Byte ring between a single producer (the capture path) and a single
+// consumer (the export pump, the sniffer task). push() never blocks: a
+// record that does not fit is dropped and counted. A record may be pushed
+// in two pieces (a header built on the stack, a body straight from the
+// source buffer), so nothing is staged on the way in. The consumer reads
+// contiguous spans in place, or copies a record out across the wrap.
+
+#define EXPORT_RING_BYTES 16384   // power of two
+
+class ExportRing {
+public:
+  ExportRing() : head(0), tail(0), dropped(0), pushed(0) {}
+
+  // Whole record or nothing
+  bool push(const void* data, size_t len) {
+    return push(data, len, nullptr, 0);
+  }
+
+  // Both pieces back to back, as one record, or nothing
+  bool push(const void* part1, size_t len1, const void* part2, size_t len2) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    size_t len = len1 + len2;
+    if (len > EXPORT_RING_BYTES - (h - t)) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    copyIn(h, part1, len1);
+    copyIn(h + len1, part2, len2);
+    head.store(h + len, std::memory_order_release);
+    pushed.fetch_add(len, std::memory_order_relaxed);
+    return true;
+  }
+
+  size_t pending() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+  }
+
+  // Longest contiguous readable span (stops at the end of the buffer)
+  size_t peek(const uint8_t** data) const {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    size_t n = head.load(std::memory_order_acquire) - t;
+    size_t pos = t & (EXPORT_RING_BYTES - 1);
+    if (n > EXPORT_RING_BYTES - pos) n = EXPORT_RING_BYTES - pos;
+    *data = buf + pos;
+    return n;
+  }
+
+  // Copies `len` pending bytes without consuming them; false if fewer
+  bool copyOut(void* dst, size_t len) const {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) - t < len) return false;
+    size_t pos = t & (EXPORT_RING_BYTES - 1);
+    size_t first = EXPORT_RING_BYTES - pos;
+    if (first > len) first = len;
+    memcpy(dst, buf + pos, first);
+    memcpy((uint8_t*)dst + first, buf, len - first);
+    return true;
+  }
+
+  void consume(size_t len) {
+    tail.store(tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+  }
+
+  // Drops everything pending (consumer side only)
+  void clear() {
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  uint32_t droppedRecords() const { return dropped.load(); }
+  uint32_t bytesPushed() const { return pushed.load(); }
+
+private:
+  void copyIn(uint32_t at, const void* data, size_t len) {
+    if (len == 0) return;
+    size_t pos = at & (EXPORT_RING_BYTES - 1);
+    size_t first = EXPORT_RING_BYTES - pos;
+    if (first > len) first = len;
+    memcpy(buf + pos, data, first);
+    memcpy(buf, (const uint8_t*)data + first, len - first);
+  }
+
+  uint8_t buf[EXPORT_RING_BYTES];
+  std::atomic<uint32_t> head;   // free-running byte counters
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> dropped;
+  std::atomic<uint32_t> pushed;
+};
+
+#endif
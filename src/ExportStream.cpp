@@ -0,0 +1,281 @@
+#include "ExportStream.h"
+#include <mutex>
+#include "ScanCodec.h"
+
+#ifdef ARDUINO
+#if CONFIG_TINYUSB_CDC_ENABLED && !ARDUINO_USB_CDC_ON_BOOT
+#include "USB.h"
+#include "USBCDC.h"
+#define EXPORT_HAVE_USB 1
+#endif
+
+// The stream has a UART of its own: on the console port, log lines and
+// command replies would land in the middle of records
+#ifndef EXPORT_UART_TX
+#define EXPORT_UART_TX 17   // UART1 TX, free on the supported boards
+#endif
+#define EXPORT_UART_BAUD 921600
+#define EXPORT_UART_BUFFER 1024
+#define SERIAL_PACKET 128   // UART TX FIFO
+#define USB_CDC_PACKET 64   // full-speed bulk endpoint
+#endif
+
+// =================================================================
+// PUMP
+// =================================================================
+
+size_t ExportPump::pump(ExportRing& ring, ExportTransport& transport, uint32_t nowMs) {
+  size_t total = 0;
+  size_t packet = transport.packetSize();
+  // A wrapped ring is read as two spans
+  for (int span = 0; span < 2; span++) {
+    size_t pending = ring.pending();
+    if (pending == 0) break;
+    bool flushDue = nowMs - lastWriteMs >= EXPORT_FLUSH_MS;
+    if (pending < EXPORT_MIN_BATCH && !flushDue && total == 0) break;
+
+    size_t room = transport.writable();
+    if (room == 0) {
+      transport.counters.stalls++;
+      break;
+    }
+
+    const uint8_t* data;
+    size_t avail = ring.peek(&data);
+    size_t n = avail < room ? avail : room;
+    // Whole packets only, except for the piece up to the end of the
+    // buffer (the rest follows right away) or a tail that is due
+    bool wholeSpan = (n == avail && avail < pending);
+    bool lastTail = (n == pending && flushDue);
+    if (!wholeSpan && !lastTail) n -= n % packet;
+    if (n == 0) {
+      transport.counters.stalls++;   // room for less than a packet
+      break;
+    }
+
+    size_t written = transport.write(data, n);
+    ring.consume(written);
+    transport.counters.bytes += written;
+    transport.counters.writes++;
+    total += written;
+    if (written < n) break;
+  }
+  if (total > 0 || ring.pending() == 0) lastWriteMs = nowMs;
+  return total;
+}
+
+// =================================================================
+// LOOPBACK TRANSPORT
+// =================================================================
+
+LoopbackTransport::LoopbackTransport(size_t capacity, size_t drainPerMs, size_t packet,
+                                     uint8_t* sink, size_t sinkSize)
+  : capacity(capacity < sizeof(fifo) ? capacity : sizeof(fifo)), drainPerMs(drainPerMs),
+    packet(packet), fifoLen(0), paused(false), sink(sink), sinkSize(sinkSize), sinkLen(0) {}
+
+size_t LoopbackTransport::writable() {
+  return capacity - fifoLen;
+}
+
+size_t LoopbackTransport::write(const uint8_t* data, size_t len) {
+  if (len > capacity - fifoLen) len = capacity - fifoLen;
+  memcpy(fifo + fifoLen, data, len);
+  fifoLen += len;
+  return len;
+}
+
+void LoopbackTransport::advance(uint32_t ms) {
+  if (paused) return;
+  size_t n = ms * drainPerMs;
+  if (n > fifoLen) n = fifoLen;
+  if (sink) {
+    size_t keep = sinkSize - sinkLen < n ? sinkSize - sinkLen : n;
+    memcpy(sink + sinkLen, fifo, keep);
+  }
+  sinkLen += n;
+  memmove(fifo, fifo + n, fifoLen - n);
+  fifoLen -= n;
+}
+
+// =================================================================
+// PRINT TRANSPORT
+// =================================================================
+#ifdef ARDUINO
+
+size_t PrintTransport::writable() {
+  int n = out.availableForWrite();
+  return n > 0 ? n : 0;
+}
+
+size_t PrintTransport::write(const uint8_t* data, size_t len) {
+  return out.write(data, len);
+}
+
+static ExportRing exportRing;
+static ExportPump exportPump;
+static PrintTransport serialTransport("serial", Serial1, SERIAL_PACKET);
+static bool uartStarted = false;
+#ifdef EXPORT_HAVE_USB
+static USBCDC usbCdc;
+static PrintTransport usbTransport("usb", usbCdc, USB_CDC_PACKET);
+static ExportTransport* transports[EXPORT_MAX_TRANSPORTS] = {&serialTransport, &usbTransport};
+static int transportCount = 2;
+#else
+static ExportTransport* transports[EXPORT_MAX_TRANSPORTS] = {&serialTransport};
+static int transportCount = 1;
+#endif
+
+static std::atomic<ExportTransport*> selected(nullptr);
+static TaskHandle_t exportTaskHandle = NULL;
+
+// Producers (scanner, sniffer) and the flush in the export task share the
+// encoder, so everything that touches it holds pushLock
+static std::mutex pushLock;
+static ScanEncoder encoder;
+static bool codecOn = false;
+static uint32_t blockStartMs;
+
+static void pushBlockLocked() {
+  const uint8_t* block;
+  size_t len = encoder.finish(&block);
+  exportRing.push(block, len);
+}
+
+static void flushCodec(bool force) {
+  std::lock_guard<std::mutex> guard(pushLock);
+  if (!encoder.empty() && (force || millis() - blockStartMs >= EXPORT_CODEC_FLUSH_MS)) {
+    pushBlockLocked();
+  }
+}
+
+// Low-priority drain loop; sleeps while no transport is selected
+static void exportTask(void* param) {
+  ExportTransport* current = nullptr;
+  uint32_t last = millis();
+  for (;;) {
+    ExportTransport* t = selected.load();
+    if (t != current) {
+      exportRing.clear();   // backlog of a previous stream
+      current = t;
+    }
+    flushCodec(false);
+    if (!t) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      last = millis();
+      continue;
+    }
+    exportPump.pump(exportRing, *t, millis());
+    vTaskDelay(1);
+    uint32_t now = millis();
+    t->counters.activeMs += now - last;
+    last = now;
+  }
+}
+
+void exportStreamBegin() {
+  xTaskCreatePinnedToCore(exportTask, "export", 3072, NULL, 1, &exportTaskHandle, 1);
+}
+
+bool exportStreamAddTransport(ExportTransport* transport) {
+  if (transportCount >= EXPORT_MAX_TRANSPORTS) return false;
+  transports[transportCount++] = transport;
+  return true;
+}
+
+bool exportStreamSelect(const char* name) {
+  ExportTransport* t = nullptr;
+  if (strcmp(name, "off") != 0) {
+    for (int i = 0; i < transportCount && !t; i++) {
+      if (strcmp(transports[i]->name(), name) == 0) t = transports[i];
+    }
+    if (!t) return false;
+  }
+  if (t == &serialTransport && !uartStarted) {
+    Serial1.setTxBufferSize(EXPORT_UART_BUFFER);
+    Serial1.begin(EXPORT_UART_BAUD, SERIAL_8N1, -1, EXPORT_UART_TX);   // TX only
+    uartStarted = true;
+  }
+#ifdef EXPORT_HAVE_USB
+  if (t == &usbTransport) {
+    usbCdc.setTxTimeoutMs(0);
+    usbCdc.begin();
+    USB.begin();
+  }
+#endif
+  selected.store(t);
+  if (exportTaskHandle) xTaskNotifyGive(exportTaskHandle);
+  return true;
+}
+
+int exportStreamNames(const char** names, int max) {
+  int n = 0;
+  for (int i = 0; i < transportCount && n < max; i++) names[n++] = transports[i]->name();
+  return n;
+}
+
+ExportTransport* exportStreamTransport() {
+  return selected.load();
+}
+
+uint32_t exportStreamDropped() {
+  return exportRing.droppedRecords();
+}
+
+void exportStreamSetCodec(bool on) {
+  flushCodec(true);
+  std::lock_guard<std::mutex> guard(pushLock);
+  codecOn = on;
+}
+
+bool exportStreamCodec() {
+  std::lock_guard<std::mutex> guard(pushLock);
+  return codecOn;
+}
+
+// Capture path: queue only, never waits for the transport. The scanner
+// and sniffer tasks both produce, so pushes are serialized here.
+void exportStreamRecord(const void* data, size_t len) {
+  if (!selected.load()) return;
+  std::lock_guard<std::mutex> guard(pushLock);
+  if (!codecOn) {
+    exportRing.push(data, len);
+    return;
+  }
+  if (encoder.empty()) blockStartMs = millis();
+  if (encoder.add((const uint8_t*)data, len)) return;
+  if (!encoder.empty()) {
+    pushBlockLocked();
+    blockStartMs = millis();
+    if (encoder.add((const uint8_t*)data, len)) return;
+  }
+  exportRing.push(data, len);   // too big for a block of its own
+}
+
+void printExportStreamStats(Print& out) {
+  ExportTransport* t = selected.load();
+  out.printf("streaming: %s\n", t ? t->name() : "off");
+  out.println("transport     bytes   writes   stalls  active(s)     KB/s");
+  for (int i = 0; i < transportCount; i++) {
+    const TransportCounters& c = transports[i]->counters;
+    uint32_t ms = c.activeMs.load();
+    uint32_t bytes = c.bytes.load();
+    out.printf("%-9s %9u %8u %8u %10u %8.1f\n", transports[i]->name(), bytes, c.writes.load(),
+               c.stalls.load(), ms / 1000, ms ? bytes / 1.024f / ms : 0.0f);
+  }
+  out.printf("ring: %u bytes queued, %u pushed, %u records dropped\n",
+             (unsigned)exportRing.pending(), exportRing.bytesPushed(), exportRing.droppedRecords());
+  // Copied under the lock: printing to a slow console must not hold up pushes
+  bool on;
+  uint32_t blocks, raw, encoded;
+  {
+    std::lock_guard<std::mutex> guard(pushLock);
+    on = codecOn;
+    blocks = encoder.blocks;
+    raw = encoder.rawBytes;
+    encoded = encoder.encodedBytes;
+  }
+  out.printf("codec: %s, %u blocks, %u -> %u bytes (%.2fx)\n", on ? "on" : "off", blocks, raw,
+             encoded, encoded ? (float)raw / encoded : 0.0f);
+}
+
+#endif
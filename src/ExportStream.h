@@ -0,0 +1,116 @@
+#ifndef EXPORT_STREAM_H
+#define EXPORT_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "ExportRing.h"
+
+// Binary streaming export: capture records queued in an ExportRing are
+// moved to a byte transport (UART, native USB CDC, loopback on the host)
+// by a pump that only ever writes what the transport can take right now.
+// When the host stops reading, the transport fills up, the pump counts a
+// stall and returns, and the ring absorbs the backlog; the capture path
+// itself never waits.
+
+#define EXPORT_MIN_BATCH 512   // bytes worth a write on their own
+#define EXPORT_FLUSH_MS 20     // a smaller tail is sent after this long
+#define EXPORT_MAX_TRANSPORTS 4
+#define EXPORT_CODEC_FLUSH_MS 50   // oldest record a codec block may hold back
+
+struct TransportCounters {
+  TransportCounters() : bytes(0), writes(0), stalls(0), activeMs(0) {}
+  std::atomic<uint32_t> bytes;
+  std::atomic<uint32_t> writes;
+  std::atomic<uint32_t> stalls;    // pump found the transport full
+  std::atomic<uint32_t> activeMs;  // time spent streaming
+};
+
+class ExportTransport {
+public:
+  virtual ~ExportTransport() {}
+  virtual const char* name() const = 0;
+  // Bytes that can be written now without blocking
+  virtual size_t writable() = 0;
+  virtual size_t write(const uint8_t* data, size_t len) = 0;
+  // Writes are sized in multiples of this (USB bulk packet, UART FIFO)
+  virtual size_t packetSize() const = 0;
+
+  TransportCounters counters;
+};
+
+class ExportPump {
+public:
+  ExportPump() : lastWriteMs(0) {}
+  // Moves as much as the transport accepts; returns the bytes written
+  size_t pump(ExportRing& ring, ExportTransport& transport, uint32_t nowMs);
+
+private:
+  uint32_t lastWriteMs;
+};
+
+// In-memory stand-in for a host reading a USB/serial stream: accepts up to
+// `capacity` unread bytes and drains `drainPerMs` bytes per millisecond
+// unless paused. Everything drained is appended to `sink` (if given).
+class LoopbackTransport : public ExportTransport {
+public:
+  LoopbackTransport(size_t capacity, size_t drainPerMs, size_t packet,
+                    uint8_t* sink = nullptr, size_t sinkSize = 0);
+  const char* name() const override { return "loopback"; }
+  size_t writable() override;
+  size_t write(const uint8_t* data, size_t len) override;
+  size_t packetSize() const override { return packet; }
+
+  void setPaused(bool paused) { this->paused = paused; }
+  void advance(uint32_t ms);   // host side: drain for `ms` milliseconds
+  size_t drained() const { return sinkLen; }
+
+private:
+  uint8_t fifo[4096];
+  size_t capacity;
+  size_t drainPerMs;
+  size_t packet;
+  size_t fifoLen;
+  bool paused;
+  uint8_t* sink;
+  size_t sinkSize;
+  size_t sinkLen;
+};
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+// Any Print with a meaningful availableForWrite(): HardwareSerial, USBCDC
+class PrintTransport : public ExportTransport {
+public:
+  PrintTransport(const char* label, Print& out, size_t packet)
+    : label(label), out(out), packet(packet) {}
+  const char* name() const override { return label; }
+  size_t writable() override;
+  size_t write(const uint8_t* data, size_t len) override;
+  size_t packetSize() const override { return packet; }
+
+private:
+  const char* label;
+  Print& out;
+  size_t packet;
+};
+
+// Device-side stream of capture records. Transports: "serial" (UART1,
+// TX on EXPORT_UART_TX at 921600 baud, never the console), on S2/S3 with
+// TinyUSB CDC and the console on UART "usb" (native USB CDC), plus any
+// registered at setup (e.g. "udp", Uplink.h).
+void exportStreamBegin();                          // starts the pump task
+bool exportStreamAddTransport(ExportTransport* transport);
+bool exportStreamSelect(const char* name);         // "off" stops streaming
+int exportStreamNames(const char** names, int max);
+ExportTransport* exportStreamTransport();          // nullptr when off
+uint32_t exportStreamDropped();
+// Packs records into ScanCodec blocks before they are queued
+void exportStreamSetCodec(bool on);
+bool exportStreamCodec();
+void exportStreamRecord(const void* data, size_t len);
+void printExportStreamStats(Print& out);
+#endif
+
+#endif
@@ -0,0 +1,153 @@
+#include "FatImage.h"
+#include <string.h>
+#include <stdio.h>
+
+#define FAT_RESERVED_SECTORS 1
+#define FAT_COPIES 2
+#define FAT_DIR_ENTRY 32
+#define FAT_ROOT_SECTORS (FAT_ROOT_ENTRIES * FAT_DIR_ENTRY / FAT_SECTOR_SIZE)
+#define FAT_CLUSTER_BYTES (FAT_SECTOR_SIZE * FAT_SECTORS_PER_CLUSTER)
+#define FAT_ATTR_READ_ONLY 0x01
+#define FAT_ATTR_VOLUME_ID 0x08
+#define FAT_DATE_1980_01_01 0x0021
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  put16(p, v);
+  put16(p + 2, v >> 16);
+}
+
+FatImage::FatImage()
+  : storage(nullptr), count(0), clusterCount(0), fatSectors(0),
+    firstDataSector(0), totalSectors(0) {}
+
+void FatImage::build(CaptureStorage& source) {
+  storage = &source;
+  SegmentInfo segs[FAT_MAX_FILES];
+  count = source.listNewestSegments(segs, FAT_MAX_FILES);
+
+  uint32_t next = 2;  // clusters 0 and 1 are reserved
+  for (int i = 0; i < count; i++) {
+    files[i].id = segs[i].id;
+    files[i].size = segs[i].size;
+    files[i].clusters = (segs[i].size + FAT_CLUSTER_BYTES - 1) / FAT_CLUSTER_BYTES;
+    files[i].firstCluster = next;
+    next += files[i].clusters;
+  }
+
+  // Pad small volumes up to the FAT16 minimum; the tail is free space
+  clusterCount = next - 2;
+  if (clusterCount < FAT16_MIN_CLUSTERS) clusterCount = FAT16_MIN_CLUSTERS;
+  fatSectors = ((clusterCount + 2) * 2 + FAT_SECTOR_SIZE - 1) / FAT_SECTOR_SIZE;
+  firstDataSector = FAT_RESERVED_SECTORS + FAT_COPIES * fatSectors + FAT_ROOT_SECTORS;
+  totalSectors = firstDataSector + clusterCount * FAT_SECTORS_PER_CLUSTER;
+}
+
+// Files are in cluster order: find the last one starting at or before
+// `cluster` (empty files share their start with the next file)
+const FatImage::File* FatImage::fileForCluster(uint32_t cluster) const {
+  int lo = 0, hi = count;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (files[mid].firstCluster <= cluster) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo == 0) return nullptr;
+  const File& f = files[lo - 1];
+  return cluster < f.firstCluster + f.clusters ? &f : nullptr;
+}
+
+void FatImage::readSector(uint32_t lba, uint8_t* buf) {
+  memset(buf, 0, FAT_SECTOR_SIZE);
+  if (lba < FAT_RESERVED_SECTORS) {
+    bootSector(buf);
+  } else if (lba < FAT_RESERVED_SECTORS + FAT_COPIES * fatSectors) {
+    fatSector((lba - FAT_RESERVED_SECTORS) % fatSectors, buf);
+  } else if (lba < firstDataSector) {
+    rootSector(lba - FAT_RESERVED_SECTORS - FAT_COPIES * fatSectors, buf);
+  } else if (lba < totalSectors) {
+    dataSector(lba - firstDataSector, buf);
+  }
+}
+
+void FatImage::bootSector(uint8_t* buf) const {
+  static const uint8_t jump[3] = {0xEB, 0x3C, 0x90};
+  memcpy(buf, jump, 3);
+  memcpy(buf + 3, "WSCAN1.0", 8);
+  put16(buf + 11, FAT_SECTOR_SIZE);
+  buf[13] = FAT_SECTORS_PER_CLUSTER;
+  put16(buf + 14, FAT_RESERVED_SECTORS);
+  buf[16] = FAT_COPIES;
+  put16(buf + 17, FAT_ROOT_ENTRIES);
+  if (totalSectors < 0x10000) put16(buf + 19, totalSectors);
+  else put32(buf + 32, totalSectors);
+  buf[21] = 0xF8;                  // fixed disk
+  put16(buf + 22, fatSectors);
+  put16(buf + 24, 63);             // sectors per track
+  put16(buf + 26, 255);            // heads
+  buf[36] = 0x80;                  // drive number
+  buf[38] = 0x29;                  // extended boot signature
+  put32(buf + 39, 0x5753434E);     // volume serial
+  memcpy(buf + 43, "WSCAN LOGS ", 11);
+  memcpy(buf + 54, "FAT16   ", 8);
+  buf[510] = 0x55;
+  buf[511] = 0xAA;
+}
+
+void FatImage::fatSector(uint32_t index, uint8_t* buf) const {
+  const uint32_t perSector = FAT_SECTOR_SIZE / 2;
+  uint32_t cluster = index * perSector;
+  const File* f = nullptr;
+  for (uint32_t i = 0; i < perSector; i++, cluster++) {
+    uint16_t v = 0;
+    if (cluster == 0) {
+      v = 0xFFF8;
+    } else if (cluster == 1) {
+      v = 0xFFFF;
+    } else if (cluster < clusterCount + 2) {
+      // Consecutive clusters usually belong to the same file
+      if (!f || cluster >= f->firstCluster + f->clusters) f = fileForCluster(cluster);
+      if (f) v = (cluster + 1 == f->firstCluster + f->clusters) ? 0xFFFF : cluster + 1;
+    }
+    put16(buf + i * 2, v);
+  }
+}
+
+void FatImage::rootSector(uint32_t index, uint8_t* buf) const {
+  const uint32_t perSector = FAT_SECTOR_SIZE / FAT_DIR_ENTRY;
+  for (uint32_t i = 0; i < perSector; i++) {
+    uint32_t entry = index * perSector + i;
+    uint8_t* e = buf + i * FAT_DIR_ENTRY;
+    if (entry == 0) {
+      memcpy(e, "WSCAN LOGS ", 11);
+      e[11] = FAT_ATTR_VOLUME_ID;
+    } else if (entry <= (uint32_t)count) {
+      const File& f = files[entry - 1];
+      char name[12];
+      snprintf(name, sizeof(name), "%08luBIN", (unsigned long)(f.id % 100000000));
+      memcpy(e, name, 11);
+      e[11] = FAT_ATTR_READ_ONLY;
+      put16(e + 16, FAT_DATE_1980_01_01);   // created
+      put16(e + 18, FAT_DATE_1980_01_01);   // accessed
+      put16(e + 24, FAT_DATE_1980_01_01);   // modified
+      put16(e + 26, f.clusters ? f.firstCluster : 0);
+      put32(e + 28, f.size);
+    }
+  }
+}
+
+void FatImage::dataSector(uint32_t index, uint8_t* buf) {
+  uint32_t cluster = index / FAT_SECTORS_PER_CLUSTER + 2;
+  const File* f = fileForCluster(cluster);
+  if (!f || !storage) return;
+  uint32_t offset = (cluster - f->firstCluster) * FAT_CLUSTER_BYTES +
+                    (index % FAT_SECTORS_PER_CLUSTER) * FAT_SECTOR_SIZE;
+  if (offset >= f->size) return;
+  uint32_t len = f->size - offset;
+  if (len > FAT_SECTOR_SIZE) len = FAT_SECTOR_SIZE;
+  storage->readSegment(f->id, offset, buf, len);
+}
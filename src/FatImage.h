@@ -0,0 +1,60 @@
+#ifndef FAT_IMAGE_H
+#define FAT_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "CaptureStorage.h"
+
+// Read-only FAT16 volume synthesized on the fly from the closed capture
+// segments: one file per segment (SSSSSSSS.BIN, the segment id), laid out
+// in consecutive clusters; the newest FAT_MAX_FILES segments when there
+// are more. Boot sector, FATs and the root directory are
+// computed per sector from the segment list, and data sectors are read
+// straight out of CaptureStorage, so nothing is copied or buffered.
+// Used by the USB mass-storage mode (UsbDrive.h); pure C++ so the image
+// can be dumped and checked with a FAT parser on the host.
+
+#define FAT_SECTOR_SIZE 512
+#define FAT_SECTORS_PER_CLUSTER 8           // 4 KB clusters
+#define FAT_ROOT_ENTRIES 512
+#define FAT_MAX_FILES 64
+#define FAT16_MIN_CLUSTERS 4096             // below 4085 it would be FAT12
+
+class FatImage {
+public:
+  FatImage();
+
+  // Snapshots the closed segments of `storage`. Segments removed after
+  // this read back as zeros; call again to pick up new ones.
+  void build(CaptureStorage& storage);
+
+  uint32_t sectorCount() const { return totalSectors; }
+  int fileCount() const { return count; }
+
+  // Fills one FAT_SECTOR_SIZE sector
+  void readSector(uint32_t lba, uint8_t* buf);
+
+private:
+  struct File {
+    uint32_t id;
+    uint32_t size;
+    uint32_t firstCluster;   // 0 for empty files
+    uint32_t clusters;
+  };
+
+  const File* fileForCluster(uint32_t cluster) const;
+  void bootSector(uint8_t* buf) const;
+  void fatSector(uint32_t index, uint8_t* buf) const;
+  void rootSector(uint32_t index, uint8_t* buf) const;
+  void dataSector(uint32_t index, uint8_t* buf);
+
+  CaptureStorage* storage;
+  File files[FAT_MAX_FILES];
+  int count;
+  uint32_t clusterCount;
+  uint32_t fatSectors;
+  uint32_t firstDataSector;
+  uint32_t totalSectors;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "FlashRegion.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef ARDUINO
+
+bool FlashRegion::open(const char* label, const char*, size_t) {
+  close();
+  part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (!part) {
+    log_w("no '%s' partition", label);
+    return false;
+  }
+  size = part->size;
+  return true;
+}
+
+void FlashRegion::close() {
+  for (int n = 0; n < FLASH_REGION_WINDOWS; n++) {
+    if (window[n]) spi_flash_munmap(handle[n]);
+    window[n] = nullptr;
+  }
+  part = nullptr;
+  size = 0;
+}
+
+const uint8_t* FlashRegion::mapWindow(int n, size_t offset, size_t len) {
+  if (!part || n < 0 || n >= FLASH_REGION_WINDOWS || offset + len > size) return nullptr;
+  // Unmap first: the old and new range together may not fit the data window
+  if (window[n]) spi_flash_munmap(handle[n]);
+  window[n] = nullptr;
+  const void* ptr;
+  esp_err_t err = esp_partition_mmap(part, offset, len, SPI_FLASH_MMAP_DATA, &ptr, &handle[n]);
+  if (err != ESP_OK) {
+    log_e("mmap of '%s' at 0x%x failed: %d", part->label, (unsigned)offset, err);
+    return nullptr;
+  }
+  window[n] = (const uint8_t*)ptr;
+  return window[n];
+}
+
+bool FlashRegion::read(size_t offset, void* dst, size_t len) const {
+  return part && esp_partition_read(part, offset, dst, len) == ESP_OK;
+}
+
+bool FlashRegion::erase(size_t offset, size_t len) {
+  return part && esp_partition_erase_range(part, offset, len) == ESP_OK;
+}
+
+bool FlashRegion::write(size_t offset, const void* src, size_t len) {
+  return part && esp_partition_write(part, offset, src, len) == ESP_OK;
+}
+
+#else
+
+bool FlashRegion::open(const char*, const char* hostPath, size_t hostSize) {
+  close();
+  if (!hostPath || hostSize == 0) return false;
+  fd = ::open(hostPath, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return false;
+  struct stat st;
+  fstat(fd, &st);
+  bool fresh = (size_t)st.st_size != hostSize;
+  if (fresh && ftruncate(fd, hostSize) != 0) {
+    close();
+    return false;
+  }
+  void* ptr = mmap(nullptr, hostSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (ptr == MAP_FAILED) {
+    close();
+    return false;
+  }
+  rw = (uint8_t*)ptr;
+  size = hostSize;
+  if (fresh) memset(rw, 0xFF, hostSize);
+  return true;
+}
+
+void FlashRegion::close() {
+  if (rw) munmap(rw, size);
+  if (fd >= 0) ::close(fd);
+  rw = nullptr;
+  fd = -1;
+  size = 0;
+}
+
+// The whole file stays mapped, so a window is just a pointer into it
+const uint8_t* FlashRegion::mapWindow(int n, size_t offset, size_t len) {
+  if (!rw || n < 0 || n >= FLASH_REGION_WINDOWS || offset + len > size) return nullptr;
+  return rw + offset;
+}
+
+bool FlashRegion::read(size_t offset, void* dst, size_t len) const {
+  if (!rw || offset + len > size) return false;
+  memcpy(dst, rw + offset, len);
+  return true;
+}
+
+bool FlashRegion::erase(size_t offset, size_t len) {
+  if (!rw || offset + len > size) return false;
+  memset(rw + offset, 0xFF, len);
+  return true;
+}
+
+bool FlashRegion::write(size_t offset, const void* src, size_t len) {
+  if (!rw || offset + len > size) return false;
+  const uint8_t* s = (const uint8_t*)src;
+  for (size_t i = 0; i < len; i++) rw[offset + i] &= s[i];
+  return true;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef FLASH_REGION_H
+#define FLASH_REGION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <esp_partition.h>
+#endif
+
+#define FLASH_SECTOR_SIZE 4096
+#define FLASH_REGION_WINDOWS 2
+
+// A raw data partition addressed by offset. On the ESP32 it is looked up
+// by label; up to FLASH_REGION_WINDOWS ranges of it can be memory-mapped
+// for zero-copy reads. The data mmap window is 4 MB in total, shared with
+// the app's rodata, so only the ranges in use are mapped, never the whole
+// partition. On the host a file stands in for it, always mapped, with NOR
+// semantics: writes can only clear bits.
+class FlashRegion {
+public:
+  FlashRegion() {}
+  ~FlashRegion() { close(); }
+
+  bool open(const char* label, const char* hostPath = nullptr, size_t hostSize = 0);
+  void close();
+
+  bool isOpen() const { return size > 0; }
+  size_t length() const { return size; }
+  // Maps [offset, offset + len) into window n, replacing what it mapped
+  // before. Returns nullptr if the mapping failed (the window is then empty).
+  const uint8_t* mapWindow(int n, size_t offset, size_t len);
+
+  bool read(size_t offset, void* dst, size_t len) const;
+  bool erase(size_t offset, size_t len);             // sector aligned
+  bool write(size_t offset, const void* src, size_t len);
+
+private:
+  FlashRegion(const FlashRegion&);
+  FlashRegion& operator=(const FlashRegion&);
+
+  size_t size = 0;
+#ifdef ARDUINO
+  const esp_partition_t* part = nullptr;
+  const uint8_t* window[FLASH_REGION_WINDOWS] = {};
+  spi_flash_mmap_handle_t handle[FLASH_REGION_WINDOWS] = {};
+#else
+  int fd = -1;
+  uint8_t* rw = nullptr;
+#endif
+};
+
+#endif
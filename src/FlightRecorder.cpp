@@ -0,0 +1,201 @@
+#include "FlightRecorder.h"
+#include <string.h>
+
+FlightRecorder::FlightRecorder()
+    : blockCount(0), current(-1), pinned(0), nextSeq(0), event(EVENT_IDLE), postEndMs(0) {
+  memset(blocks, 0, sizeof(blocks));
+  memset(&pending, 0, sizeof(pending));
+  memset(&counters, 0, sizeof(counters));
+}
+
+void FlightRecorder::begin(uint8_t* arena, size_t bytes) {
+  std::lock_guard<std::mutex> guard(lock);
+  size_t n = arena ? bytes / FLIGHT_BLOCK_BYTES : 0;
+  blockCount = n < FLIGHT_BLOCKS_MAX ? n : FLIGHT_BLOCKS_MAX;
+  memset(blocks, 0, sizeof(blocks));
+  for (int i = 0; i < blockCount; i++) blocks[i].data = arena + i * FLIGHT_BLOCK_BYTES;
+  current = -1;
+  pinned = 0;
+  event = EVENT_IDLE;
+}
+
+// A free block, else the oldest sealed one outside the event
+int FlightRecorder::claimLocked() {
+  int oldest = -1;
+  for (int i = 0; i < blockCount; i++) {
+    const Block& b = blocks[i];
+    if (b.state == BLOCK_FREE) return i;
+    if (b.state == BLOCK_SEALED && !b.pinned &&
+        (oldest < 0 || (int32_t)(b.seq - blocks[oldest].seq) < 0)) {
+      oldest = i;
+    }
+  }
+  if (oldest >= 0) counters.reused++;
+  return oldest;
+}
+
+void FlightRecorder::sealLocked() {
+  blocks[current].state = BLOCK_SEALED;
+  current = -1;
+}
+
+bool FlightRecorder::pinLocked(Block& b) {
+  if (b.pinned) return true;
+  if (pinned >= blockCount - FLIGHT_SPARE_BLOCKS) return false;
+  b.pinned = true;
+  pinned++;
+  return true;
+}
+
+// The post-trigger window is over (or out of blocks): the event is ready
+void FlightRecorder::closeLocked(bool truncated) {
+  if (current >= 0 && blocks[current].pinned) sealLocked();
+  if (truncated) pending.truncated = true;
+  if (pending.truncated) counters.truncated++;
+  counters.events++;
+  event = EVENT_READY;
+}
+
+bool FlightRecorder::append(const void* rec, size_t len) {
+  uint32_t t = ((const CaptureRecordHeader*)rec)->timeMs;
+  std::lock_guard<std::mutex> guard(lock);
+  if (blockCount == 0) return false;
+  if (event == EVENT_COLLECTING && (int32_t)(t - postEndMs) >= 0) closeLocked(false);
+  if (len > FLIGHT_BLOCK_BYTES) {
+    counters.dropped++;
+    return false;
+  }
+  if (current >= 0 && blocks[current].used + len > FLIGHT_BLOCK_BYTES) sealLocked();
+  if (current < 0) {
+    int i = claimLocked();
+    if (i < 0) {
+      counters.dropped++;
+      return false;
+    }
+    Block& b = blocks[i];
+    b.used = 0;
+    b.seq = nextSeq++;
+    b.firstMs = t;
+    b.state = BLOCK_FILLING;
+    b.pinned = false;
+    current = i;
+    if (event == EVENT_COLLECTING && !pinLocked(b)) closeLocked(true);
+  }
+  Block& b = blocks[current];
+  memcpy(b.data + b.used, rec, len);
+  b.used += len;
+  b.lastMs = t;
+  counters.records++;
+  return true;
+}
+
+bool FlightRecorder::trigger(FlightTrigger reason, const char* note, uint32_t nowMs) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (blockCount == 0) return false;
+  if (event == EVENT_COLLECTING) {
+    postEndMs = nowMs + FLIGHT_POST_MS;
+    return true;
+  }
+  if (event != EVENT_IDLE) {
+    counters.busy++;
+    return false;
+  }
+  memset(&pending, 0, sizeof(pending));
+  pending.reason = reason;
+  strncpy(pending.note, note ? note : "", FLIGHT_NOTE_LEN);
+  pending.triggerMs = nowMs;
+  event = EVENT_COLLECTING;
+  postEndMs = nowMs + FLIGHT_POST_MS;
+
+  // The block being filled, then sealed ones back to the start of the
+  // window, newest first so a short arena loses the oldest part. The pre-
+  // trigger side gets its share of the blocks, the rest is for the post-
+  // trigger side
+  if (current >= 0 && !pinLocked(blocks[current])) pending.truncated = true;
+  int preLimit =
+      (blockCount - FLIGHT_SPARE_BLOCKS) * FLIGHT_PRE_MS / (FLIGHT_PRE_MS + FLIGHT_POST_MS);
+  uint32_t fromMs = nowMs - FLIGHT_PRE_MS;
+  uint32_t below = nextSeq;
+  while (!pending.truncated) {
+    int next = -1;
+    for (int i = 0; i < blockCount; i++) {
+      const Block& b = blocks[i];
+      if (b.state != BLOCK_SEALED || b.pinned || (int32_t)(b.seq - below) >= 0) continue;
+      if (next < 0 || (int32_t)(b.seq - blocks[next].seq) > 0) next = i;
+    }
+    if (next < 0 || (int32_t)(blocks[next].lastMs - fromMs) < 0) break;
+    if (pinned >= preLimit || !pinLocked(blocks[next])) pending.truncated = true;
+    below = blocks[next].seq;
+  }
+  return true;
+}
+
+void FlightRecorder::tick(uint32_t nowMs) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (event == EVENT_COLLECTING && (int32_t)(nowMs - postEndMs) >= 0) closeLocked(false);
+}
+
+bool FlightRecorder::take(FlightEvent& out) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (event != EVENT_READY) return false;
+  out = pending;
+  out.count = 0;
+  out.bytes = 0;
+  // Pinned blocks in fill order
+  uint32_t above = 0;
+  bool first = true;
+  for (;;) {
+    int next = -1;
+    for (int i = 0; i < blockCount; i++) {
+      const Block& b = blocks[i];
+      if (!b.pinned || b.state != BLOCK_SEALED || (!first && (int32_t)(b.seq - above) <= 0)) continue;
+      if (next < 0 || (int32_t)(b.seq - blocks[next].seq) < 0) next = i;
+    }
+    if (next < 0) break;
+    Block& b = blocks[next];
+    b.state = BLOCK_FLUSHING;
+    if (out.count == 0) out.fromMs = b.firstMs;
+    out.toMs = b.lastMs;
+    out.blocks[out.count].data = b.data;
+    out.blocks[out.count].len = b.used;
+    out.count++;
+    out.bytes += b.used;
+    above = b.seq;
+    first = false;
+  }
+  event = EVENT_FLUSHING;
+  return true;
+}
+
+void FlightRecorder::release() {
+  std::lock_guard<std::mutex> guard(lock);
+  for (int i = 0; i < blockCount; i++) {
+    Block& b = blocks[i];
+    if (b.state != BLOCK_FLUSHING) continue;
+    b.state = BLOCK_FREE;
+    b.pinned = false;
+  }
+  pinned = 0;
+  if (event == EVENT_FLUSHING) event = EVENT_IDLE;
+}
+
+bool FlightRecorder::collecting() {
+  std::lock_guard<std::mutex> guard(lock);
+  return event == EVENT_COLLECTING;
+}
+
+FlightStats FlightRecorder::stats() {
+  std::lock_guard<std::mutex> guard(lock);
+  FlightStats s = counters;
+  s.blocks = blockCount;
+  s.pinned = pinned;
+  s.heldMs = 0;
+  int oldest = -1;
+  for (int i = 0; i < blockCount; i++) {
+    const Block& b = blocks[i];
+    if (b.state == BLOCK_FREE) continue;
+    if (oldest < 0 || (int32_t)(b.seq - blocks[oldest].seq) < 0) oldest = i;
+  }
+  if (oldest >= 0 && current >= 0) s.heldMs = blocks[current].lastMs - blocks[oldest].firstMs;
+  return s;
+}
@@ -0,0 +1,126 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include "CaptureStorage.h"
+
+// Pre-trigger capture buffer. Every capture record (survey reports,
+// sniffed frames) is also appended here, into fixed blocks of whole
+// records carved from one arena in RAM or PSRAM; the oldest sealed block
+// is reused when the arena is full, so it always holds the last few
+// seconds. A trigger pins the blocks of the pre-trigger window, and the
+// blocks filled until the post-trigger window ends; the event is then
+// handed to the flush task as a list of block pointers, written out
+// without copying, and the blocks return to the arena. Live capture keeps
+// the unpinned blocks: an event is cut short rather than take the last
+// FLIGHT_SPARE_BLOCKS. One event at a time; a trigger during the
+// post-trigger window extends it.
+
+#define FLIGHT_BLOCK_BYTES CAPTURE_BATCH_BYTES   // one storage write each
+#define FLIGHT_BLOCKS_MAX 256
+#define FLIGHT_SPARE_BLOCKS 2
+#define FLIGHT_PRE_MS 10000
+#define FLIGHT_POST_MS 5000
+#define FLIGHT_NOTE_LEN 12
+
+enum FlightTrigger : uint8_t {
+  FLIGHT_RULE = 1,
+  FLIGHT_BUTTON = 2,
+  FLIGHT_SERIAL = 3
+};
+
+struct FlightBlock {
+  const uint8_t* data;
+  uint32_t len;
+};
+
+// An event ready to be written out; blocks stay valid until release()
+struct FlightEvent {
+  uint8_t reason;
+  bool truncated;
+  char note[FLIGHT_NOTE_LEN];
+  uint32_t triggerMs;
+  uint32_t fromMs;
+  uint32_t toMs;
+  uint32_t bytes;
+  int count;
+  FlightBlock blocks[FLIGHT_BLOCKS_MAX];
+};
+
+struct FlightStats {
+  uint32_t records;
+  uint32_t dropped;     // no block to put them in
+  uint32_t reused;      // sealed blocks aged out
+  uint32_t events;
+  uint32_t busy;        // triggers while the previous event was flushing
+  uint32_t truncated;
+  uint32_t heldMs;      // span of the records in the arena
+  int blocks;
+  int pinned;
+};
+
+class FlightRecorder {
+public:
+  FlightRecorder();
+
+  // The arena; its size is rounded down to whole blocks
+  void begin(uint8_t* arena, size_t bytes);
+
+  // A capture record (CaptureRecordHeader first); its timeMs is the clock
+  bool append(const void* rec, size_t len);
+
+  // false if an event is still being written out
+  bool trigger(FlightTrigger reason, const char* note, uint32_t nowMs);
+  // Ends the post-trigger window when no records arrive
+  void tick(uint32_t nowMs);
+
+  // Flush side
+  bool take(FlightEvent& out);
+  void release();
+
+  bool collecting();
+  FlightStats stats();
+
+private:
+  enum BlockState : uint8_t {
+    BLOCK_FREE,
+    BLOCK_FILLING,
+    BLOCK_SEALED,
+    BLOCK_FLUSHING
+  };
+  enum EventState : uint8_t {
+    EVENT_IDLE,
+    EVENT_COLLECTING,
+    EVENT_READY,
+    EVENT_FLUSHING
+  };
+  struct Block {
+    uint8_t* data;
+    uint32_t used;
+    uint32_t seq;       // fill order
+    uint32_t firstMs;
+    uint32_t lastMs;
+    BlockState state;
+    bool pinned;
+  };
+
+  int claimLocked();
+  void sealLocked();
+  void closeLocked(bool truncated);
+  bool pinLocked(Block& b);
+
+  std::mutex lock;
+  Block blocks[FLIGHT_BLOCKS_MAX];
+  int blockCount;
+  int current;
+  int pinned;
+  uint32_t nextSeq;
+  EventState event;
+  FlightEvent pending;
+  uint32_t postEndMs;
+  FlightStats counters;
+};
+
+#endif
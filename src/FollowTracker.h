@@ -0,0 +1,132 @@
+#ifndef FOLLOW_TRACKER_H
+#define FOLLOW_TRACKER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <mutex>
+
+// Signal of the one device being followed while walking toward it. Fed by
+// the scanner task (WiFi probes) or the BT task (BLE advertisements), read
+// by the UI. Two exponential averages over the RSSI samples: the fast one
+// is shown, and its lead over the slow one is the trend, with hysteresis
+// so the arrow does not flicker on a steady signal. The averages weigh
+// each sample by the time since the previous one, so a burst of
+// advertisements does not outvote the last second.
+
+#define FOLLOW_FAST_MS 500         // time constant of the displayed value
+#define FOLLOW_SLOW_MS 2000        // reference for the trend
+#define FOLLOW_TREND_DB 2.0f       // lead that turns the arrow on
+#define FOLLOW_STALE_MS 2000       // nothing heard for this long
+#define FOLLOW_RATE_WINDOW_MS 2000
+#define FOLLOW_BAR_MIN_DBM -95
+#define FOLLOW_BAR_MAX_DBM -35
+
+enum FollowTrend : int8_t {
+  TREND_DOWN = -1,
+  TREND_FLAT = 0,
+  TREND_UP = 1
+};
+
+// Events per second over the last completed window
+struct RateMeter {
+  uint32_t startMs;
+  uint32_t count;
+  float hz;
+
+  void reset(uint32_t nowMs) {
+    startMs = nowMs;
+    count = 0;
+    hz = 0;
+  }
+  void tick(uint32_t nowMs) {
+    count++;
+    roll(nowMs);
+  }
+  void roll(uint32_t nowMs) {
+    uint32_t elapsed = nowMs - startMs;
+    if (elapsed < FOLLOW_RATE_WINDOW_MS) return;
+    hz = count * 1000.0f / elapsed;
+    startMs = nowMs;
+    count = 0;
+  }
+};
+
+struct FollowView {
+  bool valid;           // at least one sample
+  bool stale;
+  float dbm;            // smoothed
+  int last;             // latest sample
+  FollowTrend trend;
+  float rateHz;         // samples per second
+  uint32_t samples;
+  uint32_t probes;      // targeted scans, WiFi only
+  uint32_t version;     // changes with every sample
+};
+
+class FollowTracker {
+public:
+  FollowTracker() { reset(0); }
+
+  void reset(uint32_t nowMs) {
+    std::lock_guard<std::mutex> guard(lock);
+    memset(&state, 0, sizeof(state));
+    fast = slow = 0;
+    lastMs = nowMs;
+    rate.reset(nowMs);
+  }
+
+  void sample(int rssi, uint32_t nowMs) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!state.valid) {
+      fast = slow = rssi;
+      state.valid = true;
+    } else {
+      float dt = nowMs - lastMs;
+      fast += (rssi - fast) * dt / (FOLLOW_FAST_MS + dt);
+      slow += (rssi - slow) * dt / (FOLLOW_SLOW_MS + dt);
+    }
+    float lead = fast - slow;
+    if (lead > FOLLOW_TREND_DB) state.trend = TREND_UP;
+    else if (lead < -FOLLOW_TREND_DB) state.trend = TREND_DOWN;
+    else if (lead > -FOLLOW_TREND_DB / 2 && lead < FOLLOW_TREND_DB / 2) state.trend = TREND_FLAT;
+    state.last = rssi;
+    state.samples++;
+    state.version++;
+    lastMs = nowMs;
+    rate.tick(nowMs);
+  }
+
+  // A targeted scan ran, whether or not it heard the device
+  void probed() {
+    std::lock_guard<std::mutex> guard(lock);
+    state.probes++;
+  }
+
+  FollowView view(uint32_t nowMs) {
+    std::lock_guard<std::mutex> guard(lock);
+    rate.roll(nowMs);
+    FollowView v = state;
+    v.dbm = fast;
+    v.stale = !v.valid || nowMs - lastMs > FOLLOW_STALE_MS;
+    v.rateHz = v.stale ? 0 : rate.hz;
+    if (v.stale) v.trend = TREND_FLAT;
+    return v;
+  }
+
+  // Filled part of a bar of the given resolution
+  static int barLevel(float dbm, int steps) {
+    if (dbm <= FOLLOW_BAR_MIN_DBM) return 0;
+    if (dbm >= FOLLOW_BAR_MAX_DBM) return steps;
+    return (int)((dbm - FOLLOW_BAR_MIN_DBM) * steps / (FOLLOW_BAR_MAX_DBM - FOLLOW_BAR_MIN_DBM) + 0.5f);
+  }
+
+private:
+  std::mutex lock;
+  FollowView state;
+  float fast;
+  float slow;
+  uint32_t lastMs;
+  RateMeter rate;
+};
+
+#endif
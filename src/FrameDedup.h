@@ -0,0 +1,113 @@
+#ifndef FRAME_DEDUP_H
+#define FRAME_DEDUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Drops 802.11 frames that were already captured: retransmissions (the
+// retry bit is set) and copies heard again after a channel hop. A frame is
+// identified by its transmitter address, sequence control (sequence and
+// fragment number) and, for QoS data, its TID, which has a sequence space
+// of its own. Keys live in a hash of 4-way buckets and count only for
+// DEDUP_WINDOW_MS, well short of a busy sender wrapping its 12 bit
+// sequence; a full bucket gives up its oldest key. Constant memory and at
+// most 4 compares per frame. Frames without a sequence number (control
+// frames, anything shorter than a MAC header) always pass.
+
+#define DEDUP_BUCKET_BITS 7
+#define DEDUP_BUCKETS (1 << DEDUP_BUCKET_BITS)
+#define DEDUP_WAYS 4
+#define DEDUP_WINDOW_MS 100       // retries and copies come within tens of ms
+
+enum DedupVerdict {
+  DEDUP_NEW,
+  DEDUP_RETRY,       // retry bit set, original already captured
+  DEDUP_DUPLICATE    // same frame again without the retry bit
+};
+
+struct DedupStats {
+  uint32_t frames;
+  uint32_t passed;
+  uint32_t retries;        // dropped, DEDUP_RETRY
+  uint32_t duplicates;     // dropped, DEDUP_DUPLICATE
+  uint32_t lateRetries;    // retry bit set but the original was missed; kept
+  uint32_t evictions;      // live keys pushed out of a full bucket
+};
+
+class FrameDedup {
+public:
+  FrameDedup() { clear(); }
+
+  void clear() {
+    memset(table, 0, sizeof(table));
+    memset(&counters, 0, sizeof(counters));
+  }
+
+  // frame: the 802.11 header onwards, without FCS
+  DedupVerdict check(const uint8_t* frame, size_t len, uint32_t nowMs) {
+    counters.frames++;
+    uint8_t type = (frame[0] >> 2) & 3;
+    if (len < 24 || type == 1) {   // control frames carry no sequence number
+      counters.passed++;
+      return DEDUP_NEW;
+    }
+    bool retry = frame[1] & 0x08;
+    uint64_t key = 0;
+    memcpy(&key, frame + 10, 6);                          // addr2: transmitter
+    key |= (uint64_t)(frame[22] | frame[23] << 8) << 48;  // sequence control
+    uint8_t tid = 16;
+    bool fourAddr = (frame[1] & 3) == 3;
+    size_t qosAt = fourAddr ? 30 : 24;
+    if (type == 2 && (frame[0] & 0x80) && len >= qosAt + 2) tid = frame[qosAt] & 0x0F;
+
+    // Look for the key; meanwhile pick a stale way, else the oldest
+    Entry* bucket = table[hash(key, tid)];
+    Entry* victim = nullptr;
+    bool victimLive = false;
+    for (int i = 0; i < DEDUP_WAYS; i++) {
+      Entry& e = bucket[i];
+      bool live = e.used && nowMs - e.ms < DEDUP_WINDOW_MS;
+      if (live && e.key == key && e.tid == tid) {
+        e.ms = nowMs;   // a retry storm keeps the key alive
+        if (retry) {
+          counters.retries++;
+          return DEDUP_RETRY;
+        }
+        counters.duplicates++;
+        return DEDUP_DUPLICATE;
+      }
+      if (!victim || (victimLive && (!live || nowMs - e.ms > nowMs - victim->ms))) {
+        victim = &e;
+        victimLive = live;
+      }
+    }
+    if (victimLive) counters.evictions++;
+    victim->key = key;
+    victim->tid = tid;
+    victim->ms = nowMs;
+    victim->used = true;
+    if (retry) counters.lateRetries++;
+    counters.passed++;
+    return DEDUP_NEW;
+  }
+
+  const DedupStats& stats() const { return counters; }
+
+private:
+  struct Entry {
+    uint64_t key;   // transmitter, then sequence control in the top 16 bits
+    uint32_t ms;
+    uint8_t tid;    // 16: not QoS data
+    bool used;
+  };
+
+  static uint32_t hash(uint64_t key, uint8_t tid) {
+    return (uint32_t)(((key ^ tid) * 0x9E3779B97F4A7C15ULL) >> (64 - DEDUP_BUCKET_BITS));
+  }
+
+  Entry table[DEDUP_BUCKETS][DEDUP_WAYS];
+  DedupStats counters;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "Harvest.h"
+#include <BLEDevice.h>
+#include <esp_timer.h>
+
+static DisHarvester harvester;
+static std::mutex radioLock;
+
+// One BLEClient per connection: its service map outlives a disconnect
+class BleDisClient : public DisClient {
+public:
+  BleDisClient() {
+    esp_timer_create_args_t args = {};
+    args.callback = onTimeout;
+    args.arg = this;
+    args.name = "dis";
+    esp_timer_create(&args, &watchdog);
+  }
+
+  bool connect(const uint8_t id[6], uint8_t addrType, uint32_t timeoutMs) override {
+    memcpy(peer, id, 6);
+    client = BLEDevice::createClient();
+    std::lock_guard<std::mutex> guard(radioLock);
+    // BLEClient waits for the open event without a limit; cancelling the
+    // link makes the stack fail it
+    esp_timer_start_once(watchdog, (uint64_t)timeoutMs * 1000);
+    bool ok = client->connect(BLEAddress(peer), (esp_ble_addr_type_t)addrType);
+    esp_timer_stop(watchdog);
+    if (!ok) {
+      delete client;   // connect() already dropped the peer registration
+      client = nullptr;
+    }
+    return ok;
+  }
+
+  bool hasService() override {
+    service = client->getService(BLEUUID((uint16_t)0x180A));
+    return service != nullptr;
+  }
+
+  int read(uint16_t uuid, char* out, size_t cap) override {
+    BLERemoteCharacteristic* c = service->getCharacteristic(BLEUUID(uuid));
+    if (!c || !c->canRead()) return -1;
+    std::string value = c->readValue();
+    size_t n = value.size() < cap ? value.size() : cap;
+    memcpy(out, value.data(), n);
+    return n;
+  }
+
+  void disconnect() override {
+    client->disconnect();
+    // The client stays registered with BLEDevice until the event arrives
+    uint32_t start = millis();
+    while (client->isConnected() && millis() - start < HARVEST_CLOSE_WAIT_MS) delay(20);
+    if (!client->isConnected()) delete client;   // else leak it rather than free it under the stack
+    client = nullptr;
+    service = nullptr;
+  }
+
+private:
+  static void onTimeout(void* arg) {
+    esp_ble_gap_disconnect(((BleDisClient*)arg)->peer);
+  }
+
+  BLEClient* client = nullptr;
+  BLERemoteService* service = nullptr;
+  esp_timer_handle_t watchdog = nullptr;
+  uint8_t peer[6];
+};
+
+static void harvestTask(void* param) {
+  BleDisClient client;
+  DisJob job;
+  DisResult result;
+  for (;;) {
+    if (!harvester.take(job, millis())) {
+      vTaskDelay(pdMS_TO_TICKS(HARVEST_IDLE_MS));
+      continue;
+    }
+    DisHarvester::run(client, job, result);
+    harvester.finish(job, result, millis());
+  }
+}
+
+void harvestBegin() {
+  for (int i = 0; i < DIS_MAX_CONCURRENT; i++) {
+    xTaskCreatePinnedToCore(harvestTask, "dis", 4096, NULL, HARVEST_TASK_PRIORITY, NULL, 0);
+  }
+}
+
+void harvestOffer(const uint8_t id[6], uint8_t addrType) {
+  harvester.offer(id, addrType, millis());
+}
+
+std::mutex& harvestRadioLock() {
+  return radioLock;
+}
+
+bool harvestLookup(const uint8_t id[6], DisRecord& out) {
+  return harvester.lookup(id, out);
+}
+
+void printHarvest(Print& out) {
+  DisStats s = harvester.stats();
+  out.printf("dis: %d connected, %u offered, %u queued, %u connects (peak %u)\n",
+             harvester.inFlight(), s.offered, s.queued, s.connects, s.peakInFlight);
+  out.printf("  %u harvested, %u without DIS, %u failed, %u merged, %u evicted\n", s.harvested,
+             s.noService, s.failures, s.merged, s.evicted);
+  DisRecord recs[DIS_CACHE_SIZE];
+  int n = harvester.records(recs, DIS_CACHE_SIZE);
+  for (int i = 0; i < n; i++) {
+    const uint8_t* a = recs[i].id;
+    out.printf("  %02x:%02x:%02x:%02x:%02x:%02x", a[0], a[1], a[2], a[3], a[4], a[5]);
+    for (int f = 0; f < DIS_FIELD_COUNT; f++) {
+      if (recs[i].fields[f][0]) out.printf(" %s=%s", disFieldName((DisField)f), recs[i].fields[f]);
+    }
+    out.println();
+  }
+}
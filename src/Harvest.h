@@ -0,0 +1,23 @@
+#ifndef HARVEST_H
+#define HARVEST_H
+
+#include <Arduino.h>
+#include <mutex>
+#include "DisHarvest.h"
+
+// Device Information Service harvesting (DisHarvest.h) over BLEClient. The
+// workers only initiate a connection while no scan window is open: scanBLE
+// holds harvestRadioLock() around its window, the workers around connect().
+
+#define HARVEST_TASK_PRIORITY 0
+#define HARVEST_IDLE_MS 200
+#define HARVEST_CLOSE_WAIT_MS 2000   // for the disconnect event before freeing the client
+
+void harvestBegin();
+// A connectable advertiser from the last window; queued if it is due
+void harvestOffer(const uint8_t id[6], uint8_t addrType);
+std::mutex& harvestRadioLock();
+bool harvestLookup(const uint8_t id[6], DisRecord& out);
+void printHarvest(Print& out);
+
+#endif
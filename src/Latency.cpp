@@ -0,0 +1,29 @@
+#include "Latency.h"
+
+LatencyHistogram latencyHistograms[LAT_STAGE_COUNT];
+
+const char* latencyStageName(LatencyStage stage) {
+  switch (stage) {
+    case LAT_AGGREGATE:
+      return "Aggr";
+    case LAT_DISPLAY:
+      return "Disp";
+    case LAT_EXPORT:
+      return "Expt";
+    default:
+      return "?";
+  }
+}
+
+void printLatencyReport(Print& out) {
+  out.println("stage     n      p50(us)    p99(us)   p999(us)    max(us)");
+  for (int i = 0; i < LAT_STAGE_COUNT; i++) {
+    const LatencyHistogram& h = latencyHistograms[i];
+    out.printf("%-5s %7u %10u %10u %10u %10u\n", latencyStageName((LatencyStage)i),
+               h.count(), h.percentile(0.50), h.percentile(0.99), h.percentile(0.999), h.max());
+  }
+}
+
+void resetLatencyHistograms() {
+  for (int i = 0; i < LAT_STAGE_COUNT; i++) latencyHistograms[i].reset();
+}
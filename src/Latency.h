@@ -0,0 +1,36 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <Arduino.h>
+#include "LatencyHistogram.h"
+
+// End-to-end latency stages, all measured from the moment a report is
+// ingested (scan-done event, GAP advertising callback, promiscuous RX).
+enum LatencyStage {
+  LAT_AGGREGATE,   // ingest -> stored in the device table
+  LAT_DISPLAY,     // ingest -> first drawn on the LCD
+  LAT_EXPORT,      // ingest -> written out by an exporter
+  LAT_STAGE_COUNT
+};
+
+extern LatencyHistogram latencyHistograms[LAT_STAGE_COUNT];
+
+const char* latencyStageName(LatencyStage stage);
+
+// Records micros() - ingestUs against a stage. An ingest time of 0 means
+// "unknown" and is ignored.
+inline void recordLatency(LatencyStage stage, uint32_t ingestUs) {
+  if (ingestUs == 0) return;
+  latencyHistograms[stage].record((uint32_t)micros() - ingestUs);
+}
+
+// Non-zero timestamp for ingest points (0 is reserved for "unknown").
+inline uint32_t ingestTimestamp() {
+  uint32_t now = (uint32_t)micros();
+  return now ? now : 1;
+}
+
+void printLatencyReport(Print& out);
+void resetLatencyHistograms();
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Log-bucketed (HDR-style) latency histogram in microseconds.
+// Every power of two is split into 8 linear sub-buckets, so any recorded
+// value is reported with at most 12.5% error over the full 32-bit range.
+// record() is lock-free and safe to call from the BT/WiFi tasks while the
+// UI task reads percentiles.
+class LatencyHistogram {
+public:
+  static const int SUB_BUCKET_BITS = 3;
+  static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static const int BUCKET_COUNT = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  LatencyHistogram() { reset(); }
+
+  void record(uint32_t us) {
+    buckets[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    uint32_t prev = maxValue.load(std::memory_order_relaxed);
+    while (us > prev && !maxValue.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+    }
+  }
+
+  void reset() {
+    for (int i = 0; i < BUCKET_COUNT; i++) buckets[i].store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+  }
+
+  uint32_t count() const { return total.load(std::memory_order_relaxed); }
+  uint32_t max() const { return maxValue.load(std::memory_order_relaxed); }
+
+  // Returns the highest value equivalent to the bucket holding the given
+  // quantile (0.0 - 1.0), or 0 when nothing has been recorded.
+  uint32_t percentile(double q) const {
+    uint32_t n = count();
+    if (n == 0) return 0;
+    uint64_t target = (uint64_t)(q * n + 0.999999);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+      seen += buckets[i].load(std::memory_order_relaxed);
+      if (seen >= target) {
+        uint32_t upper = bucketUpperBound(i);
+        uint32_t m = max();
+        return upper < m ? upper : m;
+      }
+    }
+    return max();
+  }
+
+  static int bucketIndex(uint32_t v) {
+    if (v < (uint32_t)SUB_BUCKETS) return (int)v;
+    int msb = 31 - __builtin_clz(v);
+    int shift = msb - SUB_BUCKET_BITS;
+    return (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + (int)((v >> shift) & (SUB_BUCKETS - 1));
+  }
+
+  static uint32_t bucketUpperBound(int index) {
+    if (index < SUB_BUCKETS) return (uint32_t)index;
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t lower = (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    uint64_t upper = lower + ((uint64_t)1 << shift) - 1;
+    return upper > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)upper;
+  }
+
+private:
+  std::atomic<uint32_t> buckets[BUCKET_COUNT];
+  std::atomic<uint32_t> total;
+  std::atomic<uint32_t> maxValue;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "OtaDelta.h"
+#include <HTTPClient.h>
+#include <MD5Builder.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include "DeltaPatch.h"
+
+// Old image: the partition we are running from
+class PartitionSource : public PatchSource {
+public:
+  explicit PartitionSource(const esp_partition_t* part) : part(part) {}
+  bool read(uint32_t offset, uint8_t* dst, size_t len) override {
+    return esp_partition_read(part, offset, dst, len) == ESP_OK;
+  }
+
+private:
+  const esp_partition_t* part;
+};
+
+// New image: Update writes the next OTA slot and checks the MD5 at end()
+class UpdateSink : public PatchSink {
+public:
+  UpdateSink(const esp_partition_t* running, Print& out) : running(running), out(out) {}
+
+  bool begin(const DeltaHeader& h) override {
+    if (h.oldSize > running->size) {
+      out.println("ota: patch base larger than this slot");
+      return false;
+    }
+    if (!baseMatches(h)) {
+      out.println("ota: patch was made for a different firmware");
+      return false;
+    }
+    if (!Update.begin(h.newSize, U_FLASH)) {
+      Update.printError(out);
+      return false;
+    }
+    char hex[33];
+    for (int i = 0; i < 16; i++) sprintf(hex + i * 2, "%02x", h.newMd5[i]);
+    Update.setMD5(hex);
+    out.printf("ota: %u -> %u bytes\n", (unsigned)h.oldSize, (unsigned)h.newSize);
+    return true;
+  }
+
+  bool write(const uint8_t* data, size_t len) override {
+    return Update.write(const_cast<uint8_t*>(data), len) == len;
+  }
+
+private:
+  // MD5 of the first oldSize bytes of the running slot
+  bool baseMatches(const DeltaHeader& h) {
+    static uint8_t buf[1024];
+    MD5Builder md5;
+    md5.begin();
+    for (uint32_t off = 0; off < h.oldSize; off += sizeof(buf)) {
+      size_t n = h.oldSize - off < sizeof(buf) ? h.oldSize - off : sizeof(buf);
+      if (esp_partition_read(running, off, buf, n) != ESP_OK) return false;
+      md5.add(buf, n);
+    }
+    md5.calculate();
+    uint8_t digest[16];
+    md5.getBytes(digest);
+    return memcmp(digest, h.oldMd5, 16) == 0;
+  }
+
+  const esp_partition_t* running;
+  Print& out;
+};
+
+bool otaApplyDelta(const char* url, Print& out) {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  if (!running || !esp_ota_get_next_update_partition(NULL)) {
+    out.println("ota: no spare OTA slot");
+    return false;
+  }
+
+  HTTPClient http;
+  http.setTimeout(OTA_TIMEOUT_MS);
+  if (!http.begin(url)) {
+    out.println("ota: bad url");
+    return false;
+  }
+  int code = http.GET();
+  if (code != HTTP_CODE_OK) {
+    out.printf("ota: HTTP %d\n", code);
+    http.end();
+    return false;
+  }
+  // A chunked reply would reach the patcher with the chunk framing in it
+  int remaining = http.getSize();
+  if (remaining <= 0) {
+    out.println("ota: server sent no Content-Length");
+    http.end();
+    return false;
+  }
+
+  PartitionSource source(running);
+  UpdateSink sink(running, out);
+  // The window is 4 KB; keep it off the caller's stack
+  DeltaPatcher* patcher = new DeltaPatcher(source, sink);
+  static uint8_t buf[OTA_FETCH_BUF];
+  WiFiClient* stream = http.getStreamPtr();
+  uint32_t lastData = millis();
+  uint32_t received = 0;
+
+  while (patcher->status() == DeltaPatcher::PATCH_MORE && http.connected() && remaining > 0) {
+    size_t avail = stream->available();
+    if (avail == 0) {
+      if (millis() - lastData > OTA_TIMEOUT_MS) break;
+      delay(1);
+      continue;
+    }
+    size_t want = avail < sizeof(buf) ? avail : sizeof(buf);
+    if (want > (size_t)remaining) want = remaining;
+    int n = stream->readBytes(buf, want);
+    if (n <= 0) continue;
+    lastData = millis();
+    received += n;
+    remaining -= n;
+    patcher->feed(buf, n);
+  }
+  http.end();
+
+  bool ok = false;
+  if (patcher->status() == DeltaPatcher::PATCH_DONE) {
+    // Checks the MD5 set in begin() and switches the boot partition
+    ok = Update.end();
+    if (!ok) Update.printError(out);
+  } else {
+    out.printf("ota: %s\n", patcher->error() ? patcher->error() : "patch truncated");
+    if (Update.isRunning()) Update.abort();
+  }
+  if (ok) {
+    out.printf("ota: %u patch bytes -> %u byte image verified, reboot to run it\n",
+               (unsigned)received, (unsigned)patcher->written());
+  }
+  delete patcher;
+  return ok;
+}
@@ -0,0 +1,20 @@
+#ifndef OTA_DELTA_H
+#define OTA_DELTA_H
+
+#include <Arduino.h>
+
+// Delta firmware update: fetches a patch made by tools/mkdelta.py against
+// the running image over HTTP and applies it straight into the inactive
+// OTA slot (see DeltaPatch.h). Before anything is written the running
+// image is hashed and must match the patch's base; the result is checked
+// against the patch's target MD5 by Update.end(). The new image only
+// becomes the boot partition if that check passes. The server has to send
+// a Content-Length; chunked replies are refused.
+
+#define OTA_FETCH_BUF 1024
+#define OTA_TIMEOUT_MS 15000
+
+// Blocks until done; progress and errors go to out. Does not reboot.
+bool otaApplyDelta(const char* url, Print& out);
+
+#endif
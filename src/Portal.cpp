@@ -0,0 +1,142 @@
+#include "Portal.h"
+#include <WiFi.h>
+#include <WebServer.h>
+#include <DNSServer.h>
+#include "PortalApi.h"
+#include "ExportStream.h"
+#include "Uplink.h"
+#include "Export.h"
+#if SENSOR_NODE
+#include <ETH.h>
+#endif
+
+static WebServer server(PORTAL_HTTP_PORT);
+static DNSServer dns;
+static TaskHandle_t portalTaskHandle = NULL;
+static volatile bool running = false;
+static PortalApplyFn applyFn = nullptr;
+static PortalStatusFn statusFn = nullptr;
+static char ssid[16] = "";
+static char address[16] = "";
+static char replyBuf[PORTAL_REPLY_MAX];
+
+// WebServer keeps args as Strings; the current one is copied out
+class WebRequest : public PortalRequest {
+public:
+  bool post() const override { return server.method() == HTTP_POST; }
+  const char* path() const override { return uri.c_str(); }
+  const char* host() const override { return hostHeader.c_str(); }
+  const char* arg(const char* name) override {
+    if (!server.hasArg(name)) return nullptr;
+    value = server.arg(name);
+    return value.c_str();
+  }
+
+  String uri;
+  String hostHeader;
+
+private:
+  String value;
+};
+
+class DeviceHooks : public PortalHooks {
+public:
+  const char* address() override { return ::address; }
+  void getConfig(Config& out) override { configStore.get(out); }
+  void setConfig(const Config& next) override {
+    configStore.update(next, millis());
+    if (applyFn) applyFn(next);
+  }
+  int streams(const char** names, int max) override { return exportStreamNames(names, max); }
+  size_t status(char* out, size_t cap) override {
+    return statusFn ? statusFn(out, cap) : snprintf(out, cap, "{}");
+  }
+  size_t changes(const char* table, const char* since, char* out, size_t cap) override {
+    return exportChangesText(table, since, out, cap);
+  }
+};
+
+static DeviceHooks hooks;
+
+// Every request lands here; assets go out of flash as they are
+static void handleRequest() {
+  WebRequest req;
+  req.uri = server.uri();
+  req.hostHeader = server.hostHeader();
+  PortalReply reply = portalHandle(req, hooks, replyBuf, sizeof(replyBuf));
+  if (reply.location[0]) server.sendHeader("Location", reply.location);
+  if (reply.gzip) {
+    server.sendHeader("Content-Encoding", "gzip");
+    server.sendHeader("Cache-Control", "max-age=3600");
+  }
+  server.send_P(reply.code, reply.type, (PGM_P)reply.body, reply.len);
+}
+
+static void portalTask(void* param) {
+  while (running) {
+    if (!SENSOR_NODE) dns.processNextRequest();
+    server.handleClient();
+    vTaskDelay(pdMS_TO_TICKS(PORTAL_POLL_MS));
+  }
+  server.stop();
+  if (!SENSOR_NODE) dns.stop();
+  portalTaskHandle = NULL;
+  vTaskDelete(NULL);
+}
+
+bool portalStart(PortalApplyFn apply, PortalStatusFn status) {
+  if (running || portalTaskHandle) return running;
+  applyFn = apply;
+  statusFn = status;
+#if SENSOR_NODE
+  if (!uplinkReady()) return false;
+  ssid[0] = 0;
+  strlcpy(address, ETH.localIP().toString().c_str(), sizeof(address));
+#else
+  Config config;
+  configStore.get(config);
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  snprintf(ssid, sizeof(ssid), "Scanner-%02X%02X", mac[4], mac[5]);
+  // STA stays up next to the AP so scanning carries on
+  WiFi.mode(WIFI_AP_STA);
+  if (!WiFi.softAP(ssid, config.apPassword[0] ? config.apPassword : nullptr, PORTAL_AP_CHANNEL,
+                   0, PORTAL_MAX_CLIENTS)) {
+    WiFi.mode(WIFI_STA);
+    return false;
+  }
+  IPAddress ip = WiFi.softAPIP();
+  strlcpy(address, ip.toString().c_str(), sizeof(address));
+  dns.setErrorReplyCode(DNSReplyCode::NoError);
+  dns.start(PORTAL_DNS_PORT, "*", ip);
+#endif
+  server.onNotFound(handleRequest);
+  server.begin();
+  running = true;
+  xTaskCreatePinnedToCore(portalTask, "portal", 6144, NULL, 1, &portalTaskHandle, 1);
+  return true;
+}
+
+void portalStop() {
+  if (!running) return;
+  running = false;
+  while (portalTaskHandle) vTaskDelay(pdMS_TO_TICKS(PORTAL_POLL_MS));
+#if !SENSOR_NODE
+  WiFi.softAPdisconnect(true);
+  WiFi.mode(WIFI_STA);
+#endif
+  // Whatever was edited is written now rather than after the settle time
+  configStore.flush();
+}
+
+bool portalActive() {
+  return running;
+}
+
+const char* portalSsid() {
+  return ssid;
+}
+
+const char* portalAddress() {
+  return address;
+}
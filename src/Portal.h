@@ -0,0 +1,29 @@
+#ifndef PORTAL_H
+#define PORTAL_H
+
+#include <Arduino.h>
+#include "ConfigStore.h"
+
+// Config portal: a SoftAP "Scanner-XXXX" (password from the config, open
+// when empty) with a catch-all DNS server, so phones pop up the setup
+// page on joining. Sensor nodes keep WiFi in promiscuous mode, so there
+// the page is served on the Ethernet address instead, without AP or DNS.
+// Requests are handled by PortalApi.h in a task of its own; saved
+// settings go to the coalesced ConfigStore and are applied right away.
+
+#define PORTAL_HTTP_PORT 80
+#define PORTAL_DNS_PORT 53
+#define PORTAL_POLL_MS 10
+#define PORTAL_AP_CHANNEL 1
+#define PORTAL_MAX_CLIENTS 2
+
+typedef void (*PortalApplyFn)(const Config& config);
+typedef size_t (*PortalStatusFn)(char* out, size_t cap);   // one JSON object
+
+bool portalStart(PortalApplyFn apply, PortalStatusFn status);
+void portalStop();
+bool portalActive();
+const char* portalSsid();      // "" on sensor nodes
+const char* portalAddress();
+
+#endif
@@ -0,0 +1,249 @@
+#include "PortalApi.h"
+#include "PortalAssets.h"
+#include "Rules.h"
+#include "SegmentUpload.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+// Appends into the reply buffer; once anything is cut off, ok is false
+struct JsonOut {
+  char* buf;
+  size_t cap;
+  size_t len;
+  bool ok;
+
+  void put(const char* fmt, ...) {
+    if (!ok) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + len, cap - len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= cap - len) ok = false;
+    else len += n;
+  }
+
+  void str(const char* s) {
+    put("\"");
+    for (; *s && ok; s++) {
+      unsigned char c = *s;
+      if (c == '"' || c == '\\') put("\\%c", c);
+      else if (c == '\n') put("\\n");
+      else if (c < 0x20) put("\\u%04x", c);
+      else put("%c", c);
+    }
+    put("\"");
+  }
+};
+
+static PortalReply reply(int code, const char* type) {
+  PortalReply r;
+  memset(&r, 0, sizeof(r));
+  r.code = code;
+  r.type = type;
+  return r;
+}
+
+static PortalReply json(JsonOut& out, int code) {
+  if (!out.ok) return reply(500, "text/plain");
+  PortalReply r = reply(code, "application/json");
+  r.body = (const uint8_t*)out.buf;
+  r.len = out.len;
+  return r;
+}
+
+static PortalReply error(char* buf, size_t cap, const char* message) {
+  JsonOut out = {buf, cap, 0, true};
+  out.put("{\"error\":");
+  out.str(message);
+  out.put("}");
+  return json(out, 400);
+}
+
+// Host header without the port, compared with our own address; mDNS
+// names are ours too
+static bool foreignHost(const char* host, const char* address) {
+  size_t n = strcspn(host, ":");
+  if (n == 0) return false;
+  if (n == strlen(address) && strncmp(host, address, n) == 0) return false;
+  return !(n > 6 && strncmp(host + n - 6, ".local", 6) == 0);
+}
+
+static PortalReply getConfig(PortalHooks& hooks, char* buf, size_t cap) {
+  Config c;
+  hooks.getConfig(c);
+  const char* names[PORTAL_STREAMS_MAX];
+  int count = hooks.streams(names, PORTAL_STREAMS_MAX);
+  JsonOut out = {buf, cap, 0, true};
+  out.put("{\"scan\":%u,\"stream\":", c.scanIntervalS);
+  out.str(c.stream);
+  out.put(",\"streams\":[\"off\"");
+  for (int i = 0; i < count; i++) {
+    out.put(",");
+    out.str(names[i]);
+  }
+  out.put("],\"codec\":%s,\"chost\":", c.codec ? "true" : "false");
+  out.str(c.collectorHost);
+  out.put(",\"cport\":%u,\"appass\":%s,\"upurl\":", c.collectorPort, c.apPassword[0] ? "true" : "false");
+  out.str(c.uploadUrl);
+  out.put(",\"wssid\":");
+  out.str(c.staSsid);
+  out.put(",\"wpass\":%s,\"rules\":", c.staPassword[0] ? "true" : "false");
+  out.str(c.rules);
+  out.put("}");
+  return json(out, 200);
+}
+
+static bool parseNumber(const char* s, long lo, long hi, long& value) {
+  char* end;
+  value = strtol(s, &end, 10);
+  return *s && !*end && value >= lo && value <= hi;
+}
+
+// Rules text as typed: CRs dropped, every non-empty line must compile
+static const char* checkRules(const char* text, char* dst, size_t cap, char* message, size_t msgCap) {
+  size_t n = 0;
+  for (const char* p = text; *p; p++) {
+    if (*p == '\r') continue;
+    if (n + 1 >= cap) return "rules too long";
+    dst[n++] = *p;
+  }
+  dst[n] = 0;
+  int lineNo = 0;
+  for (const char* line = dst; *line;) {
+    const char* end = strchr(line, '\n');
+    size_t len = end ? (size_t)(end - line) : strlen(line);
+    lineNo++;
+    if (strspn(line, " \t") < len) {
+      char one[RULES_TEXT_MAX];
+      const char* err = "rule too long";
+      bool ok = false;
+      if (len < sizeof(one)) {
+        memcpy(one, line, len);
+        one[len] = 0;
+        ok = RuleEngine::check(one, &err);
+      }
+      if (!ok) {
+        snprintf(message, msgCap, "rules line %d: %s", lineNo, err);
+        return message;
+      }
+    }
+    line += end ? len + 1 : len;
+  }
+  return nullptr;
+}
+
+static PortalReply postConfig(PortalRequest& req, PortalHooks& hooks, char* buf, size_t cap) {
+  Config next;
+  hooks.getConfig(next);
+  const char* v;
+  long n;
+  if ((v = req.arg("scan"))) {
+    if (!parseNumber(v, PORTAL_SCAN_MIN_S, PORTAL_SCAN_MAX_S, n)) {
+      return error(buf, cap, "scan must be 5-600 s");
+    }
+    next.scanIntervalS = n;
+  }
+  if ((v = req.arg("stream"))) {
+    const char* names[PORTAL_STREAMS_MAX];
+    int count = hooks.streams(names, PORTAL_STREAMS_MAX);
+    bool known = strcmp(v, "off") == 0;
+    for (int i = 0; i < count && !known; i++) known = strcmp(v, names[i]) == 0;
+    if (!known) return error(buf, cap, "unknown stream");
+    snprintf(next.stream, sizeof(next.stream), "%s", v);
+  }
+  if ((v = req.arg("codec"))) {
+    if (strcmp(v, "0") != 0 && strcmp(v, "1") != 0) return error(buf, cap, "codec must be 0 or 1");
+    next.codec = v[0] == '1';
+  }
+  if ((v = req.arg("chost"))) {
+    if (!*v || strlen(v) >= sizeof(next.collectorHost) || strpbrk(v, " /:")) {
+      return error(buf, cap, "bad collector host");
+    }
+    snprintf(next.collectorHost, sizeof(next.collectorHost), "%s", v);
+  }
+  if ((v = req.arg("cport"))) {
+    if (!parseNumber(v, 1, 65535, n)) return error(buf, cap, "port must be 1-65535");
+    next.collectorPort = n;
+  }
+  if ((v = req.arg("appass"))) {
+    size_t len = strlen(v);
+    if (len && (len < PORTAL_PASSWORD_MIN || len >= sizeof(next.apPassword))) {
+      return error(buf, cap, "password must be 8-23 characters, or empty for an open network");
+    }
+    snprintf(next.apPassword, sizeof(next.apPassword), "%s", v);
+  }
+  if ((v = req.arg("upurl"))) {
+    UploadUrl url;
+    if (*v && (strlen(v) >= sizeof(next.uploadUrl) || !parseUploadUrl(v, url))) {
+      return error(buf, cap, "upload URL must be http://host[:port]/path, or empty");
+    }
+    snprintf(next.uploadUrl, sizeof(next.uploadUrl), "%s", v);
+  }
+  if ((v = req.arg("wssid"))) {
+    if (strlen(v) >= sizeof(next.staSsid)) return error(buf, cap, "SSID is at most 32 characters");
+    snprintf(next.staSsid, sizeof(next.staSsid), "%s", v);
+  }
+  if ((v = req.arg("wpass"))) {
+    size_t len = strlen(v);
+    if (len && (len < PORTAL_PASSWORD_MIN || len >= sizeof(next.staPassword))) {
+      return error(buf, cap, "WiFi password must be 8-63 characters, or empty");
+    }
+    snprintf(next.staPassword, sizeof(next.staPassword), "%s", v);
+  }
+  if ((v = req.arg("rules"))) {
+    char message[64];
+    const char* err = checkRules(v, next.rules, sizeof(next.rules), message, sizeof(message));
+    if (err) return error(buf, cap, err);
+  }
+  hooks.setConfig(next);
+  JsonOut out = {buf, cap, 0, true};
+  out.put("{\"ok\":true}");
+  return json(out, 200);
+}
+
+PortalReply portalHandle(PortalRequest& req, PortalHooks& hooks, char* buf, size_t cap) {
+  const char* path = req.path();
+  if (foreignHost(req.host(), hooks.address())) {
+    PortalReply r = reply(302, "text/plain");
+    snprintf(r.location, sizeof(r.location), "http://%s/", hooks.address());
+    return r;
+  }
+  if (strcmp(path, "/api/config") == 0) {
+    return req.post() ? postConfig(req, hooks, buf, cap) : getConfig(hooks, buf, cap);
+  }
+  if (req.post()) return reply(405, "text/plain");
+  if (strcmp(path, "/api/status") == 0) {
+    JsonOut out = {buf, cap, 0, true};
+    out.len = hooks.status(buf, cap);
+    out.ok = out.len < cap;
+    return json(out, 200);
+  }
+  if (strcmp(path, "/api/sync") == 0) {
+    const char* table = req.arg("table");
+    if (!table) return error(buf, cap, "table must be wifi, ble or btc");
+    // Only valid until the next arg(): copied before since is read
+    char name[8];
+    snprintf(name, sizeof(name), "%s", table);
+    const char* since = req.arg("since");
+    size_t len = hooks.changes(name, since ? since : "0", buf, cap);
+    if (len == 0) return reply(404, "text/plain");
+    if (len >= cap) return reply(500, "text/plain");
+    PortalReply r = reply(200, "text/plain");
+    r.body = (const uint8_t*)buf;
+    r.len = len;
+    return r;
+  }
+  if (strcmp(path, "/index.html") == 0) path = "/";
+  for (size_t i = 0; i < PORTAL_ASSET_COUNT; i++) {
+    if (strcmp(path, PORTAL_ASSETS[i].path) == 0) {
+      PortalReply r = reply(200, PORTAL_ASSETS[i].type);
+      r.body = PORTAL_ASSETS[i].data;
+      r.len = PORTAL_ASSETS[i].len;
+      r.gzip = true;
+      return r;
+    }
+  }
+  return reply(404, "text/plain");
+}
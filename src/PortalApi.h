@@ -0,0 +1,63 @@
+#ifndef PORTAL_API_H
+#define PORTAL_API_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ConfigStore.h"
+
+// Request handling for the config portal, kept apart from WebServer so it
+// runs on the host against plain sockets. Routes:
+//
+//   GET  /             setup page (gzip, from PortalAssets.h)
+//   GET  /api/config   current settings as JSON (never the passwords)
+//   POST /api/config   form fields scan, stream, codec, chost, cport,
+//                      appass, upurl, wssid, wpass, rules; any subset,
+//                      all checked before anything is applied
+//   GET  /api/status   whatever the device reports
+//   GET  /api/sync     table=wifi|ble|btc, since=<cursor>: device table
+//                      changes since the cursor, as text (see Export.h)
+//
+// Requests for any other host name (OS captive-portal probes after the
+// catch-all DNS answer) are redirected to the portal address.
+
+#define PORTAL_REPLY_MAX 4096   // rules text doubled by escaping, or a full table sync
+#define PORTAL_SCAN_MIN_S 5
+#define PORTAL_SCAN_MAX_S 600
+#define PORTAL_PASSWORD_MIN 8   // WPA2
+#define PORTAL_STREAMS_MAX 6
+
+class PortalRequest {
+public:
+  virtual ~PortalRequest() {}
+  virtual bool post() const = 0;
+  virtual const char* path() const = 0;
+  virtual const char* host() const = 0;   // "" when absent
+  // nullptr when absent; valid until the next call
+  virtual const char* arg(const char* name) = 0;
+};
+
+class PortalHooks {
+public:
+  virtual ~PortalHooks() {}
+  virtual const char* address() = 0;   // the portal's own IP
+  virtual void getConfig(Config& out) = 0;
+  virtual void setConfig(const Config& next) = 0;
+  virtual int streams(const char** names, int max) = 0;
+  // One JSON object into out; returns its length
+  virtual size_t status(char* out, size_t cap) = 0;
+  // Change batch of a device table; returns its length, 0 for no such table
+  virtual size_t changes(const char* table, const char* since, char* out, size_t cap) = 0;
+};
+
+struct PortalReply {
+  int code;
+  const char* type;
+  const uint8_t* body;   // a flash asset or the caller's buffer
+  size_t len;
+  bool gzip;             // body is a precompressed asset
+  char location[48];     // for redirects
+};
+
+PortalReply portalHandle(PortalRequest& req, PortalHooks& hooks, char* buf, size_t cap);
+
+#endif
@@ -0,0 +1,125 @@
+// Generated by tools/portal_assets.py from portal/ -- do not edit
+#ifndef PORTAL_ASSETS_H
+#define PORTAL_ASSETS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+
+struct PortalAsset {
+  const char* path;
+  const char* type;
+  const uint8_t* data;   // gzip
+  size_t len;
+};
+
+// index.html: 3566 bytes, 1529 gzipped
+static const uint8_t PORTAL_ASSET_0[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x57, 0x6d, 0x6f, 0xdb, 0x36,
+  0x10, 0xfe, 0xee, 0x5f, 0xc1, 0x3a, 0x1d, 0x6c, 0x61, 0x8a, 0x6c, 0xb7, 0x4d, 0x97, 0xc9, 0x2f,
+  0xc5, 0x96, 0x66, 0x58, 0x87, 0x2e, 0x09, 0x9a, 0x16, 0xc3, 0x30, 0xec, 0x03, 0x2d, 0x51, 0x36,
+  0x6b, 0x8a, 0x14, 0x48, 0xca, 0x89, 0x27, 0xf8, 0xbf, 0xef, 0x8e, 0xa4, 0x1c, 0x27, 0xf6, 0x90,
+  0xa1, 0xf0, 0x07, 0xe9, 0xc8, 0x7b, 0x79, 0x78, 0xf7, 0xdc, 0x89, 0x9e, 0xbc, 0x78, 0x7f, 0x7d,
+  0xf1, 0xf9, 0xcf, 0x9b, 0x4b, 0xb2, 0xb4, 0xa5, 0x98, 0x75, 0x26, 0xed, 0x83, 0xd1, 0x1c, 0x1e,
+  0x25, 0xb3, 0x94, 0x64, 0x4b, 0xaa, 0x0d, 0xb3, 0xd3, 0x6e, 0x6d, 0x8b, 0xd3, 0xf3, 0x6e, 0xbb,
+  0x2c, 0x69, 0xc9, 0xa6, 0xdd, 0x35, 0x67, 0x77, 0x95, 0xd2, 0xb6, 0x4b, 0x32, 0x25, 0x2d, 0x93,
+  0xa0, 0x76, 0xc7, 0x73, 0xbb, 0x9c, 0xe6, 0x6c, 0xcd, 0x33, 0x76, 0xea, 0x84, 0x98, 0x4b, 0x6e,
+  0x39, 0x15, 0xa7, 0x26, 0xa3, 0x82, 0x4d, 0x47, 0xe8, 0xc3, 0x72, 0x2b, 0xd8, 0xec, 0x36, 0xa3,
+  0x52, 0x32, 0x4d, 0xc0, 0x7f, 0x5d, 0x4d, 0x06, 0x7e, 0xb1, 0x33, 0x31, 0x76, 0x83, 0xcf, 0xb9,
+  0xca, 0x37, 0x4d, 0x01, 0x7e, 0x4f, 0x0b, 0x5a, 0x72, 0xb1, 0x49, 0x0d, 0x95, 0xe6, 0xd4, 0x30,
+  0xcd, 0x8b, 0x71, 0x49, 0xf5, 0x82, 0xcb, 0x74, 0x48, 0x68, 0x6d, 0x15, 0x48, 0xf7, 0x3e, 0x54,
+  0xfa, 0xfa, 0x15, 0x2b, 0xc7, 0x15, 0xcd, 0x73, 0x2e, 0x17, 0xe9, 0x08, 0xde, 0xe7, 0x34, 0x5b,
+  0x2d, 0xb4, 0xaa, 0x65, 0x9e, 0x9e, 0x14, 0x6f, 0xf0, 0xb7, 0xed, 0x2c, 0x47, 0xde, 0xad, 0xe1,
+  0xff, 0xb0, 0x74, 0x94, 0xbc, 0x66, 0xe5, 0xb6, 0xe0, 0x4c, 0xe4, 0x00, 0xa3, 0x99, 0x2b, 0x9d,
+  0x33, 0x9d, 0x8e, 0xaa, 0x7b, 0x62, 0x94, 0xe0, 0x39, 0x39, 0xc9, 0xb2, 0xec, 0xb1, 0x97, 0xa2,
+  0x0d, 0x7f, 0x3a, 0x57, 0xd6, 0xaa, 0x12, 0xe3, 0x6c, 0x3b, 0x82, 0xce, 0x99, 0x68, 0x72, 0x6e,
+  0x2a, 0x41, 0x37, 0xe9, 0x5c, 0xa8, 0x6c, 0xd5, 0xa2, 0x4c, 0xce, 0x58, 0x49, 0x86, 0x24, 0x01,
+  0x6c, 0x5b, 0x2e, 0xab, 0xda, 0xc6, 0x86, 0x09, 0x96, 0xd9, 0xd8, 0xb2, 0x7b, 0x4b, 0x35, 0xa3,
+  0x8d, 0x07, 0x3f, 0x1a, 0x0e, 0xbf, 0x1b, 0xcf, 0xd5, 0x3d, 0x02, 0x43, 0xfc, 0x1e, 0x0b, 0x44,
+  0xb9, 0xdf, 0x1d, 0x29, 0x79, 0x83, 0xb1, 0x76, 0x76, 0x4b, 0xc6, 0x17, 0x4b, 0x0b, 0x86, 0x70,
+  0xd2, 0xfd, 0x4c, 0x95, 0x4a, 0x2a, 0x53, 0xd1, 0x8c, 0x6d, 0xe7, 0x35, 0x40, 0x94, 0xcd, 0xce,
+  0xfe, 0x2d, 0x40, 0x19, 0x21, 0xa0, 0xf1, 0x5e, 0x0a, 0xd0, 0xe7, 0x49, 0x69, 0x16, 0x4d, 0x00,
+  0x3c, 0x42, 0xbc, 0x5e, 0xe1, 0xce, 0x47, 0x98, 0x2b, 0x91, 0x6f, 0x13, 0xa6, 0x75, 0x93, 0x29,
+  0xa1, 0x74, 0x7a, 0x32, 0x1f, 0x0e, 0xb7, 0x89, 0x5a, 0xb5, 0xe2, 0xf0, 0x87, 0xe1, 0xb6, 0xd2,
+  0xac, 0x79, 0x9a, 0xa8, 0x5d, 0x5c, 0x8c, 0xa8, 0xd6, 0x4c, 0x17, 0x42, 0xdd, 0xa5, 0x58, 0xb4,
+  0x6d, 0x67, 0x32, 0x08, 0x85, 0x9e, 0x0c, 0x02, 0xe1, 0xb0, 0xe2, 0x48, 0xbf, 0xd1, 0x53, 0x66,
+  0xc0, 0x4a, 0x67, 0x52, 0x28, 0x5d, 0x12, 0x9e, 0x4f, 0xbb, 0x05, 0x32, 0xa8, 0xad, 0xd8, 0x6c,
+  0x22, 0xd8, 0x82, 0xc9, 0xdc, 0x9b, 0x40, 0xac, 0xc9, 0x20, 0x2c, 0x74, 0x26, 0xae, 0x26, 0x04,
+  0xec, 0xa6, 0x5d, 0xe0, 0x9e, 0xec, 0xce, 0x3e, 0x72, 0x63, 0x89, 0x66, 0x85, 0x66, 0x66, 0x49,
+  0xfa, 0x26, 0x26, 0x67, 0xa7, 0x6f, 0x87, 0xc3, 0x08, 0x4c, 0x50, 0x73, 0x36, 0x71, 0xd5, 0x71,
+  0x31, 0x9c, 0x7e, 0x60, 0xb9, 0x7f, 0xb7, 0x9b, 0x0a, 0xde, 0x65, 0x5d, 0xce, 0x99, 0xee, 0x92,
+  0x92, 0xcb, 0x69, 0xf7, 0x0c, 0x9e, 0xf4, 0x7e, 0xda, 0x05, 0x1f, 0x08, 0x69, 0xb0, 0xc3, 0x74,
+  0x04, 0xde, 0xe5, 0x3d, 0x36, 0xca, 0x7f, 0x80, 0xb3, 0x50, 0xcc, 0xb2, 0x3b, 0xbb, 0x75, 0xcf,
+  0x1d, 0x1a, 0xcf, 0x12, 0x0f, 0xc7, 0x6b, 0xb4, 0x80, 0x82, 0x3e, 0x64, 0xd0, 0xa9, 0xb4, 0xde,
+  0xf6, 0x0f, 0x90, 0xa9, 0x9c, 0x65, 0x2d, 0xea, 0x6c, 0xc9, 0xb2, 0x15, 0xf0, 0xa8, 0x4b, 0x5c,
+  0xca, 0x43, 0x97, 0xba, 0x3a, 0x74, 0x67, 0xe4, 0x42, 0x95, 0x50, 0x3b, 0x63, 0x88, 0x79, 0x14,
+  0xff, 0x11, 0xc4, 0x6c, 0xa9, 0x8c, 0xed, 0xce, 0x2e, 0x94, 0xc0, 0x80, 0x4a, 0x13, 0x94, 0x8f,
+  0xe4, 0xcd, 0xeb, 0x05, 0x9c, 0xc1, 0xe8, 0xb1, 0x23, 0x37, 0x2f, 0xf6, 0x1c, 0x85, 0xb4, 0x1c,
+  0x38, 0xf2, 0x73, 0x25, 0x38, 0xf2, 0xc2, 0x91, 0x12, 0x8c, 0xda, 0x12, 0x9c, 0x9d, 0xbd, 0x3e,
+  0x7b, 0xb6, 0x08, 0x5f, 0x2a, 0xa1, 0x68, 0x7e, 0xbc, 0x08, 0x75, 0x55, 0x6b, 0x01, 0x35, 0x60,
+  0x8b, 0x12, 0x06, 0x19, 0xa9, 0x9d, 0x2a, 0xf9, 0xf2, 0xe9, 0x23, 0xe9, 0xcf, 0x05, 0x95, 0xab,
+  0x94, 0xa8, 0xa2, 0x38, 0x46, 0x15, 0x6f, 0x18, 0x90, 0x06, 0x01, 0x86, 0x40, 0xc6, 0x96, 0xd0,
+  0x34, 0x0c, 0x3c, 0x2f, 0xad, 0xad, 0xd2, 0xc1, 0x60, 0xf4, 0xe3, 0xab, 0x64, 0xf4, 0xf6, 0x3c,
+  0x19, 0x25, 0xa3, 0x61, 0x7a, 0x3e, 0x3c, 0x1f, 0x0e, 0x7c, 0x8c, 0x27, 0x09, 0xba, 0x33, 0x86,
+  0xc3, 0xda, 0x1f, 0xfc, 0x17, 0x4e, 0x24, 0xb3, 0x77, 0x4a, 0xaf, 0x8e, 0x04, 0xf5, 0x5a, 0x21,
+  0x68, 0x30, 0x79, 0xec, 0xa6, 0xa2, 0xc6, 0x04, 0x37, 0xf8, 0x0a, 0x7e, 0xf2, 0x70, 0x12, 0xb2,
+  0x62, 0xac, 0x32, 0x84, 0xdb, 0x63, 0xa7, 0xf1, 0x76, 0xad, 0x63, 0x2f, 0xf8, 0xbc, 0xb7, 0x5e,
+  0x9e, 0xcd, 0xf2, 0xa7, 0x5a, 0x30, 0x43, 0xfa, 0x4a, 0x32, 0x52, 0x41, 0x0f, 0x0b, 0x2e, 0x59,
+  0xb4, 0x97, 0xf3, 0x76, 0x7a, 0xb9, 0x70, 0x1a, 0x75, 0xdb, 0x70, 0x41, 0x30, 0x15, 0x13, 0xc2,
+  0x51, 0x16, 0x7a, 0x9d, 0x0a, 0xc3, 0x90, 0xe9, 0xad, 0xd5, 0x73, 0xc1, 0x6f, 0x80, 0x29, 0x54,
+  0x1c, 0x2f, 0x31, 0xad, 0x7c, 0x52, 0xae, 0xd8, 0x1d, 0xf9, 0xe9, 0x66, 0x2f, 0x2d, 0xe7, 0xdf,
+  0xbb, 0xef, 0x1c, 0xcd, 0x2c, 0xd3, 0x30, 0x15, 0x9e, 0xcf, 0x52, 0xf0, 0x14, 0x70, 0xb7, 0xd2,
+  0x61, 0x9e, 0x0e, 0x0c, 0x55, 0xc5, 0xe4, 0xff, 0xeb, 0xca, 0x6b, 0xd0, 0x6c, 0x09, 0x40, 0xfa,
+  0x52, 0xed, 0xe0, 0x46, 0x0f, 0x0d, 0xba, 0x9f, 0x09, 0x3f, 0xe9, 0x83, 0x6b, 0x53, 0xcf, 0x4b,
+  0x0e, 0x6d, 0x76, 0x4b, 0xd7, 0x6c, 0x32, 0xf0, 0x5b, 0x4e, 0x1f, 0x66, 0x28, 0x3c, 0x73, 0xbe,
+  0x76, 0x68, 0x60, 0xe6, 0x63, 0x6e, 0x41, 0x0c, 0x63, 0xd7, 0x52, 0x5b, 0x9b, 0x30, 0x6f, 0x61,
+  0x26, 0x84, 0xd9, 0x83, 0x8b, 0xdd, 0x59, 0x92, 0x24, 0x93, 0x01, 0x2c, 0xe2, 0x17, 0x3a, 0xd3,
+  0xbc, 0x82, 0xa0, 0x6b, 0xaa, 0xc9, 0xcb, 0x69, 0x51, 0xcb, 0xcc, 0x72, 0x25, 0xfb, 0x3c, 0x6a,
+  0x34, 0x0c, 0x6c, 0x2d, 0x49, 0xae, 0xb2, 0x1a, 0xdb, 0x28, 0x59, 0x30, 0x7b, 0x29, 0x18, 0xbe,
+  0xfe, 0xbc, 0xf9, 0x90, 0x83, 0xc6, 0x76, 0xdc, 0x69, 0xf5, 0x09, 0x84, 0xef, 0xdb, 0x58, 0xad,
+  0xa2, 0xe6, 0x65, 0xbf, 0x07, 0x42, 0x2f, 0x4a, 0xb0, 0xcc, 0x17, 0xe1, 0x2e, 0x61, 0xc7, 0xbb,
+  0xe5, 0x4c, 0xc0, 0xe1, 0xaf, 0x30, 0xd9, 0x6a, 0xf5, 0xae, 0xa7, 0x56, 0xbd, 0xb4, 0x07, 0x1f,
+  0xa3, 0xde, 0xf6, 0xc1, 0x17, 0x76, 0x52, 0x3f, 0x6a, 0x0a, 0x66, 0xb3, 0x65, 0xbf, 0x37, 0xa0,
+  0x15, 0x1f, 0xc0, 0x9d, 0xa4, 0xe0, 0xce, 0xe9, 0x92, 0xc9, 0xfe, 0x0e, 0xa5, 0xde, 0xa1, 0xd4,
+  0xc9, 0x57, 0x03, 0x0b, 0xd1, 0xf6, 0xa9, 0x4a, 0x16, 0x35, 0x1d, 0x88, 0x8d, 0x83, 0x1f, 0xcc,
+  0xd7, 0x54, 0xd4, 0x6c, 0x9a, 0x25, 0x28, 0x22, 0x24, 0x37, 0x5a, 0x11, 0x14, 0xd6, 0x8f, 0xe5,
+  0xb0, 0xe3, 0x56, 0xdc, 0x16, 0x4e, 0xbc, 0x3d, 0x13, 0x27, 0xbb, 0x0d, 0x9c, 0x60, 0xfb, 0x1b,
+  0x28, 0x8f, 0x31, 0x88, 0x23, 0xfd, 0xde, 0x8e, 0x93, 0xd1, 0xc4, 0x8d, 0x92, 0xbd, 0x0d, 0x27,
+  0xe3, 0x86, 0x6b, 0xf7, 0xbd, 0x0d, 0x27, 0xe3, 0x06, 0x92, 0x6b, 0x0f, 0xd7, 0x8b, 0x2c, 0xf1,
+  0xcc, 0x1c, 0x63, 0x9d, 0xcc, 0x14, 0x4f, 0xe4, 0x26, 0x7c, 0x2f, 0x1a, 0x9b, 0x84, 0xe3, 0x07,
+  0xf6, 0xd7, 0xcf, 0xbf, 0x7f, 0x9c, 0xf6, 0x7a, 0xe3, 0x0e, 0x9c, 0xce, 0x6d, 0x99, 0x04, 0x28,
+  0x72, 0x49, 0x21, 0x87, 0xbb, 0x64, 0xc8, 0xa8, 0x41, 0x7b, 0x35, 0xdd, 0x15, 0x35, 0x03, 0x4d,
+  0xcb, 0x42, 0x5d, 0x31, 0x2c, 0xea, 0x81, 0x53, 0xf5, 0xa8, 0x7c, 0x12, 0x64, 0xff, 0x7d, 0x02,
+  0x2c, 0x72, 0x3a, 0x6d, 0x43, 0x40, 0x6c, 0x80, 0x05, 0xcd, 0x79, 0xb1, 0xe4, 0x22, 0xef, 0x2b,
+  0x48, 0x3f, 0xfc, 0x1e, 0x2a, 0xe9, 0xf9, 0xf6, 0xa4, 0x96, 0x7e, 0xf1, 0x5b, 0x6a, 0x69, 0x42,
+  0x2d, 0x77, 0x0e, 0xf6, 0x20, 0xfe, 0x76, 0x7b, 0x7d, 0x85, 0xa8, 0xe0, 0xda, 0xc0, 0x8b, 0x0d,
+  0x5c, 0x08, 0x64, 0x2d, 0x44, 0x3c, 0x42, 0x27, 0x19, 0xb5, 0xfb, 0x49, 0x88, 0x1a, 0xc4, 0x08,
+  0x7e, 0x0a, 0x70, 0xa1, 0xa4, 0xef, 0xaf, 0x07, 0xe6, 0xb3, 0xa8, 0x61, 0x09, 0xf4, 0xc6, 0x1a,
+  0xbc, 0xbe, 0x67, 0x05, 0xad, 0x85, 0xed, 0x47, 0x2e, 0xed, 0xd5, 0x54, 0xc2, 0xb4, 0x81, 0xcf,
+  0xc8, 0x2d, 0xa3, 0x3a, 0x5b, 0xde, 0xc0, 0x94, 0x29, 0xe1, 0x70, 0xe3, 0xce, 0x5f, 0x9e, 0x5e,
+  0x71, 0x5b, 0x93, 0x38, 0x90, 0x27, 0x0e, 0x5c, 0x89, 0x03, 0x01, 0xe2, 0x50, 0xef, 0x38, 0x30,
+  0xe5, 0xef, 0xc3, 0x0a, 0x41, 0x03, 0x55, 0x21, 0xa7, 0xfd, 0x55, 0xfc, 0x12, 0x64, 0xcf, 0x0d,
+  0x38, 0xc7, 0xb8, 0xb3, 0xdb, 0x09, 0xbc, 0x8d, 0x0f, 0x19, 0xfc, 0xae, 0x37, 0x82, 0x86, 0x1a,
+  0x42, 0x05, 0x3b, 0xbc, 0xe8, 0x23, 0xc3, 0x90, 0x35, 0x2d, 0xc3, 0xa2, 0x07, 0x0f, 0x7e, 0x3d,
+  0x3e, 0xd0, 0x68, 0xed, 0x1e, 0x13, 0x70, 0xcf, 0xd0, 0xf3, 0x10, 0xce, 0x00, 0x31, 0x18, 0x4c,
+  0x74, 0xe2, 0xf5, 0xc3, 0xf2, 0x61, 0xa0, 0x56, 0xff, 0x50, 0x07, 0xc6, 0xc7, 0x61, 0x8b, 0xc7,
+  0x0d, 0xfc, 0x29, 0x59, 0xaa, 0x3c, 0xed, 0xdd, 0x5c, 0xdf, 0x7e, 0xee, 0xc5, 0x78, 0x91, 0x4c,
+  0xab, 0xed, 0x37, 0xb0, 0xe5, 0x2b, 0xb0, 0x05, 0xb0, 0x7d, 0xc5, 0xbb, 0xae, 0xd2, 0x11, 0x4e,
+  0xa8, 0xf0, 0x1e, 0xbb, 0x4f, 0x91, 0x87, 0xdf, 0xe0, 0x7a, 0x0f, 0x87, 0x2b, 0xd4, 0xc5, 0x6a,
+  0x84, 0x75, 0x80, 0x14, 0xdb, 0xea, 0x69, 0xa2, 0x70, 0xcd, 0x0f, 0xaa, 0xed, 0x31, 0x8a, 0x39,
+  0xaf, 0x57, 0x0a, 0x6e, 0xa8, 0x95, 0xd8, 0xf4, 0x42, 0xc0, 0x2d, 0x8e, 0x4c, 0x6f, 0x34, 0x6e,
+  0x5b, 0x63, 0x0c, 0x23, 0xff, 0x03, 0x50, 0x58, 0x83, 0xd7, 0xbe, 0x5f, 0x8c, 0xcf, 0x86, 0x70,
+  0x93, 0x1d, 0xe3, 0xad, 0x3a, 0x0c, 0x67, 0x98, 0xfb, 0xfe, 0x3e, 0x3d, 0xf0, 0x7f, 0xeb, 0xfe,
+  0x05, 0xe7, 0x5e, 0x8c, 0xbb, 0xee, 0x0d, 0x00, 0x00,
+};
+
+static const PortalAsset PORTAL_ASSETS[] = {
+  {"/", "text/html", PORTAL_ASSET_0, sizeof(PORTAL_ASSET_0)},
+};
+
+#define PORTAL_ASSET_COUNT (sizeof(PORTAL_ASSETS) / sizeof(PORTAL_ASSETS[0]))
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef RADIO_SCHEDULER_H
+#define RADIO_SCHEDULER_H
+
+#include <stdint.h>
+
+// Decides how the shared 2.4 GHz Bluetooth radio is split between BLE scan
+// windows and BR/EDR inquiry windows. Both sources get credit every round
+// in proportion to their weight (the one on screen weighs more) and the
+// source with the most credit runs next, so neither is starved. Inquiries
+// that keep finding nothing new back off exponentially, down to
+// 1/INQUIRY_MAX_BACKOFF of their background weight, and snap back on a
+// discovery.
+enum RadioSlot {
+  SLOT_BLE,
+  SLOT_INQUIRY
+};
+
+class RadioScheduler {
+public:
+  static const int FOCUS_WEIGHT = 3;
+  static const int BACKGROUND_WEIGHT = 1;
+  static const int INQUIRY_MAX_BACKOFF = 8;
+
+  RadioScheduler() : bleCredit(0), inquiryCredit(0), backoff(1) {}
+
+  // Smooth weighted round-robin: add each weight to its credit, run the
+  // richer source and charge it the sum of both weights.
+  RadioSlot next(RadioSlot focus) {
+    int bleWeight = (focus == SLOT_BLE ? FOCUS_WEIGHT : BACKGROUND_WEIGHT) * INQUIRY_MAX_BACKOFF;
+    int inquiryWeight = focus == SLOT_INQUIRY
+                          ? FOCUS_WEIGHT * INQUIRY_MAX_BACKOFF
+                          : BACKGROUND_WEIGHT * INQUIRY_MAX_BACKOFF / backoff;
+    bleCredit += bleWeight;
+    inquiryCredit += inquiryWeight;
+    if (inquiryCredit > bleCredit) {
+      inquiryCredit -= bleWeight + inquiryWeight;
+      return SLOT_INQUIRY;
+    }
+    bleCredit -= bleWeight + inquiryWeight;
+    return SLOT_BLE;
+  }
+
+  // Feedback after an inquiry window: number of devices not seen before
+  void inquiryDone(int newDevices) {
+    if (newDevices > 0) backoff = 1;
+    else if (backoff < INQUIRY_MAX_BACKOFF) backoff *= 2;
+  }
+
+  int inquiryBackoff() const { return backoff; }
+
+private:
+  int bleCredit;
+  int inquiryCredit;
+  int backoff;
+};
+
+#endif
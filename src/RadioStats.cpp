@@ -0,0 +1,27 @@
+#include "RadioStats.h"
+
+RadioCounters radioCounters[SRC_COUNT];
+
+const char* radioSourceName(RadioSource source) {
+  switch (source) {
+    case SRC_WIFI:
+      return "wifi";
+    case SRC_BLE:
+      return "ble";
+    case SRC_BT_CLASSIC:
+      return "btc";
+    default:
+      return "?";
+  }
+}
+
+void printRadioCounters(Print& out) {
+  out.println("source   reports  devices  windows  listen(s)  reports/s");
+  for (int i = 0; i < SRC_COUNT; i++) {
+    const RadioCounters& c = radioCounters[i];
+    uint32_t ms = c.listenMs.load();
+    uint32_t reports = c.reports.load();
+    out.printf("%-6s %9u %8u %8u %10u %10.1f\n", radioSourceName((RadioSource)i), reports,
+               c.devices.load(), c.windows.load(), ms / 1000, ms ? reports * 1000.0f / ms : 0.0f);
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef RADIO_STATS_H
+#define RADIO_STATS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Per-source throughput counters, bumped from the radio callbacks
+enum RadioSource {
+  SRC_WIFI,
+  SRC_BLE,
+  SRC_BT_CLASSIC,
+  SRC_COUNT
+};
+
+struct RadioCounters {
+  std::atomic<uint32_t> reports;    // raw reports delivered by the stack
+  std::atomic<uint32_t> devices;    // devices published after dedup
+  std::atomic<uint32_t> windows;    // scan / inquiry windows run
+  std::atomic<uint32_t> listenMs;   // time spent listening
+};
+
+extern RadioCounters radioCounters[SRC_COUNT];
+
+const char* radioSourceName(RadioSource source);
+void printRadioCounters(Print& out);
+
+#endif
@@ -0,0 +1,101 @@
+#include "Recorder.h"
+#include "CaptureStorage.h"
+#include "ExportStream.h"
+#include "UsbDrive.h"
+
+static FlightRecorder recorder;
+static TaskHandle_t recorderTaskHandle = NULL;
+static uint32_t lastEventMs = 0;
+static uint32_t lastEventBytes = 0;
+static uint32_t lastSegment = 0;    // 0: went to the export stream
+
+// The event in segments of its own: marker, then the pinned blocks in place
+static bool storeEvent(const FlightEventRecord& marker, const FlightEvent& ev) {
+  CaptureStorage& storage = captureStorage();
+  if (!storage.rotate()) return false;
+  uint32_t segment = storage.currentSegment();
+  bool ok = storage.append(&marker, sizeof(marker));
+  for (int i = 0; ok && i < ev.count; i++) ok = storage.appendBlock(ev.blocks[i].data, ev.blocks[i].len);
+  // Live capture is not held up; its records may land between the blocks
+  storage.rotate();
+  lastSegment = segment;
+  return ok;
+}
+
+static void streamEvent(const FlightEventRecord& marker, const FlightEvent& ev) {
+  exportStreamRecord(&marker, sizeof(marker));
+  for (int i = 0; i < ev.count; i++) {
+    const uint8_t* p = ev.blocks[i].data;
+    const uint8_t* end = p + ev.blocks[i].len;
+    while (p < end) {
+      uint16_t len = ((const CaptureRecordHeader*)p)->len;
+      exportStreamRecord(p, len);
+      p += len;
+    }
+  }
+  lastSegment = 0;
+}
+
+static void recorderTask(void* param) {
+  static FlightEvent ev;   // block list only; the records stay in the arena
+  for (;;) {
+    recorder.tick(millis());
+    if (recorder.take(ev)) {
+      FlightEventRecord marker = {};
+      marker.hdr.len = sizeof(marker);
+      marker.hdr.type = CAPTURE_FLIGHT_EVENT;
+      marker.hdr.timeMs = ev.triggerMs;
+      marker.fromMs = ev.fromMs;
+      marker.toMs = ev.toMs;
+      marker.bytes = ev.bytes;
+      marker.reason = ev.reason;
+      marker.truncated = ev.truncated;
+      memcpy(marker.note, ev.note, sizeof(marker.note));
+      if (usbDriveActive() || !captureStorage().ready() || !storeEvent(marker, ev)) {
+        streamEvent(marker, ev);
+      }
+      lastEventMs = ev.triggerMs;
+      lastEventBytes = ev.bytes;
+      recorder.release();
+    }
+    vTaskDelay(pdMS_TO_TICKS(RECORDER_TICK_MS));
+  }
+}
+
+void recorderBegin() {
+  size_t bytes = RECORDER_RAM_BYTES;
+  uint8_t* arena = NULL;
+  if (psramFound()) {
+    bytes = RECORDER_PSRAM_BYTES;
+    arena = (uint8_t*)ps_malloc(bytes);
+  }
+  if (!arena) {
+    bytes = RECORDER_RAM_BYTES;
+    arena = (uint8_t*)malloc(bytes);
+  }
+  recorder.begin(arena, arena ? bytes : 0);
+  xTaskCreatePinnedToCore(recorderTask, "recorder", 4096, NULL, RECORDER_TASK_PRIORITY,
+                          &recorderTaskHandle, 1);
+}
+
+void recorderAppend(const void* rec, size_t len) {
+  recorder.append(rec, len);
+}
+
+bool recorderTrigger(FlightTrigger reason, const char* note) {
+  return recorder.trigger(reason, note, millis());
+}
+
+void printRecorderStatus(Print& out) {
+  FlightStats s = recorder.stats();
+  out.printf("recorder: %d blocks of %u bytes, holding %.1fs, %d pinned%s\n", s.blocks,
+             FLIGHT_BLOCK_BYTES, s.heldMs / 1000.0f, s.pinned,
+             recorder.collecting() ? ", recording event" : "");
+  out.printf("  %u records, %u dropped, %u blocks reused\n", s.records, s.dropped, s.reused);
+  out.printf("  %u events (%u cut short, %u triggers while busy)", s.events, s.truncated, s.busy);
+  if (s.events) {
+    if (lastSegment) out.printf(", last at %us: %u bytes in segment #%u", lastEventMs / 1000, lastEventBytes, lastSegment);
+    else out.printf(", last at %us: %u bytes streamed", lastEventMs / 1000, lastEventBytes);
+  }
+  out.println();
+}
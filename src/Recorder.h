@@ -0,0 +1,23 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <Arduino.h>
+#include "FlightRecorder.h"
+
+// The flight recorder (FlightRecorder.h) on the device. Its arena is in
+// PSRAM when the board has it. Events are written by a low priority task
+// to the capture storage, in a segment of their own, or to the export
+// stream while the storage is away (USB drive, not mounted).
+
+#define RECORDER_PSRAM_BYTES (1024 * 1024)
+#define RECORDER_RAM_BYTES (8 * FLIGHT_BLOCK_BYTES)
+#define RECORDER_TASK_PRIORITY 0
+#define RECORDER_TICK_MS 100
+
+void recorderBegin();
+void recorderAppend(const void* rec, size_t len);
+// false if the recorder is off or still writing the previous event
+bool recorderTrigger(FlightTrigger reason, const char* note);
+void printRecorderStatus(Print& out);
+
+#endif
@@ -0,0 +1,124 @@
+#include "RfTracker.h"
+#include <string.h>
+
+// wifi_phy_rate_t codes (non-HT) in speed order; -1 for the unused code 4
+static const int8_t LEGACY_RANK[16] = {0, 1, 2, 5, -1, 1, 2, 5, 10, 8, 6, 3, 11, 9, 7, 4};
+static const uint8_t LEGACY_RATE[RF_LEGACY_RATES] = {2, 4, 11, 12, 18, 22, 24, 36, 48, 72, 96, 108};
+
+RfPhy rfPhy(const RfSample& s) {
+  switch (s.sigMode) {
+    case 0: return s.rate < 8 ? RF_PHY_B : RF_PHY_G;
+    case 1: return s.cwb ? RF_PHY_HT40 : RF_PHY_HT20;
+    default: return RF_PHY_OTHER;
+  }
+}
+
+const char* rfPhyName(RfPhy phy) {
+  static const char* const names[RF_PHY_COUNT] = {"11b", "11g", "ht20", "ht40", "other"};
+  return phy < RF_PHY_COUNT ? names[phy] : "?";
+}
+
+// Smallest bin holding the q-th fraction of the samples
+static int quantile(const uint16_t* bins, int count, uint32_t total, float q) {
+  uint32_t need = (uint32_t)(q * total);
+  if (need < q * total || need < 1) need++;
+  uint32_t sum = 0;
+  for (int i = 0; i < count; i++) {
+    sum += bins[i];
+    if (sum >= need) return i;
+  }
+  return count - 1;
+}
+
+static uint32_t sum(const uint16_t* bins, int count) {
+  uint32_t n = 0;
+  for (int i = 0; i < count; i++) n += bins[i];
+  return n;
+}
+
+static int binOf(int dbm) {
+  if (dbm < RF_DBM_MIN) dbm = RF_DBM_MIN;
+  if (dbm > RF_DBM_MAX) dbm = RF_DBM_MAX;
+  return dbm - RF_DBM_MIN;
+}
+
+RfTracker::RfTracker() {
+  clear();
+}
+
+void RfTracker::clear() {
+  std::lock_guard<std::mutex> guard(lock);
+  memset(channels, 0, sizeof(channels));
+}
+
+void RfTracker::halve(Channel& c, int shift) {
+  uint16_t* counters[] = {c.noise, c.rssi, c.phy, c.legacy, c.mcs};
+  const int sizes[] = {RF_BINS, RF_BINS, RF_PHY_COUNT, RF_LEGACY_RATES, RF_MCS_BINS};
+  for (int k = 0; k < 5; k++) {
+    for (int i = 0; i < sizes[k]; i++) counters[k][i] >>= shift;
+  }
+}
+
+void RfTracker::age(Channel& c, uint32_t nowMs) {
+  uint32_t periods = (nowMs - c.agedMs) / RF_HALF_LIFE_MS;
+  if (periods == 0) return;
+  c.agedMs += periods * RF_HALF_LIFE_MS;
+  halve(c, periods < 16 ? periods : 16);
+}
+
+// A full counter halves the whole channel, which keeps the proportions
+void RfTracker::bump(Channel& c, uint16_t& counter) {
+  if (counter == 0xFFFF) halve(c, 1);
+  counter++;
+}
+
+void RfTracker::add(const RfSample& s, uint32_t nowMs) {
+  if (s.channel < 1 || s.channel > RF_CHANNELS) return;
+  std::lock_guard<std::mutex> guard(lock);
+  Channel& c = channels[s.channel - 1];
+  if (c.frames == 0) c.agedMs = nowMs;
+  age(c, nowMs);
+  c.frames++;
+  c.lastMs = nowMs;
+
+  bump(c, c.rssi[binOf(s.rssi)]);
+  if (s.noiseFloor < 0) bump(c, c.noise[binOf(s.noiseFloor)]);   // 0: not measured
+  RfPhy phy = rfPhy(s);
+  bump(c, c.phy[phy]);
+  if (s.sigMode == 0 && LEGACY_RANK[s.rate & 15] >= 0) {
+    bump(c, c.legacy[LEGACY_RANK[s.rate & 15]]);
+  } else if (s.sigMode == 1) {
+    bump(c, c.mcs[s.mcs < RF_MCS_BINS ? s.mcs : RF_MCS_BINS - 1]);
+  }
+}
+
+bool RfTracker::summary(uint8_t channel, uint32_t nowMs, RfSummary& out) {
+  if (channel < 1 || channel > RF_CHANNELS) return false;
+  std::lock_guard<std::mutex> guard(lock);
+  Channel& c = channels[channel - 1];
+  if (c.frames == 0) return false;
+  age(c, nowMs);
+  memset(&out, 0, sizeof(out));
+  out.channel = channel;
+  out.frames = c.frames;
+  out.ageMs = nowMs - c.lastMs;
+
+  uint32_t total = sum(c.rssi, RF_BINS);
+  out.weight = total;
+  out.rssiP10 = RF_DBM_MIN + quantile(c.rssi, RF_BINS, total, 0.10f);
+  out.rssiP50 = RF_DBM_MIN + quantile(c.rssi, RF_BINS, total, 0.50f);
+  out.rssiP90 = RF_DBM_MIN + quantile(c.rssi, RF_BINS, total, 0.90f);
+  total = sum(c.noise, RF_BINS);
+  out.noiseP50 = total ? RF_DBM_MIN + quantile(c.noise, RF_BINS, total, 0.50f) : 0;
+  out.noiseP90 = total ? RF_DBM_MIN + quantile(c.noise, RF_BINS, total, 0.90f) : 0;
+
+  total = sum(c.phy, RF_PHY_COUNT);
+  for (int i = 0; i < RF_PHY_COUNT && total; i++) {
+    out.mixPct[i] = (c.phy[i] * 100 + total / 2) / total;
+  }
+  total = sum(c.legacy, RF_LEGACY_RATES);
+  out.legacyRate = total ? LEGACY_RATE[quantile(c.legacy, RF_LEGACY_RATES, total, 0.50f)] : 0;
+  total = sum(c.mcs, RF_MCS_BINS);
+  out.mcsP50 = total ? quantile(c.mcs, RF_MCS_BINS, total, 0.50f) : -1;
+  return true;
+}
@@ -0,0 +1,94 @@
+#ifndef RF_TRACKER_H
+#define RF_TRACKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+// RF environment per WiFi channel, fed with the receive metadata of every
+// sniffed frame: noise floor and RSSI distributions, and the PHY mode and
+// rate mix. Both distributions are histograms of 1 dB bins, which is the
+// resolution the radio reports anyway, so quantiles are exact and a sample
+// costs one increment; memory per channel is fixed. Old samples fade out:
+// every counter of a channel is halved each RF_HALF_LIFE_MS, and early
+// when one of them would overflow. Fed from the WiFi driver callback, read
+// by the sniffer task and the UI; the lock is only held for a sample or a
+// summary.
+
+#define RF_CHANNELS 14
+#define RF_DBM_MIN -110           // lowest bin; anything below counts here
+#define RF_DBM_MAX -11            // highest bin
+#define RF_BINS (RF_DBM_MAX - RF_DBM_MIN + 1)
+#define RF_LEGACY_RATES 12        // 1 to 54 Mbps
+#define RF_MCS_BINS 16
+#define RF_HALF_LIFE_MS 60000
+
+enum RfPhy : uint8_t {
+  RF_PHY_B,       // DSSS/CCK
+  RF_PHY_G,       // OFDM, non-HT
+  RF_PHY_HT20,
+  RF_PHY_HT40,
+  RF_PHY_OTHER,   // VHT and anything newer
+  RF_PHY_COUNT
+};
+
+// Receive metadata of one frame, as the driver reports it (wifi_pkt_rx_ctrl_t)
+struct __attribute__((packed)) RfSample {
+  uint8_t channel;
+  int8_t rssi;
+  int8_t noiseFloor;
+  uint8_t sigMode;    // 0 non-HT, 1 HT, 3 VHT
+  uint8_t rate;       // wifi_phy_rate_t, non-HT only
+  uint8_t mcs;        // HT only
+  uint8_t cwb;        // HT only: 1 for a 40 MHz frame
+  uint8_t reserved;
+};
+
+struct RfSummary {
+  uint8_t channel;
+  uint32_t frames;      // since boot
+  uint32_t weight;      // samples still counted after fading
+  uint32_t ageMs;       // since the last frame
+  int8_t noiseP50;
+  int8_t noiseP90;
+  int8_t rssiP10;
+  int8_t rssiP50;
+  int8_t rssiP90;
+  uint8_t mixPct[RF_PHY_COUNT];
+  uint8_t legacyRate;   // median non-HT rate in 500 kbps units, 0 if none
+  int8_t mcsP50;        // median HT MCS, -1 if none
+};
+
+RfPhy rfPhy(const RfSample& s);
+const char* rfPhyName(RfPhy phy);
+
+class RfTracker {
+public:
+  RfTracker();
+  void clear();
+
+  void add(const RfSample& s, uint32_t nowMs);
+  // false if nothing was heard on the channel (1-14)
+  bool summary(uint8_t channel, uint32_t nowMs, RfSummary& out);
+
+private:
+  struct Channel {
+    uint16_t noise[RF_BINS];
+    uint16_t rssi[RF_BINS];
+    uint16_t phy[RF_PHY_COUNT];
+    uint16_t legacy[RF_LEGACY_RATES];
+    uint16_t mcs[RF_MCS_BINS];
+    uint32_t frames;
+    uint32_t lastMs;
+    uint32_t agedMs;      // last half-life boundary applied
+  };
+
+  static void halve(Channel& c, int shift);
+  static void age(Channel& c, uint32_t nowMs);
+  static void bump(Channel& c, uint16_t& counter);
+
+  std::mutex lock;
+  Channel channels[RF_CHANNELS];
+};
+
+#endif
@@ -0,0 +1,359 @@
+#include "Rules.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// =================================================================
+// SLIDING WINDOW
+// =================================================================
+
+void SlidingCounter::init(uint32_t windowMs) {
+  bucketMs = windowMs / RULES_WINDOW_BUCKETS;
+  if (bucketMs == 0) bucketMs = 1;
+  clear();
+}
+
+void SlidingCounter::clear() {
+  memset(buckets, 0, sizeof(buckets));
+  head = 0;
+  headStart = 0;
+  total = 0;
+}
+
+// The window covers the current bucket and the RULES_WINDOW_BUCKETS - 1
+// before it, so it is exact to within one bucket
+uint32_t SlidingCounter::add(uint32_t nowMs) {
+  uint32_t steps = (nowMs - headStart) / bucketMs;
+  if (steps >= RULES_WINDOW_BUCKETS) {
+    memset(buckets, 0, sizeof(buckets));
+    total = 0;
+    headStart = nowMs;
+  } else if (steps > 0) {
+    for (uint32_t i = 0; i < steps; i++) {
+      head = (head + 1) % RULES_WINDOW_BUCKETS;
+      total -= buckets[head];
+      buckets[head] = 0;
+    }
+    headStart += steps * bucketMs;
+  }
+  if (buckets[head] < 0xFFFF) {
+    buckets[head]++;
+    total++;
+  }
+  return total;
+}
+
+// =================================================================
+// COMPILER
+// =================================================================
+
+enum TokenType { TOK_END, TOK_IDENT, TOK_NUM, TOK_OP, TOK_COMMA, TOK_COLON, TOK_ARROW, TOK_BAD };
+
+struct Lexer {
+  const char* p;
+  TokenType type;
+  char text[RULES_NAME_MAX];
+  long num;
+
+  // Reads the next token into type/text/num
+  void next() {
+    while (*p == ' ' || *p == '\t') p++;
+    text[0] = 0;
+    if (!*p) {
+      type = TOK_END;
+    } else if (isalpha((unsigned char)*p)) {
+      size_t n = 0;
+      while (isalnum((unsigned char)*p) || *p == '_' || (*p == '-' && p[1] != '>')) {
+        if (n < sizeof(text) - 1) text[n++] = tolower((unsigned char)*p);
+        p++;
+      }
+      text[n] = 0;
+      type = TOK_IDENT;
+    } else if (isdigit((unsigned char)*p) || (*p == '-' && isdigit((unsigned char)p[1]))) {
+      char* end;
+      num = strtol(p, &end, 10);
+      p = end;
+      type = TOK_NUM;
+    } else if (p[0] == '-' && p[1] == '>') {
+      p += 2;
+      type = TOK_ARROW;
+    } else if (*p == ',' || *p == ':') {
+      type = *p++ == ',' ? TOK_COMMA : TOK_COLON;
+    } else if (strchr("<>=!", *p)) {
+      text[0] = *p++;
+      text[1] = 0;
+      if (*p == '=') {
+        text[1] = *p++;
+        text[2] = 0;
+      }
+      type = TOK_OP;
+    } else {
+      type = TOK_BAD;
+    }
+  }
+
+  bool ident(const char* word) const { return type == TOK_IDENT && strcmp(text, word) == 0; }
+};
+
+static const char* const FIELD_NAMES[RF_COUNT] = {"rssi", "channel", "extra", "security", "new", "open"};
+
+static int parseCmp(const char* op) {
+  static const char* const OPS[] = {">", "<", ">=", "<=", "==", "!="};
+  for (int i = 0; i < 6; i++) {
+    if (strcmp(op, OPS[i]) == 0) return i;
+  }
+  return -1;
+}
+
+static uint8_t negate(uint8_t cmp) {
+  static const uint8_t NOT[] = {CMP_LE, CMP_GE, CMP_LT, CMP_GT, CMP_NE, CMP_EQ};
+  return NOT[cmp];
+}
+
+// Seconds after a count/every keyword, with an optional "s"
+static bool parseSeconds(Lexer& lex, uint32_t& ms) {
+  if (lex.type != TOK_NUM || lex.num <= 0 || lex.num > 86400) return false;
+  ms = lex.num * 1000;
+  lex.next();
+  if (lex.ident("s")) lex.next();
+  return true;
+}
+
+// Compiles text into r, with its instructions at code[0..room)
+bool RuleEngine::compile(const char* text, Rule& r, RuleInsn* code, int room, const char** error) {
+  if (strlen(text) >= RULES_TEXT_MAX) {
+    *error = "rule too long";
+    return false;
+  }
+  memset(&r, 0, sizeof(r));
+  strcpy(r.text, text);
+  r.limitMs = RULES_DEFAULT_LIMIT_S * 1000;
+
+  Lexer lex = {text, TOK_END, "", 0};
+  lex.next();
+  if (lex.type != TOK_IDENT) {
+    *error = "expected a rule name";
+    return false;
+  }
+  strcpy(r.name, lex.text);
+  lex.next();
+  if (lex.type != TOK_COLON) {
+    *error = "expected ':' after the name";
+    return false;
+  }
+  lex.next();
+  if (lex.ident("wifi")) r.sources = RULE_SRC_WIFI;
+  else if (lex.ident("ble")) r.sources = RULE_SRC_BLE;
+  else if (lex.ident("btc")) r.sources = RULE_SRC_BTC;
+  else if (lex.ident("any")) r.sources = RULE_SRC_ANY;
+  else {
+    *error = "source must be wifi, ble, btc or any";
+    return false;
+  }
+  lex.next();
+
+  // Conditions: groups of compares joined by "or"; fail targets are
+  // patched once the start of the following group is known
+  int start = 0;
+  int pc = 0;
+  int groupFirst = pc;
+  bool expectCond = !(lex.type == TOK_ARROW || lex.ident("count"));
+  while (expectCond) {
+    bool negated = false;
+    if (lex.ident("not")) {
+      negated = true;
+      lex.next();
+    }
+    RuleInsn insn = {};
+    int field = -1;
+    for (int i = 0; i < RF_COUNT; i++) {
+      if (lex.ident(FIELD_NAMES[i])) field = i;
+    }
+    if (field < 0) {
+      *error = "unknown condition";
+      return false;
+    }
+    insn.field = field;
+    lex.next();
+    if (field == RF_NEW || field == RF_OPEN) {
+      insn.cmp = CMP_NE;
+      insn.value = 0;
+    } else {
+      int cmp = lex.type == TOK_OP ? parseCmp(lex.text) : -1;
+      if (cmp < 0) {
+        *error = "expected a comparison";
+        return false;
+      }
+      lex.next();
+      if (lex.type != TOK_NUM || lex.num < -32768 || lex.num > 32767) {
+        *error = "expected a number";
+        return false;
+      }
+      insn.cmp = cmp;
+      insn.value = lex.num;
+      lex.next();
+    }
+    if (negated) insn.cmp = negate(insn.cmp);
+    if (pc + 2 > room) {
+      *error = "rule code full";
+      return false;
+    }
+    code[pc++] = insn;
+
+    bool orNext = lex.ident("or");
+    if (lex.ident("and") || orNext) {
+      lex.next();
+    } else {
+      expectCond = false;
+    }
+    if (orNext || !expectCond) {
+      code[pc].cmp = CMP_ACCEPT;
+      pc++;
+      for (int i = groupFirst; i < pc - 1; i++) code[i].fail = pc - start;
+      groupFirst = pc;
+    }
+  }
+  if (pc == start) {
+    if (room < 1) {
+      *error = "rule code full";
+      return false;
+    }
+    code[pc++].cmp = CMP_ACCEPT;   // no conditions: every report of the source
+  }
+
+  if (lex.ident("count")) {
+    lex.next();
+    if (lex.type != TOK_OP || strcmp(lex.text, ">") != 0) {
+      *error = "expected 'count > N in Ts'";
+      return false;
+    }
+    lex.next();
+    if (lex.type != TOK_NUM || lex.num < 0) {
+      *error = "expected a count";
+      return false;
+    }
+    r.threshold = lex.num;
+    lex.next();
+    uint32_t windowMs;
+    if (!lex.ident("in") || (lex.next(), !parseSeconds(lex, windowMs))) {
+      *error = "expected 'in Ts'";
+      return false;
+    }
+    r.window.init(windowMs);
+    r.aggregate = true;
+  }
+
+  if (lex.type != TOK_ARROW) {
+    *error = "expected '->' and actions";
+    return false;
+  }
+  do {
+    lex.next();
+    if (lex.ident("alert")) r.actions |= RULE_ALERT;
+    else if (lex.ident("blink")) r.actions |= RULE_BLINK;
+    else if (lex.ident("export")) r.actions |= RULE_EXPORT;
+    else if (lex.ident("record")) r.actions |= RULE_RECORD;
+    else {
+      *error = "action must be alert, blink, export or record";
+      return false;
+    }
+    lex.next();
+  } while (lex.type == TOK_COMMA);
+
+  if (lex.ident("every")) {
+    lex.next();
+    if (!parseSeconds(lex, r.limitMs)) {
+      *error = "expected 'every Ts'";
+      return false;
+    }
+  }
+  if (lex.type != TOK_END) {
+    *error = "unexpected text at the end";
+    return false;
+  }
+
+  r.codeLen = pc;
+  return true;
+}
+
+bool RuleEngine::add(const char* text, const char** error) {
+  if (count >= RULES_MAX) {
+    *error = "too many rules";
+    return false;
+  }
+  Rule& r = rules[count];
+  if (!compile(text, r, code + codeUsed, RULES_MAX_CODE - codeUsed, error)) return false;
+  r.codeStart = codeUsed;
+  codeUsed += r.codeLen;
+  count++;
+  return true;
+}
+
+bool RuleEngine::check(const char* text, const char** error) {
+  Rule r;
+  RuleInsn scratch[RULES_TEXT_MAX / 2];
+  return compile(text, r, scratch, RULES_TEXT_MAX / 2, error);
+}
+
+void RuleEngine::clear() {
+  count = 0;
+  codeUsed = 0;
+}
+
+// Jump targets are relative to the rule, so code after it just moves down
+bool RuleEngine::remove(int index) {
+  if (index < 0 || index >= count) return false;
+  uint16_t start = rules[index].codeStart;
+  uint16_t len = rules[index].codeLen;
+  memmove(code + start, code + start + len, (codeUsed - start - len) * sizeof(RuleInsn));
+  codeUsed -= len;
+  memmove(rules + index, rules + index + 1, (count - index - 1) * sizeof(Rule));
+  count--;
+  for (int i = index; i < count; i++) rules[i].codeStart -= len;
+  return true;
+}
+
+// =================================================================
+// EVALUATION
+// =================================================================
+
+bool RuleEngine::match(const Rule& rule, const RuleReport& report) const {
+  const RuleInsn* base = code + rule.codeStart;
+  const RuleInsn* pc = base;
+  const RuleInsn* end = base + rule.codeLen;
+  while (pc < end) {
+    int16_t v = report.f[pc->field];
+    bool ok;
+    switch (pc->cmp) {
+      case CMP_GT: ok = v > pc->value; break;
+      case CMP_LT: ok = v < pc->value; break;
+      case CMP_GE: ok = v >= pc->value; break;
+      case CMP_LE: ok = v <= pc->value; break;
+      case CMP_EQ: ok = v == pc->value; break;
+      case CMP_NE: ok = v != pc->value; break;
+      default: return true;   // CMP_ACCEPT
+    }
+    pc = ok ? pc + 1 : base + pc->fail;
+  }
+  return false;
+}
+
+int RuleEngine::evaluate(const RuleReport& report, uint32_t nowMs) {
+  int fired = 0;
+  for (int i = 0; i < count; i++) {
+    Rule& r = rules[i];
+    if (!(r.sources & report.source) || !match(r, report)) continue;
+    r.matches++;
+    if (r.aggregate && r.window.add(nowMs) <= r.threshold) continue;
+    if (r.fired && nowMs - r.lastFireMs < r.limitMs) {
+      r.suppressed++;
+      continue;
+    }
+    r.fired = true;
+    r.lastFireMs = nowMs;
+    r.fires++;
+    fired++;
+    if (onFire) onFire(fireCtx, r, report);
+  }
+  return fired;
+}
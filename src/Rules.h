@@ -0,0 +1,146 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Alert rules over scan reports. A rule is one line of text,
+//
+//   name: source [cond {and|or cond}] [count > N in Ts] -> action{,action} [every Ts]
+//
+//   source   wifi | ble | btc | any
+//   cond     [not] new | open | FIELD OP NUMBER
+//            FIELD: rssi, channel, extra (TX power / device class), security
+//            OP: > < >= <= == !=
+//   count    aggregate: fire when more than N matching reports fell in
+//            the last T seconds (a sliding window of RULES_WINDOW_BUCKETS)
+//   action   alert (LCD) | blink (backlight) | export (event record) |
+//            record (flight recorder dump, FlightRecorder.h)
+//   every    at most one firing per T seconds (default RULES_DEFAULT_LIMIT_S)
+//
+// e.g.  close: any new and rssi > -50 -> alert,blink
+//       open6: wifi new and open and channel == 6 -> alert,export
+//       burst: ble new count > 20 in 60s -> alert every 60s
+//
+// "and" binds tighter than "or". Rules are compiled once into a shared
+// flat array of compare instructions; each failed compare jumps straight
+// to the next "or" group, so evaluation short-circuits without a stack.
+
+#define RULES_MAX 64
+#define RULES_MAX_CODE 512
+#define RULES_NAME_MAX 12
+#define RULES_TEXT_MAX 96
+#define RULES_WINDOW_BUCKETS 12
+#define RULES_DEFAULT_LIMIT_S 10
+
+enum RuleSource {
+  RULE_SRC_WIFI = 0x01,
+  RULE_SRC_BLE = 0x02,
+  RULE_SRC_BTC = 0x04,
+  RULE_SRC_ANY = 0x07
+};
+
+enum RuleField {
+  RF_RSSI,
+  RF_CHANNEL,
+  RF_EXTRA,
+  RF_SECURITY,
+  RF_NEW,
+  RF_OPEN,
+  RF_COUNT
+};
+
+enum RuleAction {
+  RULE_ALERT = 0x01,
+  RULE_BLINK = 0x02,
+  RULE_EXPORT = 0x04,
+  RULE_RECORD = 0x08
+};
+
+// One device sighting as the rules see it
+struct RuleReport {
+  uint8_t source;            // RuleSource bit
+  uint8_t id[6];
+  int16_t f[RF_COUNT];
+};
+
+enum RuleCmp : uint8_t { CMP_GT, CMP_LT, CMP_GE, CMP_LE, CMP_EQ, CMP_NE, CMP_ACCEPT };
+
+// Compare f[field] against value; on failure continue at fail (relative
+// to the rule's first instruction), on success at the next instruction.
+// CMP_ACCEPT ends a group that matched.
+struct RuleInsn {
+  uint8_t cmp;
+  uint8_t field;
+  int16_t value;
+  uint16_t fail;
+};
+
+// Matching reports per bucket over a window of RULES_WINDOW_BUCKETS buckets
+struct SlidingCounter {
+  uint16_t buckets[RULES_WINDOW_BUCKETS];
+  uint32_t bucketMs;
+  uint32_t headStart;   // start time of the newest bucket
+  uint8_t head;
+  uint32_t total;
+
+  void init(uint32_t windowMs);
+  uint32_t add(uint32_t nowMs);   // counts one report, returns the window total
+  void clear();
+};
+
+struct Rule {
+  char name[RULES_NAME_MAX];
+  char text[RULES_TEXT_MAX];
+  uint8_t sources;
+  uint8_t actions;
+  uint16_t codeStart;
+  uint16_t codeLen;
+  bool aggregate;         // fires on the window count, not single reports
+  uint32_t threshold;
+  uint32_t limitMs;
+  uint32_t lastFireMs;
+  bool fired;             // lastFireMs is valid
+  uint32_t matches;
+  uint32_t fires;
+  uint32_t suppressed;    // matched, but inside the rate limit
+  SlidingCounter window;
+};
+
+class RuleEngine {
+public:
+  typedef void (*FireFn)(void* ctx, const Rule& rule, const RuleReport& report);
+
+  RuleEngine() : count(0), codeUsed(0), onFire(nullptr), fireCtx(nullptr) {}
+
+  void setHandler(FireFn fn, void* ctx) {
+    onFire = fn;
+    fireCtx = ctx;
+  }
+
+  // Compiles and appends a rule; on failure returns false and sets error
+  bool add(const char* text, const char** error);
+  // Syntax check only (config validation)
+  static bool check(const char* text, const char** error);
+  bool remove(int index);   // recompiles the rest
+  void clear();
+
+  // Runs every rule against one report; returns how many fired
+  int evaluate(const RuleReport& report, uint32_t nowMs);
+
+  int size() const { return count; }
+  const Rule& rule(int i) const { return rules[i]; }
+
+private:
+  static bool compile(const char* text, Rule& r, RuleInsn* code, int room, const char** error);
+  bool match(const Rule& rule, const RuleReport& report) const;
+
+  Rule rules[RULES_MAX];
+  int count;
+  RuleInsn code[RULES_MAX_CODE];
+  int codeUsed;
+  FireFn onFire;
+  void* fireCtx;
+};
+
+#endif
@@ -0,0 +1,304 @@
+#include "ScanCodec.h"
+#include <string.h>
+
+#define ADDR_END 22   // frame control, duration, addr1..3
+
+static uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static uint8_t macTag(const uint8_t* mac) {
+  // The low bytes vary most between devices of one vendor
+  return mac[5] ^ mac[4] ^ mac[3] << 1;
+}
+
+// =================================================================
+// ENCODER
+// =================================================================
+
+void ScanEncoder::reset() {
+  pos = sizeof(CaptureRecordHeader);
+  records = 0;
+  prevChannel = 0;
+  prevRate = 0;
+  next = 0;
+  used = 0;
+}
+
+void ScanEncoder::putVarint(uint32_t v) {
+  while (v >= 0x80) {
+    out[pos++] = v | 0x80;
+    v >>= 7;
+  }
+  out[pos++] = v;
+}
+
+void ScanEncoder::putDelta(uint32_t timeMs) {
+  putVarint(zigzag((int32_t)(timeMs - prevTime)));
+  prevTime = timeMs;
+}
+
+// Tags filter the compare; the scan is exact, so an address is never
+// in the dictionary twice
+int ScanEncoder::lookup(const uint8_t* mac) {
+  uint8_t t = macTag(mac);
+  for (int slot = 0; slot < used; slot++) {
+    if (tag[slot] == t && memcmp(dict[slot].mac, mac, 6) == 0) return slot;
+  }
+  return -1;
+}
+
+int ScanEncoder::insert(const uint8_t* mac) {
+  int slot = next;
+  next = (next + 1) % CODEC_DICT_SIZE;
+  memcpy(dict[slot].mac, mac, 6);
+  dict[slot].rssi = 0;
+  dict[slot].extra = 0;
+  tag[slot] = macTag(mac);
+  if (used < CODEC_DICT_SIZE) used++;
+  return slot;
+}
+
+int ScanEncoder::putMac(const uint8_t* mac, uint8_t& flags, uint8_t bit) {
+  int slot = lookup(mac);
+  if (slot >= 0) {
+    flags |= bit;
+    out[pos++] = slot;
+    return slot;
+  }
+  memcpy(out + pos, mac, 6);
+  pos += 6;
+  return insert(mac);
+}
+
+bool ScanEncoder::add(const uint8_t* rec, size_t len) {
+  CaptureRecordHeader hdr;
+  if (len < sizeof(hdr)) return true;   // nothing a decoder could rebuild
+  memcpy(&hdr, rec, sizeof(hdr));
+  // No op is more than 8 bytes bigger than its record
+  if (pos + len + 8 > sizeof(out)) return false;
+
+  if (records == 0) {
+    firstMs = hdr.timeMs;
+    prevTime = hdr.timeMs;
+  }
+  size_t opPos = pos++;
+  uint8_t flags = 0;
+
+  if (hdr.len == len && len == sizeof(SurveyRecord) && hdr.reserved == 0 &&
+      hdr.type >= CAPTURE_WIFI_SURVEY && hdr.type <= CAPTURE_BTC_SURVEY) {
+    const SurveyRecord* s = (const SurveyRecord*)rec;
+    if (hdr.timeMs == prevTime) flags |= CODEC_SAME_TIME;
+    else putDelta(hdr.timeMs);
+    CodecSlot& slot = dict[putMac(s->id, flags, CODEC_HIT)];
+    bool hit = flags & CODEC_HIT;
+    int rssi = RSSI_LITERAL;
+    if (hit && s->rssi == slot.rssi) rssi = RSSI_SAME;
+    else if (hit && s->rssi == slot.rssi + 1) rssi = RSSI_UP;
+    else if (hit && s->rssi == slot.rssi - 1) rssi = RSSI_DOWN;
+    else out[pos++] = s->rssi;
+    flags |= rssi << CODEC_RSSI_SHIFT;
+    if (hit && slot.extra == s->extra) flags |= CODEC_SAME_EXTRA;
+    else out[pos++] = s->extra;
+    slot.rssi = s->rssi;
+    slot.extra = s->extra;
+    out[opPos] = hdr.type << 5 | flags;
+
+  } else if (hdr.len == len && len >= sizeof(FrameRecord) && hdr.type == CAPTURE_WIFI_FRAME &&
+             hdr.reserved == 0 && ((const FrameRecord*)rec)->reserved == 0) {
+    const FrameRecord* f = (const FrameRecord*)rec;
+    const uint8_t* payload = rec + sizeof(FrameRecord);
+    size_t capLen = len - sizeof(FrameRecord);
+    putDelta(hdr.timeMs);
+    if (f->channel == prevChannel) flags |= CODEC_SAME_CHANNEL;
+    else out[pos++] = f->channel;
+    out[pos++] = f->rssi;
+    if (f->rate == prevRate) flags |= CODEC_SAME_RATE;
+    else out[pos++] = f->rate;
+    out[pos++] = f->frameType;
+    putVarint(f->origLen);
+    putVarint(capLen);
+    prevChannel = f->channel;
+    prevRate = f->rate;
+    size_t from = 0;
+    if (capLen >= ADDR_END) {
+      memcpy(out + pos, payload, 4);
+      pos += 4;
+      for (int i = 0; i < 3; i++) putMac(payload + 4 + i * 6, flags, CODEC_ADDR_HIT << i);
+      from = ADDR_END;
+    }
+    memcpy(out + pos, payload + from, capLen - from);
+    pos += capLen - from;
+    out[opPos] = CAPTURE_WIFI_FRAME << 5 | flags;
+
+  } else {
+    out[opPos] = CODEC_OP_RAW << 5;
+    putVarint(len);
+    memcpy(out + pos, rec, len);
+    pos += len;
+    prevTime = hdr.timeMs;
+  }
+
+  records++;
+  rawBytes += len;
+  return true;
+}
+
+size_t ScanEncoder::finish(const uint8_t** block) {
+  CaptureRecordHeader hdr;
+  hdr.len = pos;
+  hdr.type = CAPTURE_CODEC_BLOCK;
+  hdr.reserved = CODEC_VERSION;
+  hdr.timeMs = firstMs;
+  memcpy(out, &hdr, sizeof(hdr));
+  *block = out;
+  size_t len = pos;
+  encodedBytes += len;
+  blocks++;
+  reset();
+  return len;
+}
+
+// =================================================================
+// DECODER
+// =================================================================
+
+// Bounds-checked reader over the block body
+struct CodecReader {
+  const uint8_t* p;
+  const uint8_t* end;
+  bool ok;
+
+  uint8_t byte() {
+    if (p >= end) {
+      ok = false;
+      return 0;
+    }
+    return *p++;
+  }
+  uint32_t varint() {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+      uint8_t b = byte();
+      v |= (uint32_t)(b & 0x7f) << shift;
+      if (!(b & 0x80)) return v;
+    }
+    ok = false;
+    return 0;
+  }
+  bool bytes(uint8_t* dst, size_t n) {
+    if ((size_t)(end - p) < n) return ok = false;
+    memcpy(dst, p, n);
+    p += n;
+    return true;
+  }
+};
+
+bool ScanDecoder::decode(const uint8_t* block, size_t len, EmitFn emit, void* ctx) {
+  CaptureRecordHeader bh;
+  if (len < sizeof(bh)) return false;
+  memcpy(&bh, block, sizeof(bh));
+  if (bh.type != CAPTURE_CODEC_BLOCK || bh.reserved != CODEC_VERSION || bh.len != len) return false;
+
+  CodecReader in = {block + sizeof(bh), block + len, true};
+  memset(dict, 0, sizeof(dict));
+  int next = 0;
+  uint32_t prevTime = bh.timeMs;
+  uint8_t prevChannel = 0, prevRate = 0;
+
+  // Reads a MAC reference into dst; literals join the dictionary
+  auto getMac = [&](uint8_t* dst, bool hit) -> int {
+    if (hit) {
+      uint8_t slot = in.byte();
+      if (slot >= CODEC_DICT_SIZE) in.ok = false;
+      if (!in.ok) return -1;
+      memcpy(dst, dict[slot].mac, 6);
+      return slot;
+    }
+    if (!in.bytes(dst, 6)) return -1;
+    int slot = next;
+    next = (next + 1) % CODEC_DICT_SIZE;
+    memcpy(dict[slot].mac, dst, 6);
+    dict[slot].rssi = 0;
+    dict[slot].extra = 0;
+    return slot;
+  };
+
+  while (in.p < in.end) {
+    uint8_t op = in.byte();
+    uint8_t flags = op & 0x1f;
+    size_t recLen;
+
+    if (op >> 5 == CODEC_OP_RAW) {
+      recLen = in.varint();
+      if (!in.ok || recLen < sizeof(CaptureRecordHeader) || recLen > sizeof(rec) ||
+          !in.bytes(rec, recLen)) {
+        return false;
+      }
+      CaptureRecordHeader h;
+      memcpy(&h, rec, sizeof(h));
+      if (h.len != recLen) return false;
+      prevTime = h.timeMs;
+
+    } else if (op >> 5 >= CAPTURE_WIFI_SURVEY && op >> 5 <= CAPTURE_BTC_SURVEY) {
+      SurveyRecord s;
+      s.hdr.len = sizeof(s);
+      s.hdr.type = op >> 5;
+      s.hdr.reserved = 0;
+      if (!(flags & CODEC_SAME_TIME)) prevTime += unzigzag(in.varint());
+      s.hdr.timeMs = prevTime;
+      bool hit = flags & CODEC_HIT;
+      int slot = getMac(s.id, hit);
+      if (slot < 0) return false;
+      int rssi = flags >> CODEC_RSSI_SHIFT;
+      if (!hit && rssi != RSSI_LITERAL) return false;
+      if (rssi == RSSI_LITERAL) s.rssi = in.byte();
+      else s.rssi = dict[slot].rssi + (rssi == RSSI_UP) - (rssi == RSSI_DOWN);
+      s.extra = flags & CODEC_SAME_EXTRA ? dict[slot].extra : (int8_t)in.byte();
+      if (!in.ok) return false;
+      dict[slot].rssi = s.rssi;
+      dict[slot].extra = s.extra;
+      recLen = sizeof(s);
+      memcpy(rec, &s, sizeof(s));
+
+    } else if (op >> 5 == CAPTURE_WIFI_FRAME) {
+      FrameRecord f;
+      f.hdr.type = CAPTURE_WIFI_FRAME;
+      f.hdr.reserved = 0;
+      prevTime += unzigzag(in.varint());
+      f.hdr.timeMs = prevTime;
+      f.channel = flags & CODEC_SAME_CHANNEL ? prevChannel : in.byte();
+      f.rssi = in.byte();
+      f.rate = flags & CODEC_SAME_RATE ? prevRate : in.byte();
+      f.frameType = in.byte();
+      f.origLen = in.varint();
+      f.reserved = 0;
+      size_t capLen = in.varint();
+      if (!in.ok || capLen > sizeof(rec) - sizeof(f)) return false;
+      prevChannel = f.channel;
+      prevRate = f.rate;
+      uint8_t* payload = rec + sizeof(f);
+      size_t from = 0;
+      if (capLen >= ADDR_END) {
+        if (!in.bytes(payload, 4)) return false;
+        for (int i = 0; i < 3; i++) {
+          if (getMac(payload + 4 + i * 6, flags & (CODEC_ADDR_HIT << i)) < 0) return false;
+        }
+        from = ADDR_END;
+      }
+      if (!in.bytes(payload + from, capLen - from)) return false;
+      recLen = sizeof(f) + capLen;
+      f.hdr.len = recLen;
+      memcpy(rec, &f, sizeof(f));
+
+    } else {
+      return false;
+    }
+    emit(ctx, rec, recLen);
+  }
+  return in.ok;
+}
@@ -0,0 +1,103 @@
+#ifndef SCAN_CODEC_H
+#define SCAN_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "CaptureStorage.h"
+
+// Export compression for capture records. Consecutive records are packed
+// into one CAPTURE_CODEC_BLOCK record (header timeMs = first record's
+// time, reserved = CODEC_VERSION), so transports and the collector keep
+// seeing whole records. Inside a block:
+//   - MACs (survey ids, frame addr1..3) are replaced by a 1-byte index
+//     into a dictionary of the last CODEC_DICT_SIZE addresses
+//   - a sighting's RSSI and extra byte are left out when they equal the
+//     last values seen for that MAC
+//   - timestamps are zigzag varint deltas from the previous record
+//   - anything else goes through as a raw record
+// Every block starts from an empty dictionary, so a lost datagram only
+// costs its own records. Ops (kind in bits 7..5, flags in 4..0; the
+// kind of a packed record is its CaptureRecordType):
+//   RAW      varint len, record
+//   SURVEY   flags: MAC hit, same time, same extra, RSSI code (2 bits:
+//            same, +1, -1, literal)
+//            [dt], MAC (index | 6 bytes), [rssi], [extra]
+//   FRAME    flags: same channel, same rate, addr1..3 hit
+//            dt, [channel], rssi, [rate], frameType, varint origLen,
+//            varint capLen, payload (addresses as above if capLen >= 22)
+// tools/scancodec.py is the host decoder.
+
+#define CODEC_VERSION 1
+#define CODEC_BLOCK_BYTES 1280   // encoded body; a block fits one UDP datagram
+#define CODEC_DICT_SIZE 64
+
+#define CODEC_OP_RAW 0
+
+#define CODEC_HIT 0x01
+#define CODEC_SAME_TIME 0x02
+#define CODEC_SAME_EXTRA 0x04
+#define CODEC_RSSI_SHIFT 3
+enum CodecRssi { RSSI_SAME, RSSI_UP, RSSI_DOWN, RSSI_LITERAL };
+
+#define CODEC_SAME_CHANNEL 0x01
+#define CODEC_SAME_RATE 0x02
+#define CODEC_ADDR_HIT 0x04   // << 0..2 for addr1..3
+
+struct CodecSlot {
+  uint8_t mac[6];
+  int8_t rssi;
+  int8_t extra;
+};
+
+class ScanEncoder {
+public:
+  ScanEncoder() { reset(); }
+
+  // Packs one capture record. False when the block has no room: finish()
+  // it and try again (a record that does not fit an empty block has to
+  // be sent as it is).
+  bool add(const uint8_t* rec, size_t len);
+  bool empty() const { return records == 0; }
+
+  // Closes the block; returns the CAPTURE_CODEC_BLOCK record (valid until
+  // the next add) and starts a new one
+  size_t finish(const uint8_t** block);
+
+  uint32_t rawBytes = 0;       // records in
+  uint32_t encodedBytes = 0;   // blocks out, headers included
+  uint32_t blocks = 0;
+
+private:
+  void reset();
+  void putVarint(uint32_t v);
+  void putDelta(uint32_t timeMs);
+  int putMac(const uint8_t* mac, uint8_t& flags, uint8_t bit);
+  int lookup(const uint8_t* mac);
+  int insert(const uint8_t* mac);
+
+  uint8_t out[sizeof(CaptureRecordHeader) + CODEC_BLOCK_BYTES];
+  size_t pos;
+  uint16_t records;
+  uint32_t firstMs;
+  uint32_t prevTime;
+  uint8_t prevChannel;
+  uint8_t prevRate;
+  CodecSlot dict[CODEC_DICT_SIZE];
+  uint8_t next;
+  uint8_t used;
+  uint8_t tag[CODEC_DICT_SIZE];    // macTag() of each slot
+};
+
+// Unpacks a CAPTURE_CODEC_BLOCK record; calls emit for every record in
+// it. Returns false (after emitting what was valid) on a malformed block.
+class ScanDecoder {
+public:
+  typedef void (*EmitFn)(void* ctx, const uint8_t* rec, size_t len);
+  bool decode(const uint8_t* block, size_t len, EmitFn emit, void* ctx);
+
+private:
+  uint8_t rec[sizeof(FrameRecord) + CODEC_BLOCK_BYTES];
+  CodecSlot dict[CODEC_DICT_SIZE];
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "ScanMerge.h"
+#include <string.h>
+
+ScanMerge::ScanMerge() : active(true), duplicates(false) {
+  clear();
+  memset(&counters, 0, sizeof(counters));
+}
+
+// Forgets every held and delivered report
+void ScanMerge::clear() {
+  for (int i = 0; i < SCAN_MERGE_SLOTS; i++) slots[i].state = SLOT_FREE;
+  overflow.state = SLOT_FREE;
+}
+
+void ScanMerge::configure(bool active, bool duplicates) {
+  this->active = active;
+  this->duplicates = duplicates;
+}
+
+ScanMerge::Slot* ScanMerge::find(const uint8_t bda[6]) {
+  for (int i = 0; i < SCAN_MERGE_SLOTS; i++) {
+    if (slots[i].state != SLOT_FREE && memcmp(slots[i].report.bda, bda, 6) == 0) return &slots[i];
+  }
+  return nullptr;
+}
+
+// A slot for a new address: a free one, else the least recently seen
+// delivered one, else the overflow slot
+ScanMerge::Slot* ScanMerge::claim(const uint8_t bda[6], uint32_t nowMs) {
+  Slot* slot = nullptr;
+  for (int i = 0; i < SCAN_MERGE_SLOTS; i++) {
+    Slot& s = slots[i];
+    if (s.state == SLOT_FREE) {
+      slot = &s;
+      break;
+    }
+    if (s.state == SLOT_DONE && (slot == nullptr || (int32_t)(s.lastMs - slot->lastMs) < 0)) slot = &s;
+  }
+  if (slot == nullptr) slot = &overflow;
+  memset(&slot->report, 0, sizeof(slot->report));
+  memcpy(slot->report.bda, bda, 6);
+  slot->state = SLOT_FREE;
+  slot->heldMs = nowMs;
+  return slot;
+}
+
+// Replaces the advertising half, moving the scan response behind it; true
+// if the bytes changed
+bool ScanMerge::setAdv(Slot& slot, const uint8_t* data, uint8_t len) {
+  ScanReport& r = slot.report;
+  if (len == r.advLen && memcmp(r.payload, data, len) == 0) return false;
+  memmove(r.payload + len, r.payload + r.advLen, r.rspLen);
+  memcpy(r.payload, data, len);
+  r.advLen = len;
+  return true;
+}
+
+// Replaces the scan response half; true if the bytes changed
+bool ScanMerge::setRsp(Slot& slot, const uint8_t* data, uint8_t len) {
+  ScanReport& r = slot.report;
+  if (len == r.rspLen && memcmp(r.payload + r.advLen, data, len) == 0) return false;
+  memcpy(r.payload + r.advLen, data, len);
+  r.rspLen = len;
+  return true;
+}
+
+void ScanMerge::add(const uint8_t bda[6], uint8_t addrType, uint8_t evtType, int rssi,
+                    const uint8_t* data, uint8_t advLen, uint8_t rspLen, uint32_t nowMs) {
+  counters.reports++;
+  if (advLen > SCAN_MERGE_DATA_MAX) advLen = SCAN_MERGE_DATA_MAX;
+  if (rspLen > SCAN_MERGE_DATA_MAX) rspLen = SCAN_MERGE_DATA_MAX;
+  bool response = evtType == ADV_EVT_SCAN_RSP;
+  bool scannable = active && (evtType == ADV_EVT_CONN_ADV || evtType == ADV_EVT_DISC_ADV);
+
+  Slot* slot = find(bda);
+  bool fresh = slot == nullptr;
+  if (fresh) slot = claim(bda, nowMs);
+  ScanReport& r = slot->report;
+  bool hadAdv = r.advLen > 0, hadRsp = r.rspLen > 0;
+  bool changed;
+  if (response) {
+    // Data of a SCAN_RSP event is all scan response
+    int len = advLen + rspLen;
+    changed = setRsp(*slot, data, len > SCAN_MERGE_DATA_MAX ? SCAN_MERGE_DATA_MAX : len);
+  } else {
+    changed = setAdv(*slot, data, advLen);
+    if (rspLen > 0) changed |= setRsp(*slot, data + advLen, rspLen);
+    r.evtType = evtType;
+    r.addrType = addrType;
+  }
+  if (fresh) {
+    r.evtType = evtType;
+    r.addrType = addrType;
+  }
+  r.rssi = rssi;
+  slot->lastMs = nowMs;
+
+  switch (slot->state) {
+    case SLOT_FREE:
+      if (slot != &overflow && scannable && r.rspLen == 0) {
+        slot->state = SLOT_HELD;
+        slot->heldMs = nowMs;
+      } else {
+        slot->state = SLOT_READY;
+      }
+      break;
+
+    case SLOT_HELD:
+      if (response || r.rspLen > 0) {
+        slot->state = SLOT_READY;   // the pair is complete
+        counters.merged++;
+      } else if (!changed) {
+        counters.repeats++;
+      } else {
+        counters.merged++;          // newer ADV data, still waiting
+      }
+      break;
+
+    case SLOT_READY:
+      if (changed) counters.merged++;
+      else counters.repeats++;
+      break;
+
+    case SLOT_DONE:
+      // Without duplicates a delivered device only comes back for the half
+      // it was missing (a late scan response), not for every change; with
+      // them, each ADV waits for its response again
+      if (!changed) counters.repeats++;
+      if (duplicates && scannable && !response && rspLen == 0) {
+        slot->state = SLOT_HELD;
+        slot->heldMs = nowMs;
+      } else if (duplicates || (!hadAdv && r.advLen > 0) || (!hadRsp && r.rspLen > 0)) {
+        slot->state = SLOT_READY;
+      }
+      break;
+  }
+}
+
+const ScanReport* ScanMerge::next(uint32_t nowMs, bool flush) {
+  if (overflow.state == SLOT_READY) {
+    overflow.state = SLOT_FREE;
+    counters.delivered++;
+    return &overflow.report;
+  }
+  for (int i = 0; i < SCAN_MERGE_SLOTS; i++) {
+    Slot& s = slots[i];
+    if (s.state == SLOT_HELD && (flush || nowMs - s.heldMs >= SCAN_MERGE_HOLD_MS)) {
+      counters.expired++;
+      s.state = SLOT_READY;
+    }
+    if (s.state == SLOT_READY) {
+      s.state = SLOT_DONE;
+      counters.delivered++;
+      return &s.report;
+    }
+  }
+  return nullptr;
+}
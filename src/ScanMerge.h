@@ -0,0 +1,92 @@
+#ifndef SCAN_MERGE_H
+#define SCAN_MERGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Pairs BLE advertisements with their scan responses during an active
+// scan. Reports are keyed by address. An ADV_IND or ADV_SCAN_IND is held
+// for up to SCAN_MERGE_HOLD_MS; the SCAN_RSP that follows is appended to
+// the same buffer and the pair comes out of next() as one report, parsed
+// once. Anything else is ready at once. Delivered reports stay in their
+// slot so that repeats are recognised: merging the same bytes twice
+// changes nothing and yields nothing. A delivered report is only reopened
+// for the half it lacked. Fixed storage; not thread safe (the GAP
+// callback owns it).
+
+#define SCAN_MERGE_SLOTS 16
+#define SCAN_MERGE_DATA_MAX 31   // legacy advertising data, either half
+#define SCAN_MERGE_HOLD_MS 100   // a scan response follows its ADV within the same window
+
+// esp_ble_evt_type_t
+#define ADV_EVT_CONN_ADV 0       // ADV_IND
+#define ADV_EVT_CONN_DIR_ADV 1   // ADV_DIRECT_IND
+#define ADV_EVT_DISC_ADV 2       // ADV_SCAN_IND
+#define ADV_EVT_NON_CONN_ADV 3
+#define ADV_EVT_SCAN_RSP 4
+
+// One advertiser's reports, combined: the advertising data at the front of
+// payload, the scan response right after it
+struct ScanReport {
+  uint8_t bda[6];
+  uint8_t addrType;
+  uint8_t evtType;      // of the advertisement, or the scan response if that is all we have
+  int rssi;
+  uint8_t payload[2 * SCAN_MERGE_DATA_MAX];
+  uint8_t advLen;
+  uint8_t rspLen;
+};
+
+struct ScanMergeStats {
+  uint32_t reports;     // handed to add()
+  uint32_t delivered;   // handed back by next(), one parse each
+  uint32_t merged;      // folded into another report instead of parsed alone
+  uint32_t repeats;     // identical to what was already held or delivered
+  uint32_t expired;     // ADVs whose scan response never came
+};
+
+inline bool advConnectable(uint8_t evtType) {
+  return evtType == ADV_EVT_CONN_ADV || evtType == ADV_EVT_CONN_DIR_ADV;
+}
+
+class ScanMerge {
+public:
+  ScanMerge();
+  void clear();
+  // A passive scan never waits for scan responses; with duplicates every
+  // report comes out again, merged, rather than only changed ones
+  void configure(bool active, bool duplicates);
+
+  // advLen and rspLen bytes of data, as in esp_ble_gap_cb_param_t::scan_rst
+  void add(const uint8_t bda[6], uint8_t addrType, uint8_t evtType, int rssi, const uint8_t* data,
+           uint8_t advLen, uint8_t rspLen, uint32_t nowMs);
+
+  // The next report ready for parsing, valid until the next add(); held
+  // reports are released once they have waited SCAN_MERGE_HOLD_MS, or all
+  // of them when flush is set (end of scan)
+  const ScanReport* next(uint32_t nowMs, bool flush = false);
+
+  const ScanMergeStats& stats() const { return counters; }
+
+private:
+  enum State : uint8_t { SLOT_FREE, SLOT_HELD, SLOT_READY, SLOT_DONE };
+  struct Slot {
+    ScanReport report;
+    State state;
+    uint32_t heldMs;
+    uint32_t lastMs;
+  };
+
+  Slot* find(const uint8_t bda[6]);
+  Slot* claim(const uint8_t bda[6], uint32_t nowMs);
+  static bool setAdv(Slot& slot, const uint8_t* data, uint8_t len);
+  static bool setRsp(Slot& slot, const uint8_t* data, uint8_t len);
+
+  Slot slots[SCAN_MERGE_SLOTS];
+  Slot overflow;   // when every slot is pending; ready at once
+  bool active;
+  bool duplicates;
+  ScanMergeStats counters;
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include "SegmentUpload.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#define UPLOAD_POLL_MS 30000   // look for newly closed segments
+#define UPLOAD_BUSY_MS 1000    // retry after a burst
+
+enum UploadResult { UPLOAD_OK, UPLOAD_GONE, UPLOAD_PAUSED, UPLOAD_FAILED };
+
+bool parseUploadUrl(const char* url, UploadUrl& out) {
+  memset(&out, 0, sizeof(out));
+  if (strncmp(url, "http://", 7) != 0) return false;
+  const char* host = url + 7;
+  size_t hostLen = strcspn(host, ":/");
+  if (hostLen == 0 || hostLen >= sizeof(out.host)) return false;
+  for (size_t i = 0; i < hostLen; i++) {
+    if (!isalnum((unsigned char)host[i]) && host[i] != '.' && host[i] != '-') return false;
+  }
+  memcpy(out.host, host, hostLen);
+  const char* p = host + hostLen;
+  out.port = 80;
+  if (*p == ':') {
+    char* end;
+    long port = strtol(p + 1, &end, 10);
+    if (end == p + 1 || port < 1 || port > 65535) return false;
+    out.port = port;
+    p = end;
+  }
+  if (*p && *p != '/') return false;
+  size_t pathLen = strlen(p);
+  while (pathLen > 0 && p[pathLen - 1] == '/') pathLen--;
+  if (pathLen >= sizeof(out.path) || memchr(p, ' ', pathLen)) return false;
+  memcpy(out.path, p, pathLen);
+  return true;
+}
+
+void Backoff::failed(uint32_t nowMs) {
+  delayMs = delayMs == 0 ? UPLOAD_BACKOFF_MIN_MS : delayMs * 2;
+  if (delayMs > UPLOAD_BACKOFF_MAX_MS) delayMs = UPLOAD_BACKOFF_MAX_MS;
+  untilMs = nowMs + delayMs;
+}
+
+SegmentUploader::SegmentUploader(CaptureStorage& storage, UploadConn& conn, UploadHooks& hooks)
+  : storage(storage), conn(conn), hooks(hooks), haveTarget(false), haveCursor(false), lastId(0) {
+  memset(&url, 0, sizeof(url));
+  memset(&counters, 0, sizeof(counters));
+  node[0] = 0;
+}
+
+void SegmentUploader::setTarget(const UploadUrl& url, const char* node) {
+  this->url = url;
+  snprintf(this->node, sizeof(this->node), "%s", node);
+  haveTarget = true;
+  haveCursor = false;   // a different server holds different segments
+  backoff.succeeded();
+}
+
+void SegmentUploader::fail(int status) {
+  counters.failures++;
+  counters.lastStatus = status;
+  haveCursor = false;
+  backoff.failed(hooks.now());
+}
+
+uint32_t SegmentUploader::run() {
+  if (!haveTarget || !hooks.online()) return UPLOAD_POLL_MS;
+  if (!backoff.ready(hooks.now())) return backoff.wait(hooks.now());
+  if (hooks.busy()) return UPLOAD_BUSY_MS;
+  if (!haveCursor && !queryCursor()) return backoff.delay();
+
+  // The server is ahead of us: storage was wiped and ids started over
+  if (lastId >= storage.currentSegment()) lastId = 0;
+  // The next page of segments past the cursor, oldest first
+  SegmentInfo segs[UPLOAD_MAX_SEGMENTS];
+  int n = storage.listSegments(lastId, segs, UPLOAD_MAX_SEGMENTS);
+  for (int i = 0; i < n; i++) {
+    const SegmentInfo& seg = segs[i];
+    if (lastId != 0 && seg.id > lastId + 1) counters.skipped += seg.id - lastId - 1;
+    int result = upload(seg);
+    if (result == UPLOAD_FAILED) return backoff.delay();
+    if (result == UPLOAD_PAUSED) return UPLOAD_BUSY_MS;
+    if (result == UPLOAD_OK) {
+      counters.segments++;
+      counters.bytes += seg.size;
+    } else {
+      counters.skipped++;
+    }
+    lastId = seg.id;
+    backoff.succeeded();
+    if (hooks.busy()) return UPLOAD_BUSY_MS;
+  }
+  return n == UPLOAD_MAX_SEGMENTS ? UPLOAD_BUSY_MS : UPLOAD_POLL_MS;   // more behind this page
+}
+
+bool SegmentUploader::request(const char* method, const char* target, bool chunked) {
+  if (!conn.connect(url.host, url.port, UPLOAD_TIMEOUT_MS)) return false;
+  char head[200];
+  int len = snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: %s:%u\r\n%sConnection: close\r\n\r\n",
+                     method, target, url.host, url.port,
+                     chunked ? "Content-Type: application/octet-stream\r\n"
+                               "Transfer-Encoding: chunked\r\n" : "");
+  if (len <= 0 || (size_t)len >= sizeof(head) || !conn.write(head, len)) {
+    conn.stop();
+    return false;
+  }
+  return true;
+}
+
+// Reads the whole reply (the server closes); returns the status code and
+// the body in body, or -1
+int SegmentUploader::readStatus(char* body, size_t cap) {
+  size_t have = 0;
+  uint32_t startMs = hooks.now();
+  while (have < cap - 1 && hooks.now() - startMs < UPLOAD_TIMEOUT_MS) {
+    size_t n = conn.read(body + have, cap - 1 - have, UPLOAD_TIMEOUT_MS);
+    if (n == 0) break;
+    have += n;
+  }
+  conn.stop();
+  body[have] = 0;
+  int status;
+  if (sscanf(body, "HTTP/1.%*d %d", &status) != 1) return -1;
+  const char* text = strstr(body, "\r\n\r\n");
+  const char* start = text ? text + 4 : body + have;
+  memmove(body, start, body + have - start + 1);
+  return status;
+}
+
+bool SegmentUploader::queryCursor() {
+  char target[80];
+  snprintf(target, sizeof(target), "%s/%s/last", url.path, node);
+  if (!request("GET", target, false)) {
+    fail(-1);
+    return false;
+  }
+  char* body = (char*)chunk;
+  int status = readStatus(body, sizeof(chunk));
+  if (status != 200) {
+    fail(status);
+    return false;
+  }
+  counters.lastStatus = status;
+  lastId = strtoul(body, NULL, 10);
+  haveCursor = true;
+  return true;
+}
+
+bool SegmentUploader::sendChunk(const uint8_t* data, size_t len) {
+  char size[12];
+  int n = snprintf(size, sizeof(size), "%x\r\n", (unsigned)len);
+  return conn.write(size, n) && conn.write(data, len) && conn.write("\r\n", 2);
+}
+
+// Holds the transfer open while a burst lasts, up to UPLOAD_PAUSE_MAX_MS
+bool SegmentUploader::waitWhileBusy() {
+  if (!hooks.busy()) return true;
+  counters.pauses++;
+  uint32_t start = hooks.now();
+  while (hooks.busy()) {
+    if (hooks.now() - start >= UPLOAD_PAUSE_MAX_MS) return false;
+    hooks.sleep(UPLOAD_PAUSE_STEP_MS);
+  }
+  return true;
+}
+
+int SegmentUploader::upload(const SegmentInfo& seg) {
+  char target[80];
+  snprintf(target, sizeof(target), "%s/%s/%u", url.path, node, (unsigned)seg.id);
+  if (!request("PUT", target, true)) {
+    fail(-1);
+    return UPLOAD_FAILED;
+  }
+  for (uint32_t offset = 0; offset < seg.size;) {
+    if (!waitWhileBusy()) {
+      conn.stop();   // the server drops the partial segment
+      return UPLOAD_PAUSED;
+    }
+    size_t want = seg.size - offset < sizeof(chunk) ? seg.size - offset : sizeof(chunk);
+    size_t n = storage.readSegment(seg.id, offset, chunk, want);
+    if (n == 0) {
+      conn.stop();   // rotated out under us
+      return UPLOAD_GONE;
+    }
+    if (!sendChunk(chunk, n)) {
+      conn.stop();
+      fail(-1);
+      return UPLOAD_FAILED;
+    }
+    offset += n;
+  }
+  if (!conn.write("0\r\n\r\n", 5)) {
+    conn.stop();
+    fail(-1);
+    return UPLOAD_FAILED;
+  }
+  int status = readStatus((char*)chunk, sizeof(chunk));
+  if (status < 200 || status > 299) {
+    fail(status);
+    return UPLOAD_FAILED;
+  }
+  counters.lastStatus = status;
+  return UPLOAD_OK;
+}
+
+// =================================================================
+// HOST STAND-IN
+// =================================================================
+#ifndef ARDUINO
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+class HostConn : public UploadConn {
+public:
+  HostConn() : fd(-1) {}
+  ~HostConn() { stop(); }
+
+  bool connect(const char* host, uint16_t port, uint32_t timeoutMs) override {
+    stop();
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res;
+    if (getaddrinfo(host, service, &hints, &res) != 0) return false;
+    fd = socket(res->ai_family, res->ai_socktype, 0);
+    timeval tv = {(time_t)(timeoutMs / 1000), (suseconds_t)(timeoutMs % 1000 * 1000)};
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    bool ok = fd >= 0 && ::connect(fd, res->ai_addr, res->ai_addrlen) == 0;
+    freeaddrinfo(res);
+    if (!ok) stop();
+    return ok;
+  }
+
+  bool write(const void* data, size_t len) override {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0) {
+      ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+      if (n <= 0) return false;
+      p += n;
+      len -= n;
+    }
+    return true;
+  }
+
+  size_t read(void* dst, size_t len, uint32_t timeoutMs) override {
+    pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeoutMs) <= 0) return 0;
+    ssize_t n = recv(fd, dst, len, 0);
+    return n > 0 ? n : 0;
+  }
+
+  void stop() override {
+    if (fd >= 0) close(fd);
+    fd = -1;
+  }
+
+private:
+  int fd;
+};
+
+UploadConn* newHostUploadConn() {
+  return new HostConn();
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef SEGMENT_UPLOAD_H
+#define SEGMENT_UPLOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "CaptureStorage.h"
+
+// Bulk upload of closed capture segments to a collection server
+// (tools/upload_server.py), one HTTP/1.1 request per segment:
+//
+//   GET <path>/<node>/last      200, body: newest segment id held, 0 if none
+//   PUT <path>/<node>/<id>      the segment, Transfer-Encoding: chunked;
+//                               2xx once it is stored in full
+//
+// Segments go out oldest first, read UPLOAD_CHUNK_BYTES at a time straight
+// from storage, so RAM use does not depend on segment size. Progress is
+// the server's: after a reboot or a failed transfer the uploader asks for
+// /last and carries on with the next id, so an interrupted segment is
+// simply sent again. Failures back off exponentially.
+
+#define UPLOAD_CHUNK_BYTES 1024
+#define UPLOAD_BACKOFF_MIN_MS 5000
+#define UPLOAD_BACKOFF_MAX_MS (10 * 60 * 1000UL)
+#define UPLOAD_TIMEOUT_MS 10000
+#define UPLOAD_PAUSE_MAX_MS 20000    // longest a burst may hold a transfer open
+#define UPLOAD_PAUSE_STEP_MS 100
+#define UPLOAD_MAX_SEGMENTS 64
+
+struct UploadUrl {
+  char host[40];
+  uint16_t port;
+  char path[40];   // without a trailing '/'
+};
+
+// "http://host[:port][/path]"; https is not supported
+bool parseUploadUrl(const char* url, UploadUrl& out);
+
+// One TCP connection (WiFiClient on the device, a socket on the host)
+class UploadConn {
+public:
+  virtual ~UploadConn() {}
+  virtual bool connect(const char* host, uint16_t port, uint32_t timeoutMs) = 0;
+  virtual bool write(const void* data, size_t len) = 0;   // all of it or false
+  // Up to len bytes, waiting at most timeoutMs for the first; 0 on close
+  virtual size_t read(void* dst, size_t len, uint32_t timeoutMs) = 0;
+  virtual void stop() = 0;
+};
+
+// Environment of the uploader task
+class UploadHooks {
+public:
+  virtual ~UploadHooks() {}
+  virtual uint32_t now() = 0;
+  virtual void sleep(uint32_t ms) = 0;
+  virtual bool online() = 0;
+  virtual bool busy() = 0;   // capture burst: hold off
+};
+
+struct UploadStats {
+  uint32_t segments;     // stored by the server
+  uint64_t bytes;
+  uint32_t failures;
+  uint32_t skipped;      // dropped by storage before they could be sent
+  uint32_t pauses;       // transfers held for a capture burst
+  int lastStatus;        // HTTP status, or -1 for a connection error
+};
+
+class Backoff {
+public:
+  Backoff() : delayMs(0), untilMs(0) {}
+  bool ready(uint32_t nowMs) const { return delayMs == 0 || (int32_t)(nowMs - untilMs) >= 0; }
+  uint32_t wait(uint32_t nowMs) const { return ready(nowMs) ? 0 : untilMs - nowMs; }
+  void failed(uint32_t nowMs);
+  void succeeded() { delayMs = 0; }
+  uint32_t delay() const { return delayMs; }
+
+private:
+  uint32_t delayMs;
+  uint32_t untilMs;
+};
+
+class SegmentUploader {
+public:
+  SegmentUploader(CaptureStorage& storage, UploadConn& conn, UploadHooks& hooks);
+
+  void setTarget(const UploadUrl& url, const char* node);
+  void clearTarget() { haveTarget = false; }
+
+  // Sends what is due; returns the milliseconds until it wants to run again
+  uint32_t run();
+
+  const UploadStats& stats() const { return counters; }
+  uint32_t cursor() const { return lastId; }      // newest id the server holds
+  bool synced() const { return haveCursor; }
+  uint32_t backoffMs() const { return backoff.delay(); }
+
+private:
+  bool queryCursor();
+  int upload(const SegmentInfo& seg);
+  bool sendChunk(const uint8_t* data, size_t len);
+  bool request(const char* method, const char* target, bool chunked);
+  int readStatus(char* body, size_t cap);
+  bool waitWhileBusy();
+  void fail(int status);
+
+  CaptureStorage& storage;
+  UploadConn& conn;
+  UploadHooks& hooks;
+  UploadUrl url;
+  char node[16];
+  bool haveTarget;
+  bool haveCursor;
+  uint32_t lastId;
+  Backoff backoff;
+  UploadStats counters;
+  uint8_t chunk[UPLOAD_CHUNK_BYTES];
+};
+
+#ifndef ARDUINO
+// Host stand-in: plain blocking sockets
+UploadConn* newHostUploadConn();
+#endif
+
+#endif
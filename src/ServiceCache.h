@@ -0,0 +1,135 @@
+#ifndef SERVICE_CACHE_H
+#define SERVICE_CACHE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <mutex>
+
+// Discovered _wscan._udp services, kept until their mDNS TTL runs out.
+// Filled by the background discovery task; lookups never block on the
+// network, so the export path only ever sees cached answers.
+
+#define SERVICE_CACHE_SIZE 8
+#define SERVICE_NAME_LEN 32
+
+enum ServiceRole {
+  ROLE_NODE,
+  ROLE_COLLECTOR
+};
+
+struct ServiceEntry {
+  char instance[SERVICE_NAME_LEN];   // empty = free slot
+  uint32_t ip;                        // network byte order, as in lwIP
+  uint16_t port;
+  uint8_t role;
+  uint32_t expiresMs;
+  uint32_t refreshMs;                 // re-query after half the TTL
+};
+
+class ServiceCache {
+public:
+  ServiceCache() { memset(entries, 0, sizeof(entries)); }
+
+  // A TTL of 0 is an mDNS goodbye and removes the entry
+  void update(const char* instance, uint32_t ip, uint16_t port, ServiceRole role,
+              uint32_t ttlSec, uint32_t nowMs) {
+    std::lock_guard<std::mutex> guard(lock);
+    ServiceEntry* slot = nullptr;
+    for (int i = 0; i < SERVICE_CACHE_SIZE && !slot; i++) {
+      ServiceEntry& e = entries[i];
+      if (e.instance[0] && strncmp(e.instance, instance, SERVICE_NAME_LEN - 1) == 0) slot = &e;
+    }
+    if (ttlSec == 0) {
+      if (slot) slot->instance[0] = 0;
+      return;
+    }
+    if (!slot) {
+      // A free or expired slot, else the one expiring soonest
+      slot = &entries[0];
+      for (int i = 0; i < SERVICE_CACHE_SIZE; i++) {
+        ServiceEntry& e = entries[i];
+        if (!e.instance[0] || expired(e, nowMs)) {
+          slot = &e;
+          break;
+        }
+        if ((int32_t)(e.expiresMs - slot->expiresMs) < 0) slot = &e;
+      }
+      strncpy(slot->instance, instance, SERVICE_NAME_LEN - 1);
+      slot->instance[SERVICE_NAME_LEN - 1] = 0;
+    }
+    slot->ip = ip;
+    slot->port = port;
+    slot->role = role;
+    slot->expiresMs = nowMs + ttlSec * 1000;
+    slot->refreshMs = nowMs + ttlSec * 500;
+  }
+
+  // First live entry of the role; slots keep their order, so the answer
+  // stays put while that service keeps being refreshed
+  bool find(ServiceRole role, uint32_t nowMs, ServiceEntry& out) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < SERVICE_CACHE_SIZE; i++) {
+      const ServiceEntry& e = entries[i];
+      if (e.instance[0] && e.role == role && !expired(e, nowMs)) {
+        out = e;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // True when no live entry of the role is younger than half its TTL
+  bool needsRefresh(ServiceRole role, uint32_t nowMs) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < SERVICE_CACHE_SIZE; i++) {
+      const ServiceEntry& e = entries[i];
+      if (e.instance[0] && e.role == role && (int32_t)(nowMs - e.refreshMs) < 0) return false;
+    }
+    return true;
+  }
+
+  // Copies out the live entries; returns how many
+  int snapshot(ServiceEntry* out, int max, uint32_t nowMs) {
+    std::lock_guard<std::mutex> guard(lock);
+    int n = 0;
+    for (int i = 0; i < SERVICE_CACHE_SIZE && n < max; i++) {
+      if (entries[i].instance[0] && !expired(entries[i], nowMs)) out[n++] = entries[i];
+    }
+    return n;
+  }
+
+private:
+  static bool expired(const ServiceEntry& e, uint32_t nowMs) {
+    return (int32_t)(nowMs - e.expiresMs) >= 0;
+  }
+
+  ServiceEntry entries[SERVICE_CACHE_SIZE];
+  std::mutex lock;
+};
+
+// TXT role=collector marks a collector; anything else is a node
+inline ServiceRole serviceRole(const char* roleTxt) {
+  return roleTxt && strcmp(roleTxt, "collector") == 0 ? ROLE_COLLECTOR : ROLE_NODE;
+}
+
+// When the discovery task browses: as soon as no collector is younger
+// than half its TTL, but at most every retryMs while none answers
+class DiscoverySchedule {
+public:
+  explicit DiscoverySchedule(uint32_t retryMs) : retryMs(retryMs), lastQuery(0), queried(false) {}
+
+  bool due(ServiceCache& cache, uint32_t nowMs) {
+    if (!cache.needsRefresh(ROLE_COLLECTOR, nowMs)) return false;
+    if (queried && nowMs - lastQuery < retryMs) return false;
+    lastQuery = nowMs;
+    queried = true;
+    return true;
+  }
+
+private:
+  uint32_t retryMs;
+  uint32_t lastQuery;
+  bool queried;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include "Sniffer.h"
+#include <esp_wifi.h>
+#include "CaptureStorage.h"
+#include "ExportRing.h"
+#include "ExportStream.h"
+#include "UsbDrive.h"
+#include "Recorder.h"
+#include "FrameDedup.h"
+#include "RfTracker.h"
+
+static ExportRing frameRing;   // WiFi driver callback -> sniffer task
+static TaskHandle_t snifferTaskHandle = NULL;
+static std::atomic<uint8_t> channel(1);
+static std::atomic<uint32_t> frames(0), bytes(0), queued(0), typeCounts[3];
+static std::atomic<uint16_t> snapMgmt(SNIFF_SNAPLEN_MGMT), snapData(SNIFF_SNAPLEN_DATA);
+static FrameDedup dedup;       // driver task only
+static RfTracker rfTracker;    // fed by the driver task, read by the sniffer task and UI
+static uint32_t rfExported[RF_CHANNELS];   // frames per channel at the last summary
+
+// Runs in the WiFi driver task: copy the head of the frame and get out.
+// The frame goes from the driver buffer straight into the ring, behind
+// the record header built here
+static void onPromiscuousRx(void* buf, wifi_promiscuous_pkt_type_t type) {
+  const wifi_promiscuous_pkt_t* pkt = (const wifi_promiscuous_pkt_t*)buf;
+  uint16_t origLen = pkt->rx_ctrl.sig_len > 4 ? pkt->rx_ctrl.sig_len - 4 : 0;  // minus FCS
+  uint16_t snap = type == WIFI_PKT_MGMT ? snapMgmt.load() : snapData.load();
+  uint16_t capLen = origLen < snap ? origLen : snap;
+  uint32_t now = millis();
+
+  frames++;
+  // The RF picture counts every frame on the air, retransmissions too
+  RfSample rx;
+  rx.channel = pkt->rx_ctrl.channel;
+  rx.rssi = pkt->rx_ctrl.rssi;
+  rx.noiseFloor = pkt->rx_ctrl.noise_floor;
+  rx.sigMode = pkt->rx_ctrl.sig_mode;
+  rx.rate = pkt->rx_ctrl.rate;
+  rx.mcs = pkt->rx_ctrl.mcs;
+  rx.cwb = pkt->rx_ctrl.cwb;
+  rx.reserved = 0;
+  rfTracker.add(rx, now);
+
+  // Retransmissions and copies heard again are not worth the ring space
+  if (dedup.check(pkt->payload, origLen, now) != DEDUP_NEW) return;
+  if (type <= WIFI_PKT_DATA) typeCounts[type]++;
+
+  FrameRecord rec;
+  rec.hdr.len = sizeof(FrameRecord) + capLen;
+  rec.hdr.type = CAPTURE_WIFI_FRAME;
+  rec.hdr.reserved = 0;
+  rec.hdr.timeMs = now;
+  rec.channel = pkt->rx_ctrl.channel;
+  rec.rssi = pkt->rx_ctrl.rssi;
+  rec.rate = pkt->rx_ctrl.rate;
+  rec.frameType = type;
+  rec.origLen = origLen;
+  rec.reserved = 0;
+  if (frameRing.push(&rec, sizeof(rec), pkt->payload, capLen)) {
+    bytes += rec.hdr.len;
+    queued++;
+  }
+}
+
+// Exports a summary of every channel heard since the last round
+static void exportRfSummaries(uint32_t nowMs) {
+  for (uint8_t ch = 1; ch <= RF_CHANNELS; ch++) {
+    RfSummary s;
+    if (!rfTracker.summary(ch, nowMs, s) || s.frames == rfExported[ch - 1]) continue;
+    rfExported[ch - 1] = s.frames;
+    RfSummaryRecord rec;
+    rec.hdr.len = sizeof(rec);
+    rec.hdr.type = CAPTURE_RF_SUMMARY;
+    rec.hdr.reserved = 0;
+    rec.hdr.timeMs = nowMs;
+    rec.channel = ch;
+    rec.noiseP50 = s.noiseP50;
+    rec.noiseP90 = s.noiseP90;
+    rec.rssiP10 = s.rssiP10;
+    rec.rssiP50 = s.rssiP50;
+    rec.rssiP90 = s.rssiP90;
+    memcpy(rec.mixPct, s.mixPct, sizeof(rec.mixPct));
+    rec.legacyRate = s.legacyRate;
+    rec.mcs = s.mcsP50;
+    rec.reserved = 0;
+    rec.frames = s.frames;
+    exportStreamRecord(&rec, sizeof(rec));
+  }
+}
+
+// Drains the frame queue, hops to the next channel every dwell period and
+// exports the RF summaries
+static void snifferTask(void* param) {
+  static uint8_t rec[sizeof(FrameRecord) + SNIFF_SNAPLEN_MAX];
+  uint32_t hopAt = millis() + SNIFF_DWELL_MS;
+  uint32_t rfExportAt = millis() + RF_EXPORT_MS;
+  for (;;) {
+    CaptureRecordHeader hdr;
+    while (frameRing.copyOut(&hdr, sizeof(hdr))) {
+      frameRing.copyOut(rec, hdr.len);
+      frameRing.consume(hdr.len);
+      exportStreamRecord(rec, hdr.len);
+      recorderAppend(rec, hdr.len);
+      if (!usbDriveActive()) captureStorage().append(rec, hdr.len);
+    }
+
+    if ((int32_t)(millis() - hopAt) >= 0) {
+      uint8_t next = channel.load() % SNIFF_CHANNELS + 1;
+      if (esp_wifi_set_channel(next, WIFI_SECOND_CHAN_NONE) == ESP_OK) channel.store(next);
+      hopAt += SNIFF_DWELL_MS;
+    }
+    if ((int32_t)(millis() - rfExportAt) >= 0) {
+      exportRfSummaries(millis());
+      rfExportAt += RF_EXPORT_MS;
+    }
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+}
+
+bool snifferBegin() {
+  if (snifferTaskHandle) return true;
+  wifi_promiscuous_filter_t filter = {WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA};
+  if (esp_wifi_set_promiscuous_filter(&filter) != ESP_OK ||
+      esp_wifi_set_promiscuous_rx_cb(onPromiscuousRx) != ESP_OK ||
+      esp_wifi_set_promiscuous(true) != ESP_OK) {
+    return false;
+  }
+  esp_wifi_set_channel(channel.load(), WIFI_SECOND_CHAN_NONE);
+  xTaskCreatePinnedToCore(snifferTask, "sniffer", 4096, NULL, 2, &snifferTaskHandle, 1);
+  return true;
+}
+
+void snifferSetSnaplen(uint16_t mgmt, uint16_t data) {
+  snapMgmt.store(mgmt < SNIFF_SNAPLEN_MAX ? mgmt : SNIFF_SNAPLEN_MAX);
+  snapData.store(data < SNIFF_SNAPLEN_MAX ? data : SNIFF_SNAPLEN_MAX);
+}
+
+bool snifferActive() {
+  return snifferTaskHandle != NULL;
+}
+
+uint8_t snifferChannel() {
+  return channel.load();
+}
+
+SnifferStats snifferStats() {
+  SnifferStats s;
+  s.frames = frames.load();
+  s.bytes = bytes.load();
+  s.dropped = frameRing.droppedRecords();
+  s.mgmt = typeCounts[WIFI_PKT_MGMT].load();
+  s.ctrl = typeCounts[WIFI_PKT_CTRL].load();
+  s.data = typeCounts[WIFI_PKT_DATA].load();
+  const DedupStats& d = dedup.stats();   // racy, fine for a status line
+  s.retries = d.retries;
+  s.duplicates = d.duplicates;
+  s.lateRetries = d.lateRetries;
+  return s;
+}
+
+bool snifferRfSummary(uint8_t channel, RfSummary& out) {
+  return rfTracker.summary(channel, millis(), out);
+}
+
+void printRfSummary(Print& out) {
+  out.println("ch   frames  noise p50/p90  rssi p10/p50/p90  11b 11g ht20 ht40 oth  rate  mcs  age(s)");
+  for (uint8_t ch = 1; ch <= RF_CHANNELS; ch++) {
+    RfSummary s;
+    if (!snifferRfSummary(ch, s)) continue;
+    out.printf("%2u %8u  %5d %5d     %4d %4d %4d     %3u %3u %4u %4u %3u %5.1f %4d %7u\n", ch, s.frames,
+               s.noiseP50, s.noiseP90, s.rssiP10, s.rssiP50, s.rssiP90, s.mixPct[RF_PHY_B],
+               s.mixPct[RF_PHY_G], s.mixPct[RF_PHY_HT20], s.mixPct[RF_PHY_HT40], s.mixPct[RF_PHY_OTHER],
+               s.legacyRate / 2.0f, s.mcsP50, s.ageMs / 1000);
+  }
+}
+
+void printSnifferStats(Print& out) {
+  SnifferStats s = snifferStats();
+  out.printf("sniffer: %s, channel %u\n", snifferActive() ? "on" : "off", snifferChannel());
+  out.printf("  %u frames (%u mgmt, %u data, %u ctrl), %u bytes queued, %u dropped\n",
+             s.frames, s.mgmt, s.data, s.ctrl, s.bytes, s.dropped);
+  // Ring depth follows the snaplen: entries are only as long as their capture
+  uint32_t n = queued.load();
+  uint32_t entryBytes = n ? s.bytes / n : 0;
+  out.printf("  snaplen %u mgmt, %u data; ring holds ~%u frames\n", snapMgmt.load(),
+             snapData.load(), entryBytes ? EXPORT_RING_BYTES / entryBytes : 0);
+  out.printf("  %u retries, %u duplicates skipped, %u retries without original\n",
+             s.retries, s.duplicates, s.lateRetries);
+}
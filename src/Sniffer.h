@@ -0,0 +1,53 @@
+#ifndef SNIFFER_H
+#define SNIFFER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "CaptureStorage.h"
+#include "RfTracker.h"
+
+// Full-time WiFi promiscuous capture for sensor nodes. The radio never
+// joins a network: it hops channels and every management/data frame is
+// truncated to the snaplen of its type and queued from the WiFi driver
+// callback. Ring entries are only as long as their capture, so a short
+// data snaplen (headers only) buys ring depth and frame rate.
+// Retransmissions and duplicates are dropped before the queue (see
+// FrameDedup.h); the type counts cover the frames that were kept. The
+// receive metadata of every frame heard, dropped ones included (noise
+// floor, RSSI, PHY mode and rate), goes to a per-channel RF tracker from
+// the callback, summarised on the export stream every RF_EXPORT_MS.
+// A sniffer task drains the queue into the capture storage and the
+// binary export stream (see ExportStream.h).
+
+#define SNIFF_SNAPLEN_MAX 1024   // a record still fits one export datagram
+#define SNIFF_SNAPLEN_MGMT SNIFF_SNAPLEN_MAX   // management frames whole
+#define SNIFF_SNAPLEN_DATA FRAME_MAC_HEADER_MAX   // every data MAC header whole
+#define SNIFF_DWELL_MS 250       // time per channel while hopping
+#define SNIFF_CHANNELS 13
+#define RF_EXPORT_MS 10000       // RF summaries of the channels heard meanwhile
+
+struct SnifferStats {
+  uint32_t frames;      // frames delivered by the driver
+  uint32_t bytes;       // captured bytes queued
+  uint32_t dropped;     // frames lost because the queue was full
+  uint32_t mgmt;
+  uint32_t data;
+  uint32_t ctrl;
+  uint32_t retries;     // skipped as retransmissions
+  uint32_t duplicates;  // skipped as copies heard again
+  uint32_t lateRetries; // retransmissions kept, the original was missed
+};
+
+// Puts the WiFi radio into promiscuous mode and starts hopping
+bool snifferBegin();
+// Captured bytes per management / data frame, up to SNIFF_SNAPLEN_MAX
+void snifferSetSnaplen(uint16_t mgmt, uint16_t data);
+bool snifferActive();
+uint8_t snifferChannel();
+SnifferStats snifferStats();
+void printSnifferStats(Print& out);
+// false if nothing was heard on the channel
+bool snifferRfSummary(uint8_t channel, RfSummary& out);
+void printRfSummary(Print& out);
+
+#endif
@@ -0,0 +1,124 @@
+#include "Uplink.h"
+
+#if SENSOR_NODE
+
+#include <ETH.h>
+#include "CaptureStorage.h"
+#include "WiFiEvents.h"
+
+UdpTransport udpTransport;
+static volatile bool ethUp = false;
+
+// =================================================================
+// UDP TRANSPORT
+// =================================================================
+
+UdpTransport::UdpTransport()
+  : fill(4), seq(0), targetAddr(0), port(COLLECTOR_PORT), localAddr(0), linkEvents(0),
+    applied(0), ready(false) {
+  IPAddress ip;
+  ip.fromString(COLLECTOR_HOST);
+  targetAddr.store((uint32_t)ip);
+}
+
+void UdpTransport::linkUp(const IPAddress& local) {
+  localAddr.store((uint32_t)local);
+  linkEvents++;
+}
+
+void UdpTransport::linkDown() {
+  localAddr.store(0);
+  linkEvents++;
+}
+
+void UdpTransport::setTarget(const IPAddress& ip, uint16_t port) {
+  targetAddr.store((uint32_t)ip);
+  this->port.store(port);
+}
+
+size_t UdpTransport::writable() {
+  // Rebind once per link change; a failed bind waits for the next one
+  uint32_t events = linkEvents.load();
+  if (events != applied) {
+    applied = events;
+    if (ready) udp.stop();
+    uint32_t local = localAddr.load();
+    fill = 4;
+    ready = local != 0 && udp.begin(IPAddress(local), NODE_PORT);
+  }
+  return ready ? UDP_EXPORT_PAYLOAD - fill : 0;
+}
+
+size_t UdpTransport::write(const uint8_t* data, size_t len) {
+  if (len > UDP_EXPORT_PAYLOAD - fill) len = UDP_EXPORT_PAYLOAD - fill;
+  memcpy(datagram + fill, data, len);
+  fill += len;
+
+  // Send the complete records, keep a trailing partial one
+  size_t whole = 4;
+  while (whole + sizeof(CaptureRecordHeader) <= fill) {
+    uint16_t recLen = datagram[whole] | datagram[whole + 1] << 8;
+    if (recLen < sizeof(CaptureRecordHeader)) {
+      fill = 4;   // corrupt stream: drop the datagram and resync
+      return len;
+    }
+    if (whole + recLen > fill) break;
+    whole += recLen;
+  }
+  if (whole == 4) return len;
+
+  memcpy(datagram, &seq, 4);
+  udp.beginPacket(target(), targetPort());
+  udp.write(datagram, whole);
+  udp.endPacket();
+  seq++;
+  memmove(datagram + 4, datagram + whole, fill - whole);
+  fill = 4 + fill - whole;
+  return len;
+}
+
+// =================================================================
+// ETHERNET
+// =================================================================
+
+static void onEthEvent(const WiFiEventMsg& e) {
+  switch (e.id) {
+    case ARDUINO_EVENT_ETH_GOT_IP:
+      ethUp = true;
+      udpTransport.linkUp(ETH.localIP());
+      exportStreamSelect("udp");
+      break;
+    case ARDUINO_EVENT_ETH_DISCONNECTED:
+    case ARDUINO_EVENT_ETH_STOP:
+      // The pump stalls and the export ring absorbs the gap
+      ethUp = false;
+      udpTransport.linkDown();
+      break;
+    default:
+      break;
+  }
+}
+
+void uplinkBegin() {
+  exportStreamAddTransport(&udpTransport);
+  wifiEvents.on(ARDUINO_EVENT_ETH_GOT_IP, onEthEvent);
+  wifiEvents.on(ARDUINO_EVENT_ETH_DISCONNECTED, onEthEvent);
+  wifiEvents.on(ARDUINO_EVENT_ETH_STOP, onEthEvent);
+  ETH.begin();   // PHY and pins from ETH_PHY_* build flags
+}
+
+bool uplinkReady() {
+  return ethUp;
+}
+
+void printUplinkStatus(Print& out) {
+  if (!ethUp) {
+    out.println("uplink: ethernet down");
+    return;
+  }
+  out.printf("uplink: %s %uMbps%s, collector %s:%u\n", ETH.localIP().toString().c_str(),
+             ETH.linkSpeed(), ETH.fullDuplex() ? " FD" : "",
+             udpTransport.target().toString().c_str(), udpTransport.targetPort());
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <WiFiUdp.h>
+#include "ExportStream.h"
+
+// Sensor-node profile (-D SENSOR_NODE=1, see platformio.ini): WiFi stays
+// in promiscuous mode full-time and all export goes over wired Ethernet
+// (RMII PHY, ETH_PHY_* pins from the build flags). The WiFi interface
+// never gets an address, and the export socket is bound to the Ethernet
+// address, so nothing is ever queued for WiFi TX.
+#ifndef SENSOR_NODE
+#define SENSOR_NODE 0
+#endif
+
+#ifndef COLLECTOR_HOST
+#define COLLECTOR_HOST "192.168.1.10"
+#endif
+#ifndef COLLECTOR_PORT
+#define COLLECTOR_PORT 5005
+#endif
+#define NODE_PORT 5006   // local port of the export socket
+
+// Datagram: uint32_t sequence number, then whole capture records
+#define UDP_EXPORT_PAYLOAD 1400
+
+// Export transport sending capture records to the collector as UDP
+// datagrams. Records never straddle datagrams: a record cut off at the
+// end of a ring span is held back until the rest arrives.
+class UdpTransport : public ExportTransport {
+public:
+  UdpTransport();
+  const char* name() const override { return "udp"; }
+  size_t writable() override;
+  size_t write(const uint8_t* data, size_t len) override;
+  size_t packetSize() const override { return 1; }
+
+  // Link state from the Ethernet event task. Only flagged here: the
+  // socket is opened and closed by the export task in writable(), so it
+  // never changes under a write in progress.
+  void linkUp(const IPAddress& local);
+  void linkDown();
+  // May be called from another task (discovery) while streaming
+  void setTarget(const IPAddress& ip, uint16_t port);
+  IPAddress target() const { return IPAddress(targetAddr.load()); }
+  uint16_t targetPort() const { return port.load(); }
+
+private:
+  WiFiUDP udp;
+  uint8_t datagram[UDP_EXPORT_PAYLOAD];
+  size_t fill;
+  uint32_t seq;
+  std::atomic<uint32_t> targetAddr;
+  std::atomic<uint16_t> port;
+  std::atomic<uint32_t> localAddr;   // 0 while the link is down
+  std::atomic<uint32_t> linkEvents;
+  uint32_t applied;                  // export task: linkEvents acted on
+  bool ready;                        // export task: socket bound
+};
+
+extern UdpTransport udpTransport;
+
+// Brings up Ethernet; once it has an address the UDP transport is bound
+// and streaming to the collector starts
+void uplinkBegin();
+bool uplinkReady();
+void printUplinkStatus(Print& out);
+
+#endif
@@ -0,0 +1,114 @@
+#include "Upload.h"
+#include <WiFi.h>
+#include <mutex>
+#include "Uplink.h"
+#include "UsbDrive.h"
+
+// WiFiClient works on whichever interface routes to the server
+class WiFiConn : public UploadConn {
+public:
+  bool connect(const char* host, uint16_t port, uint32_t timeoutMs) override {
+    return client.connect(host, port, timeoutMs);
+  }
+  bool write(const void* data, size_t len) override {
+    return client.write((const uint8_t*)data, len) == len;
+  }
+  size_t read(void* dst, size_t len, uint32_t timeoutMs) override {
+    uint32_t start = millis();
+    while (!client.available()) {
+      if (!client.connected() || millis() - start >= timeoutMs) return 0;
+      delay(10);
+    }
+    int n = client.read((uint8_t*)dst, len);
+    return n > 0 ? n : 0;
+  }
+  void stop() override { client.stop(); }
+
+private:
+  WiFiClient client;
+};
+
+class TaskHooks : public UploadHooks {
+public:
+  uint32_t now() override { return millis(); }
+  void sleep(uint32_t ms) override { vTaskDelay(pdMS_TO_TICKS(ms)); }
+  bool online() override {
+#if SENSOR_NODE
+    return uplinkReady();
+#else
+    return WiFi.status() == WL_CONNECTED;
+#endif
+  }
+  // Capture write rate over the last window; only this task asks
+  bool busy() override {
+    if (usbDriveActive()) return true;
+    uint32_t nowMs = millis();
+    if (nowMs - sampleMs >= UPLOAD_RATE_WINDOW_MS) {
+      uint64_t bytes = captureStorage().bytesWritten();
+      burst = (bytes - sampleBytes) * 1000 / (nowMs - sampleMs) > UPLOAD_BURST_BYTES_S;
+      sampleBytes = bytes;
+      sampleMs = nowMs;
+    }
+    return burst;
+  }
+
+private:
+  uint32_t sampleMs = 0;
+  uint64_t sampleBytes = 0;
+  bool burst = false;
+};
+
+static WiFiConn conn;
+static TaskHooks hooks;
+static SegmentUploader uploader(captureStorage(), conn, hooks);
+static TaskHandle_t uploadTaskHandle = NULL;
+
+// A new target waits here until the task is between transfers
+static std::mutex pendingLock;
+static UploadUrl pendingUrl;
+static bool pendingOn = false;
+static bool pendingSet = false;
+
+static void uploadTask(void* param) {
+  char node[13];
+  snprintf(node, sizeof(node), "%012llx", (unsigned long long)ESP.getEfuseMac());
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> guard(pendingLock);
+      if (pendingSet) {
+        if (pendingOn) uploader.setTarget(pendingUrl, node);
+        else uploader.clearTarget();
+        pendingSet = false;
+      }
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(uploader.run()));
+  }
+}
+
+void uploadBegin() {
+  xTaskCreatePinnedToCore(uploadTask, "upload", 4096, NULL, UPLOAD_TASK_PRIORITY,
+                          &uploadTaskHandle, 1);
+}
+
+bool uploadConfigure(const char* url) {
+  UploadUrl parsed;
+  bool ok = url[0] && parseUploadUrl(url, parsed);
+  {
+    std::lock_guard<std::mutex> guard(pendingLock);
+    pendingUrl = parsed;
+    pendingOn = ok;
+    pendingSet = true;
+  }
+  if (uploadTaskHandle) xTaskNotifyGive(uploadTaskHandle);
+  return ok || !url[0];
+}
+
+void printUploadStatus(Print& out) {
+  // Read while the task may be updating them; good enough for a status line
+  const UploadStats& s = uploader.stats();
+  out.printf("upload: %s, %s, server has #%u, backoff %us\n",
+             hooks.online() ? "online" : "offline", uploader.synced() ? "synced" : "not synced",
+             uploader.cursor(), uploader.backoffMs() / 1000);
+  out.printf("  %u segments, %llu bytes, %u failures (last %d), %u pauses, %u skipped\n",
+             s.segments, (unsigned long long)s.bytes, s.failures, s.lastStatus, s.pauses, s.skipped);
+}
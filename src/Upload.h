@@ -0,0 +1,21 @@
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+#include <Arduino.h>
+#include "SegmentUpload.h"
+
+// Background upload of closed capture segments (SegmentUpload.h) over the
+// WiFi backhaul, or Ethernet on sensor nodes. The task runs at the lowest
+// priority and steps aside while capture is writing faster than
+// UPLOAD_BURST_BYTES_S or the USB drive is attached.
+
+#define UPLOAD_TASK_PRIORITY 0
+#define UPLOAD_BURST_BYTES_S 16384
+#define UPLOAD_RATE_WINDOW_MS 500
+
+void uploadBegin();
+// "http://host[:port]/path", or "" to stop; false if the URL is unusable
+bool uploadConfigure(const char* url);
+void printUploadStatus(Print& out);
+
+#endif
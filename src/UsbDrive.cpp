@@ -0,0 +1,112 @@
+#include "UsbDrive.h"
+#include <Arduino.h>
+#include "CaptureStorage.h"
+#include "FatImage.h"
+
+#if CONFIG_TINYUSB_MSC_ENABLED
+
+#include "USB.h"
+#include "USBMSC.h"
+
+static USBMSC msc;
+static FatImage image;
+static volatile bool active = false;
+static bool mscStarted = false;   // msc.begin() without msc.end() yet
+static bool usbStarted = false;   // the USB device stays up once started
+static uint8_t partial[FAT_SECTOR_SIZE];
+
+// TinyUSB asks for whole endpoint buffers; only the first sector can start
+// at a non-zero offset. Full sectors are rendered straight into its buffer.
+static int32_t onMscRead(uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  uint8_t* out = (uint8_t*)buffer;
+  uint32_t done = 0;
+  while (done < bufsize) {
+    uint32_t n = FAT_SECTOR_SIZE - offset;
+    if (n > bufsize - done) n = bufsize - done;
+    if (n == FAT_SECTOR_SIZE) {
+      image.readSector(lba, out + done);
+    } else {
+      image.readSector(lba, partial);
+      memcpy(out + done, partial + offset, n);
+    }
+    done += n;
+    offset = 0;
+    lba++;
+  }
+  return done;
+}
+
+static int32_t onMscWrite(uint32_t, uint32_t, uint8_t*, uint32_t) {
+  return -1;  // read-only medium
+}
+
+static void removeMedium() {
+  msc.mediaPresent(false);
+  active = false;
+}
+
+// From TinyUSB's task, so only the medium goes; msc.end() waits for the
+// next usbDriveStart() or usbDriveStop()
+static bool onMscStartStop(uint8_t, bool start, bool loadEject) {
+  if (loadEject && !start) removeMedium();
+  return true;
+}
+
+bool usbDriveSupported() {
+  return true;
+}
+
+bool usbDriveStart() {
+  CaptureStorage& storage = captureStorage();
+  if (!storage.ready()) return false;
+
+  // Make the newest records visible before taking the snapshot
+  storage.rotate();
+  if (mscStarted) msc.end();   // ejected by the host last time
+  mscStarted = false;
+  active = true;
+  image.build(storage);
+
+  msc.vendorID("WSCAN");
+  msc.productID("Capture Logs");
+  msc.productRevision("1.0");
+  msc.onRead(onMscRead);
+  msc.onWrite(onMscWrite);
+  msc.onStartStop(onMscStartStop);
+  if (!msc.begin(image.sectorCount(), FAT_SECTOR_SIZE)) {
+    active = false;
+    return false;
+  }
+  mscStarted = true;
+  msc.mediaPresent(true);
+  if (!usbStarted) usbStarted = USB.begin();
+  return true;
+}
+
+void usbDriveStop() {
+  removeMedium();
+  if (mscStarted) msc.end();
+  mscStarted = false;
+}
+
+bool usbDriveActive() {
+  return active;
+}
+
+#else
+
+bool usbDriveSupported() {
+  return false;
+}
+
+bool usbDriveStart() {
+  return false;
+}
+
+void usbDriveStop() {}
+
+bool usbDriveActive() {
+  return false;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef USB_DRIVE_H
+#define USB_DRIVE_H
+
+// Read-only USB mass-storage mode: the closed capture segments show up as
+// files on a synthesized FAT volume (see FatImage.h). Needs a chip with a
+// native USB-OTG port (ESP32-S2/S3) and TinyUSB MSC enabled; elsewhere
+// usbDriveSupported() is false and usbDriveStart() fails.
+
+bool usbDriveSupported();
+
+// Closes the current segment, snapshots the segment list and presents the
+// drive to the host. Survey logging pauses while the drive is active so
+// no segment is dropped underneath the host.
+bool usbDriveStart();
+
+// Removes the medium (also happens when the host ejects the drive)
+void usbDriveStop();
+
+bool usbDriveActive();
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef VERSION_H
+#define VERSION_H
+
+// Reported over mDNS and checked by OTA; bump on every release
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "1.5.0"
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+#include "WiFiEvents.h"
+#include <chrono>
+
+WiFiEvents wifiEvents;
+
+bool WiFiEvents::on(int32_t id, WiFiEventHandler fn) {
+  if (id < 0 || id >= WIFI_EVENT_IDS) return false;
+  std::lock_guard<std::mutex> guard(lock);
+  for (int i = 0; i < WIFI_EVENT_HANDLERS; i++) {
+    if (!table[id][i]) {
+      table[id][i] = fn;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WiFiEvents::post(int32_t id, const WiFiEventInfo& info, uint32_t atUs) {
+  bool wasEmpty;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (head - tail == WIFI_EVENT_QUEUE) {
+      dropCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    WiFiEventMsg& m = queue[head % WIFI_EVENT_QUEUE];
+    m.id = id;
+    m.atUs = atUs;
+    m.info = info;
+    wasEmpty = head == tail;
+    head++;
+  }
+  // The dispatch task only waits on an empty queue
+  if (wasEmpty) ready.notify_one();
+  return true;
+}
+
+bool WiFiEvents::dispatchNext(uint32_t waitMs) {
+  WiFiEventMsg m;
+  WiFiEventHandler row[WIFI_EVENT_HANDLERS];
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    if (!ready.wait_for(guard, std::chrono::milliseconds(waitMs), [this] { return head != tail; })) {
+      return false;
+    }
+    m = queue[tail % WIFI_EVENT_QUEUE];
+    tail++;
+    if (m.id < 0 || m.id >= WIFI_EVENT_IDS) return true;
+    // Handlers may register more handlers: none is called under the lock
+    for (int i = 0; i < WIFI_EVENT_HANDLERS; i++) row[i] = table[m.id][i];
+  }
+  for (int i = 0; i < WIFI_EVENT_HANDLERS && row[i]; i++) row[i](m);
+  return true;
+}
+
+#ifdef ARDUINO
+#include "Latency.h"
+
+static void onCoreEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  wifiEvents.post(event, info, ingestTimestamp());
+}
+
+static void wifiEventTask(void* param) {
+  for (;;) wifiEvents.dispatchNext(1000);
+}
+
+void wifiEventsBegin() {
+  WiFi.onEvent(onCoreEvent);
+  xTaskCreatePinnedToCore(wifiEventTask, "wifievt", 3072, NULL, 2, NULL, 1);
+}
+#endif
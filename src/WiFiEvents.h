@@ -0,0 +1,70 @@
+#ifndef WIFI_EVENTS_H
+#define WIFI_EVENTS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// WiFi and Ethernet events for our own handlers. The core's WiFi.onEvent()
+// mallocs every event and copies each std::function entry of its list on
+// every dispatch; here one callback is registered with it, which copies
+// the event by value into a fixed queue, and the dispatch task calls the
+// handlers from a table indexed by event ID. Nothing is allocated once
+// the handlers are in.
+//
+// Handlers run on the dispatch task, not the core's event task: atUs is
+// when the event reached us, for ingest timestamps.
+
+#define WIFI_EVENT_IDS 48        // above ARDUINO_EVENT_MAX in core 2.0.14
+#define WIFI_EVENT_HANDLERS 4    // per event ID
+#define WIFI_EVENT_QUEUE 16
+
+#ifdef ARDUINO
+#include <WiFi.h>
+typedef arduino_event_info_t WiFiEventInfo;
+#else
+// Host stand-in, the size of the core's union
+struct WiFiEventInfo {
+  uint8_t bytes[128];
+};
+#endif
+
+struct WiFiEventMsg {
+  int32_t id;
+  uint32_t atUs;
+  WiFiEventInfo info;
+};
+
+typedef void (*WiFiEventHandler)(const WiFiEventMsg& e);
+
+class WiFiEvents {
+public:
+  // False when the ID is out of range or all its slots are taken
+  bool on(int32_t id, WiFiEventHandler fn);
+  // From the event source; never blocks, a full queue drops the event
+  bool post(int32_t id, const WiFiEventInfo& info, uint32_t atUs);
+  // Waits up to waitMs for one event and runs its handlers
+  bool dispatchNext(uint32_t waitMs);
+
+  uint32_t dropped() const { return dropCount.load(std::memory_order_relaxed); }
+
+private:
+  std::mutex lock;
+  std::condition_variable ready;
+  WiFiEventHandler table[WIFI_EVENT_IDS][WIFI_EVENT_HANDLERS] = {};
+  WiFiEventMsg queue[WIFI_EVENT_QUEUE];
+  uint32_t head = 0;
+  uint32_t tail = 0;
+  std::atomic<uint32_t> dropCount{0};
+};
+
+extern WiFiEvents wifiEvents;
+
+#ifdef ARDUINO
+// Registers with WiFi.onEvent() and starts the dispatch task
+void wifiEventsBegin();
+#endif
+
+#endif
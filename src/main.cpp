@@ -3,8 +3,36 @@
 #include <LiquidCrystal_I2C.h>
 #include <BLEDevice.h>
 #include <BLEUtils.h>
-#include <BLEScan.h>
+#include <soc/soc_caps.h>
+#if SOC_BT_CLASSIC_SUPPORTED
+#include <BluetoothSerial.h>   // BR/EDR inquiry; the S2/S3 only have BLE
+#endif
 #include <string>
+#include <mutex>
+#include "Devices.h"
+#include "DeviceHistory.h"
+#include "CaptureStorage.h"
+#include "Export.h"
+#include "ExportStream.h"
+#include "Latency.h"
+#include "RadioScheduler.h"
+#include "ActiveScanPolicy.h"
+#include "BleScanner.h"
+#include "FollowTracker.h"
+#include "RadioStats.h"
+#include "UsbDrive.h"
+#include "Sniffer.h"
+#include "Uplink.h"
+#include "Discovery.h"
+#include "OtaDelta.h"
+#include "ScanCodec.h"
+#include "Rules.h"
+#include "ConfigStore.h"
+#include "Portal.h"
+#include "Upload.h"
+#include "Harvest.h"
+#include "Recorder.h"
+#include "WiFiEvents.h"
 
 // LCD Configuration (I2C)
 #define LCD_ADDRESS 0x27
@@ -12,15 +40,27 @@
 #define LCD_ROWS 2
 LiquidCrystal_I2C lcd(LCD_ADDRESS, LCD_COLS, LCD_ROWS);
 
-// Button Pins
+// Button Pins (Ethernet boards move them off the RMII pins)
+#ifndef BTN_UP
 #define BTN_UP 32
 #define BTN_DOWN 33
 #define BTN_SELECT 25
 #define BTN_BACK 26
+#endif
 
-// Device Limits
-#define MAX_WIFI_DEVICES 25
-#define MAX_BLE_DEVICES 25
+#define MAX_BTC_INGEST 32
+#define INQUIRY_WINDOW_MS 3840   // 3 inquiry units of 1.28 s
+#define ALERT_HOLD_MS 3000        // rule alert stays on the LCD this long
+#define BLINK_MS 2000             // backlight blink after a rule fires
+#define BLINK_PERIOD_MS 250
+#define PORTAL_SCAN_INTERVAL_MS 30000   // reduced scanning while the portal serves
+#define PORTAL_SCAN_DWELL_MS 80         // per channel, short enough to keep AP clients
+#define PORTAL_BLE_SCAN_S 1
+#define FOLLOW_WIFI_DWELL_MS 60   // single-channel probe, ~95 ms with scan start/stop
+#define FOLLOW_DRAW_MS 100        // LCD refresh cap in follow mode
+#define LCD_CHAR_UP 5             // custom characters; 1-4 are partial bar cells
+#define LCD_CHAR_DOWN 6
+#define NTP_SERVER "pool.ntp.org"
 
 // --- Enums for State Management ---
 enum MenuState {
@@ -28,55 +68,141 @@ enum MenuState {
   WIFI_SCAN_LIST,
   BLE_SCAN_LIST,
   WIFI_DETAILS,
-  BLE_DETAILS
+  BLE_DETAILS,
+  BTC_SCAN_LIST,
+  BTC_DETAILS,
+  DIAGNOSTICS,
+  PORTAL_INFO,
+  FOLLOW
 };
 
-// --- Structures for Device Information ---
-struct WiFiDeviceInfo {
-  String ssid;
-  String mac;
-  int channel;
-  int rssi;
-  wifi_auth_mode_t security;
+// Main menu entries, in display order
+enum MainMenuItem {
+  MENU_WIFI,
+  MENU_BLE,
+  MENU_BT_CLASSIC,
+  MENU_DIAGNOSTICS,
+  MENU_PORTAL,
+  MENU_ITEM_COUNT
 };
+const char* const MENU_LABELS[MENU_ITEM_COUNT] = {"WiFi Scanner", "BLE Scanner", "BT Classic",
+                                                  "Diagnostics", "Setup Portal"};
 
-struct BLEDeviceInfo {
-  String name;
-  String address;
+// Inquiry results collected by the BR/EDR discovery callback; names are
+// looked up afterwards, in the scanner task
+struct BTCInquiryResult {
+  uint8_t address[6];
+  uint32_t cod;
   int rssi;
-  int txPower;
-  std::string serviceUUID = "";
+  uint32_t us;
 };
 
 // --- Global Variables ---
-WiFiDeviceInfo wifiDevices[MAX_WIFI_DEVICES];
-BLEDeviceInfo bleDevices[MAX_BLE_DEVICES];
-int wifiDeviceCount = 0;
-int bleDeviceCount = 0;
-
-MenuState currentState = MAIN_MENU;
+volatile MenuState currentState = MAIN_MENU;
 int listIndex = 0;       // For scrolling through device lists
 int detailPage = 0;      // For scrolling through detail pages
-unsigned long lastScanTime = 0;
-const unsigned long SCAN_INTERVAL = 10000; // 10 seconds
+volatile unsigned long scanIntervalMs = 10000; // from the config
+
+// Background scanning
+TaskHandle_t scannerTaskHandle = NULL;
+RadioScheduler btScheduler;   // BLE scan vs. BR/EDR inquiry interleaving
+ActiveScanPolicy blePolicy;   // active BLE windows only for unnamed devices
+FollowTracker followTracker;
+RateMeter followDrawRate;
+// Device followed from a details page; set by the UI before entering FOLLOW
+struct {
+  bool ble;
+  uint8_t id[6];
+  int channel;
+  char name[17];
+} followTarget;
+#if SOC_BT_CLASSIC_SUPPORTED
+BluetoothSerial SerialBT;
+#endif
+RadioSource shownSource = SRC_COUNT;   // table version whose entries are being drawn
+uint32_t shownVersion = 0;
+uint32_t shownMask = 0;                // entries of that version already drawn once
 
 // Button Debounce
 unsigned long lastDebounceTime = 0;
 const unsigned long DEBOUNCE_DELAY = 200;
 
+// Latency ingest points (written from the WiFi event / BT tasks)
+volatile uint32_t wifiScanDoneUs = 0;
+BTCInquiryResult btcInquiry[MAX_BTC_INGEST];
+volatile int btcInquiryCount = 0;
+
+// Rules run in the scanner task; alerts are drawn by the UI loop
+const char* const DEFAULT_RULES[] = {
+  "close: any new and rssi > -50 -> alert,blink",
+  "open6: wifi new and open and channel == 6 -> alert,export",
+  "burst: ble new count > 20 in 60s -> alert,export every 60s",
+};
+RuleEngine ruleEngine;
+std::mutex rulesLock;       // serial commands vs. evaluation
+std::mutex alertLock;
+struct {
+  char rule[RULES_NAME_MAX];
+  uint8_t id[6];
+  int rssi;
+  bool pending;
+} ruleAlert;
+volatile uint32_t blinkUntil = 0;
+
 // --- Function Prototypes ---
 void updateDisplay();
 void handleButtons();
+void handleSerial();
 bool isButtonPressed(int pin);
-void refreshScan();
+void requestScan();
+void scannerTask(void* param);
+void checkForNewResults();
+void noteDisplayed(RadioSource source, uint32_t version, int index, uint32_t ingestUs);
 void scanWiFi();
 void scanBLE();
+bool applyScanPlan(const ScanPlan& plan);
+void whitelistAdd(const uint8_t id[6], uint8_t addrType);
+bool selectFollowTarget();
+void followWiFi();
+void followBLE();
+void refreshFollow();
+int scanBTClassic();
+#if SOC_BT_CLASSIC_SUPPORTED
+void onInquiryResult(BTAdvertisedDevice* device);
+#endif
+void logSurvey(CaptureRecordType type, const uint8_t id[6], int rssi, int extra);
+void checkRules(RadioSource source, const uint8_t id[6], int rssi, int channel, int extra,
+                int security, bool fresh);
+void onRuleFired(void* ctx, const Rule& rule, const RuleReport& report);
+template <typename Table> bool neverSeen(const Table& prev, const uint8_t id[6]);
+template <typename Table> int snapshotCount(EpochSnapshot<Table>& snapshot);
+template <typename Table> bool snapshotVersion(EpochSnapshot<Table>& snapshot, uint32_t& version);
+bool updateAlerts();
+void printRules();
+void loadConfig();
+void applyConfig(const Config& config);
+size_t portalStatus(char* out, size_t cap);
+void benchmarkStorage();
+void benchmarkStream(unsigned long seconds);
+void benchmarkCodec();
 String getWifiSecurityString(wifi_auth_mode_t security);
 void drawMainMenu();
 void drawWifiList();
 void drawBleList();
 void drawWifiDetails();
 void drawBleDetails();
+void drawBtcList();
+void drawBtcDetails();
+void drawDiagnostics();
+void drawRf(uint8_t channel);
+void drawPortal();
+void drawFollow();
+void drawHistory(const uint8_t id[6]);
+
+// Every advertisement that passes the whitelist while follow mode scans
+void onFollowReport(const uint8_t bda[6], int rssi) {
+  if (memcmp(bda, followTarget.id, 6) == 0) followTracker.sample(rssi, millis());
+}
 
 // =================================================================
 // SETUP
@@ -85,8 +211,21 @@ void setup() {
   Serial.begin(115200);
 
   // Initialize LCD
+#ifdef LCD_SDA
+  Wire.begin(LCD_SDA, LCD_SCL);  // non-default I2C pins; lcd.init() keeps them
+#endif
   lcd.init();
   lcd.backlight();
+  // Follow mode: bar cells 1-4 columns full, trend arrows
+  for (uint8_t c = 1; c <= 4; c++) {
+    uint8_t rows[8];
+    memset(rows, (0x1F << (5 - c)) & 0x1F, sizeof(rows));
+    lcd.createChar(c, rows);
+  }
+  uint8_t up[8] = {0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00};
+  uint8_t down[8] = {0x04, 0x04, 0x04, 0x04, 0x15, 0x0E, 0x04, 0x00};
+  lcd.createChar(LCD_CHAR_UP, up);
+  lcd.createChar(LCD_CHAR_DOWN, down);
   lcd.clear();
   lcd.print("Scanner Starting");
   delay(1000);
@@ -100,13 +239,45 @@ void setup() {
   // Initialize WiFi
   WiFi.mode(WIFI_STA);
   WiFi.disconnect();
-  
+  // Wall clock for the device history, whenever a network (the upload
+  // WiFi or the Ethernet uplink) reaches an NTP server
+  configTime(0, 0, NTP_SERVER);
+  wifiEvents.on(ARDUINO_EVENT_WIFI_SCAN_DONE, [](const WiFiEventMsg& e) {
+    wifiScanDoneUs = e.atUs;
+  });
+  wifiEventsBegin();
+
   // Initialize BLE
   BLEDevice::init("ESP32-Scanner");
-  BLEScan* pBLEScan = BLEDevice::getScan();
-  pBLEScan->setActiveScan(true);
-  pBLEScan->setInterval(100);
-  pBLEScan->setWindow(99);
+  bleScannerBegin();   // each window's mode comes from blePolicy
+
+#if SOC_BT_CLASSIC_SUPPORTED
+  // Classic BT shares the controller (dual mode); master role for inquiry
+  SerialBT.begin("ESP32-Scanner", true);
+#endif
+
+  // Long-term history lives in its own flash partition, if the layout has one
+  deviceHistory.begin();
+  if (!captureStorage().begin()) {
+    Serial.printf("capture storage '%s' unavailable\n", captureStorage().name());
+  }
+  recorderBegin();
+
+  ruleEngine.setHandler(onRuleFired, NULL);
+
+  // Scans run on core 0 next to the radio stacks; the UI only reads snapshots
+  xTaskCreatePinnedToCore(scannerTask, "scanner", 8192, NULL, 1, &scannerTaskHandle, 0);
+  exportStreamBegin();
+
+#if SENSOR_NODE
+  // The WiFi radio only listens; export goes out over Ethernet
+  if (!snifferBegin()) Serial.println("promiscuous mode failed");
+  uplinkBegin();
+  discoveryBegin();
+#endif
+  loadConfig();
+  uploadBegin();
+  harvestBegin();
 
   updateDisplay();
 }
@@ -116,13 +287,14 @@ void setup() {
 // =================================================================
 void loop() {
   handleButtons();
-
-  // Auto-refresh scan lists
-  if ((currentState == WIFI_SCAN_LIST || currentState == BLE_SCAN_LIST) && 
-      (millis() - lastScanTime > SCAN_INTERVAL)) {
-    refreshScan();
+  handleSerial();
+  // A rule alert holds the screen until it times out
+  if (!updateAlerts()) {
+    checkForNewResults();
+    refreshFollow();
   }
-  
+  configStore.tick(millis());
+
   delay(50); // Small delay to prevent hammering the CPU
 }
 
@@ -130,26 +302,109 @@ void loop() {
 // CORE LOGIC
 // =================================================================
 
-void refreshScan() {
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print("Scanning...");
-  
+// Wakes the scanner task for an immediate scan of the current list
+void requestScan() {
+  xTaskNotifyGive(scannerTaskHandle);
+}
+
+// Auto-refreshes the visible scan list every scanIntervalMs, or sooner when
+// requested. Results are published as new snapshot versions. While the
+// portal is up, scans are spaced out and shortened (see scanWiFi/scanBLE)
+// and the portal screen gets a background survey of both radios. Follow
+// mode keeps the task on the one device until the UI leaves it.
+void scannerTask(void* param) {
+  for (;;) {
+    unsigned long interval = scanIntervalMs;
+    if (portalActive() && interval < PORTAL_SCAN_INTERVAL_MS) interval = PORTAL_SCAN_INTERVAL_MS;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(interval));
+    MenuState state = currentState;
+    if (state == PORTAL_INFO) {
+      if (!SENSOR_NODE) scanWiFi();
+      scanBLE();
+    } else if (state == WIFI_SCAN_LIST) {
+      // On a sensor node the WiFi radio belongs to the sniffer
+      if (!SENSOR_NODE) scanWiFi();
+    } else if (state == BLE_SCAN_LIST || state == BTC_SCAN_LIST) {
+      // Interleave BLE and inquiry windows until the list on screen is fresh
+      RadioSlot focus = (state == BLE_SCAN_LIST) ? SLOT_BLE : SLOT_INQUIRY;
+      RadioSlot slot;
+      do {
+        slot = btScheduler.next(focus);
+        if (slot == SLOT_BLE) {
+          scanBLE();
+        } else {
+          btScheduler.inquiryDone(scanBTClassic());
+        }
+      } while (slot != focus && currentState == state);
+    } else if (state == FOLLOW) {
+      if (followTarget.ble) followBLE();
+      else if (!SENSOR_NODE) followWiFi();
+    }
+  }
+}
+
+// Redraws the list when the scanner published a newer version. Versions
+// are compared by their publish counter: with 3 slots in the pool a new
+// version often reuses the address of one drawn before.
+void checkForNewResults() {
+  static MenuState drawnState = MAIN_MENU;
+  static uint32_t drawnVersion = 0;
+  uint32_t latest;
+  bool ok;
   if (currentState == WIFI_SCAN_LIST) {
-    scanWiFi();
+    ok = snapshotVersion(wifiSnapshot, latest);
   } else if (currentState == BLE_SCAN_LIST) {
-    scanBLE();
+    ok = snapshotVersion(bleSnapshot, latest);
+  } else if (currentState == BTC_SCAN_LIST) {
+    ok = snapshotVersion(btcSnapshot, latest);
+  } else {
+    drawnState = MAIN_MENU;
+    return;
+  }
+  if (ok && (currentState != drawnState || latest != drawnVersion)) {
+    drawnState = currentState;
+    drawnVersion = latest;
+    listIndex = 0; // Reset index after scan
+    updateDisplay();
+  }
+}
+
+// Redraws the follow screen on a new sample or loss of signal, at most
+// every FOLLOW_DRAW_MS
+void refreshFollow() {
+  static uint32_t drawnVersion = 0;
+  static bool drawnStale = false;
+  static unsigned long drawnMs = 0;
+  if (currentState != FOLLOW || millis() - drawnMs < FOLLOW_DRAW_MS) return;
+  FollowView v = followTracker.view(millis());
+  if (v.version == drawnVersion && v.stale == drawnStale) return;
+  drawnVersion = v.version;
+  drawnStale = v.stale;
+  drawnMs = millis();
+  drawFollow();
+}
+
+// Records display latency the first time an entry of a version is drawn
+void noteDisplayed(RadioSource source, uint32_t version, int index, uint32_t ingestUs) {
+  if (source != shownSource || version != shownVersion) {
+    shownSource = source;
+    shownVersion = version;
+    shownMask = 0;
+  }
+  if (index < 32 && !(shownMask & (1UL << index))) {
+    shownMask |= 1UL << index;
+    recordLatency(LAT_DISPLAY, ingestUs);
   }
-  
-  listIndex = 0; // Reset index after scan
-  lastScanTime = millis();
-  updateDisplay();
 }
 
 void handleButtons() {
+  bool paged = (currentState == WIFI_DETAILS || currentState == BLE_DETAILS ||
+                currentState == BTC_DETAILS || currentState == DIAGNOSTICS ||
+                currentState == PORTAL_INFO || currentState == FOLLOW);   // follow has one page
+
   // --- UP Button ---
   if (isButtonPressed(BTN_UP)) {
-    if (currentState == WIFI_DETAILS || currentState == BLE_DETAILS) {
+    if (paged) {
       detailPage--; // Navigate up through detail pages
     } else {
       listIndex--; // Navigate up through device list
@@ -159,7 +414,7 @@ void handleButtons() {
 
   // --- DOWN Button ---
   if (isButtonPressed(BTN_DOWN)) {
-    if (currentState == WIFI_DETAILS || currentState == BLE_DETAILS) {
+    if (paged) {
       detailPage++; // Navigate down through detail pages
     } else {
       listIndex++; // Navigate down through device list
@@ -171,12 +426,28 @@ void handleButtons() {
   if (isButtonPressed(BTN_SELECT)) {
     detailPage = 0; // Reset detail page on select
     if (currentState == MAIN_MENU) {
-      currentState = (listIndex == 0) ? WIFI_SCAN_LIST : BLE_SCAN_LIST;
-      refreshScan(); // Initial scan
-    } else if (currentState == WIFI_SCAN_LIST && wifiDeviceCount > 0) {
+      if (listIndex == MENU_DIAGNOSTICS) {
+        currentState = DIAGNOSTICS;
+      } else if (listIndex == MENU_PORTAL) {
+        if (portalStart(applyConfig, portalStatus)) {
+          currentState = PORTAL_INFO;
+          requestScan();
+        }
+      } else {
+        if (listIndex == MENU_WIFI) currentState = WIFI_SCAN_LIST;
+        else if (listIndex == MENU_BLE) currentState = BLE_SCAN_LIST;
+        else currentState = BTC_SCAN_LIST;
+        requestScan(); // Initial scan
+      }
+    } else if (currentState == WIFI_SCAN_LIST && snapshotCount(wifiSnapshot) > 0) {
       currentState = WIFI_DETAILS;
-    } else if (currentState == BLE_SCAN_LIST && bleDeviceCount > 0) {
+    } else if (currentState == BLE_SCAN_LIST && snapshotCount(bleSnapshot) > 0) {
       currentState = BLE_DETAILS;
+    } else if (currentState == BTC_SCAN_LIST && snapshotCount(btcSnapshot) > 0) {
+      currentState = BTC_DETAILS;
+    } else if ((currentState == WIFI_DETAILS || currentState == BLE_DETAILS) && selectFollowTarget()) {
+      currentState = FOLLOW;
+      requestScan();
     }
     updateDisplay();
   }
@@ -188,10 +459,21 @@ void handleButtons() {
       currentState = WIFI_SCAN_LIST;
     } else if (currentState == BLE_DETAILS) {
       currentState = BLE_SCAN_LIST;
+    } else if (currentState == BTC_DETAILS) {
+      currentState = BTC_SCAN_LIST;
+    } else if (currentState == FOLLOW) {
+      currentState = followTarget.ble ? BLE_DETAILS : WIFI_DETAILS;
+    } else if (currentState == PORTAL_INFO) {
+      portalStop();
+      currentState = MAIN_MENU;
+    } else if (currentState == MAIN_MENU) {
+      // Marks an event for the flight recorder; the backlight blinks if taken
+      if (recorderTrigger(FLIGHT_BUTTON, "button")) blinkUntil = millis() + BLINK_MS;
     } else {
       currentState = MAIN_MENU;
     }
-    listIndex = 0;
+    // Back from follow mode lands on the same device
+    if (currentState != WIFI_DETAILS && currentState != BLE_DETAILS) listIndex = 0;
     updateDisplay();
   }
 }
@@ -206,58 +488,809 @@ bool isButtonPressed(int pin) {
   return false;
 }
 
+// Serial commands:
+//   lat / lat reset         latency report / clear histograms
+//   sync wifi|ble|btc <cursor> device changes since <epoch>:<seq> (see Export.h)
+//   radio                   per-source throughput counters, BLE policy and parse cache
+//   hist / hist compact     device history stats / force a compaction
+//   segs / bench storage    list the newest capture segments / write throughput test
+//   usb / usb off           present closed segments as a USB drive (S2/S3)
+//   stream serial|usb|off   binary stream of capture records / stream stats
+//   stream codec on|off     pack streamed records (ScanCodec.h)
+//   bench stream [s]        end-to-end throughput of the selected transport
+//   bench codec             codec ratio and speed on the closed segments
+//   sniff / uplink / mdns   promiscuous capture / Ethernet uplink / discovery
+//   sniff snap <m> <d>      captured bytes per management / data frame
+//   rf                      noise floor, RSSI and PHY mix per sniffed channel
+//   rules / rule <text>     list rules / add one (syntax in Rules.h)
+//   rule del <n> / clear    remove one rule / all of them
+//   ota <url>               apply a delta patch (tools/mkdelta.py) and reboot
+//   portal / portal off     config portal (Portal.h) / stop it
+//   config                  settings as loaded and saved (ConfigStore.h)
+//   upload [<url>|off]      upload status / set the server (SegmentUpload.h)
+//   dis                     Device Information harvest (DisHarvest.h)
+//   follow                  follow mode sample and redraw rates
+//   rec / rec mark          flight recorder status / dump the last seconds
+void handleSerial() {
+  static char buf[128];
+  static int len = 0;
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (len < (int)sizeof(buf) - 1) buf[len++] = c;
+      continue;
+    }
+    if (len == 0) continue;
+    buf[len] = 0;
+    len = 0;
+
+    if (strcmp(buf, "lat") == 0) {
+      printLatencyReport(Serial);
+    } else if (strcmp(buf, "lat reset") == 0) {
+      resetLatencyHistograms();
+      Serial.println("latency histograms cleared");
+    } else if (strncmp(buf, "sync wifi", 9) == 0) {
+      exportWifiChanges(Serial, parseExportCursor(buf + 9));
+    } else if (strncmp(buf, "sync ble", 8) == 0) {
+      exportBleChanges(Serial, parseExportCursor(buf + 8));
+    } else if (strncmp(buf, "sync btc", 8) == 0) {
+      exportBtClassicChanges(Serial, parseExportCursor(buf + 8));
+    } else if (strcmp(buf, "radio") == 0) {
+      printRadioCounters(Serial);
+      Serial.printf("inquiry backoff: 1/%d\n", btScheduler.inquiryBackoff());
+      const ActiveScanStats& a = blePolicy.stats();
+      Serial.printf("ble active: %u/%u windows (%u targeted), %u resolved, %u gave up\n",
+                    a.activeWindows, a.windows, a.targetedWindows, a.resolved, a.gaveUp);
+      AdvCacheStats c = bleParseCacheStats();
+      Serial.printf("ble parse cache: %u hits, %u parsed, %u evicted\n", c.hits, c.misses, c.evictions);
+    } else if (strcmp(buf, "hist") == 0) {
+      HistoryStats s = deviceHistory.stats();
+      Serial.printf("history: %u/%u devices, log %u/%u, gen %u, %u compactions, %u dropped, %u skipped\n",
+                    s.baseCount, s.capacity, s.logCount, s.logCapacity, s.generation,
+                    s.compactions, s.dropped, s.skipped);
+    } else if (strcmp(buf, "hist compact") == 0) {
+      deviceHistory.compact();
+    } else if (strcmp(buf, "segs") == 0) {
+      SegmentInfo segs[32];
+      uint32_t total;
+      int n = captureStorage().listNewestSegments(segs, 32, &total);
+      Serial.printf("%s: %u closed segments, writing #%u\n", captureStorage().name(), total,
+                    captureStorage().currentSegment());
+      for (int i = 0; i < n; i++) Serial.printf("  #%u %u bytes\n", segs[i].id, segs[i].size);
+    } else if (strcmp(buf, "bench storage") == 0) {
+      if (usbDriveActive()) Serial.println("USB drive active, run 'usb off' first");
+      else benchmarkStorage();
+    } else if (strcmp(buf, "usb") == 0) {
+      if (!usbDriveSupported()) {
+        Serial.println("USB mass storage needs an S2/S3 with TinyUSB MSC");
+      } else if (usbDriveStart()) {
+        Serial.println("USB drive attached, survey logging paused");
+      } else {
+        Serial.println("USB drive failed: no capture storage");
+      }
+    } else if (strcmp(buf, "stream") == 0) {
+      printExportStreamStats(Serial);
+    } else if (strcmp(buf, "stream codec on") == 0 || strcmp(buf, "stream codec off") == 0) {
+      exportStreamSetCodec(buf[14] == 'n');
+    } else if (strncmp(buf, "stream ", 7) == 0) {
+      if (!exportStreamSelect(buf + 7)) Serial.printf("no transport '%s'\n", buf + 7);
+    } else if (strcmp(buf, "bench codec") == 0) {
+      benchmarkCodec();
+    } else if (strncmp(buf, "bench stream", 12) == 0) {
+      unsigned long secs = strtoul(buf + 12, NULL, 10);
+      benchmarkStream(secs ? secs : 10);
+    } else if (strcmp(buf, "sniff") == 0) {
+      printSnifferStats(Serial);
+    } else if (strncmp(buf, "sniff snap ", 11) == 0) {
+      unsigned mgmt, data;
+      Config c;
+      configStore.get(c);
+      if (sscanf(buf + 11, "%u %u", &mgmt, &data) == 2 && mgmt <= SNIFF_SNAPLEN_MAX &&
+          data <= SNIFF_SNAPLEN_MAX) {
+        c.snapMgmt = mgmt;
+        c.snapData = data;
+        configStore.update(c, millis());
+        snifferSetSnaplen(mgmt, data);
+      } else {
+        Serial.printf("sniff snap: expected <mgmt> <data>, up to %u bytes\n", SNIFF_SNAPLEN_MAX);
+      }
+    } else if (strcmp(buf, "rf") == 0) {
+      printRfSummary(Serial);
+    } else if (strcmp(buf, "uplink") == 0) {
+#if SENSOR_NODE
+      printUplinkStatus(Serial);
+#else
+      Serial.println("uplink: not a sensor node build");
+#endif
+    } else if (strcmp(buf, "mdns") == 0) {
+#if SENSOR_NODE
+      printDiscovery(Serial);
+#else
+      Serial.println("mdns: not a sensor node build");
+#endif
+    } else if (strcmp(buf, "rules") == 0) {
+      printRules();
+    } else if (strcmp(buf, "rule clear") == 0) {
+      std::lock_guard<std::mutex> guard(rulesLock);
+      ruleEngine.clear();
+    } else if (strncmp(buf, "rule del ", 9) == 0) {
+      std::lock_guard<std::mutex> guard(rulesLock);
+      if (!ruleEngine.remove(atoi(buf + 9))) Serial.println("no such rule");
+    } else if (strncmp(buf, "rule ", 5) == 0) {
+      std::lock_guard<std::mutex> guard(rulesLock);
+      const char* error;
+      if (!ruleEngine.add(buf + 5, &error)) Serial.printf("rule: %s\n", error);
+    } else if (strncmp(buf, "ota ", 4) == 0) {
+      if (otaApplyDelta(buf + 4, Serial)) {
+        Serial.flush();
+        ESP.restart();
+      }
+    } else if (strcmp(buf, "portal") == 0) {
+      if (portalStart(applyConfig, portalStatus)) {
+        Serial.printf("portal on %s %s\n", portalSsid(), portalAddress());
+      } else {
+        Serial.println("portal failed");
+      }
+    } else if (strcmp(buf, "portal off") == 0) {
+      portalStop();
+    } else if (strcmp(buf, "config") == 0) {
+      Config c;
+      configStore.get(c);
+      Serial.printf("scan %us, stream %s%s, collector %s:%u, portal %s\n", c.scanIntervalS,
+                    c.stream, c.codec ? " (codec)" : "", c.collectorHost, c.collectorPort,
+                    c.apPassword[0] ? "WPA2" : "open");
+      Serial.printf("upload %s via '%s', snaplen %u mgmt %u data\n%s\n",
+                    c.uploadUrl[0] ? c.uploadUrl : "off", c.staSsid, c.snapMgmt, c.snapData, c.rules);
+      Serial.printf("%u NVS commits%s\n", configStore.commits(),
+                    configStore.dirty() ? ", edits pending" : "");
+    } else if (strcmp(buf, "upload") == 0) {
+      printUploadStatus(Serial);
+    } else if (strncmp(buf, "upload ", 7) == 0) {
+      const char* url = strcmp(buf + 7, "off") == 0 ? "" : buf + 7;
+      Config c;
+      configStore.get(c);
+      if (strlen(url) < sizeof(c.uploadUrl) && uploadConfigure(url)) {
+        strlcpy(c.uploadUrl, url, sizeof(c.uploadUrl));
+        configStore.update(c, millis());
+      } else {
+        Serial.println("upload: expected http://host[:port]/path");
+      }
+    } else if (strcmp(buf, "follow") == 0) {
+      if (currentState != FOLLOW) {
+        Serial.println("follow: press SELECT on a WiFi or BLE details page");
+      } else {
+        FollowView v = followTracker.view(millis());
+        Serial.printf("follow %s: %.1f dBm (last %d)%s, %.1f samples/s, %.1f redraws/s, %u samples, %u probes\n",
+                      followTarget.name, v.dbm, v.last, v.stale ? " lost" : "", v.rateHz,
+                      followDrawRate.hz, v.samples, v.probes);
+      }
+    } else if (strcmp(buf, "rec") == 0) {
+      printRecorderStatus(Serial);
+    } else if (strcmp(buf, "rec mark") == 0) {
+      if (!recorderTrigger(FLIGHT_SERIAL, "serial")) Serial.println("rec: busy writing the last event");
+    } else if (strcmp(buf, "dis") == 0) {
+      printHarvest(Serial);
+    } else if (strcmp(buf, "usb off") == 0) {
+      usbDriveStop();
+      Serial.println("USB drive detached");
+    } else {
+      Serial.printf("unknown command: %s\n", buf);
+    }
+  }
+}
+
 // =================================================================
 // SCANNING FUNCTIONS
 // =================================================================
 
 void scanWiFi() {
-  wifiDeviceCount = 0;
-  int n = WiFi.scanNetworks(false, true); // (async, show_hidden)
+  // A reader still pins every spare version; try again next interval
+  WiFiTable* table = wifiSnapshot.beginWrite();
+  if (!table) return;
+
+  wifiScanDoneUs = 0;
+  unsigned long start = millis();
+  int n = portalActive() ? WiFi.scanNetworks(false, true, false, PORTAL_SCAN_DWELL_MS)
+                         : WiFi.scanNetworks(false, true); // (async, show_hidden)
+  uint32_t ingestUs = wifiScanDoneUs;
+  radioCounters[SRC_WIFI].windows++;
+  radioCounters[SRC_WIFI].listenMs += millis() - start;
+  if (n > 0) radioCounters[SRC_WIFI].reports += n;
+  table->count = 0;
   if (n > 0) {
-    wifiDeviceCount = min(n, MAX_WIFI_DEVICES);
-    for (int i = 0; i < wifiDeviceCount; ++i) {
-      wifiDevices[i].ssid = WiFi.SSID(i);
-      wifiDevices[i].mac = WiFi.BSSIDstr(i);
-      wifiDevices[i].channel = WiFi.channel(i);
-      wifiDevices[i].rssi = WiFi.RSSI(i);
-      wifiDevices[i].security = WiFi.encryptionType(i);
+    table->count = min(n, MAX_WIFI_DEVICES);
+    for (int i = 0; i < table->count; ++i) {
+      WiFiDeviceInfo& dev = table->items[i];
+      memcpy(dev.id, WiFi.BSSID(i), 6);
+      strlcpy(dev.ssid, WiFi.SSID(i).c_str(), sizeof(dev.ssid));
+      strlcpy(dev.mac, WiFi.BSSIDstr(i).c_str(), sizeof(dev.mac));
+      dev.channel = WiFi.channel(i);
+      dev.rssi = WiFi.RSSI(i);
+      dev.security = WiFi.encryptionType(i);
+      dev.ingestUs = ingestUs;
+      recordLatency(LAT_AGGREGATE, ingestUs);
     }
   }
   WiFi.scanDelete(); // Clear results from memory
+
+  // The previous version stays intact until this task's next beginWrite()
+  const WiFiTable* prev = wifiSnapshot.latest();
+  radioCounters[SRC_WIFI].devices += table->count;
+  stampChanges(*prev, *table, wifiChanges);
+  table->version = prev->version + 1;
+  wifiSnapshot.publish(table);
+
+  uint32_t now = historyClockMinutes();
+  for (int i = 0; i < table->count; i++) {
+    const WiFiDeviceInfo& dev = table->items[i];
+    checkRules(SRC_WIFI, dev.id, dev.rssi, dev.channel, dev.channel, dev.security,
+               neverSeen(*prev, dev.id));
+    deviceHistory.recordSighting(dev.id, now);
+    logSurvey(CAPTURE_WIFI_SURVEY, dev.id, dev.rssi, dev.channel);
+  }
 }
 
 void scanBLE() {
-  bleDeviceCount = 0;
-  BLEScan* pBLEScan = BLEDevice::getScan();
-  BLEScanResults foundDevices = pBLEScan->start(2, false); // Scan for 2 seconds
-  int count = foundDevices.getCount();
-  
-  for (int i = 0; i < count && bleDeviceCount < MAX_BLE_DEVICES; i++) {
-    BLEAdvertisedDevice device = foundDevices.getDevice(i);
-    
-    // Prevent duplicates
-    bool found = false;
-    for(int j=0; j < bleDeviceCount; j++) {
-      if (bleDevices[j].address.equals(device.getAddress().toString().c_str())) {
-        found = true;
-        break;
-      }
+  BLETable* table = bleSnapshot.beginWrite();
+  if (!table) return;
+
+  static BleSighting found[BLE_SCAN_MAX];   // scanner task only
+  ScanPlan plan = blePolicy.plan(millis());
+  unsigned long start = millis();
+  int count;
+  {
+    // No window while a harvest connection is being set up
+    std::lock_guard<std::mutex> guard(harvestRadioLock());
+    bool whitelistOnly = applyScanPlan(plan);
+    count = bleScan(portalActive() ? PORTAL_BLE_SCAN_S : 2, plan.active, whitelistOnly, found, BLE_SCAN_MAX);
+  }
+  radioCounters[SRC_BLE].windows++;
+  radioCounters[SRC_BLE].listenMs += millis() - start;
+  table->count = 0;
+
+  // One sighting per address, scan response already merged in
+  for (int i = 0; i < count && table->count < MAX_BLE_DEVICES; i++) {
+    const BleSighting& s = found[i];
+    BLEDeviceInfo& dev = table->items[table->count];
+    memcpy(dev.id, s.id, 6);
+    // The name may only come in a scan response, from an earlier window
+    const BLEMeta* meta = blePolicy.observe(dev.id, s.addrType, plan.active, s.scanResponse,
+                                            s.adv.name, millis());
+    strlcpy(dev.name, meta->name[0] ? meta->name : "N/A", sizeof(dev.name));
+    snprintf(dev.address, sizeof(dev.address), "%02x:%02x:%02x:%02x:%02x:%02x",
+             s.id[0], s.id[1], s.id[2], s.id[3], s.id[4], s.id[5]);
+    dev.rssi = s.rssi;
+    dev.txPower = s.adv.haveTxPower ? s.adv.txPower : 0;
+    strlcpy(dev.serviceUUID, s.adv.serviceUUID[0] ? s.adv.serviceUUID : "None", sizeof(dev.serviceUUID));
+    dev.ingestUs = s.ingestUs;
+    recordLatency(LAT_AGGREGATE, dev.ingestUs);
+    if (s.connectable) harvestOffer(dev.id, s.addrType);
+    table->count++;
+  }
+
+  const BLETable* prev = bleSnapshot.latest();
+  radioCounters[SRC_BLE].devices += table->count;
+  stampChanges(*prev, *table, bleChanges);
+  table->version = prev->version + 1;
+  bleSnapshot.publish(table);
+
+  uint32_t now = historyClockMinutes();
+  for (int i = 0; i < table->count; i++) {
+    const BLEDeviceInfo& dev = table->items[i];
+    checkRules(SRC_BLE, dev.id, dev.rssi, 0, dev.txPower, 0, neverSeen(*prev, dev.id));
+    deviceHistory.recordSighting(dev.id, now);
+    logSurvey(CAPTURE_BLE_SURVEY, dev.id, dev.rssi, dev.txPower);
+  }
+}
+
+// Loads the plan's devices into the controller whitelist; false for an
+// empty plan, which scans everybody
+bool applyScanPlan(const ScanPlan& plan) {
+  if (plan.whitelistCount == 0) return false;
+  esp_ble_gap_clear_whitelist();
+  for (int i = 0; i < plan.whitelistCount; i++) {
+    whitelistAdd(plan.whitelist[i]->id, plan.whitelist[i]->addrType);
+  }
+  return true;
+}
+
+void whitelistAdd(const uint8_t id[6], uint8_t addrType) {
+  esp_ble_gap_update_whitelist(true, (uint8_t*)id,
+                               addrType == BLE_ADDR_TYPE_PUBLIC ? BLE_WL_ADDR_TYPE_PUBLIC
+                                                                : BLE_WL_ADDR_TYPE_RANDOM);
+}
+
+// Copies the device on the details page into followTarget
+bool selectFollowTarget() {
+  if (currentState == WIFI_DETAILS) {
+    if (SENSOR_NODE) return false;   // the WiFi radio belongs to the sniffer
+    EpochSnapshot<WiFiTable>::ReadGuard wifi = wifiSnapshot.read();
+    if (!wifi || listIndex >= wifi->count) return false;
+    const WiFiDeviceInfo& dev = wifi->items[listIndex];
+    followTarget.ble = false;
+    memcpy(followTarget.id, dev.id, 6);
+    followTarget.channel = dev.channel;
+    strlcpy(followTarget.name, dev.ssid[0] ? dev.ssid : dev.mac, sizeof(followTarget.name));
+  } else {
+    EpochSnapshot<BLETable>::ReadGuard ble = bleSnapshot.read();
+    if (!ble || listIndex >= ble->count) return false;
+    const BLEDeviceInfo& dev = ble->items[listIndex];
+    followTarget.ble = true;
+    memcpy(followTarget.id, dev.id, 6);
+    followTarget.channel = 0;
+    strlcpy(followTarget.name, dev.name, sizeof(followTarget.name));
+  }
+  followTracker.reset(millis());
+  followDrawRate.reset(millis());
+  return true;
+}
+
+// Back-to-back probes of the followed AP's channel, filtered to its BSSID,
+// until follow mode ends
+void followWiFi() {
+  while (currentState == FOLLOW) {
+    unsigned long start = millis();
+    int n = WiFi.scanNetworks(false, true, false, FOLLOW_WIFI_DWELL_MS, followTarget.channel, NULL,
+                              followTarget.id);
+    radioCounters[SRC_WIFI].windows++;
+    radioCounters[SRC_WIFI].listenMs += millis() - start;
+    followTracker.probed();
+    for (int i = 0; i < n; i++) {
+      if (memcmp(WiFi.BSSID(i), followTarget.id, 6) == 0) followTracker.sample(WiFi.RSSI(i), millis());
     }
+    if (n > 0) radioCounters[SRC_WIFI].reports += n;
+    WiFi.scanDelete();
+    if (n < 0) delay(FOLLOW_WIFI_DWELL_MS);   // scan failed; do not spin
+  }
+}
 
-    if (!found) {
-      bleDevices[bleDeviceCount].name = device.haveName() ? device.getName().c_str() : "N/A";
-      bleDevices[bleDeviceCount].address = device.getAddress().toString().c_str();
-      bleDevices[bleDeviceCount].rssi = device.haveRSSI() ? device.getRSSI() : 0;
-      bleDevices[bleDeviceCount].txPower = device.haveTXPower() ? device.getTXPower() : 0;
-      if(device.haveServiceUUID()) {
-        bleDevices[bleDeviceCount].serviceUUID = device.getServiceUUID().toString();
-      } else {
-        bleDevices[bleDeviceCount].serviceUUID = "None";
+// One continuous passive scan that only the followed address gets through
+// (controller whitelist); onFollowReport sees each of its advertisements
+void followBLE() {
+  const BLEMeta* meta = blePolicy.lookup(followTarget.id);
+  // No DIS connections while following
+  std::lock_guard<std::mutex> guard(harvestRadioLock());
+  esp_ble_gap_clear_whitelist();
+  whitelistAdd(followTarget.id, meta ? meta->addrType : BLE_ADDR_TYPE_RANDOM);
+  unsigned long start = millis();
+  if (bleFollowStart(onFollowReport)) {
+    while (currentState == FOLLOW) vTaskDelay(pdMS_TO_TICKS(100));
+    bleFollowStop();
+  }
+  radioCounters[SRC_BLE].windows++;
+  radioCounters[SRC_BLE].listenMs += millis() - start;
+}
+
+// Runs one asynchronous BR/EDR inquiry window and publishes the devices
+// found. Returns how many of them were not in the previous version.
+#if SOC_BT_CLASSIC_SUPPORTED
+// Name from the stack's own result set of the inquiry, "N/A" if none
+void inquiryName(BTScanResults* results, const uint8_t address[6], char* out, size_t size) {
+  strlcpy(out, "N/A", size);
+  for (int i = 0; results && i < results->getCount(); i++) {
+    BTAdvertisedDevice* device = results->getDevice(i);
+    if (memcmp(*device->getAddress().getNative(), address, 6) != 0) continue;
+    if (device->haveName() && !device->getName().empty()) strlcpy(out, device->getName().c_str(), size);
+    return;
+  }
+}
+
+int scanBTClassic() {
+  BTClassicTable* table = btcSnapshot.beginWrite();
+  if (!table) return 0;
+
+  btcInquiryCount = 0;
+  unsigned long start = millis();
+  if (!SerialBT.discoverAsync(onInquiryResult, INQUIRY_WINDOW_MS)) return 0;
+  vTaskDelay(pdMS_TO_TICKS(INQUIRY_WINDOW_MS + 200));
+  SerialBT.discoverAsyncStop();
+  BTScanResults* results = SerialBT.getScanResults();
+  radioCounters[SRC_BT_CLASSIC].windows++;
+  radioCounters[SRC_BT_CLASSIC].listenMs += millis() - start;
+
+  const BTClassicTable* prev = btcSnapshot.latest();
+  int fresh = 0;
+  int count = btcInquiryCount;
+  table->count = 0;
+  for (int i = 0; i < count && table->count < MAX_BTC_DEVICES; i++) {
+    const BTCInquiryResult& res = btcInquiry[i];
+    if (findById(*table, res.address)) continue;
+
+    BTClassicDeviceInfo& dev = table->items[table->count++];
+    memcpy(dev.id, res.address, 6);
+    inquiryName(results, res.address, dev.name, sizeof(dev.name));
+    snprintf(dev.address, sizeof(dev.address), "%02x:%02x:%02x:%02x:%02x:%02x",
+             res.address[0], res.address[1], res.address[2],
+             res.address[3], res.address[4], res.address[5]);
+    dev.cod = res.cod;
+    dev.rssi = res.rssi;
+    dev.ingestUs = res.us;
+    recordLatency(LAT_AGGREGATE, dev.ingestUs);
+    if (!findById(*prev, dev.id)) fresh++;
+  }
+
+  radioCounters[SRC_BT_CLASSIC].devices += table->count;
+  stampChanges(*prev, *table, btcChanges);
+  table->version = prev->version + 1;
+  btcSnapshot.publish(table);
+
+  uint32_t now = historyClockMinutes();
+  for (int i = 0; i < table->count; i++) {
+    const BTClassicDeviceInfo& dev = table->items[i];
+    int major = (dev.cod >> 8) & 0x1F;
+    checkRules(SRC_BT_CLASSIC, dev.id, dev.rssi, 0, major, 0, neverSeen(*prev, dev.id));
+    deviceHistory.recordSighting(dev.id, now);
+    logSurvey(CAPTURE_BTC_SURVEY, dev.id, dev.rssi, major);
+  }
+  return fresh;
+}
+
+// Called from the BT stack for every device new to the current inquiry.
+// Only fixed-size fields are copied here: getName() builds a std::string.
+void onInquiryResult(BTAdvertisedDevice* device) {
+  radioCounters[SRC_BT_CLASSIC].reports++;
+  int i = btcInquiryCount;
+  if (i >= MAX_BTC_INGEST) return;
+  BTCInquiryResult& res = btcInquiry[i];
+  memcpy(res.address, *device->getAddress().getNative(), 6);
+  res.cod = device->haveCOD() ? device->getCOD() : 0;
+  res.rssi = device->haveRSSI() ? device->getRSSI() : 0;
+  res.us = ingestTimestamp();
+  btcInquiryCount = i + 1;
+}
+#else
+// No BR/EDR radio: the BT Classic list stays empty
+int scanBTClassic() {
+  return 0;
+}
+#endif
+
+// Appends one sighting to the survey log on the capture storage
+void logSurvey(CaptureRecordType type, const uint8_t id[6], int rssi, int extra) {
+  SurveyRecord rec;
+  rec.hdr.len = sizeof(rec);
+  rec.hdr.type = type;
+  rec.hdr.reserved = 0;
+  rec.hdr.timeMs = millis();
+  memcpy(rec.id, id, 6);
+  rec.rssi = rssi;
+  rec.extra = extra;
+  exportStreamRecord(&rec, sizeof(rec));
+  recorderAppend(&rec, sizeof(rec));
+
+  // The host is reading a snapshot of the segments; don't rotate under it
+  if (usbDriveActive()) return;
+  captureStorage().append(&rec, sizeof(rec));
+}
+
+// =================================================================
+// RULES & ALERTS
+// =================================================================
+
+// Never seen before: not in the device history, or without one, not in
+// the previous scan
+template <typename Table>
+bool neverSeen(const Table& prev, const uint8_t id[6]) {
+  HistoryRecord rec;
+  if (deviceHistory.ready()) return !deviceHistory.lookup(id, rec);
+  return !findById(prev, id);
+}
+
+// Entries of the published version; 0 while every reader slot is taken
+template <typename Table>
+int snapshotCount(EpochSnapshot<Table>& snapshot) {
+  typename EpochSnapshot<Table>::ReadGuard table = snapshot.read();
+  return table ? table->count : 0;
+}
+
+// Publish counter of the current version; false while every reader slot
+// is taken
+template <typename Table>
+bool snapshotVersion(EpochSnapshot<Table>& snapshot, uint32_t& version) {
+  typename EpochSnapshot<Table>::ReadGuard table = snapshot.read();
+  if (!table) return false;
+  version = table->version;
+  return true;
+}
+
+void checkRules(RadioSource source, const uint8_t id[6], int rssi, int channel, int extra,
+                int security, bool fresh) {
+  RuleReport report;
+  report.source = 1 << source;   // RULE_SRC_* follow RadioSource
+  memcpy(report.id, id, 6);
+  report.f[RF_RSSI] = rssi;
+  report.f[RF_CHANNEL] = channel;
+  report.f[RF_EXTRA] = extra;
+  report.f[RF_SECURITY] = security;
+  report.f[RF_NEW] = fresh;
+  report.f[RF_OPEN] = source == SRC_WIFI && security == WIFI_AUTH_OPEN;
+  std::lock_guard<std::mutex> guard(rulesLock);
+  ruleEngine.evaluate(report, millis());
+}
+
+// Scanner task: queue the LCD part for the UI loop, export right away
+void onRuleFired(void* ctx, const Rule& rule, const RuleReport& report) {
+  if (rule.actions & RULE_ALERT) {
+    std::lock_guard<std::mutex> guard(alertLock);
+    strlcpy(ruleAlert.rule, rule.name, sizeof(ruleAlert.rule));
+    memcpy(ruleAlert.id, report.id, 6);
+    ruleAlert.rssi = report.f[RF_RSSI];
+    ruleAlert.pending = true;
+  }
+  if (rule.actions & RULE_BLINK) blinkUntil = millis() + BLINK_MS;
+  if (rule.actions & RULE_EXPORT) {
+    RuleEventRecord rec = {};
+    rec.hdr.len = sizeof(rec);
+    rec.hdr.type = CAPTURE_RULE_EVENT;
+    rec.hdr.timeMs = millis();
+    memcpy(rec.id, report.id, 6);
+    rec.rssi = report.f[RF_RSSI];
+    rec.source = report.source;
+    strncpy(rec.rule, rule.name, sizeof(rec.rule));
+    exportStreamRecord(&rec, sizeof(rec));
+  }
+  if (rule.actions & RULE_RECORD) recorderTrigger(FLIGHT_RULE, rule.name);
+}
+
+// Draws a new alert and drives the backlight blink; true while an alert
+// is on screen
+bool updateAlerts() {
+  static uint32_t alertShownAt = 0;
+  static bool showing = false;
+  static bool lightOn = true;
+  uint32_t now = millis();
+
+  bool blinking = (int32_t)(blinkUntil - now) > 0;
+  bool wantLight = !blinking || (now / BLINK_PERIOD_MS) % 2 == 0;
+  if (wantLight != lightOn) {
+    if (wantLight) lcd.backlight();
+    else lcd.noBacklight();
+    lightOn = wantLight;
+  }
+
+  char rule[RULES_NAME_MAX];
+  uint8_t id[6];
+  int rssi;
+  bool fresh = false;
+  {
+    std::lock_guard<std::mutex> guard(alertLock);
+    if (ruleAlert.pending) {
+      memcpy(rule, ruleAlert.rule, sizeof(rule));
+      memcpy(id, ruleAlert.id, 6);
+      rssi = ruleAlert.rssi;
+      ruleAlert.pending = false;
+      fresh = true;
+    }
+  }
+  if (fresh) {
+    lcd.clear();
+    lcd.setCursor(0, 0);
+    lcd.print("! ");
+    lcd.print(rule);
+    lcd.setCursor(0, 1);
+    char line[LCD_COLS + 1];
+    snprintf(line, sizeof(line), "%02X%02X%02X%02X%02X%02X %d", id[0], id[1], id[2], id[3],
+             id[4], id[5], rssi);
+    lcd.print(line);
+    alertShownAt = now;
+    showing = true;
+  } else if (showing && now - alertShownAt >= ALERT_HOLD_MS) {
+    showing = false;
+    updateDisplay();
+  }
+  return showing;
+}
+
+// =================================================================
+// CONFIG
+// =================================================================
+
+// Stored settings over the build defaults, then applied
+void loadConfig() {
+  Config defaults = {};
+  defaults.scanIntervalS = 10;
+  strlcpy(defaults.stream, SENSOR_NODE ? "udp" : "off", sizeof(defaults.stream));
+  defaults.codec = SENSOR_NODE;   // the uplink is the bottleneck on a busy channel
+  strlcpy(defaults.collectorHost, COLLECTOR_HOST, sizeof(defaults.collectorHost));
+  defaults.collectorPort = COLLECTOR_PORT;
+  defaults.snapMgmt = SNIFF_SNAPLEN_MGMT;
+  defaults.snapData = SNIFF_SNAPLEN_DATA;
+  for (const char* text : DEFAULT_RULES) {
+    strlcat(defaults.rules, text, sizeof(defaults.rules));
+    strlcat(defaults.rules, "\n", sizeof(defaults.rules));
+  }
+  if (!configStore.begin(defaults)) Serial.println("config: NVS unavailable, using defaults");
+  Config config;
+  configStore.get(config);
+  applyConfig(config);
+}
+
+// Setup and the portal task; everything it touches is safe from either
+void applyConfig(const Config& config) {
+  scanIntervalMs = config.scanIntervalS * 1000UL;
+  exportStreamSetCodec(config.codec);
+  if (!exportStreamSelect(config.stream)) Serial.printf("config: no transport '%s'\n", config.stream);
+#if SENSOR_NODE
+  IPAddress ip;
+  if (ip.fromString(config.collectorHost)) udpTransport.setTarget(ip, config.collectorPort);
+  snifferSetSnaplen(config.snapMgmt, config.snapData);
+#else
+  // WiFi backhaul for uploads; scans share the radio with the association
+  static char joinedSsid[sizeof(config.staSsid)] = "";
+  static char joinedPassword[sizeof(config.staPassword)] = "";
+  if (strcmp(joinedSsid, config.staSsid) != 0 || strcmp(joinedPassword, config.staPassword) != 0) {
+    strlcpy(joinedSsid, config.staSsid, sizeof(joinedSsid));
+    strlcpy(joinedPassword, config.staPassword, sizeof(joinedPassword));
+    if (joinedSsid[0]) WiFi.begin(joinedSsid, joinedPassword[0] ? joinedPassword : nullptr);
+    else WiFi.disconnect();
+  }
+#endif
+  if (!uploadConfigure(config.uploadUrl)) Serial.printf("config: bad upload URL '%s'\n", config.uploadUrl);
+  std::lock_guard<std::mutex> guard(rulesLock);
+  ruleEngine.clear();
+  char text[RULES_TEXT_MAX];
+  for (const char* line = config.rules; *line;) {
+    size_t len = strcspn(line, "\n");
+    if (len > 0 && len < sizeof(text)) {
+      memcpy(text, line, len);
+      text[len] = 0;
+      const char* error;
+      if (!ruleEngine.add(text, &error)) Serial.printf("rule '%s': %s\n", text, error);
+    }
+    line += line[len] ? len + 1 : len;
+  }
+}
+
+size_t portalStatus(char* out, size_t cap) {
+  SegmentInfo newest;
+  uint32_t segments;
+  captureStorage().listNewestSegments(&newest, 1, &segments);
+  ExportTransport* t = exportStreamTransport();
+  int rules;
+  {
+    std::lock_guard<std::mutex> guard(rulesLock);
+    rules = ruleEngine.size();
+  }
+  return snprintf(out, cap,
+                  "{\"uptime\":%lu,\"heap\":%u,\"wifi\":%d,\"ble\":%d,\"btc\":%d,"
+                  "\"segments\":%u,\"stream\":\"%s\",\"dropped\":%u,\"rules\":%d,\"commits\":%u}",
+                  millis() / 1000, ESP.getFreeHeap(), snapshotCount(wifiSnapshot),
+                  snapshotCount(bleSnapshot), snapshotCount(btcSnapshot), segments, t ? t->name() : "off",
+                  exportStreamDropped(), rules, configStore.commits());
+}
+
+void printRules() {
+  std::lock_guard<std::mutex> guard(rulesLock);
+  Serial.printf("%d rules (max %d)\n", ruleEngine.size(), RULES_MAX);
+  for (int i = 0; i < ruleEngine.size(); i++) {
+    const Rule& r = ruleEngine.rule(i);
+    Serial.printf("%2d %-40s match %u fired %u limited %u\n", i, r.text, r.matches, r.fires,
+                  r.suppressed);
+  }
+}
+
+// Sustained write throughput of the selected engine, in fresh segments
+// that are removed again afterwards
+void benchmarkStorage() {
+  CaptureStorage& storage = captureStorage();
+  if (!storage.ready()) {
+    Serial.println("capture storage not mounted");
+    return;
+  }
+  const size_t total = 1024 * 1024;
+  SurveyRecord rec = {};
+  rec.hdr.len = sizeof(rec);
+
+  storage.rotate();
+  uint32_t first = storage.currentSegment();
+  unsigned long start = micros();
+  size_t written = 0;
+  while (written < total && storage.append(&rec, sizeof(rec))) written += sizeof(rec);
+  storage.flush();
+  unsigned long elapsed = micros() - start;
+  storage.rotate();
+  uint32_t last = storage.currentSegment();
+
+  Serial.printf("%s: %u bytes in %lu ms, %lu KB/s\n", storage.name(), written, elapsed / 1000,
+                (unsigned long)((uint64_t)written * 1000000 / elapsed / 1024));
+  for (uint32_t id = first; id < last; id++) storage.removeSegment(id);
+}
+
+// Feeds synthetic survey records into the export stream as fast as the
+// ring takes them; the collector stand-in (tools/collector.py) reports
+// what actually arrived
+void benchmarkStream(unsigned long seconds) {
+  ExportTransport* t = exportStreamTransport();
+  if (!t) {
+    Serial.println("no stream selected");
+    return;
+  }
+  SurveyRecord rec = {};
+  rec.hdr.len = sizeof(rec);
+  rec.hdr.type = CAPTURE_WIFI_SURVEY;
+  uint32_t bytes0 = t->counters.bytes.load();
+  uint32_t drops0 = exportStreamDropped();
+  uint32_t seq = 0;
+  unsigned long start = millis();
+  while (millis() - start < seconds * 1000) {
+    for (int i = 0; i < 64; i++) {
+      rec.hdr.timeMs = millis();
+      memcpy(rec.id, &seq, sizeof(seq));
+      seq++;
+      exportStreamRecord(&rec, sizeof(rec));
+    }
+    vTaskDelay(1);
+  }
+  unsigned long elapsed = millis() - start;
+  uint32_t sent = t->counters.bytes.load() - bytes0;
+  Serial.printf("%s: %u records offered, %u bytes sent in %lu ms (%lu KB/s), %u dropped\n",
+                t->name(), seq, sent, elapsed, (unsigned long)((uint64_t)sent * 1000 / elapsed / 1024),
+                exportStreamDropped() - drops0);
+}
+
+// Packs the closed capture segments with the export codec and unpacks
+// them again: compression ratio and speed on recorded traffic
+static void countDecoded(void* ctx, const uint8_t* rec, size_t len) {
+  *(size_t*)ctx += len;
+}
+
+void benchmarkCodec() {
+  static ScanEncoder enc;
+  static ScanDecoder dec;
+  static uint8_t chunk[CAPTURE_BATCH_BYTES];
+  SegmentInfo segs[32];
+  int n = captureStorage().listNewestSegments(segs, 32);
+  if (n == 0) {
+    Serial.println("no closed segments to compress");
+    return;
+  }
+  enc = ScanEncoder();
+  size_t decoded = 0;
+  bool ok = true;
+  unsigned long encodeUs = 0, decodeUs = 0;
+  for (int i = 0; i < n; i++) {
+    // Whole records only: carry a partial one over to the next read
+    uint32_t offset = 0;
+    size_t got;
+    while ((got = captureStorage().readSegment(segs[i].id, offset, chunk, sizeof(chunk))) > 0) {
+      size_t used = 0;
+      CaptureRecordHeader hdr;
+      while (used + sizeof(hdr) <= got) {
+        memcpy(&hdr, chunk + used, sizeof(hdr));
+        if (hdr.len < sizeof(hdr) || used + hdr.len > got) break;
+        unsigned long t0 = micros();
+        bool added = enc.add(chunk + used, hdr.len);
+        const uint8_t* block;
+        size_t blockLen = 0;
+        if (!added) {
+          blockLen = enc.finish(&block);
+          enc.add(chunk + used, hdr.len);
+        }
+        encodeUs += micros() - t0;
+        if (blockLen) {
+          t0 = micros();
+          ok &= dec.decode(block, blockLen, countDecoded, &decoded);
+          decodeUs += micros() - t0;
+        }
+        used += hdr.len;
       }
-      bleDeviceCount++;
+      if (used == 0) break;   // corrupt record
+      offset += used;
     }
   }
-  pBLEScan->clearResults();
+  if (!enc.empty()) {
+    const uint8_t* block;
+    size_t blockLen = enc.finish(&block);
+    ok &= dec.decode(block, blockLen, countDecoded, &decoded);
+  }
+
+  Serial.printf("codec: %d segments, %u -> %u bytes (%.2fx) in %u blocks\n", n, enc.rawBytes,
+                enc.encodedBytes, enc.encodedBytes ? (float)enc.rawBytes / enc.encodedBytes : 0.0f,
+                enc.blocks);
+  Serial.printf("encode %lu KB/s, decode %lu KB/s, round trip %s\n",
+                encodeUs ? (unsigned long)((uint64_t)enc.rawBytes * 1000000 / encodeUs / 1024) : 0,
+                decodeUs ? (unsigned long)((uint64_t)decoded * 1000000 / decodeUs / 1024) : 0,
+                ok && decoded == enc.rawBytes ? "ok" : "FAILED");
 }
 
 // =================================================================
@@ -282,70 +1315,122 @@ void updateDisplay() {
     case BLE_DETAILS:
       drawBleDetails();
       break;
+    case BTC_SCAN_LIST:
+      drawBtcList();
+      break;
+    case BTC_DETAILS:
+      drawBtcDetails();
+      break;
+    case DIAGNOSTICS:
+      drawDiagnostics();
+      break;
+    case PORTAL_INFO:
+      drawPortal();
+      break;
+    case FOLLOW:
+      drawFollow();
+      break;
   }
 }
 
 void drawMainMenu() {
   // Handle index wrapping
-  if (listIndex < 0) listIndex = 1;
-  if (listIndex > 1) listIndex = 0;
+  if (listIndex < 0) listIndex = MENU_ITEM_COUNT - 1;
+  if (listIndex >= MENU_ITEM_COUNT) listIndex = 0;
 
-  lcd.setCursor(0, 0);
-  lcd.print(listIndex == 0 ? "-> WiFi Scanner" : "   WiFi Scanner");
-  lcd.setCursor(0, 1);
-  lcd.print(listIndex == 1 ? "-> BLE Scanner" : "   BLE Scanner");
+  // Show the page of menu items containing the selection
+  int first = listIndex - (listIndex % LCD_ROWS);
+  for (int row = 0; row < LCD_ROWS && first + row < MENU_ITEM_COUNT; row++) {
+    lcd.setCursor(0, row);
+    lcd.print(first + row == listIndex ? "-> " : "   ");
+    lcd.print(MENU_LABELS[first + row]);
+  }
 }
 
 void drawWifiList() {
+#if SENSOR_NODE
+  SnifferStats s = snifferStats();
   lcd.setCursor(0, 0);
+  lcd.print("Sniffing ch ");
+  lcd.print(snifferChannel());
+  lcd.setCursor(0, 1);
+  lcd.print(s.frames);
+  lcd.print(" frames");
+  return;
+#endif
+  EpochSnapshot<WiFiTable>::ReadGuard wifi = wifiSnapshot.read();
+  if (!wifi) return;
+
+  lcd.setCursor(0, 0);
+  if (wifi->version == 0) {
+    lcd.print("Scanning...");
+    return;
+  }
   lcd.print("WiFi Networks ");
-  lcd.print(wifiDeviceCount);
-  
-  if (wifiDeviceCount == 0) {
+  lcd.print(wifi->count);
+
+  if (wifi->count == 0) {
     lcd.setCursor(0, 1);
     lcd.print("No networks found");
     return;
   }
-  
+
   // Handle index wrapping
-  if (listIndex < 0) listIndex = wifiDeviceCount - 1;
-  if (listIndex >= wifiDeviceCount) listIndex = 0;
-  
+  if (listIndex < 0) listIndex = wifi->count - 1;
+  if (listIndex >= wifi->count) listIndex = 0;
+
+  const WiFiDeviceInfo& dev = wifi->items[listIndex];
+  noteDisplayed(SRC_WIFI, wifi->version, listIndex, dev.ingestUs);
+
   lcd.setCursor(0, 1);
-  String ssid = wifiDevices[listIndex].ssid;
+  String ssid = dev.ssid;
   if (ssid.length() == 0) ssid = "Hidden Network";
   String line = "-> " + ssid;
   lcd.print(line.substring(0, 16));
 }
 
 void drawBleList() {
+  EpochSnapshot<BLETable>::ReadGuard ble = bleSnapshot.read();
+  if (!ble) return;
+
   lcd.setCursor(0, 0);
+  if (ble->version == 0) {
+    lcd.print("Scanning...");
+    return;
+  }
   lcd.print("BLE Devices   ");
-  lcd.print(bleDeviceCount);
+  lcd.print(ble->count);
 
-  if (bleDeviceCount == 0) {
+  if (ble->count == 0) {
     lcd.setCursor(0, 1);
     lcd.print("No devices found");
     return;
   }
-  
+
   // Handle index wrapping
-  if (listIndex < 0) listIndex = bleDeviceCount - 1;
-  if (listIndex >= bleDeviceCount) listIndex = 0;
-  
+  if (listIndex < 0) listIndex = ble->count - 1;
+  if (listIndex >= ble->count) listIndex = 0;
+
+  const BLEDeviceInfo& dev = ble->items[listIndex];
+  noteDisplayed(SRC_BLE, ble->version, listIndex, dev.ingestUs);
+
   lcd.setCursor(0, 1);
-  String name = bleDevices[listIndex].name;
+  String name = dev.name;
   String line = "-> " + name;
   lcd.print(line.substring(0, 16));
 }
 
 void drawWifiDetails() {
-  const int totalPages = 3;
+  const int totalPages = 4;
   // Handle page wrapping
   if (detailPage < 0) detailPage = totalPages - 1;
   if (detailPage >= totalPages) detailPage = 0;
 
-  String top_line = wifiDevices[listIndex].ssid;
+  EpochSnapshot<WiFiTable>::ReadGuard wifi = wifiSnapshot.read();
+  if (!wifi || listIndex >= wifi->count) return;
+  const WiFiDeviceInfo& dev = wifi->items[listIndex];
+
+  String top_line = dev.ssid;
   if (top_line.length() == 0) top_line = "Hidden Network";
   top_line.trim();
   lcd.setCursor(0, 0);
@@ -355,28 +1440,35 @@ void drawWifiDetails() {
   switch (detailPage) {
     case 0: // RSSI
       lcd.print("RSSI: ");
-      lcd.print(wifiDevices[listIndex].rssi);
+      lcd.print(dev.rssi);
       lcd.print(" dBm");
       break;
     case 1: // MAC Address
-      lcd.print(wifiDevices[listIndex].mac);
+      lcd.print(dev.mac);
       break;
     case 2: // Channel and Security
       lcd.print("Ch: ");
-      lcd.print(wifiDevices[listIndex].channel);
+      lcd.print(dev.channel);
       lcd.print(" Sec: ");
-      lcd.print(getWifiSecurityString(wifiDevices[listIndex].security));
+      lcd.print(getWifiSecurityString(dev.security));
+      break;
+    case 3: // Long-term history
+      drawHistory(dev.id);
       break;
   }
 }
 
 void drawBleDetails() {
-  const int totalPages = 4;
+  const int totalPages = 6;
   // Handle page wrapping
   if (detailPage < 0) detailPage = totalPages - 1;
   if (detailPage >= totalPages) detailPage = 0;
 
-  String top_line = bleDevices[listIndex].name;
+  EpochSnapshot<BLETable>::ReadGuard ble = bleSnapshot.read();
+  if (!ble || listIndex >= ble->count) return;
+  const BLEDeviceInfo& dev = ble->items[listIndex];
+
+  String top_line = dev.name;
   top_line.trim();
   lcd.setCursor(0,0);
   lcd.print(top_line.substring(0, 16));
@@ -385,24 +1477,225 @@ void drawBleDetails() {
   switch (detailPage) {
     case 0: // RSSI
       lcd.print("RSSI: ");
-      lcd.print(bleDevices[listIndex].rssi);
+      lcd.print(dev.rssi);
       lcd.print(" dBm");
       break;
     case 1: // Full BLE Address
-      lcd.print(bleDevices[listIndex].address);
+      lcd.print(dev.address);
       break;
     case 2: // TX Power
       lcd.print("TX Power: ");
-      lcd.print(bleDevices[listIndex].txPower);
+      lcd.print(dev.txPower);
       lcd.print(" dB");
       break;
     case 3: // Service UUID (first part)
       lcd.print("UUID:");
-      lcd.print(bleDevices[listIndex].serviceUUID.c_str());
+      lcd.print(dev.serviceUUID);
+      break;
+    case 4: // Long-term history
+      drawHistory(dev.id);
+      break;
+    case 5: { // Device Information Service
+      DisRecord rec;
+      if (!harvestLookup(dev.id, rec)) {
+        lcd.print("DIS: not tried");
+      } else if (rec.state != DIS_DONE) {
+        lcd.print("DIS: ");
+        lcd.print(disStateName(rec.state));
+      } else {
+        String info = String(rec.fields[DIS_MODEL]) + " " + rec.fields[DIS_FIRMWARE];
+        info.trim();
+        lcd.print(info.length() ? info.substring(0, 16) : String(rec.fields[DIS_MANUFACTURER]).substring(0, 16));
+      }
+      break;
+    }
+  }
+}
+
+void drawBtcList() {
+  EpochSnapshot<BTClassicTable>::ReadGuard btc = btcSnapshot.read();
+  if (!btc) return;
+
+  lcd.setCursor(0, 0);
+  if (btc->version == 0) {
+    lcd.print("Scanning...");
+    return;
+  }
+  lcd.print("BT Classic    ");
+  lcd.print(btc->count);
+
+  if (btc->count == 0) {
+    lcd.setCursor(0, 1);
+    lcd.print("No devices found");
+    return;
+  }
+
+  // Handle index wrapping
+  if (listIndex < 0) listIndex = btc->count - 1;
+  if (listIndex >= btc->count) listIndex = 0;
+
+  const BTClassicDeviceInfo& dev = btc->items[listIndex];
+  noteDisplayed(SRC_BT_CLASSIC, btc->version, listIndex, dev.ingestUs);
+
+  lcd.setCursor(0, 1);
+  String name = dev.name;
+  String line = "-> " + name;
+  lcd.print(line.substring(0, 16));
+}
+
+void drawBtcDetails() {
+  const int totalPages = 4;
+  // Handle page wrapping
+  if (detailPage < 0) detailPage = totalPages - 1;
+  if (detailPage >= totalPages) detailPage = 0;
+
+  EpochSnapshot<BTClassicTable>::ReadGuard btc = btcSnapshot.read();
+  if (!btc || listIndex >= btc->count) return;
+  const BTClassicDeviceInfo& dev = btc->items[listIndex];
+
+  String top_line = dev.name;
+  top_line.trim();
+  lcd.setCursor(0, 0);
+  lcd.print(top_line.substring(0, 16));
+
+  lcd.setCursor(0, 1);
+  switch (detailPage) {
+    case 0: // RSSI
+      lcd.print("RSSI: ");
+      lcd.print(dev.rssi);
+      lcd.print(" dBm");
+      break;
+    case 1: // BD_ADDR
+      lcd.print(dev.address);
+      break;
+    case 2: // Class of Device
+      lcd.print(codMajorClassName(dev.cod));
+      lcd.print(" ");
+      lcd.print(dev.cod, HEX);
+      break;
+    case 3: // Long-term history
+      drawHistory(dev.id);
       break;
   }
 }
 
+// Prints e.g. "12x since 34h" for the device on the current row
+void drawHistory(const uint8_t id[6]) {
+  HistoryRecord rec;
+  if (!deviceHistory.lookup(id, rec)) {
+    lcd.print(deviceHistory.ready() ? "No history" : "History off");
+    return;
+  }
+  // The clock may still be behind a record from a synced boot
+  uint32_t now = historyClockMinutes();
+  uint32_t age = now > rec.firstSeen ? now - rec.firstSeen : 0;
+  char line[LCD_COLS + 1];
+  snprintf(line, sizeof(line), "%ux since %luh", rec.count, (unsigned long)(age / 60));
+  lcd.print(line);
+}
+
+void drawDiagnostics() {
+  // One page per latency stage, then one per channel the sniffer heard
+  uint8_t rfChannels[RF_CHANNELS];
+  int rfCount = 0;
+  RfSummary rf;
+  for (uint8_t ch = 1; ch <= RF_CHANNELS; ch++) {
+    if (snifferRfSummary(ch, rf)) rfChannels[rfCount++] = ch;
+  }
+  int totalPages = LAT_STAGE_COUNT + rfCount;
+  if (detailPage < 0) detailPage = totalPages - 1;
+  if (detailPage >= totalPages) detailPage = 0;
+  if (detailPage >= LAT_STAGE_COUNT) {
+    drawRf(rfChannels[detailPage - LAT_STAGE_COUNT]);
+    return;
+  }
+
+  const LatencyHistogram& h = latencyHistograms[detailPage];
+  lcd.setCursor(0, 0);
+  lcd.print(latencyStageName((LatencyStage)detailPage));
+  lcd.print(" n=");
+  lcd.print(h.count());
+
+  // p50/p99/p999 in milliseconds
+  char line[LCD_COLS + 1];
+  snprintf(line, sizeof(line), "%lu/%lu/%lums",
+           (unsigned long)(h.percentile(0.50) / 1000),
+           (unsigned long)(h.percentile(0.99) / 1000),
+           (unsigned long)(h.percentile(0.999) / 1000));
+  lcd.setCursor(0, 1);
+  lcd.print(line);
+}
+
+// Median noise floor and RSSI, then the PHY mix in percent
+void drawRf(uint8_t channel) {
+  RfSummary s = {};
+  snifferRfSummary(channel, s);
+  char line[LCD_COLS + 1];
+  lcd.setCursor(0, 0);
+  if (s.weight == 0) {
+    snprintf(line, sizeof(line), "ch%-2u quiet %lus", channel, (unsigned long)(s.ageMs / 1000));
+    lcd.print(line);
+    return;
+  }
+  if (s.noiseP50) snprintf(line, sizeof(line), "ch%-2u nf%4d r%4d", channel, s.noiseP50, s.rssiP50);
+  else snprintf(line, sizeof(line), "ch%-2u nf  -- r%4d", channel, s.rssiP50);
+  lcd.print(line);
+  // 11b, 11g, HT20, HT40 (w for wide); 100% shows as 99 to keep the columns
+  int pct[4];
+  for (int i = 0; i < 4; i++) pct[i] = s.mixPct[i] > 99 ? 99 : s.mixPct[i];
+  snprintf(line, sizeof(line), "b%2d g%2d n%2d w%2d", pct[0], pct[1], pct[2], pct[3]);
+  lcd.setCursor(0, 1);
+  lcd.print(line);
+}
+
+void drawPortal() {
+  // Page 0: where to connect, page 1: what was saved
+  if (detailPage < 0) detailPage = 1;
+  if (detailPage > 1) detailPage = 0;
+  char line[LCD_COLS + 1];
+  lcd.setCursor(0, 0);
+  if (detailPage == 0) {
+    lcd.print(portalSsid()[0] ? portalSsid() : "Portal (eth)");
+    lcd.setCursor(0, 1);
+    lcd.print(portalAddress());
+  } else {
+    Config c;
+    configStore.get(c);
+    snprintf(line, sizeof(line), "Scan %us %s", c.scanIntervalS, c.stream);
+    lcd.print(line);
+    lcd.setCursor(0, 1);
+    snprintf(line, sizeof(line), "Saved %u%s", configStore.commits(), configStore.dirty() ? " *" : "");
+    lcd.print(line);
+  }
+}
+
+// Name, smoothed dBm, trend arrow and sample rate over an 80-step bar.
+// Overwrites the previous frame instead of clearing, to keep up with 10 Hz
+void drawFollow() {
+  FollowView v = followTracker.view(millis());
+  followDrawRate.tick(millis());
+  char line[LCD_COLS + 1];
+  char rate[5];
+  if (v.stale) strlcpy(rate, v.valid ? "lost" : "wait", sizeof(rate));
+  else if (v.rateHz > 0) snprintf(rate, sizeof(rate), "%2.0fHz", v.rateHz);
+  else strlcpy(rate, "  Hz", sizeof(rate));   // first rate window still open
+  char dbm[6] = "  --";
+  if (v.valid) snprintf(dbm, sizeof(dbm), "%4d", (int)lroundf(v.dbm));
+  char arrow = v.trend == TREND_UP ? LCD_CHAR_UP : v.trend == TREND_DOWN ? LCD_CHAR_DOWN : '-';
+  snprintf(line, sizeof(line), "%-5.5s%s %c %s", followTarget.name, dbm, arrow, rate);
+  lcd.setCursor(0, 0);
+  lcd.print(line);
+
+  int level = v.valid ? FollowTracker::barLevel(v.dbm, LCD_COLS * 5) : 0;
+  for (int i = 0; i < LCD_COLS; i++) {
+    int cell = level - i * 5;
+    line[i] = cell >= 5 ? (char)0xFF : cell > 0 ? (char)cell : ' ';
+  }
+  line[LCD_COLS] = 0;
+  lcd.setCursor(0, 1);
+  lcd.print(line);
+}
+
 String getWifiSecurityString(wifi_auth_mode_t security) {
   switch (security) {
     case WIFI_AUTH_OPEN:
@@ -420,4 +1713,4 @@ String getWifiSecurityString(wifi_auth_mode_t security) {
     default:
       return "Unknown";
   }
-}
\ No newline at end of file
+}
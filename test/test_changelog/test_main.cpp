@@ -0,0 +1,185 @@
+// Delta sync against randomized update streams: a client that applies
+// every "changes since" batch (or a full snapshot when its cursor fell out
+// of the log) always ends up with the device table
+#include <unity.h>
+#include <stdlib.h>
+#include <map>
+#include <array>
+#include "ChangeLog.h"
+
+#define SYNC_LOG_SIZE 48
+#define SYNC_TABLE_MAX 24
+#define SYNC_ID_POOL 40
+#define SYNC_STEPS 20000
+
+struct Rec {
+  uint8_t id[6];
+  int rssi;
+  uint32_t seq;
+};
+
+struct Table {
+  typedef Rec Record;
+  Rec items[SYNC_TABLE_MAX];
+  int count;
+  uint32_t seq;
+};
+
+bool significantChange(const Rec& a, const Rec& b) {
+  return abs(a.rssi - b.rssi) >= 5;
+}
+
+typedef std::array<uint8_t, 6> Mac;
+
+// The exporter's client: a map of what it was told
+struct Client {
+  std::map<Mac, int> devices;
+  uint32_t upserts = 0;
+  uint32_t evicts = 0;
+
+  void upsert(const Rec& r) {
+    Mac m;
+    memcpy(m.data(), r.id, 6);
+    devices[m] = r.rssi;
+    upserts++;
+  }
+  void evict(uint32_t, const uint8_t id[6]) {
+    Mac m;
+    memcpy(m.data(), id, 6);
+    devices.erase(m);
+    evicts++;
+  }
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void makeId(int n, uint8_t id[6]) {
+  memset(id, 0, 6);
+  id[0] = 0xAA;
+  id[5] = n;
+}
+
+// One scan: some devices leave, some appear, some move. Moves are all
+// significant, so the client's copy must match exactly.
+static void rescan(const Table& prev, Table& next) {
+  next.count = 0;
+  for (int i = 0; i < prev.count; i++) {
+    if (rand() % 10 == 0) continue;
+    Rec r = prev.items[i];
+    if (rand() % 4 == 0) r.rssi += rand() % 2 ? 6 : -6;
+    next.items[next.count++] = r;
+  }
+  int arrivals = rand() % 4;
+  for (int k = 0; k < arrivals && next.count < SYNC_TABLE_MAX; k++) {
+    Rec r;
+    makeId(rand() % SYNC_ID_POOL, r.id);
+    if (findById(next, r.id) || findById(prev, r.id)) continue;
+    r.rssi = -40 - rand() % 50;
+    r.seq = 0;
+    next.items[next.count++] = r;
+  }
+}
+
+static void assertSameAsTable(const Client& c, const Table& t) {
+  TEST_ASSERT_EQUAL_INT(t.count, (int)c.devices.size());
+  for (int i = 0; i < t.count; i++) {
+    Mac m;
+    memcpy(m.data(), t.items[i].id, 6);
+    std::map<Mac, int>::const_iterator it = c.devices.find(m);
+    TEST_ASSERT_TRUE(it != c.devices.end());
+    TEST_ASSERT_EQUAL_INT(t.items[i].rssi, it->second);
+  }
+}
+
+static void test_randomized_stream() {
+  srand(78);
+  static ChangeLog<SYNC_LOG_SIZE> log;
+  static Table tables[2];
+  memset(tables, 0, sizeof(tables));
+  int cur = 0;
+
+  Client client;
+  uint32_t cursor = 0;
+  uint32_t deltas = 0, fulls = 0;
+  for (int step = 0; step < SYNC_STEPS; step++) {
+    Table& prev = tables[cur];
+    Table& next = tables[1 - cur];
+    rescan(prev, next);
+    stampChanges(prev, next, log);
+    cur = 1 - cur;
+
+    if (rand() % (1 + step % 19) != 0) continue;   // clients poll irregularly
+    const Table& t = tables[cur];
+    if (forEachChangeSince(log, t, cursor, client)) {
+      deltas++;
+    } else {
+      client.devices.clear();
+      for (int i = 0; i < t.count; i++) client.upsert(t.items[i]);
+      fulls++;
+    }
+    cursor = t.seq;
+    assertSameAsTable(client, t);
+  }
+  // Both paths were taken
+  TEST_ASSERT_TRUE(deltas > 100);
+  TEST_ASSERT_TRUE(fulls > 10);
+  TEST_ASSERT_TRUE(client.evicts > 0);
+}
+
+// Each entry carries the sequence number of its own last significant change
+static void test_entry_sequence_numbers() {
+  static ChangeLog<SYNC_LOG_SIZE> log;
+  Table a, b;
+  memset(&a, 0, sizeof(a));
+  memset(&b, 0, sizeof(b));
+  makeId(1, b.items[0].id);
+  b.items[0].rssi = -60;
+  makeId(2, b.items[1].id);
+  b.items[1].rssi = -70;
+  b.count = 2;
+  stampChanges(a, b, log);
+  TEST_ASSERT_EQUAL_UINT32(1, b.items[0].seq);
+  TEST_ASSERT_EQUAL_UINT32(2, b.items[1].seq);
+  TEST_ASSERT_EQUAL_UINT32(2, b.seq);
+
+  // Small drift keeps the seq, a big one and an eviction get new ones
+  a = b;
+  a.items[0].rssi = -62;
+  a.items[1].rssi = -50;
+  stampChanges(b, a, log);
+  TEST_ASSERT_EQUAL_UINT32(1, a.items[0].seq);
+  TEST_ASSERT_EQUAL_UINT32(3, a.items[1].seq);
+  b = a;
+  b.count = 1;
+  stampChanges(a, b, log);
+  TEST_ASSERT_EQUAL_UINT32(4, b.seq);
+
+  Client client;
+  TEST_ASSERT_TRUE(forEachChangeSince(log, b, 2, client));
+  TEST_ASSERT_EQUAL_UINT32(0, client.upserts);   // id 2 was updated, then evicted
+  TEST_ASSERT_EQUAL_UINT32(1, client.evicts);
+  // A cursor from the future (another boot) cannot be served
+  TEST_ASSERT_FALSE(forEachChangeSince(log, b, 9, client));
+}
+
+static void test_cursor_past_the_log() {
+  static ChangeLog<SYNC_LOG_SIZE> log;
+  uint8_t id[6];
+  makeId(1, id);
+  for (int i = 0; i < SYNC_LOG_SIZE * 2; i++) log.append(CHANGE_UPDATE, id);
+  Table t;
+  memset(&t, 0, sizeof(t));
+  t.seq = log.lastSeq();
+  Client client;
+  TEST_ASSERT_FALSE(forEachChangeSince(log, t, 1, client));
+  TEST_ASSERT_TRUE(forEachChangeSince(log, t, log.firstSeq() - 1, client));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_entry_sequence_numbers);
+  RUN_TEST(test_cursor_past_the_log);
+  RUN_TEST(test_randomized_stream);
+  return UNITY_END();
+}
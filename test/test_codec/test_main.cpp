@@ -0,0 +1,179 @@
+// ScanCodec: random record streams survive encode/decode byte for byte,
+// repetitive scans compress, and damaged blocks never read or write out
+// of bounds (run under a sanitizer to see the latter)
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "ScanCodec.h"
+
+#define FUZZ_RECORDS 50000
+#define FUZZ_MUTATIONS 20000
+#define MAC_POOL 100
+
+typedef std::vector<uint8_t> Bytes;
+
+static std::vector<Bytes> decoded;
+static uint8_t pool[MAC_POOL][6];
+static uint32_t clockMs;
+
+static void collect(void* ctx, const uint8_t* rec, size_t len) {
+  (void)ctx;
+  decoded.push_back(Bytes(rec, rec + len));
+}
+
+static void countOnly(void* ctx, const uint8_t* rec, size_t len) {
+  (void)rec;
+  *(size_t*)ctx += len;
+}
+
+void setUp() {
+  decoded.clear();
+  clockMs = 1000;
+  for (int i = 0; i < MAC_POOL; i++) {
+    for (int k = 0; k < 6; k++) pool[i][k] = rand();
+  }
+}
+
+void tearDown() {}
+
+static void header(Bytes& r, uint8_t type, size_t len) {
+  r.resize(len);
+  CaptureRecordHeader h;
+  h.len = len;
+  h.type = type;
+  h.reserved = rand() % 50 == 0 ? 1 : 0;   // not packable, goes raw
+  clockMs += rand() % 3 == 0 ? 0 : rand() % 2000;
+  if (rand() % 100 == 0) clockMs -= rand() % 500;   // out of order
+  h.timeMs = clockMs;
+  memcpy(r.data(), &h, sizeof(h));
+}
+
+static Bytes randomRecord() {
+  Bytes r;
+  int kind = rand() % 10;
+  if (kind < 6) {
+    header(r, CAPTURE_WIFI_SURVEY + rand() % 3, sizeof(SurveyRecord));
+    SurveyRecord* s = (SurveyRecord*)r.data();
+    memcpy(s->id, pool[rand() % MAC_POOL], 6);
+    s->rssi = -30 - rand() % 4;
+    s->extra = rand() % 3;
+  } else if (kind < 9) {
+    size_t capLen = rand() % 3 ? rand() % 40 : rand() % 300;
+    header(r, CAPTURE_WIFI_FRAME, sizeof(FrameRecord) + capLen);
+    FrameRecord* f = (FrameRecord*)r.data();
+    f->channel = 1 + rand() % 3;
+    f->rssi = -rand() % 90;
+    f->rate = rand() % 2 ? 11 : rand();
+    f->frameType = rand() % 3;
+    f->origLen = capLen + rand() % 1000;
+    f->reserved = rand() % 50 == 0 ? 7 : 0;
+    uint8_t* p = r.data() + sizeof(FrameRecord);
+    for (size_t i = 0; i < capLen; i++) p[i] = rand();
+    for (int a = 0; a < 3 && 4 + 6 * (a + 1) <= (int)capLen; a++) {
+      if (rand() % 4) memcpy(p + 4 + 6 * a, pool[rand() % MAC_POOL], 6);
+    }
+  } else {
+    size_t len = sizeof(CaptureRecordHeader) + rand() % 200;
+    header(r, rand() % 10, len);
+    for (size_t i = sizeof(CaptureRecordHeader); i < len; i++) r[i] = rand();
+  }
+  return r;
+}
+
+static void flushBlock(ScanEncoder& enc, ScanDecoder& dec, std::vector<Bytes>* blocks) {
+  const uint8_t* block;
+  size_t len = enc.finish(&block);
+  if (blocks) blocks->push_back(Bytes(block, block + len));
+  TEST_ASSERT_TRUE(dec.decode(block, len, collect, nullptr));
+}
+
+static void encodeAll(const std::vector<Bytes>& in, ScanEncoder& enc, std::vector<Bytes>* blocks) {
+  static ScanDecoder dec;
+  for (size_t i = 0; i < in.size(); i++) {
+    if (enc.add(in[i].data(), in[i].size())) continue;
+    flushBlock(enc, dec, blocks);
+    TEST_ASSERT_TRUE(enc.add(in[i].data(), in[i].size()));
+  }
+  if (!enc.empty()) flushBlock(enc, dec, blocks);
+}
+
+static void test_random_round_trip() {
+  srand(87);
+  std::vector<Bytes> in;
+  for (int i = 0; i < FUZZ_RECORDS; i++) in.push_back(randomRecord());
+  static ScanEncoder enc;
+  encodeAll(in, enc, nullptr);
+  TEST_ASSERT_EQUAL_size_t(in.size(), decoded.size());
+  for (size_t i = 0; i < in.size(); i++) {
+    TEST_ASSERT_EQUAL_size_t(in[i].size(), decoded[i].size());
+    TEST_ASSERT_EQUAL_MEMORY(in[i].data(), decoded[i].data(), in[i].size());
+  }
+}
+
+// Ten scans of the same forty devices with small RSSI changes: about 3
+// bytes a sighting, plus each block's first sight of every address (the
+// README quotes the ratio)
+static void test_repetitive_scans_compress() {
+  std::vector<Bytes> in;
+  for (int scan = 0; scan < 10; scan++) {
+    clockMs += 5000;
+    for (int d = 0; d < 40; d++) {
+      Bytes r(sizeof(SurveyRecord));
+      SurveyRecord* s = (SurveyRecord*)r.data();
+      s->hdr.len = sizeof(SurveyRecord);
+      s->hdr.type = CAPTURE_BLE_SURVEY;
+      s->hdr.reserved = 0;
+      s->hdr.timeMs = clockMs + d * 3;
+      memcpy(s->id, pool[d], 6);
+      s->rssi = -60 - d % 20 + (scan + d) % 3 - 1;
+      s->extra = -4;
+      in.push_back(r);
+    }
+  }
+  static ScanEncoder enc;
+  enc = ScanEncoder();
+  encodeAll(in, enc, nullptr);
+  char msg[80];
+  snprintf(msg, sizeof(msg), "%u -> %u bytes (%.1fx)", enc.rawBytes, enc.encodedBytes,
+           (double)enc.rawBytes / enc.encodedBytes);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(enc.encodedBytes * 33 < enc.rawBytes * 10);
+  TEST_ASSERT_EQUAL_size_t(in.size(), decoded.size());
+}
+
+// Damaged blocks: flipped bytes, cut short, garbage headers
+static void test_mutated_blocks() {
+  srand(870);
+  std::vector<Bytes> in;
+  for (int i = 0; i < 5000; i++) in.push_back(randomRecord());
+  std::vector<Bytes> blocks;
+  static ScanEncoder enc;
+  enc = ScanEncoder();
+  encodeAll(in, enc, &blocks);
+
+  static ScanDecoder dec;
+  size_t total = 0;
+  for (int i = 0; i < FUZZ_MUTATIONS; i++) {
+    Bytes b = blocks[rand() % blocks.size()];
+    int flips = 1 + rand() % 4;
+    for (int k = 0; k < flips; k++) b[rand() % b.size()] ^= 1 << (rand() % 8);
+    if (rand() % 4 == 0) b.resize(rand() % b.size());
+    // The header's own length is trusted as little as the rest
+    dec.decode(b.data(), b.size(), countOnly, &total);
+  }
+  for (int i = 0; i < 1000; i++) {
+    Bytes b(rand() % 2000);
+    for (size_t k = 0; k < b.size(); k++) b[k] = rand();
+    dec.decode(b.data(), b.size(), countOnly, &total);
+  }
+  TEST_ASSERT_TRUE(total > 0);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_random_round_trip);
+  RUN_TEST(test_repetitive_scans_compress);
+  RUN_TEST(test_mutated_blocks);
+  return UNITY_END();
+}
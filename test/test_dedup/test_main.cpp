@@ -0,0 +1,186 @@
+// Frame dedup under synthetic retry storms: every original passes once and
+// every retransmission or cross-channel copy is caught, however many
+// senders interleave; sequence numbers and the millisecond clock wrap
+// without false drops; and the cost per frame, benchmarked
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "FrameDedup.h"
+
+#define STORM_SENDERS 40
+#define STORM_FRAMES 20000
+#define STORM_RETRY_PERCENT 30
+#define STORM_MAX_RETRIES 7
+#define BENCH_FRAMES 2000000
+
+static FrameDedup* dedup;
+
+void setUp() {
+  dedup = new FrameDedup();
+}
+
+void tearDown() {
+  delete dedup;
+}
+
+// A QoS data frame from `sender`, or a beacon; 4 addresses puts the QoS
+// control field at 30
+static size_t frame(uint8_t* out, uint32_t sender, uint16_t seq, uint8_t frag, bool retry,
+                    bool qos = true, uint8_t tid = 0, bool fourAddr = false) {
+  memset(out, 0, 40);
+  out[0] = qos ? 0x88 : 0x80;
+  out[1] = (retry ? 0x08 : 0) | (fourAddr ? 0x03 : 0x01);
+  out[10] = 0x02;
+  memcpy(out + 12, &sender, 4);
+  out[22] = (seq << 4 | (frag & 0x0F)) & 0xFF;
+  out[23] = (seq << 4) >> 8;
+  size_t at = fourAddr ? 30 : 24;
+  if (!qos) return at;
+  out[at] = tid;
+  return at + 2;
+}
+
+// Senders interleaved at random; each frame is retried up to seven times a
+// few ms apart, some of them heard again on the next channel
+static void test_retry_storm() {
+  uint16_t seq[STORM_SENDERS] = {};
+  srand(11);
+  uint8_t f[40];
+  uint32_t now = 0, originals = 0, retries = 0, copies = 0;
+  for (int i = 0; i < STORM_FRAMES; i++) {
+    uint32_t s = rand() % STORM_SENDERS;
+    seq[s] = (seq[s] + 1) & 0xFFF;
+    size_t len = frame(f, s, seq[s], 0, false, true, s % 8);
+    TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, len, now));
+    originals++;
+    if (rand() % 100 < STORM_RETRY_PERCENT) {
+      int n = 1 + rand() % STORM_MAX_RETRIES;
+      for (int r = 0; r < n; r++) {
+        now += 1 + rand() % 3;
+        frame(f, s, seq[s], 0, true, true, s % 8);
+        TEST_ASSERT_EQUAL(DEDUP_RETRY, dedup->check(f, len, now));
+        retries++;
+      }
+    }
+    if (rand() % 100 < 5) {
+      frame(f, s, seq[s], 0, false, true, s % 8);
+      TEST_ASSERT_EQUAL(DEDUP_DUPLICATE, dedup->check(f, len, now + 20));
+      copies++;
+    }
+    now += rand() % 2;
+  }
+  const DedupStats& st = dedup->stats();
+  TEST_ASSERT_EQUAL_UINT32(originals + retries + copies, st.frames);
+  TEST_ASSERT_EQUAL_UINT32(originals, st.passed);
+  TEST_ASSERT_EQUAL_UINT32(retries, st.retries);
+  TEST_ASSERT_EQUAL_UINT32(copies, st.duplicates);
+  TEST_ASSERT_EQUAL_UINT32(0, st.lateRetries);
+  char msg[120];
+  snprintf(msg, sizeof(msg), "%u frames from %d senders: %u passed, %u retries, %u copies dropped, %u evictions",
+           st.frames, STORM_SENDERS, st.passed, st.retries, st.duplicates, st.evictions);
+  TEST_MESSAGE(msg);
+}
+
+// Retries spaced wider than the window still match while the storm lasts;
+// a retry whose original was missed passes and is counted
+static void test_long_storm_and_late_retry() {
+  uint8_t f[40];
+  size_t len = frame(f, 1, 100, 0, false);
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, len, 0));
+  frame(f, 1, 100, 0, true);
+  for (uint32_t t = 60; t < 1000; t += 60) TEST_ASSERT_EQUAL(DEDUP_RETRY, dedup->check(f, len, t));
+  // Quiet for a window: the key is gone
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, len, 960 + DEDUP_WINDOW_MS));
+  TEST_ASSERT_EQUAL_UINT32(1, dedup->stats().lateRetries);
+
+  // Fragments, TIDs and senders are sequence spaces of their own
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, frame(f, 2, 7, 0, false), 2000));
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, frame(f, 2, 7, 1, false), 2000));
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, frame(f, 2, 7, 0, false, true, 5), 2000));
+  // TID read after addr4 in a 4-address frame
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, frame(f, 2, 7, 0, false, true, 6, true), 2000));
+  TEST_ASSERT_EQUAL(DEDUP_RETRY, dedup->check(f, frame(f, 2, 7, 0, true, true, 6, true), 2001));
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, frame(f, 3, 7, 0, false), 2000));
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, frame(f, 2, 7, 0, false, false), 2000));
+
+  // Control frames and runts always pass
+  uint8_t ack[10] = {0xD4, 0x08};
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(ack, sizeof(ack), 2000));
+  TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(ack, sizeof(ack), 2000));
+}
+
+// A busy sender runs through its 12 bit sequence space several times:
+// each number comes round again long after its key expired, so every
+// frame passes; so does the millisecond clock rolling over
+static void test_sequence_and_clock_wraparound() {
+  uint8_t f[40];
+  uint32_t now = 0xFFFFFFFF - 3000;
+  for (int i = 0; i < 3 * 4096 + 10; i++) {
+    size_t len = frame(f, 9, i & 0xFFF, 0, false);
+    TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, len, now));
+    frame(f, 9, i & 0xFFF, 0, true);
+    TEST_ASSERT_EQUAL(DEDUP_RETRY, dedup->check(f, len, now + 1));
+    now += 2;   // 500 frames/s, wrapping every 8 s
+  }
+  const DedupStats& st = dedup->stats();
+  TEST_ASSERT_EQUAL_UINT32(3 * 4096 + 10, st.passed);
+  TEST_ASSERT_EQUAL_UINT32(3 * 4096 + 10, st.retries);
+  TEST_ASSERT_EQUAL_UINT32(0, st.duplicates);
+
+  // More live keys than ways: the oldest go, but nothing new is dropped
+  dedup->clear();
+  for (uint32_t s = 0; s < 4 * DEDUP_BUCKETS * DEDUP_WAYS; s++) {
+    TEST_ASSERT_EQUAL(DEDUP_NEW, dedup->check(f, frame(f, s, 1, 0, false), 5));
+  }
+  TEST_ASSERT_TRUE(dedup->stats().evictions >= 3 * DEDUP_BUCKETS * DEDUP_WAYS);
+}
+
+// --- Cost per frame: a storm mix, and every frame new with full buckets ---
+
+static double bench(bool storm, uint32_t* passed) {
+  static uint8_t frames[1024][40];
+  static uint8_t lens[1024];
+  srand(5);
+  uint16_t seq[STORM_SENDERS] = {};
+  for (int i = 0; i < 1024; i++) {
+    uint32_t s = storm ? rand() % STORM_SENDERS : i;
+    bool retry = storm && i > 0 && rand() % 100 < STORM_RETRY_PERCENT;
+    if (!retry) seq[s % STORM_SENDERS] = (seq[s % STORM_SENDERS] + 1) & 0xFFF;
+    if (retry) memcpy(frames[i], frames[i - 1], 40), frames[i][1] |= 0x08, lens[i] = lens[i - 1];
+    else lens[i] = frame(frames[i], s, seq[s % STORM_SENDERS], 0, false);
+  }
+  dedup->clear();
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+    uint8_t* f = frames[i % 1024];
+    if (!storm) memcpy(f + 12, &i, 4);   // a new transmitter every frame
+    dedup->check(f, lens[i % 1024], i / 1000);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  *passed = dedup->stats().passed;
+  return ns / BENCH_FRAMES;
+}
+
+static void test_benchmark() {
+  uint32_t stormPassed, newPassed;
+  double storm = bench(true, &stormPassed);
+  double allNew = bench(false, &newPassed);
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%.1f ns/frame in a retry storm (%u of %d passed), %.1f ns/frame all new with full buckets; %u bytes",
+           storm, stormPassed, BENCH_FRAMES, allNew, (unsigned)sizeof(FrameDedup));
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL_UINT32(BENCH_FRAMES, newPassed);
+  // O(1): the worst case costs no more than a few times the common one
+  TEST_ASSERT_TRUE(allNew < 5 * storm + 50);
+  TEST_ASSERT_TRUE(storm < 1000);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_retry_storm);
+  RUN_TEST(test_long_storm_and_late_retry);
+  RUN_TEST(test_sequence_and_clock_wraparound);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,182 @@
+// Delta patches applied through the host file stand-in: a patch built the
+// way tools/mkdelta.py lays it out turns the old image into the new one,
+// and damaged patches are rejected
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include "DeltaPatch.h"
+
+#define OLD_FILE "delta_old.bin"
+#define PATCH_FILE "delta_patch.bin"
+#define OUT_FILE "delta_out.bin"
+#define IMAGE_BYTES 50000
+
+static std::vector<uint8_t> oldImage, newImage, patch;
+
+static void put32(std::vector<uint8_t>& v, uint32_t x) {
+  for (int i = 0; i < 4; i++) v.push_back(x >> (8 * i));
+}
+
+static void writeFile(const char* path, const std::vector<uint8_t>& data) {
+  FILE* f = fopen(path, "wb");
+  TEST_ASSERT_NOT_NULL(f);
+  TEST_ASSERT_EQUAL_size_t(data.size(), fwrite(data.data(), 1, data.size(), f));
+  fclose(f);
+}
+
+static std::vector<uint8_t> readFile(const char* path) {
+  std::vector<uint8_t> data;
+  FILE* f = fopen(path, "rb");
+  if (!f) return data;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+  fclose(f);
+  return data;
+}
+
+static void header(std::vector<uint8_t>& p, uint32_t oldSize, uint32_t newSize) {
+  DeltaHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, DELTA_MAGIC, 4);
+  h.oldSize = oldSize;
+  h.newSize = newSize;
+  p.insert(p.end(), (uint8_t*)&h, (uint8_t*)&h + sizeof(h));
+}
+
+static void copyOp(uint32_t offset, uint32_t len) {
+  patch.push_back(DELTA_OP_COPY);
+  put32(patch, offset);
+  put32(patch, len);
+  newImage.insert(newImage.end(), oldImage.begin() + offset, oldImage.begin() + offset + len);
+}
+
+static void addOp(uint32_t len) {
+  patch.push_back(DELTA_OP_ADD);
+  put32(patch, len);
+  for (uint32_t i = 0; i < len; i++) {
+    uint8_t b = rand();
+    patch.push_back(b);
+    newImage.push_back(b);
+  }
+}
+
+// A new build: moved blocks, rewritten ones and a longer tail. Copies
+// larger than DELTA_WINDOW and ones crossing it both occur.
+static void makePatch() {
+  srand(86);
+  oldImage.resize(IMAGE_BYTES);
+  for (size_t i = 0; i < oldImage.size(); i++) oldImage[i] = rand();
+  newImage.clear();
+  patch.clear();
+  copyOp(0, 10000);
+  addOp(300);
+  copyOp(20000, 9000);
+  copyOp(10000, 5);
+  addOp(1);
+  copyOp(40000, 10000);
+  addOp(DELTA_WINDOW + 17);
+  patch.push_back(DELTA_OP_END);
+  std::vector<uint8_t> full;
+  header(full, oldImage.size(), newImage.size());
+  full.insert(full.end(), patch.begin(), patch.end());
+  patch.swap(full);
+  writeFile(OLD_FILE, oldImage);
+}
+
+void setUp() {
+  makePatch();
+}
+
+void tearDown() {
+  unlink(OLD_FILE);
+  unlink(PATCH_FILE);
+  unlink(OUT_FILE);
+}
+
+static void test_round_trip() {
+  writeFile(PATCH_FILE, patch);
+  const char* error = "unset";
+  TEST_ASSERT_TRUE(applyPatchFiles(OLD_FILE, PATCH_FILE, OUT_FILE, &error));
+  TEST_ASSERT_NULL(error);
+  std::vector<uint8_t> out = readFile(OUT_FILE);
+  TEST_ASSERT_EQUAL_size_t(newImage.size(), out.size());
+  TEST_ASSERT_EQUAL_MEMORY(newImage.data(), out.data(), out.size());
+}
+
+// Fed a byte at a time, every op straddles a feed
+static void test_byte_at_a_time() {
+  struct MemSource : PatchSource {
+    bool read(uint32_t offset, uint8_t* dst, size_t len) override {
+      memcpy(dst, oldImage.data() + offset, len);
+      return true;
+    }
+  } source;
+  struct MemSink : PatchSink {
+    std::vector<uint8_t> out;
+    bool begin(const DeltaHeader&) override { return true; }
+    bool write(const uint8_t* data, size_t len) override {
+      out.insert(out.end(), data, data + len);
+      return true;
+    }
+  } sink;
+  DeltaPatcher* patcher = new DeltaPatcher(source, sink);
+  for (size_t i = 0; i < patch.size(); i++) {
+    DeltaPatcher::Status s = patcher->feed(&patch[i], 1);
+    TEST_ASSERT_TRUE(s == (i + 1 == patch.size() ? DeltaPatcher::PATCH_DONE : DeltaPatcher::PATCH_MORE));
+  }
+  TEST_ASSERT_EQUAL_UINT32(newImage.size(), patcher->written());
+  TEST_ASSERT_EQUAL_MEMORY(newImage.data(), sink.out.data(), newImage.size());
+  delete patcher;
+}
+
+static void test_truncated_patch() {
+  patch.resize(patch.size() - 100);
+  writeFile(PATCH_FILE, patch);
+  const char* error = nullptr;
+  TEST_ASSERT_FALSE(applyPatchFiles(OLD_FILE, PATCH_FILE, OUT_FILE, &error));
+  TEST_ASSERT_EQUAL_STRING("truncated patch", error);
+}
+
+static void test_wrong_base() {
+  oldImage.resize(IMAGE_BYTES - 1);
+  writeFile(OLD_FILE, oldImage);
+  writeFile(PATCH_FILE, patch);
+  const char* error = nullptr;
+  TEST_ASSERT_FALSE(applyPatchFiles(OLD_FILE, PATCH_FILE, OUT_FILE, &error));
+  TEST_ASSERT_EQUAL_STRING("rejected by target", error);
+}
+
+static void test_copy_outside_old_image() {
+  std::vector<uint8_t> bad;
+  header(bad, IMAGE_BYTES, 100);
+  bad.push_back(DELTA_OP_COPY);
+  put32(bad, IMAGE_BYTES - 50);
+  put32(bad, 100);
+  bad.push_back(DELTA_OP_END);
+  writeFile(PATCH_FILE, bad);
+  const char* error = nullptr;
+  TEST_ASSERT_FALSE(applyPatchFiles(OLD_FILE, PATCH_FILE, OUT_FILE, &error));
+  TEST_ASSERT_EQUAL_STRING("copy outside old image", error);
+}
+
+static void test_trailing_data() {
+  patch.push_back(0);
+  writeFile(PATCH_FILE, patch);
+  const char* error = nullptr;
+  TEST_ASSERT_FALSE(applyPatchFiles(OLD_FILE, PATCH_FILE, OUT_FILE, &error));
+  TEST_ASSERT_EQUAL_STRING("trailing data", error);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_byte_at_a_time);
+  RUN_TEST(test_truncated_patch);
+  RUN_TEST(test_wrong_base);
+  RUN_TEST(test_copy_outside_old_image);
+  RUN_TEST(test_trailing_data);
+  return UNITY_END();
+}
@@ -0,0 +1,232 @@
+// Service cache TTLs and the discovery schedule, then collector
+// registration end to end: a responder on a loopback multicast group
+// answers browses the way the fleet's mDNS services do, and the node side
+// caches the answers and follows the live collector as they come and go
+#include <unity.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "ServiceCache.h"
+
+#define MDNS_TEST_GROUP "239.255.77.77"
+#define MDNS_TEST_PORT 53535
+#define BROWSE_WAIT_MS 200
+#define RETRY_MS 15000
+
+void setUp() {}
+void tearDown() {}
+
+static void test_ttl_expiry_and_refresh() {
+  ServiceCache cache;
+  ServiceEntry e;
+  cache.update("c1", 0x0100007F, 5005, ROLE_COLLECTOR, 10, 1000);
+  TEST_ASSERT_TRUE(cache.find(ROLE_COLLECTOR, 10999, e));
+  TEST_ASSERT_FALSE(cache.find(ROLE_COLLECTOR, 11000, e));
+  TEST_ASSERT_FALSE(cache.find(ROLE_NODE, 1000, e));
+
+  // Half the TTL in, a browse is due; an answer pushes both out again
+  TEST_ASSERT_FALSE(cache.needsRefresh(ROLE_COLLECTOR, 5999));
+  TEST_ASSERT_TRUE(cache.needsRefresh(ROLE_COLLECTOR, 6000));
+  cache.update("c1", 0x0100007F, 5006, ROLE_COLLECTOR, 10, 6000);
+  TEST_ASSERT_FALSE(cache.needsRefresh(ROLE_COLLECTOR, 6000));
+  TEST_ASSERT_TRUE(cache.find(ROLE_COLLECTOR, 15999, e));
+  TEST_ASSERT_EQUAL_UINT16(5006, e.port);
+
+  // Goodbye
+  cache.update("c1", 0, 0, ROLE_COLLECTOR, 0, 7000);
+  TEST_ASSERT_FALSE(cache.find(ROLE_COLLECTOR, 7000, e));
+  TEST_ASSERT_TRUE(cache.needsRefresh(ROLE_COLLECTOR, 7000));
+}
+
+static void test_full_cache_evicts_soonest_expiry() {
+  ServiceCache cache;
+  char name[16];
+  for (int i = 0; i < SERVICE_CACHE_SIZE; i++) {
+    snprintf(name, sizeof(name), "n%d", i);
+    cache.update(name, i, 1, ROLE_NODE, 100 + i, 0);
+  }
+  cache.update("c", 9, 2, ROLE_COLLECTOR, 10, 0);
+  ServiceEntry all[SERVICE_CACHE_SIZE];
+  TEST_ASSERT_EQUAL_INT(SERVICE_CACHE_SIZE, cache.snapshot(all, SERVICE_CACHE_SIZE, 0));
+  for (int i = 0; i < SERVICE_CACHE_SIZE; i++) TEST_ASSERT_TRUE(strcmp(all[i].instance, "n0") != 0);
+  // The expired collector makes room before any live node
+  cache.update("late", 10, 3, ROLE_NODE, 50, 20000);
+  TEST_ASSERT_EQUAL_INT(SERVICE_CACHE_SIZE, cache.snapshot(all, SERVICE_CACHE_SIZE, 20000));
+  ServiceEntry e;
+  TEST_ASSERT_FALSE(cache.find(ROLE_COLLECTOR, 20000, e));
+}
+
+static void test_schedule_retries_while_nothing_answers() {
+  ServiceCache cache;
+  DiscoverySchedule schedule(RETRY_MS);
+  TEST_ASSERT_TRUE(schedule.due(cache, 0));
+  TEST_ASSERT_FALSE(schedule.due(cache, RETRY_MS - 1));
+  TEST_ASSERT_TRUE(schedule.due(cache, RETRY_MS));
+  // A live collector holds off browses until half its TTL
+  cache.update("c1", 1, 1, ROLE_COLLECTOR, 120, RETRY_MS);
+  TEST_ASSERT_FALSE(schedule.due(cache, 3 * RETRY_MS));
+  TEST_ASSERT_TRUE(schedule.due(cache, RETRY_MS + 60000));
+  TEST_ASSERT_EQUAL(ROLE_COLLECTOR, serviceRole("collector"));
+  TEST_ASSERT_EQUAL(ROLE_NODE, serviceRole("node"));
+  TEST_ASSERT_EQUAL(ROLE_NODE, serviceRole(nullptr));
+}
+
+// --- Loopback multicast responder ---
+// Answers every "_wscan._udp" query datagram on the group with one
+// "instance role port ttl" line per service it advertises
+
+struct Advert {
+  char instance[SERVICE_NAME_LEN];
+  char role[12];
+  uint16_t port;
+  uint32_t ttl;
+};
+
+static std::mutex advertLock;
+static Advert adverts[4];
+static int advertCount;
+static std::atomic<int> queriesSeen(0);
+
+static void advertise(int n, const Advert* list) {
+  std::lock_guard<std::mutex> guard(advertLock);
+  memcpy(adverts, list, n * sizeof(Advert));
+  advertCount = n;
+}
+
+static int groupSocket() {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(MDNS_TEST_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) return -1;
+  ip_mreq mreq;
+  mreq.imr_multiaddr.s_addr = inet_addr(MDNS_TEST_GROUP);
+  mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+  if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) return -1;
+  return fd;
+}
+
+static void responder(int fd, std::atomic<bool>* stop) {
+  char buf[256];
+  while (!*stop) {
+    pollfd p = {fd, POLLIN, 0};
+    if (poll(&p, 1, 20) <= 0) continue;
+    sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t n = recvfrom(fd, buf, sizeof(buf) - 1, 0, (sockaddr*)&from, &fromLen);
+    if (n <= 0) continue;
+    buf[n] = 0;
+    if (strcmp(buf, "_wscan._udp") != 0) continue;
+    queriesSeen++;
+    std::lock_guard<std::mutex> guard(advertLock);
+    for (int i = 0; i < advertCount; i++) {
+      int len = snprintf(buf, sizeof(buf), "%s %s %u %u", adverts[i].instance, adverts[i].role,
+                         adverts[i].port, adverts[i].ttl);
+      sendto(fd, buf, len, 0, (sockaddr*)&from, fromLen);
+    }
+  }
+}
+
+// The node side of one browse, as queryServices() does it on the device:
+// every answer goes into the cache under the address it came from
+static int browse(ServiceCache& cache, uint32_t nowMs) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  in_addr lo;
+  lo.s_addr = htonl(INADDR_LOOPBACK);
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &lo, sizeof(lo));
+  unsigned char loop = 1;
+  setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  sockaddr_in group = {};
+  group.sin_family = AF_INET;
+  group.sin_port = htons(MDNS_TEST_PORT);
+  group.sin_addr.s_addr = inet_addr(MDNS_TEST_GROUP);
+  sendto(fd, "_wscan._udp", 11, 0, (sockaddr*)&group, sizeof(group));
+
+  int answers = 0;
+  char buf[256];
+  pollfd p = {fd, POLLIN, 0};
+  while (poll(&p, 1, BROWSE_WAIT_MS) > 0) {
+    sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t n = recvfrom(fd, buf, sizeof(buf) - 1, 0, (sockaddr*)&from, &fromLen);
+    if (n <= 0) break;
+    buf[n] = 0;
+    char instance[SERVICE_NAME_LEN], role[12];
+    unsigned port, ttl;
+    if (sscanf(buf, "%31s %11s %u %u", instance, role, &port, &ttl) != 4) continue;
+    cache.update(instance, from.sin_addr.s_addr, port, serviceRole(role), ttl, nowMs);
+    answers++;
+  }
+  close(fd);
+  return answers;
+}
+
+// One pass of the discovery task: browse when due, then the collector to
+// export to (port 0 for none)
+static uint16_t discoveryStep(ServiceCache& cache, DiscoverySchedule& schedule, uint32_t nowMs) {
+  if (schedule.due(cache, nowMs)) browse(cache, nowMs);
+  ServiceEntry e;
+  if (!cache.find(ROLE_COLLECTOR, nowMs, e)) return 0;
+  TEST_ASSERT_EQUAL_HEX32(htonl(INADDR_LOOPBACK), e.ip);
+  return e.port;
+}
+
+static void test_collector_registration_over_multicast() {
+  int fd = groupSocket();
+  TEST_ASSERT_TRUE_MESSAGE(fd >= 0, "no multicast on loopback");
+  std::atomic<bool> stop(false);
+  std::thread t(responder, fd, &stop);
+
+  const Advert fleet[2] = {{"node-a", "node", 5006, 120}, {"col-1", "collector", 5005, 40}};
+  advertise(2, fleet);
+  ServiceCache cache;
+  DiscoverySchedule schedule(RETRY_MS);
+  uint32_t now = 0;
+  TEST_ASSERT_EQUAL_UINT16(5005, discoveryStep(cache, schedule, now));
+  ServiceEntry e;
+  TEST_ASSERT_TRUE(cache.find(ROLE_NODE, now, e));
+  TEST_ASSERT_EQUAL_STRING("node-a", e.instance);
+  TEST_ASSERT_EQUAL_INT(1, queriesSeen.load());
+
+  // Every 5 s, as the task runs: no browse until half the TTL (20 s)
+  for (now = 5000; now < 20000; now += 5000) discoveryStep(cache, schedule, now);
+  TEST_ASSERT_EQUAL_INT(1, queriesSeen.load());
+  TEST_ASSERT_EQUAL_UINT16(5005, discoveryStep(cache, schedule, now));
+  TEST_ASSERT_EQUAL_INT(2, queriesSeen.load());
+
+  // The collector goes away: its entry runs out, browses go on at the
+  // retry interval, and a new collector is picked up on the next one
+  const Advert alone[1] = {{"node-a", "node", 5006, 120}};
+  advertise(1, alone);
+  uint16_t port = 5005;
+  for (now += 5000; port != 0; now += 5000) port = discoveryStep(cache, schedule, now);
+  TEST_ASSERT_TRUE(now <= 20000 + 40000 + 5000);
+  int before = queriesSeen.load();
+  const Advert moved[2] = {{"node-a", "node", 5006, 120}, {"col-2", "collector", 6005, 20}};
+  advertise(2, moved);
+  for (int i = 0; i < 3 && port == 0; i++, now += 5000) port = discoveryStep(cache, schedule, now);
+  TEST_ASSERT_EQUAL_UINT16(6005, port);
+  TEST_ASSERT_EQUAL_INT(before + 1, queriesSeen.load());
+
+  stop = true;
+  t.join();
+  close(fd);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ttl_expiry_and_refresh);
+  RUN_TEST(test_full_cache_evicts_soonest_expiry);
+  RUN_TEST(test_schedule_retries_while_nothing_answers);
+  RUN_TEST(test_collector_registration_over_multicast);
+  return UNITY_END();
+}
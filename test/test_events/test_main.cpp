@@ -0,0 +1,245 @@
+// WiFi event dispatch: events are copied by value when posted, reach only
+// the handlers of their ID, and a full queue drops rather than blocks.
+// The benchmark runs the event source and the dispatch task as threads,
+// against a model of the core's path over the same bounded queue (a
+// malloc'd event per post, the handler list copied entry by entry on
+// every dispatch).
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <thread>
+#include <vector>
+#include "WiFiEvents.h"
+
+#define BENCH_EVENTS 200000
+#define BENCH_OTHER_HANDLERS 6   // registered for other events, walked anyway
+#define EVT_SCAN_DONE 1
+#define EVT_GOT_IP 7
+
+static std::atomic<uint32_t> allocations(0);
+
+void* operator new(size_t n) {
+  allocations++;
+  void* p = malloc(n);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+static int scanDone;
+static int gotIp;
+static uint32_t lastAtUs;
+static uint8_t lastByte;
+
+static void onScanDone(const WiFiEventMsg& e) {
+  scanDone++;
+  lastAtUs = e.atUs;
+  lastByte = e.info.bytes[0];
+}
+
+static void onGotIp(const WiFiEventMsg&) { gotIp++; }
+
+void setUp() {
+  scanDone = gotIp = 0;
+}
+
+void tearDown() {}
+
+static void test_dispatch_by_id_and_value() {
+  WiFiEvents* ev = new WiFiEvents();
+  TEST_ASSERT_TRUE(ev->on(EVT_SCAN_DONE, onScanDone));
+  TEST_ASSERT_TRUE(ev->on(EVT_GOT_IP, onGotIp));
+  TEST_ASSERT_TRUE(ev->on(EVT_GOT_IP, onGotIp));
+  TEST_ASSERT_FALSE(ev->on(WIFI_EVENT_IDS, onGotIp));
+
+  // The source's buffer is reused as soon as post() returns
+  WiFiEventInfo info = {};
+  info.bytes[0] = 0x11;
+  TEST_ASSERT_TRUE(ev->post(EVT_SCAN_DONE, info, 1234));
+  info.bytes[0] = 0x22;
+  TEST_ASSERT_TRUE(ev->post(EVT_GOT_IP, info, 1235));
+  TEST_ASSERT_TRUE(ev->post(3, info, 1236));   // nobody listens
+
+  TEST_ASSERT_TRUE(ev->dispatchNext(0));
+  TEST_ASSERT_EQUAL_INT(1, scanDone);
+  TEST_ASSERT_EQUAL_UINT32(1234, lastAtUs);
+  TEST_ASSERT_EQUAL_HEX8(0x11, lastByte);
+  TEST_ASSERT_TRUE(ev->dispatchNext(0));
+  TEST_ASSERT_EQUAL_INT(2, gotIp);
+  TEST_ASSERT_TRUE(ev->dispatchNext(0));
+  TEST_ASSERT_FALSE(ev->dispatchNext(10));
+  TEST_ASSERT_EQUAL_INT(1, scanDone);
+  delete ev;
+}
+
+static void test_full_table_and_queue() {
+  WiFiEvents* ev = new WiFiEvents();
+  for (int i = 0; i < WIFI_EVENT_HANDLERS; i++) TEST_ASSERT_TRUE(ev->on(EVT_SCAN_DONE, onScanDone));
+  TEST_ASSERT_FALSE(ev->on(EVT_SCAN_DONE, onScanDone));
+
+  WiFiEventInfo info = {};
+  for (int i = 0; i < WIFI_EVENT_QUEUE; i++) TEST_ASSERT_TRUE(ev->post(EVT_SCAN_DONE, info, i));
+  TEST_ASSERT_FALSE(ev->post(EVT_SCAN_DONE, info, 99));
+  TEST_ASSERT_EQUAL_UINT32(1, ev->dropped());
+  while (ev->dispatchNext(0)) {}
+  TEST_ASSERT_EQUAL_INT(WIFI_EVENT_QUEUE * WIFI_EVENT_HANDLERS, scanDone);
+  TEST_ASSERT_EQUAL_UINT32(WIFI_EVENT_QUEUE - 1, lastAtUs);
+  delete ev;
+}
+
+// --- The core's path, as WiFiGeneric.cpp does it ---
+
+struct CoreEvent {
+  int32_t id;
+  WiFiEventInfo info;
+};
+
+struct CoreEntry {
+  std::function<void(int32_t, const WiFiEventInfo&)> cb;
+  int32_t id;
+};
+
+class CorePath {
+public:
+  std::vector<CoreEntry> list;
+
+  bool post(int32_t id, const WiFiEventInfo& info) {
+    CoreEvent* e = (CoreEvent*)malloc(sizeof(CoreEvent));
+    e->id = id;
+    e->info = info;
+    bool wasEmpty;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (head - tail == WIFI_EVENT_QUEUE) {
+        free(e);
+        return false;
+      }
+      wasEmpty = head == tail;
+      pending[head++ % WIFI_EVENT_QUEUE] = e;
+    }
+    if (wasEmpty) ready.notify_one();
+    return true;
+  }
+
+  void dispatchNext() {
+    CoreEvent* e;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      ready.wait(guard, [this] { return head != tail; });
+      e = pending[tail++ % WIFI_EVENT_QUEUE];
+    }
+    for (size_t i = 0; i < list.size(); i++) {
+      CoreEntry entry = list[i];
+      if (entry.id == e->id) entry.cb(e->id, e->info);
+    }
+    free(e);
+  }
+
+private:
+  std::mutex lock;
+  std::condition_variable ready;
+  CoreEvent* pending[WIFI_EVENT_QUEUE];
+  uint32_t head = 0;
+  uint32_t tail = 0;
+};
+
+struct Bench {
+  double nsPerEvent;       // source and dispatch task on their own threads
+  double dispatchNs;       // post and dispatch back to back on one thread
+  uint32_t allocations;    // over the threaded run
+};
+
+static double since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() * 1e9 / BENCH_EVENTS;
+}
+
+static Bench benchTable() {
+  WiFiEvents* ev = new WiFiEvents();
+  for (int i = 0; i < BENCH_OTHER_HANDLERS; i++) ev->on(EVT_GOT_IP + 1 + i, onGotIp);
+  ev->on(EVT_SCAN_DONE, onScanDone);
+  WiFiEventInfo info = {};
+  uint32_t before = allocations;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  std::thread consumer([ev] {
+    for (int i = 0; i < BENCH_EVENTS; i++) ev->dispatchNext(1000);
+  });
+  for (int i = 0; i < BENCH_EVENTS; i++) {
+    while (!ev->post(EVT_SCAN_DONE, info, i)) std::this_thread::yield();
+  }
+  consumer.join();
+  double ns = since(t0);
+  // The consumer thread's own start-up is not the dispatch path
+  uint32_t extra = allocations - before;
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_EVENTS; i++) {
+    ev->post(EVT_SCAN_DONE, info, i);
+    ev->dispatchNext(0);
+  }
+  double dispatchNs = since(t0);
+  delete ev;
+  return {ns, dispatchNs, extra};
+}
+
+static Bench benchCore() {
+  CorePath* core = new CorePath();
+  for (int i = 0; i < BENCH_OTHER_HANDLERS; i++) {
+    core->list.push_back({[](int32_t, const WiFiEventInfo&) { gotIp++; }, EVT_GOT_IP + 1 + i});
+  }
+  WiFiEventMsg m = {};
+  core->list.push_back({[m](int32_t, const WiFiEventInfo&) { onScanDone(m); }, EVT_SCAN_DONE});
+  WiFiEventInfo info = {};
+  uint32_t before = allocations;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  std::thread consumer([core] {
+    for (int i = 0; i < BENCH_EVENTS; i++) core->dispatchNext();
+  });
+  for (int i = 0; i < BENCH_EVENTS; i++) {
+    while (!core->post(EVT_SCAN_DONE, info)) std::this_thread::yield();
+  }
+  consumer.join();
+  double ns = since(t0);
+  uint32_t extra = allocations - before;
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_EVENTS; i++) {
+    core->post(EVT_SCAN_DONE, info);
+    core->dispatchNext();
+  }
+  double dispatchNs = since(t0);
+  delete core;
+  return {ns, dispatchNs, extra};
+}
+
+static void test_dispatch_benchmark() {
+  Bench table = benchTable();
+  TEST_ASSERT_EQUAL_INT(2 * BENCH_EVENTS, scanDone);
+  scanDone = 0;
+  Bench core = benchCore();
+  TEST_ASSERT_EQUAL_INT(2 * BENCH_EVENTS, scanDone);
+  char msg[160];
+  snprintf(msg, sizeof(msg), "table: %.0f ns/event across threads, %.0f ns on one, %u allocations", table.nsPerEvent,
+           table.dispatchNs, table.allocations);
+  TEST_MESSAGE(msg);
+  snprintf(msg, sizeof(msg), "core path: %.0f ns/event across threads, %.0f ns on one, %u allocations",
+           core.nsPerEvent, core.dispatchNs, core.allocations);
+  TEST_MESSAGE(msg);
+  // Only the consumer thread itself allocates on the table path
+  TEST_ASSERT_TRUE(table.allocations <= 2);
+  TEST_ASSERT_TRUE(core.allocations >= BENCH_EVENTS);
+  // glibc's malloc is cheap and the thread hand-off dominates: on the host
+  // the two are level, and what the table saves is the heap traffic
+  TEST_ASSERT_TRUE(table.nsPerEvent < core.nsPerEvent * 2);
+  TEST_ASSERT_TRUE(table.dispatchNs < core.dispatchNs * 2);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_dispatch_by_id_and_value);
+  RUN_TEST(test_full_table_and_queue);
+  RUN_TEST(test_dispatch_benchmark);
+  return UNITY_END();
+}
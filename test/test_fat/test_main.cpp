@@ -0,0 +1,197 @@
+// The synthesized FAT16 volume, read back the way a host would: boot
+// sector, FAT chains and root directory, then every file's bytes compared
+// with the capture segment it stands for
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "FatImage.h"
+
+#define FAT_TEST_FILE "fat_test.bin"
+#define FAT_TEST_SEGMENTS 6
+
+static CaptureStorage* storage;
+
+void setUp() {
+  unlink(FAT_TEST_FILE);
+  storage = newHostCaptureStorage(FAT_TEST_FILE, 16 * CAPTURE_SEGMENT_BYTES);
+  TEST_ASSERT_TRUE(storage->begin());
+}
+
+void tearDown() {
+  delete storage;
+  unlink(FAT_TEST_FILE);
+}
+
+static uint16_t get16(const uint8_t* p) { return p[0] | p[1] << 8; }
+static uint32_t get32(const uint8_t* p) { return get16(p) | (uint32_t)get16(p + 2) << 16; }
+
+// Segments of assorted sizes: under a cluster, exactly one, several
+static void writeSegments() {
+  static const int records[FAT_TEST_SEGMENTS] = {3, 256, 1000, 1, 4000, 77};
+  uint32_t n = 0;
+  for (int s = 0; s < FAT_TEST_SEGMENTS; s++) {
+    for (int i = 0; i < records[s]; i++, n++) {
+      SurveyRecord r;
+      r.hdr.len = sizeof(r);
+      r.hdr.type = CAPTURE_BLE_SURVEY;
+      r.hdr.reserved = 0;
+      r.hdr.timeMs = n;
+      memset(r.id, n * 7, 6);
+      r.rssi = -(int)(n % 90);
+      r.extra = s;
+      TEST_ASSERT_TRUE(storage->append(&r, sizeof(r)));
+    }
+    TEST_ASSERT_TRUE(storage->rotate());
+  }
+}
+
+static void test_volume_parses() {
+  writeSegments();
+  FatImage image;
+  image.build(*storage);
+  TEST_ASSERT_EQUAL_INT(FAT_TEST_SEGMENTS, image.fileCount());
+
+  uint8_t boot[FAT_SECTOR_SIZE];
+  image.readSector(0, boot);
+  TEST_ASSERT_EQUAL_HEX8(0x55, boot[510]);
+  TEST_ASSERT_EQUAL_HEX8(0xAA, boot[511]);
+  uint32_t bytesPerSector = get16(boot + 11);
+  uint32_t perCluster = boot[13];
+  uint32_t reserved = get16(boot + 14);
+  uint32_t fats = boot[16];
+  uint32_t rootEntries = get16(boot + 17);
+  uint32_t total = get16(boot + 19) ? get16(boot + 19) : get32(boot + 32);
+  uint32_t fatSize = get16(boot + 22);
+  TEST_ASSERT_EQUAL_UINT32(FAT_SECTOR_SIZE, bytesPerSector);
+  TEST_ASSERT_EQUAL_UINT32(image.sectorCount(), total);
+  TEST_ASSERT_TRUE(fats >= 1 && fatSize > 0 && perCluster > 0);
+
+  // FAT type comes from the cluster count alone
+  uint32_t rootSectors = (rootEntries * 32 + bytesPerSector - 1) / bytesPerSector;
+  uint32_t firstData = reserved + fats * fatSize + rootSectors;
+  uint32_t clusters = (total - firstData) / perCluster;
+  TEST_ASSERT_TRUE(clusters >= 4085 && clusters < 65525);
+  TEST_ASSERT_TRUE(fatSize * bytesPerSector >= (clusters + 2) * 2);
+
+  // The whole FAT in memory; every copy the same
+  uint8_t* fat = (uint8_t*)malloc(fatSize * bytesPerSector);
+  uint8_t sector[FAT_SECTOR_SIZE];
+  for (uint32_t i = 0; i < fatSize; i++) image.readSector(reserved + i, fat + i * bytesPerSector);
+  for (uint32_t copy = 1; copy < fats; copy++) {
+    for (uint32_t i = 0; i < fatSize; i++) {
+      image.readSector(reserved + copy * fatSize + i, sector);
+      TEST_ASSERT_EQUAL_MEMORY(fat + i * bytesPerSector, sector, bytesPerSector);
+    }
+  }
+  TEST_ASSERT_EQUAL_HEX16(0xFFF8, get16(fat));
+
+  SegmentInfo segs[FAT_TEST_SEGMENTS];
+  TEST_ASSERT_EQUAL_INT(FAT_TEST_SEGMENTS, storage->listSegments(segs, FAT_TEST_SEGMENTS));
+
+  // Root directory: the volume label, then one file per segment
+  uint32_t rootStart = reserved + fats * fatSize;
+  uint8_t* root = (uint8_t*)malloc(rootSectors * bytesPerSector);
+  for (uint32_t i = 0; i < rootSectors; i++) image.readSector(rootStart + i, root + i * bytesPerSector);
+  TEST_ASSERT_EQUAL_HEX8(0x08, root[11]);
+  uint32_t clusterBytes = perCluster * bytesPerSector;
+  uint8_t* want = (uint8_t*)malloc(clusterBytes);
+  uint8_t* got = (uint8_t*)malloc(clusterBytes);
+  for (int f = 0; f < FAT_TEST_SEGMENTS; f++) {
+    const uint8_t* e = root + (f + 1) * 32;
+    char name[12];
+    snprintf(name, sizeof(name), "%08uBIN", (unsigned)segs[f].id);
+    TEST_ASSERT_EQUAL_MEMORY(name, e, 11);
+    uint32_t size = get32(e + 28);
+    TEST_ASSERT_EQUAL_UINT32(segs[f].size, size);
+
+    // Follow the chain and compare cluster by cluster
+    uint32_t cluster = get16(e + 26);
+    uint32_t offset = 0;
+    while (offset < size) {
+      TEST_ASSERT_TRUE(cluster >= 2 && cluster < clusters + 2);
+      uint32_t lba = firstData + (cluster - 2) * perCluster;
+      for (uint32_t s = 0; s < perCluster; s++) image.readSector(lba + s, got + s * bytesPerSector);
+      uint32_t len = size - offset < clusterBytes ? size - offset : clusterBytes;
+      TEST_ASSERT_EQUAL_size_t(len, storage->readSegment(segs[f].id, offset, want, len));
+      TEST_ASSERT_EQUAL_MEMORY(want, got, len);
+      offset += len;
+      cluster = get16(fat + cluster * 2);
+    }
+    TEST_ASSERT_TRUE(cluster >= 0xFFF8);
+  }
+  // Nothing after the last file
+  TEST_ASSERT_EQUAL_HEX8(0, root[(FAT_TEST_SEGMENTS + 1) * 32]);
+  free(fat);
+  free(root);
+  free(want);
+  free(got);
+}
+
+static void test_empty_storage() {
+  FatImage image;
+  image.build(*storage);
+  TEST_ASSERT_EQUAL_INT(0, image.fileCount());
+  uint8_t boot[FAT_SECTOR_SIZE];
+  image.readSector(0, boot);
+  TEST_ASSERT_EQUAL_MEMORY("FAT16   ", boot + 54, 8);
+  // Reads past the end are zeros, not a crash
+  uint8_t sector[FAT_SECTOR_SIZE];
+  memset(sector, 0xEE, sizeof(sector));
+  image.readSector(image.sectorCount() + 10, sector);
+  for (int i = 0; i < FAT_SECTOR_SIZE; i++) TEST_ASSERT_EQUAL_HEX8(0, sector[i]);
+}
+
+// A medium with more segments than one scan holds: the drive and the
+// listings show the newest ones
+static void test_newest_segments() {
+  const char* path = "fat_many_test.bin";
+  unlink(path);
+  CaptureStorage* many = newHostCaptureStorage(path, 80 * CAPTURE_SEGMENT_BYTES);
+  TEST_ASSERT_TRUE(many->begin());
+  SurveyRecord r = {};
+  r.hdr.len = sizeof(r);
+  r.hdr.type = CAPTURE_WIFI_SURVEY;
+  for (int s = 0; s < 70; s++) {
+    TEST_ASSERT_TRUE(many->append(&r, sizeof(r)));
+    TEST_ASSERT_TRUE(many->rotate());
+  }
+  uint32_t last = many->currentSegment() - 1;
+
+  SegmentInfo segs[32];
+  uint32_t total;
+  TEST_ASSERT_EQUAL_INT(32, many->listNewestSegments(segs, 32, &total));
+  TEST_ASSERT_EQUAL_UINT32(70, total);
+  for (int i = 0; i < 32; i++) TEST_ASSERT_EQUAL_UINT32(last - 31 + i, segs[i].id);
+  // Paging from the front still reaches every one
+  uint32_t after = 0, seen = 0;
+  int n;
+  while ((n = many->listSegments(after, segs, 32)) > 0) {
+    seen += n;
+    after = segs[n - 1].id;
+  }
+  TEST_ASSERT_EQUAL_UINT32(70, seen);
+  TEST_ASSERT_EQUAL_UINT32(last, after);
+
+  FatImage image;
+  image.build(*many);
+  TEST_ASSERT_EQUAL_INT(FAT_MAX_FILES, image.fileCount());
+  uint8_t boot[FAT_SECTOR_SIZE], sector[FAT_SECTOR_SIZE];
+  image.readSector(0, boot);
+  uint32_t rootStart = get16(boot + 14) + boot[16] * get16(boot + 22);
+  // Entry 0 is the volume label, entry 1 the oldest file shown
+  image.readSector(rootStart, sector);
+  char name[12];
+  snprintf(name, sizeof(name), "%08uBIN", (unsigned)(last - FAT_MAX_FILES + 1));
+  TEST_ASSERT_EQUAL_MEMORY(name, sector + 32, 11);
+  delete many;
+  unlink(path);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_volume_parses);
+  RUN_TEST(test_empty_storage);
+  RUN_TEST(test_newest_segments);
+  return UNITY_END();
+}
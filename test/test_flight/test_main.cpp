@@ -0,0 +1,263 @@
+// Flight recorder fed a replayed trace: a minute of sniffed frames and
+// survey reports with a deauth flood in the middle that someone triggers
+// on two seconds in. The event must hold every record from the start of
+// the pre-trigger window to the end of the post-trigger one, byte for byte
+// and in order, straight out of the arena; live capture keeps recording
+// while it is flushed, and a small arena cuts the event short rather than
+// drop live records.
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "FlightRecorder.h"
+
+#define TRACE_MS 60000
+#define FRAMES_PER_S 200
+#define FLOOD_FROM_MS 30000
+#define FLOOD_MS 8000
+#define FLOOD_PER_S 1500
+#define TRIGGER_MS (FLOOD_FROM_MS + 2000)
+#define FLUSH_MS 400            // trace time that goes by while an event is written out
+#define ARENA_BYTES (FLIGHT_BLOCKS_MAX * FLIGHT_BLOCK_BYTES)
+#define SMALL_ARENA_BLOCKS 24
+
+// The trace: records back to back, each with a unique sequence number
+struct Trace {
+  std::vector<uint8_t> bytes;
+  std::vector<size_t> offsets;
+  std::vector<uint32_t> times;
+
+  size_t size() const { return offsets.size(); }
+  const uint8_t* record(size_t i) const { return bytes.data() + offsets[i]; }
+  uint16_t len(size_t i) const { return ((const CaptureRecordHeader*)record(i))->len; }
+};
+
+static Trace trace;
+static uint8_t* arena;
+
+static void add(const void* rec, size_t len) {
+  trace.offsets.push_back(trace.bytes.size());
+  trace.times.push_back(((const CaptureRecordHeader*)rec)->timeMs);
+  trace.bytes.insert(trace.bytes.end(), (const uint8_t*)rec, (const uint8_t*)rec + len);
+}
+
+static void frame(uint32_t t, uint32_t seq, uint8_t frameType, size_t snap) {
+  uint8_t rec[sizeof(FrameRecord) + 128];
+  FrameRecord* f = (FrameRecord*)rec;
+  memset(rec, 0, sizeof(rec));
+  f->hdr.len = sizeof(FrameRecord) + snap;
+  f->hdr.type = CAPTURE_WIFI_FRAME;
+  f->hdr.timeMs = t;
+  f->channel = 6;
+  f->rssi = -40 - seq % 50;
+  f->frameType = frameType;
+  f->origLen = snap + 40;
+  memcpy(rec + sizeof(FrameRecord) + 4, &seq, 4);   // after frame control and duration
+  add(rec, f->hdr.len);
+}
+
+static void survey(uint32_t t, uint32_t seq, uint8_t type) {
+  SurveyRecord s = {};
+  s.hdr.len = sizeof(s);
+  s.hdr.type = type;
+  s.hdr.timeMs = t;
+  memcpy(s.id, &seq, 4);
+  s.rssi = -70;
+  add(&s, sizeof(s));
+}
+
+// Frames at a steady rate with varied snaplens, a WiFi survey every 10 s
+// and a BLE one every 2 s, and the flood: deauths, 26 bytes each
+static void buildTrace() {
+  trace = Trace();
+  srand(3);
+  uint32_t seq = 0;
+  for (uint32_t t = 0; t < TRACE_MS; t++) {
+    if (t % 10000 == 0) for (int i = 0; i < 30; i++) survey(t, seq++, CAPTURE_WIFI_SURVEY);
+    if (t % 2000 == 0) for (int i = 0; i < 12; i++) survey(t, seq++, CAPTURE_BLE_SURVEY);
+    if (rand() % 1000 < FRAMES_PER_S) frame(t, seq++, rand() % 3, 24 + rand() % 105);
+    if (t >= FLOOD_FROM_MS && t < FLOOD_FROM_MS + FLOOD_MS) {
+      for (int i = 0; i < FLOOD_PER_S / 1000; i++) frame(t, seq++, 0, 26);
+      if (rand() % 1000 < FLOOD_PER_S % 1000) frame(t, seq++, 0, 26);
+    }
+  }
+}
+
+void setUp() {
+  if (trace.size() == 0) buildTrace();
+  arena = (uint8_t*)malloc(ARENA_BYTES);
+}
+
+void tearDown() {
+  free(arena);
+}
+
+// Walks the event's blocks and checks they are one unbroken run of the
+// trace, returning the indices of its first and last records
+static void checkContiguous(const FlightEvent& ev, size_t& first, size_t& last) {
+  TEST_ASSERT_TRUE(ev.count > 0);
+  const uint8_t* p = ev.blocks[0].data;
+  first = trace.size();
+  for (size_t i = 0; i < trace.size(); i++) {
+    if (trace.times[i] == ev.fromMs && memcmp(trace.record(i), p, trace.len(i)) == 0) {
+      first = i;
+      break;
+    }
+  }
+  TEST_ASSERT_TRUE_MESSAGE(first < trace.size(), "first record of the event not in the trace");
+  size_t i = first;
+  uint32_t bytes = 0;
+  for (int b = 0; b < ev.count; b++) {
+    // Zero copy: the blocks are the arena's own
+    TEST_ASSERT_TRUE(ev.blocks[b].data >= arena && ev.blocks[b].data + ev.blocks[b].len <= arena + ARENA_BYTES);
+    const uint8_t* q = ev.blocks[b].data;
+    const uint8_t* end = q + ev.blocks[b].len;
+    while (q < end) {
+      TEST_ASSERT_TRUE_MESSAGE(i < trace.size(), "event runs past the trace");
+      uint16_t len = ((const CaptureRecordHeader*)q)->len;
+      TEST_ASSERT_EQUAL_UINT16(trace.len(i), len);
+      TEST_ASSERT_EQUAL_MEMORY(trace.record(i), q, len);
+      q += len;
+      i++;
+    }
+    TEST_ASSERT_TRUE(q == end);
+    bytes += ev.blocks[b].len;
+  }
+  last = i - 1;
+  TEST_ASSERT_EQUAL_UINT32(ev.bytes, bytes);
+  TEST_ASSERT_EQUAL_UINT32(ev.toMs, trace.times[last]);
+}
+
+// Replays the trace from `from` up to (not including) time `until`,
+// ticking as the recorder task would
+static size_t replay(FlightRecorder& rec, size_t from, uint32_t until) {
+  size_t i = from;
+  for (; i < trace.size() && trace.times[i] < until; i++) {
+    TEST_ASSERT_TRUE(rec.append(trace.record(i), trace.len(i)));
+    if (i + 1 == trace.size() || trace.times[i + 1] != trace.times[i]) rec.tick(trace.times[i]);
+  }
+  return i;
+}
+
+static void test_pre_and_post_windows() {
+  FlightRecorder* rec = new FlightRecorder();
+  rec->begin(arena, ARENA_BYTES);
+  size_t i = replay(*rec, 0, TRIGGER_MS);
+  TEST_ASSERT_TRUE(rec->trigger(FLIGHT_BUTTON, "", TRIGGER_MS));
+  i = replay(*rec, i, TRIGGER_MS + FLIGHT_POST_MS);
+  TEST_ASSERT_TRUE(rec->collecting());
+  rec->tick(TRIGGER_MS + FLIGHT_POST_MS);
+  TEST_ASSERT_FALSE(rec->collecting());
+
+  static FlightEvent ev;
+  TEST_ASSERT_TRUE(rec->take(ev));
+  // The flush takes a while; the sniffer does not wait for it, and the
+  // event's blocks are not touched meanwhile
+  std::vector<uint8_t> copy;
+  for (int b = 0; b < ev.count; b++) copy.insert(copy.end(), ev.blocks[b].data, ev.blocks[b].data + ev.blocks[b].len);
+  i = replay(*rec, i, TRIGGER_MS + FLIGHT_POST_MS + FLUSH_MS);
+  TEST_ASSERT_FALSE(rec->trigger(FLIGHT_SERIAL, "", TRIGGER_MS + FLIGHT_POST_MS + FLUSH_MS));
+  size_t first, last;
+  checkContiguous(ev, first, last);
+  size_t off = 0;
+  for (int b = 0; b < ev.count; b++) {
+    TEST_ASSERT_EQUAL_MEMORY(copy.data() + off, ev.blocks[b].data, ev.blocks[b].len);
+    off += ev.blocks[b].len;
+  }
+  rec->release();
+
+  // Whole blocks: the pre-trigger window starts within a block of its
+  // nominal start, the post-trigger one runs to the last record before
+  // its end, and the flood is in it from its first deauth
+  TEST_ASSERT_FALSE(ev.truncated);
+  TEST_ASSERT_EQUAL_UINT8(FLIGHT_BUTTON, ev.reason);
+  TEST_ASSERT_EQUAL_UINT32(TRIGGER_MS, ev.triggerMs);
+  TEST_ASSERT_TRUE(ev.fromMs <= TRIGGER_MS - FLIGHT_PRE_MS);
+  TEST_ASSERT_TRUE(ev.fromMs > TRIGGER_MS - FLIGHT_PRE_MS - 1000);
+  TEST_ASSERT_TRUE(last + 1 < trace.size());
+  TEST_ASSERT_TRUE(trace.times[last] < TRIGGER_MS + FLIGHT_POST_MS);
+  TEST_ASSERT_TRUE(trace.times[last + 1] >= TRIGGER_MS + FLIGHT_POST_MS);
+
+  FlightStats s = rec->stats();
+  TEST_ASSERT_EQUAL_UINT32(i, s.records);
+  TEST_ASSERT_EQUAL_UINT32(0, s.dropped);
+  TEST_ASSERT_EQUAL_UINT32(1, s.events);
+  TEST_ASSERT_EQUAL_UINT32(1, s.busy);
+  TEST_ASSERT_EQUAL_INT(0, s.pinned);
+  char msg[120];
+  snprintf(msg, sizeof(msg), "event: %u records, %u bytes in %d blocks, %.1f s",
+           (unsigned)(last - first + 1), ev.bytes, ev.count, (ev.toMs - ev.fromMs) / 1000.0f);
+  TEST_MESSAGE(msg);
+
+  // Released: the rest of the trace goes through without a drop, and the
+  // arena holds the last stretch of it again
+  replay(*rec, i, TRACE_MS);
+  s = rec->stats();
+  TEST_ASSERT_EQUAL_UINT32(trace.size(), s.records);
+  TEST_ASSERT_EQUAL_UINT32(0, s.dropped);
+  TEST_ASSERT_TRUE(s.heldMs > FLIGHT_PRE_MS + FLIGHT_POST_MS);
+  delete rec;
+}
+
+// A rule firing again within the post-trigger window extends it
+static void test_retrigger_extends_window() {
+  FlightRecorder* rec = new FlightRecorder();
+  rec->begin(arena, ARENA_BYTES);
+  size_t i = replay(*rec, 0, FLOOD_FROM_MS);
+  TEST_ASSERT_TRUE(rec->trigger(FLIGHT_RULE, "deauth", FLOOD_FROM_MS));
+  i = replay(*rec, i, FLOOD_FROM_MS + 3000);
+  TEST_ASSERT_TRUE(rec->trigger(FLIGHT_RULE, "deauth", FLOOD_FROM_MS + 3000));
+  i = replay(*rec, i, FLOOD_FROM_MS + 3000 + FLIGHT_POST_MS);
+  rec->tick(FLOOD_FROM_MS + 3000 + FLIGHT_POST_MS);
+
+  static FlightEvent ev;
+  TEST_ASSERT_TRUE(rec->take(ev));
+  size_t first, last;
+  checkContiguous(ev, first, last);
+  TEST_ASSERT_EQUAL_STRING("deauth", ev.note);
+  TEST_ASSERT_EQUAL_UINT32(FLOOD_FROM_MS, ev.triggerMs);
+  TEST_ASSERT_TRUE(trace.times[last] >= FLOOD_FROM_MS + 3000 + FLIGHT_POST_MS - 10);
+  TEST_ASSERT_FALSE(ev.truncated);
+  rec->release();
+  TEST_ASSERT_EQUAL_UINT32(1, rec->stats().events);
+  delete rec;
+}
+
+// Not enough blocks for the flood: the event keeps the records nearest the
+// trigger and ends early, and live capture never loses a record
+static void test_small_arena_cuts_event_short() {
+  FlightRecorder* rec = new FlightRecorder();
+  rec->begin(arena, SMALL_ARENA_BLOCKS * FLIGHT_BLOCK_BYTES);
+  size_t i = replay(*rec, 0, TRIGGER_MS);
+  TEST_ASSERT_TRUE(rec->trigger(FLIGHT_BUTTON, "", TRIGGER_MS));
+  i = replay(*rec, i, TRIGGER_MS + FLIGHT_POST_MS);
+  TEST_ASSERT_FALSE(rec->collecting());
+
+  static FlightEvent ev;
+  TEST_ASSERT_TRUE(rec->take(ev));
+  i = replay(*rec, i, TRIGGER_MS + FLIGHT_POST_MS + FLUSH_MS);
+  size_t first, last;
+  checkContiguous(ev, first, last);
+  rec->release();
+  TEST_ASSERT_TRUE(ev.truncated);
+  TEST_ASSERT_TRUE(ev.fromMs > TRIGGER_MS - FLIGHT_PRE_MS);
+  TEST_ASSERT_TRUE(ev.fromMs < TRIGGER_MS);
+  TEST_ASSERT_TRUE(ev.toMs > TRIGGER_MS);
+  TEST_ASSERT_TRUE(ev.toMs < TRIGGER_MS + FLIGHT_POST_MS);
+  TEST_ASSERT_TRUE(ev.count <= SMALL_ARENA_BLOCKS - FLIGHT_SPARE_BLOCKS);
+
+  replay(*rec, i, TRACE_MS);
+  FlightStats s = rec->stats();
+  TEST_ASSERT_EQUAL_UINT32(trace.size(), s.records);
+  TEST_ASSERT_EQUAL_UINT32(0, s.dropped);
+  TEST_ASSERT_EQUAL_UINT32(1, s.truncated);
+  delete rec;
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_pre_and_post_windows);
+  RUN_TEST(test_retrigger_extends_window);
+  RUN_TEST(test_small_arena_cuts_event_short);
+  return UNITY_END();
+}
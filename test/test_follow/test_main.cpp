@@ -0,0 +1,201 @@
+// Follow mode simulated millisecond by millisecond: a walk toward the
+// device, a pause next to it and a walk away, with the samples arriving as
+// targeted WiFi probes or BLE advertisements do, some of them missed, and
+// the UI loop redrawing as refreshFollow() does. Reports the sample and
+// redraw rates the screen would show and checks the trend arrow against
+// where the walker is going.
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include "FollowTracker.h"
+
+#define WALK_IN_MS 30000      // 31 m to 1 m at 1 m/s
+#define PAUSE_MS 15000
+#define WALK_OUT_MS 30000
+#define SIM_MS (WALK_IN_MS + PAUSE_MS + WALK_OUT_MS)
+#define NOISE_DB 4.0          // standard deviation of a single sample
+#define NEAR_M 8              // where a metre changes the signal by over 1 dB
+
+// As main.cpp: loop() sleeps 50 ms, redraws are capped at FOLLOW_DRAW_MS
+#define LOOP_MS 50
+#define FOLLOW_DRAW_MS 100
+
+struct Source {
+  const char* name;
+  uint32_t periodMs;    // probe length or advertising interval
+  uint32_t jitterMs;    // scan start/stop, or the advertiser's advDelay
+  int heardPercent;
+};
+
+// A ~95 ms single-channel probe, a 100 ms advertiser and a 20 ms one
+static const Source WIFI_PROBE = {"WiFi probe", 90, 10, 90};
+static const Source BLE_100MS = {"BLE 100 ms", 100, 10, 80};
+static const Source BLE_20MS = {"BLE 20 ms", 20, 10, 80};
+
+static float distanceAt(uint32_t t) {
+  if (t < WALK_IN_MS) return 31 - t / 1000.0f;
+  if (t < WALK_IN_MS + PAUSE_MS) return 1;
+  return 1 + (t - WALK_IN_MS - PAUSE_MS) / 1000.0f;
+}
+
+// Log-distance path loss, -45 dBm at one metre
+static float rssiAt(uint32_t t) {
+  return -45 - 25 * log10f(distanceAt(t));
+}
+
+struct Run {
+  float sampleHz;       // what the screen shows, averaged over its redraws
+  float drawHz;
+  uint32_t samples;
+  uint32_t draws;
+  int downIn, ticksIn;                        // trend at each redraw, walking in
+  int upNear, ticksNear;                      // the last NEAR_M of the way in
+  int flipsPaused, ticksPaused;               // arrow changes standing still
+  int upOut, ticksOut;
+  int downNear, ticksLeaving;                 // the first NEAR_M of the way out
+  float worstLagDb;                           // displayed vs true, after the first seconds
+};
+
+static Run simulate(const Source& src, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> noise(0, NOISE_DB);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::uniform_int_distribution<int> jitter(0, src.jitterMs);
+
+  FollowTracker* tracker = new FollowTracker();
+  tracker->reset(0);
+  Run run = {};
+  uint32_t nextSample = src.periodMs + jitter(rng);
+  uint32_t nextLoop = LOOP_MS;
+  uint32_t drawnVersion = 0, drawnMs = 0;
+  bool drawnStale = false;
+  FollowTrend shown = TREND_FLAT;
+  double hzSum = 0;
+  int hzCount = 0;
+
+  for (uint32_t t = 0; t < SIM_MS; t++) {
+    if (t == nextSample) {
+      if (percent(rng) < src.heardPercent) tracker->sample(lroundf(rssiAt(t) + noise(rng)), t);
+      nextSample = t + src.periodMs + jitter(rng);
+    }
+    if (t != nextLoop) continue;
+    nextLoop = t + LOOP_MS;
+
+    // refreshFollow()
+    if (t - drawnMs < FOLLOW_DRAW_MS) continue;
+    FollowView v = tracker->view(t);
+    if (v.version == drawnVersion && v.stale == drawnStale) continue;
+    drawnVersion = v.version;
+    drawnStale = v.stale;
+    drawnMs = t;
+    run.draws++;
+    if (t < 5000 || v.stale) continue;   // averages still settling
+
+    hzSum += v.rateHz;
+    hzCount++;
+    float lag = fabsf(v.dbm - rssiAt(t));
+    if (lag > run.worstLagDb) run.worstLagDb = lag;
+    bool near = distanceAt(t) <= NEAR_M;
+    if (t < WALK_IN_MS) {
+      run.ticksIn++;
+      run.downIn += v.trend == TREND_DOWN;
+      run.ticksNear += near;
+      run.upNear += near && v.trend == TREND_UP;
+    } else if (t >= WALK_IN_MS + 5000 && t < WALK_IN_MS + PAUSE_MS) {
+      run.ticksPaused++;
+      run.flipsPaused += v.trend != shown;
+    } else if (t >= WALK_IN_MS + PAUSE_MS + 1000) {
+      run.ticksOut++;
+      run.upOut += v.trend == TREND_UP;
+      run.ticksLeaving += near;
+      run.downNear += near && v.trend == TREND_DOWN;
+    }
+    shown = v.trend;
+  }
+  FollowView v = tracker->view(SIM_MS);
+  run.samples = v.samples;
+  run.sampleHz = hzCount ? hzSum / hzCount : 0;
+  run.drawHz = run.draws * 1000.0f / SIM_MS;
+  delete tracker;
+  return run;
+}
+
+static void report(const Source& src, const Run& r) {
+  char msg[200];
+  snprintf(msg, sizeof(msg),
+           "%s: %.1f samples/s, %.1f redraws/s; arrow up %d%% of the last %d m in, down %d%% of the "
+           "first %d m out, %d changes in %d redraws standing still; worst lag %.1f dB",
+           src.name, r.sampleHz, r.drawHz, 100 * r.upNear / r.ticksNear, NEAR_M,
+           100 * r.downNear / r.ticksLeaving, NEAR_M, r.flipsPaused, r.ticksPaused, r.worstLagDb);
+  TEST_MESSAGE(msg);
+}
+
+// The arrow follows the walker: mostly up over the last metres in and
+// down over the first metres out (further away a step is lost in the
+// noise), hardly ever the wrong way, and quiet while standing still
+static void checkTrend(const Run& r) {
+  TEST_ASSERT_TRUE(r.upNear * 2 > r.ticksNear);
+  TEST_ASSERT_TRUE(r.downIn * 20 < r.ticksIn);
+  TEST_ASSERT_TRUE(r.downNear * 2 > r.ticksLeaving);
+  TEST_ASSERT_TRUE(r.upOut * 20 < r.ticksOut);
+  TEST_ASSERT_TRUE(r.flipsPaused * 5 < r.ticksPaused);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Back-to-back probes: one sample per probe that hears the AP, and as many
+// redraws as the loop period leaves room for
+static void test_wifi_probe_rate() {
+  Run r = simulate(WIFI_PROBE, 1);
+  report(WIFI_PROBE, r);
+  TEST_ASSERT_TRUE(r.sampleHz >= 8 && r.sampleHz <= 11);
+  TEST_ASSERT_TRUE(r.drawHz >= 5 && r.drawHz <= 10);
+  checkTrend(r);
+}
+
+static void test_ble_advertiser_rates() {
+  Run slow = simulate(BLE_100MS, 2);
+  report(BLE_100MS, slow);
+  TEST_ASSERT_TRUE(slow.sampleHz >= 7 && slow.sampleHz <= 9);
+  TEST_ASSERT_TRUE(slow.drawHz >= 5 && slow.drawHz <= 10);
+  checkTrend(slow);
+
+  // Five times the samples: the redraw cap holds, and the time weighting
+  // keeps the extra samples from making the arrow any twitchier
+  Run fast = simulate(BLE_20MS, 3);
+  report(BLE_20MS, fast);
+  TEST_ASSERT_TRUE(fast.sampleHz >= 30);
+  TEST_ASSERT_TRUE(fast.drawHz >= 9 && fast.drawHz <= 10);
+  checkTrend(fast);
+  TEST_ASSERT_TRUE(fast.worstLagDb < slow.worstLagDb + 3);
+}
+
+// A burst at one instant carries no weight; silence goes stale
+static void test_bursts_and_loss() {
+  FollowTracker* tracker = new FollowTracker();
+  tracker->reset(0);
+  for (uint32_t t = 0; t <= 2000; t += 100) tracker->sample(-70, t);
+  for (int i = 0; i < 50; i++) tracker->sample(-30, 2000);
+  FollowView v = tracker->view(2000);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, -70, v.dbm);
+  TEST_ASSERT_EQUAL_INT(-30, v.last);
+  TEST_ASSERT_EQUAL(TREND_FLAT, v.trend);
+  TEST_ASSERT_FALSE(v.stale);
+  TEST_ASSERT_FLOAT_WITHIN(1, 10, v.rateHz);
+
+  v = tracker->view(2000 + FOLLOW_STALE_MS + 1);
+  TEST_ASSERT_TRUE(v.stale);
+  TEST_ASSERT_EQUAL(TREND_FLAT, v.trend);
+  TEST_ASSERT_EQUAL_FLOAT(0, v.rateHz);
+  delete tracker;
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_wifi_probe_rate);
+  RUN_TEST(test_ble_advertiser_rates);
+  RUN_TEST(test_bursts_and_loss);
+  return UNITY_END();
+}
@@ -0,0 +1,263 @@
+// DIS harvesting against a fake GATT client: devices missing some or all
+// of the characteristics, connections that time out and the retry and
+// cool-down that follow, and the connect budget with worker threads
+// racing for jobs the way the harvest tasks do
+#include <unity.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DisHarvest.h"
+
+// What one fake peripheral does when connected to
+struct FakeDevice {
+  bool reachable = true;            // else connect() runs into its timeout
+  bool service = true;
+  std::map<uint16_t, std::string> values;
+  int connectMs = 0;                // real time a connect takes, for the thread test
+};
+
+static std::map<uint64_t, FakeDevice> devices;
+static std::atomic<int> connected(0);
+static std::atomic<int> peakConnected(0);
+static std::atomic<int> connects(0);
+static std::atomic<int> disconnects(0);
+static uint32_t clockMs;   // advanced by connect timeouts
+
+static uint64_t key(const uint8_t id[6]) {
+  uint64_t k = 0;
+  for (int i = 0; i < 6; i++) k = (k << 8) | id[i];
+  return k;
+}
+
+class FakeClient : public DisClient {
+public:
+  bool connect(const uint8_t id[6], uint8_t, uint32_t timeoutMs) override {
+    connects++;
+    lastTimeoutMs = timeoutMs;
+    auto it = devices.find(key(id));
+    if (it == devices.end() || !it->second.reachable) {
+      clockMs += timeoutMs;
+      return false;
+    }
+    device = &it->second;
+    int now = ++connected;
+    for (int peak = peakConnected; now > peak && !peakConnected.compare_exchange_weak(peak, now);) {}
+    if (device->connectMs) std::this_thread::sleep_for(std::chrono::milliseconds(device->connectMs));
+    return true;
+  }
+
+  bool hasService() override { return device->service; }
+
+  int read(uint16_t uuid, char* out, size_t cap) override {
+    auto it = device->values.find(uuid);
+    if (it == device->values.end()) return -1;
+    size_t n = it->second.size() < cap ? it->second.size() : cap;
+    memcpy(out, it->second.data(), n);
+    return n;
+  }
+
+  void disconnect() override {
+    connected--;
+    disconnects++;
+    device = nullptr;
+  }
+
+  uint32_t lastTimeoutMs = 0;
+
+private:
+  FakeDevice* device = nullptr;
+};
+
+static void id(uint8_t out[6], int n) {
+  const uint8_t base[6] = {0xD0, 0x11, 0x22, 0x33, 0x44, 0};
+  memcpy(out, base, 6);
+  out[5] = n;
+}
+
+static FakeDevice& device(int n) {
+  uint8_t a[6];
+  id(a, n);
+  return devices[key(a)];
+}
+
+// One worker pass: take a due job, run it, finish it
+static bool harvestOne(DisHarvester& h, FakeClient& client, DisResult& result) {
+  DisJob job;
+  if (!h.take(job, clockMs)) return false;
+  DisHarvester::run(client, job, result);
+  h.finish(job, result, clockMs);
+  return true;
+}
+
+void setUp() {
+  devices.clear();
+  connected = peakConnected = connects = disconnects = 0;
+  clockMs = 1000;
+}
+
+void tearDown() {}
+
+static void test_missing_characteristics() {
+  FakeDevice& d = device(1);
+  d.values[0x2A29] = "Acme";
+  d.values[0x2A24] = std::string("Tag 3\0\0\0", 8);       // NUL padded
+  d.values[0x2A25] = "SN-0042   ";                        // space padded
+  d.values[0x2A26] = "1.2\x01\xff";                       // stray bytes
+  d.values[0x2A28] = std::string(40, 'x');                // longer than a field
+  // no hardware revision at all
+
+  DisHarvester* h = new DisHarvester();
+  FakeClient client;
+  DisResult result;
+  uint8_t a[6];
+  id(a, 1);
+  TEST_ASSERT_TRUE(h->offer(a, 0, clockMs));
+  TEST_ASSERT_TRUE(harvestOne(*h, client, result));
+  TEST_ASSERT_EQUAL(DIS_DONE, result.state);
+  TEST_ASSERT_EQUAL_UINT32(DIS_CONNECT_TIMEOUT_MS, client.lastTimeoutMs);
+
+  DisRecord r;
+  TEST_ASSERT_TRUE(h->lookup(a, r));
+  TEST_ASSERT_EQUAL(DIS_DONE, r.state);
+  TEST_ASSERT_EQUAL_STRING("Acme", r.fields[DIS_MANUFACTURER]);
+  TEST_ASSERT_EQUAL_STRING("Tag 3", r.fields[DIS_MODEL]);
+  TEST_ASSERT_EQUAL_STRING("SN-0042", r.fields[DIS_SERIAL]);
+  TEST_ASSERT_EQUAL_STRING("", r.fields[DIS_HARDWARE]);
+  TEST_ASSERT_EQUAL_STRING("1.2??", r.fields[DIS_FIRMWARE]);
+  TEST_ASSERT_EQUAL_size_t(DIS_FIELD_LEN - 1, strlen(r.fields[DIS_SOFTWARE]));
+
+  // Connected without the service: no reads, the long cool-down all the same
+  uint8_t b[6];
+  id(b, 2);
+  device(2).service = false;
+  TEST_ASSERT_TRUE(h->offer(b, 0, clockMs));
+  TEST_ASSERT_TRUE(harvestOne(*h, client, result));
+  TEST_ASSERT_EQUAL(DIS_NO_SERVICE, result.state);
+  TEST_ASSERT_FALSE(h->offer(b, 0, clockMs + DIS_COOLDOWN_MS - 1));
+  TEST_ASSERT_TRUE(h->offer(b, 0, clockMs + DIS_COOLDOWN_MS));
+  TEST_ASSERT_EQUAL_INT(connects.load(), disconnects.load());
+  delete h;
+}
+
+// Attempts that time out are retried after DIS_RETRY_MS, and after
+// DIS_ATTEMPTS_MAX of them only after the long cool-down; a failed
+// connect is never disconnected
+static void test_timeouts_and_retries() {
+  device(3).reachable = false;
+  DisHarvester* h = new DisHarvester();
+  FakeClient client;
+  DisResult result;
+  uint8_t a[6];
+  id(a, 3);
+  for (int attempt = 1; attempt <= DIS_ATTEMPTS_MAX; attempt++) {
+    TEST_ASSERT_TRUE(h->offer(a, 0, clockMs));
+    uint32_t before = clockMs;
+    TEST_ASSERT_TRUE(harvestOne(*h, client, result));
+    TEST_ASSERT_EQUAL(DIS_FAILED, result.state);
+    TEST_ASSERT_EQUAL_UINT32(before + DIS_CONNECT_TIMEOUT_MS, clockMs);
+    uint32_t wait = attempt < DIS_ATTEMPTS_MAX ? DIS_RETRY_MS : DIS_COOLDOWN_MS;
+    TEST_ASSERT_FALSE(h->offer(a, 0, clockMs + wait - 1));
+    clockMs += wait;
+  }
+  DisStats s = h->stats();
+  TEST_ASSERT_EQUAL_UINT32(DIS_ATTEMPTS_MAX, s.failures);
+  TEST_ASSERT_EQUAL_INT(0, disconnects.load());
+  TEST_ASSERT_EQUAL_INT(0, connected.load());
+
+  // Back in range: harvested, and the attempt count starts over
+  device(3).reachable = true;
+  device(3).values[0x2A29] = "Acme";
+  TEST_ASSERT_TRUE(h->offer(a, 0, clockMs));
+  TEST_ASSERT_TRUE(harvestOne(*h, client, result));
+  DisRecord r;
+  TEST_ASSERT_TRUE(h->lookup(a, r));
+  TEST_ASSERT_EQUAL(DIS_DONE, r.state);
+  TEST_ASSERT_EQUAL_UINT8(0, r.attempts);
+  delete h;
+}
+
+// Scanner offers while three workers race for jobs: never more than
+// DIS_MAX_CONCURRENT links, the queue never past DIS_QUEUE_SIZE, and
+// every offered device harvested once
+static void test_connect_budget() {
+  const int count = DIS_QUEUE_SIZE + 4;
+  for (int n = 0; n < count; n++) {
+    device(n).values[0x2A24] = "Tag";
+    device(n).connectMs = 5;
+  }
+  DisHarvester* h = new DisHarvester();
+  int accepted = 0;
+  uint8_t a[6];
+  for (int n = 0; n < count; n++) {
+    id(a, n);
+    if (h->offer(a, 0, clockMs + n)) accepted++;
+  }
+  TEST_ASSERT_EQUAL_INT(DIS_QUEUE_SIZE, accepted);
+
+  std::atomic<int> done(0);
+  std::vector<std::thread> workers;
+  for (int w = 0; w < 3; w++) {
+    workers.emplace_back([&] {
+      FakeClient client;
+      DisResult result;
+      while (done < count) {
+        if (harvestOne(*h, client, result)) done++;
+        else std::this_thread::yield();
+      }
+    });
+  }
+  // The rest get in as the queue drains
+  for (int n = DIS_QUEUE_SIZE; n < count; n++) {
+    id(a, n);
+    while (!h->offer(a, 0, clockMs + n)) std::this_thread::yield();
+  }
+  for (std::thread& t : workers) t.join();
+
+  DisStats s = h->stats();
+  TEST_ASSERT_EQUAL_UINT32(count, s.harvested);
+  TEST_ASSERT_EQUAL_UINT32(count, s.connects);
+  TEST_ASSERT_TRUE(peakConnected.load() <= DIS_MAX_CONCURRENT);
+  TEST_ASSERT_EQUAL_UINT32(peakConnected.load(), s.peakInFlight);
+  TEST_ASSERT_EQUAL_INT(0, h->inFlight());
+  TEST_ASSERT_EQUAL_INT(count, disconnects.load());
+  DisRecord recs[DIS_CACHE_SIZE];
+  TEST_ASSERT_EQUAL_INT(count, h->records(recs, DIS_CACHE_SIZE));
+  delete h;
+}
+
+// A private address that rotated: the asset keeps one record
+static void test_rotated_address_merges() {
+  for (int n = 10; n <= 11; n++) {
+    device(n).values[0x2A24] = "Tag";
+    device(n).values[0x2A25] = "SN-7";
+  }
+  DisHarvester* h = new DisHarvester();
+  FakeClient client;
+  DisResult result;
+  uint8_t a[6], b[6];
+  id(a, 10);
+  id(b, 11);
+  TEST_ASSERT_TRUE(h->offer(a, 1, clockMs));
+  TEST_ASSERT_TRUE(harvestOne(*h, client, result));
+  clockMs += 60000;
+  TEST_ASSERT_TRUE(h->offer(b, 1, clockMs));
+  TEST_ASSERT_TRUE(harvestOne(*h, client, result));
+  DisRecord r;
+  TEST_ASSERT_FALSE(h->lookup(a, r));
+  TEST_ASSERT_TRUE(h->lookup(b, r));
+  TEST_ASSERT_EQUAL_UINT32(1, h->stats().merged);
+  delete h;
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_missing_characteristics);
+  RUN_TEST(test_timeouts_and_retries);
+  RUN_TEST(test_connect_budget);
+  RUN_TEST(test_rotated_address_merges);
+  return UNITY_END();
+}
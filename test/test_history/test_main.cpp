@@ -0,0 +1,211 @@
+// Device history on a host file: sightings survive compactions and a
+// reopen, the base keeps existing devices when it is full, and lookups
+// run alongside a compaction (run it in env:native-tsan too)
+#include <unity.h>
+#include <unistd.h>
+#include <thread>
+#include <atomic>
+#include "DeviceHistory.h"
+
+#define HISTORY_TEST_FILE "history_test.bin"
+#define HISTORY_TEST_BYTES 0x10000
+
+void setUp() {
+  unlink(HISTORY_TEST_FILE);
+}
+
+void tearDown() {
+  unlink(HISTORY_TEST_FILE);
+}
+
+static void mac(uint32_t n, uint8_t out[6]) {
+  out[0] = 0x02;
+  out[1] = 0;
+  out[2] = n >> 24;
+  out[3] = n >> 16;
+  out[4] = n >> 8;
+  out[5] = n;
+}
+
+static void test_layout_of_a_small_partition() {
+  {
+    DeviceHistory h;
+    TEST_ASSERT_TRUE(h.begin(HISTORY_TEST_FILE, HISTORY_TEST_BYTES));
+    HistoryStats s = h.stats();
+    TEST_ASSERT_EQUAL_UINT32(1024, s.capacity);
+    TEST_ASSERT_EQUAL_UINT32(819, s.logCapacity);
+  }
+  unlink(HISTORY_TEST_FILE);
+  DeviceHistory tiny;
+  TEST_ASSERT_FALSE(tiny.begin(HISTORY_TEST_FILE, HISTORY_MIN_BYTES - HISTORY_SECTOR_SIZE));
+  TEST_ASSERT_FALSE(tiny.ready());
+}
+
+static void test_sightings_survive_compaction_and_reopen() {
+  uint8_t id[6];
+  {
+    DeviceHistory h;
+    TEST_ASSERT_TRUE(h.begin(HISTORY_TEST_FILE, HISTORY_TEST_BYTES));
+    for (uint32_t i = 0; i < 900; i++) {
+      mac(i, id);
+      h.recordSighting(id, 60 * 10 + i);
+    }
+    // Again an hour later: new hour bit, count 2
+    for (uint32_t i = 0; i < 900; i++) {
+      mac(i, id);
+      h.recordSighting(id, 60 * 11 + i);
+    }
+    TEST_ASSERT_TRUE(h.stats().compactions >= 2);
+  }
+  DeviceHistory h;
+  TEST_ASSERT_TRUE(h.begin(HISTORY_TEST_FILE, HISTORY_TEST_BYTES));
+  HistoryRecord rec;
+  for (uint32_t i = 0; i < 900; i++) {
+    mac(i, id);
+    TEST_ASSERT_TRUE(h.lookup(id, rec));
+    TEST_ASSERT_EQUAL_UINT32(60 * 10 + i, rec.firstSeen);
+    TEST_ASSERT_EQUAL_UINT32(60 * 11 + i, rec.lastSeen);
+    TEST_ASSERT_EQUAL_UINT16(2, rec.count);
+  }
+  mac(5000, id);
+  TEST_ASSERT_FALSE(h.lookup(id, rec));
+}
+
+// Once the base is full, known devices are still updated and new ones
+// are counted as dropped
+static void test_full_base_keeps_known_devices() {
+  DeviceHistory h;
+  TEST_ASSERT_TRUE(h.begin(HISTORY_TEST_FILE, HISTORY_TEST_BYTES));
+  uint8_t id[6];
+  for (uint32_t i = 0; i < 3000; i++) {
+    mac(i, id);
+    h.recordSighting(id, i + 1);
+  }
+  h.compact();
+  HistoryStats s = h.stats();
+  TEST_ASSERT_EQUAL_UINT32(s.capacity, s.baseCount);
+  TEST_ASSERT_EQUAL_UINT32(3000 - s.capacity, s.dropped);
+  HistoryRecord rec;
+  mac(0, id);
+  TEST_ASSERT_TRUE(h.lookup(id, rec));
+  h.recordSighting(id, 100000);
+  h.compact();
+  TEST_ASSERT_TRUE(h.lookup(id, rec));
+  TEST_ASSERT_EQUAL_UINT32(100000, rec.lastSeen);
+}
+
+// The 16 MB layout's partition holds 100k devices and survives a reopen
+static void test_large_partition() {
+  uint8_t id[6];
+  {
+    DeviceHistory h;
+    TEST_ASSERT_TRUE(h.begin(HISTORY_TEST_FILE, 0x3F0000));
+    TEST_ASSERT_TRUE(h.stats().capacity >= 100000);
+    for (uint32_t i = 0; i < 100000; i++) {
+      mac(i * 7919, id);
+      h.recordSighting(id, i + 1);
+    }
+    h.compact();
+    HistoryStats s = h.stats();
+    TEST_ASSERT_EQUAL_UINT32(100000, s.baseCount);
+    TEST_ASSERT_EQUAL_UINT32(0, s.dropped);
+  }
+  DeviceHistory h;
+  TEST_ASSERT_TRUE(h.begin(HISTORY_TEST_FILE, 0x3F0000));
+  HistoryRecord rec;
+  for (uint32_t i = 0; i < 100000; i += 97) {
+    mac(i * 7919, id);
+    TEST_ASSERT_TRUE(h.lookup(id, rec));
+    TEST_ASSERT_EQUAL_UINT32(i + 1, rec.firstSeen);
+  }
+}
+
+// Times go on from the newest stored one after a reboot without a wall
+// clock; a clock behind a record never moves it back, and hour bits only
+// come from wall-clock times
+static void test_clock() {
+  const uint32_t wall = (HISTORY_WALL_MINUTES / 1440 + 100) * 1440 + 13 * 60;   // 13:00
+  uint8_t a[6], b[6], c[6];
+  mac(1, a);
+  mac(2, b);
+  mac(3, c);
+  {
+    DeviceHistory h;
+    TEST_ASSERT_TRUE(h.begin(HISTORY_TEST_FILE, HISTORY_TEST_BYTES));
+    TEST_ASSERT_EQUAL_UINT32(1, h.resumeMinutes());
+    h.recordSighting(a, 0);   // no clock yet
+    h.recordSighting(b, 500);
+    h.recordSighting(c, wall);
+  }
+  DeviceHistory h;
+  TEST_ASSERT_TRUE(h.begin(HISTORY_TEST_FILE, HISTORY_TEST_BYTES));
+  TEST_ASSERT_EQUAL_UINT32(wall + 1, h.resumeMinutes());
+  HistoryRecord rec;
+  TEST_ASSERT_FALSE(h.lookup(a, rec));
+  TEST_ASSERT_TRUE(h.lookup(b, rec));
+  TEST_ASSERT_EQUAL_HEX8(0, rec.hours[0] | rec.hours[1] | rec.hours[2]);
+  TEST_ASSERT_TRUE(h.lookup(c, rec));
+  TEST_ASSERT_EQUAL_HEX8(1 << 5, rec.hours[1]);
+
+  // An uptime clock behind the record: lastSeen stays, the count too
+  h.recordSighting(c, 900);
+  TEST_ASSERT_TRUE(h.lookup(c, rec));
+  TEST_ASSERT_EQUAL_UINT32(wall, rec.lastSeen);
+  TEST_ASSERT_EQUAL_UINT16(1, rec.count);
+  h.compact();
+  h.recordSighting(c, wall + 60);
+  TEST_ASSERT_TRUE(h.lookup(c, rec));
+  TEST_ASSERT_EQUAL_UINT32(wall + 60, rec.lastSeen);
+  TEST_ASSERT_EQUAL_HEX8(3 << 5, rec.hours[1]);
+  TEST_ASSERT_EQUAL_UINT16(2, rec.count);
+}
+
+// Readers never miss a device that was recorded before they looked, even
+// while a compaction moves it from the log into the other base
+static void test_lookups_during_compaction() {
+  DeviceHistory h;
+  TEST_ASSERT_TRUE(h.begin(HISTORY_TEST_FILE, HISTORY_TEST_BYTES));
+  std::atomic<uint32_t> recorded(0);
+  std::atomic<bool> done(false);
+  std::thread writer([&]() {
+    uint8_t id[6];
+    // Sightings again until the compactor got to run (one core runs them in turn)
+    for (uint32_t i = 0; i < 1000 || h.stats().compactions < 2; i++) {
+      if (i % 16 == 0) std::this_thread::yield();
+      mac(i % 1000, id);
+      h.recordSighting(id, i * 20 + 1);
+      if (i < 1000) recorded = i + 1;
+    }
+    done = true;
+  });
+  std::thread compactor([&]() {
+    while (!done) h.compact();
+  });
+  uint32_t missing = 0, lookups = 0;
+  while (!done) {
+    uint32_t n = recorded;
+    for (uint32_t i = 0; i < n; i += 7) {
+      uint8_t id[6];
+      HistoryRecord rec;
+      mac(i, id);
+      if (!h.lookup(id, rec)) missing++;
+      lookups++;
+    }
+  }
+  writer.join();
+  compactor.join();
+  TEST_ASSERT_EQUAL_UINT32(0, missing);
+  TEST_ASSERT_EQUAL_UINT32(0, h.stats().skipped);
+  TEST_ASSERT_TRUE(h.stats().compactions > 1);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_layout_of_a_small_partition);
+  RUN_TEST(test_sightings_survive_compaction_and_reopen);
+  RUN_TEST(test_full_base_keeps_known_devices);
+  RUN_TEST(test_large_partition);
+  RUN_TEST(test_clock);
+  RUN_TEST(test_lookups_during_compaction);
+  return UNITY_END();
+}
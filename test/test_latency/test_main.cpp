@@ -0,0 +1,89 @@
+// LatencyHistogram bucket and percentile math
+#include <unity.h>
+#include "LatencyHistogram.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_small_values_are_exact() {
+  for (uint32_t v = 0; v < LatencyHistogram::SUB_BUCKETS; v++) {
+    TEST_ASSERT_EQUAL_INT(v, LatencyHistogram::bucketIndex(v));
+    TEST_ASSERT_EQUAL_UINT32(v, LatencyHistogram::bucketUpperBound(v));
+  }
+}
+
+// Every value lands in a bucket whose upper bound is at most 12.5% above it
+static void test_bucket_error_bound() {
+  int prev = 0;
+  for (uint64_t v = 1; v <= 0xFFFFFFFFull; v += v / 7 + 1) {
+    int index = LatencyHistogram::bucketIndex((uint32_t)v);
+    TEST_ASSERT_TRUE(index >= prev);
+    TEST_ASSERT_TRUE(index < LatencyHistogram::BUCKET_COUNT);
+    uint32_t upper = LatencyHistogram::bucketUpperBound(index);
+    TEST_ASSERT_TRUE(upper >= v);
+    TEST_ASSERT_TRUE(upper - v <= v / 8);
+    prev = index;
+  }
+  TEST_ASSERT_EQUAL_INT(LatencyHistogram::BUCKET_COUNT - 1, LatencyHistogram::bucketIndex(0xFFFFFFFFu));
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, LatencyHistogram::bucketUpperBound(LatencyHistogram::BUCKET_COUNT - 1));
+}
+
+// Bucket boundaries: the first value of each bucket is one past the
+// previous bucket's upper bound
+static void test_buckets_are_contiguous() {
+  for (int i = 1; i < LatencyHistogram::BUCKET_COUNT; i++) {
+    uint32_t first = LatencyHistogram::bucketUpperBound(i - 1) + 1;
+    TEST_ASSERT_EQUAL_INT(i, LatencyHistogram::bucketIndex(first));
+  }
+}
+
+static void test_empty_percentile_is_zero() {
+  LatencyHistogram h;
+  TEST_ASSERT_EQUAL_UINT32(0, h.count());
+  TEST_ASSERT_EQUAL_UINT32(0, h.percentile(0.5));
+  TEST_ASSERT_EQUAL_UINT32(0, h.percentile(1.0));
+}
+
+static void test_percentiles() {
+  LatencyHistogram h;
+  for (uint32_t v = 1; v <= 1000; v++) h.record(v);
+  TEST_ASSERT_EQUAL_UINT32(1000, h.count());
+  TEST_ASSERT_EQUAL_UINT32(1000, h.max());
+
+  uint32_t p50 = h.percentile(0.5);
+  TEST_ASSERT_TRUE(p50 >= 500 && p50 <= 500 + 500 / 8);
+  uint32_t p99 = h.percentile(0.99);
+  TEST_ASSERT_TRUE(p99 >= 990 && p99 <= 1000);
+  TEST_ASSERT_EQUAL_UINT32(1, h.percentile(0.0));
+  // Never above the largest value recorded
+  TEST_ASSERT_EQUAL_UINT32(1000, h.percentile(1.0));
+}
+
+static void test_single_value_is_clamped_to_max() {
+  LatencyHistogram h;
+  h.record(1234);
+  TEST_ASSERT_EQUAL_UINT32(1234, h.percentile(0.5));
+  TEST_ASSERT_EQUAL_UINT32(1234, h.percentile(0.999));
+}
+
+static void test_reset() {
+  LatencyHistogram h;
+  h.record(10);
+  h.record(100000);
+  h.reset();
+  TEST_ASSERT_EQUAL_UINT32(0, h.count());
+  TEST_ASSERT_EQUAL_UINT32(0, h.max());
+  TEST_ASSERT_EQUAL_UINT32(0, h.percentile(0.99));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_small_values_are_exact);
+  RUN_TEST(test_bucket_error_bound);
+  RUN_TEST(test_buckets_are_contiguous);
+  RUN_TEST(test_empty_percentile_is_zero);
+  RUN_TEST(test_percentiles);
+  RUN_TEST(test_single_value_is_clamped_to_max);
+  RUN_TEST(test_reset);
+  return UNITY_END();
+}
@@ -0,0 +1,218 @@
+// Scan response merging: interleaved ADV/SCAN_RSP sequences from several
+// advertisers come out as one report per device, parsed once; repeats of
+// the same bytes yield nothing, and late or missing halves are handled
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ScanMerge.h"
+
+#define WINDOW_DEVICES 12
+#define WINDOW_REPEATS 6   // each advertiser's pair, heard again and again
+
+static ScanMerge* merge;
+
+void setUp() {
+  merge = new ScanMerge();
+  merge->configure(true, false);
+}
+
+void tearDown() {
+  delete merge;
+}
+
+static void addr(uint8_t bda[6], int n) {
+  for (int i = 0; i < 6; i++) bda[i] = 0xA0 + i;
+  bda[5] = n;
+}
+
+// Flags plus a name, or a 16-bit service list for the scan response
+static uint8_t advData(uint8_t* out, int n) {
+  const uint8_t adv[] = {0x02, 0x01, 0x06, 0x05, 0x09, 'd', 'e', 'v', (uint8_t)('0' + n)};
+  memcpy(out, adv, sizeof(adv));
+  return sizeof(adv);
+}
+
+static uint8_t rspData(uint8_t* out, int n) {
+  const uint8_t rsp[] = {0x03, 0x03, 0x0F, (uint8_t)(0x18 + n)};
+  memcpy(out, rsp, sizeof(rsp));
+  return sizeof(rsp);
+}
+
+static void adv(int n, uint8_t evtType, uint32_t nowMs) {
+  uint8_t bda[6], data[31];
+  addr(bda, n);
+  merge->add(bda, 0, evtType, -50 - n, data, advData(data, n), 0, nowMs);
+}
+
+static void rsp(int n, uint32_t nowMs) {
+  uint8_t bda[6], data[31];
+  addr(bda, n);
+  merge->add(bda, 0, ADV_EVT_SCAN_RSP, -60 - n, data, rspData(data, n), 0, nowMs);
+}
+
+// Both halves of device n, advertising data first
+static void checkPair(const ScanReport* r, int n) {
+  TEST_ASSERT_NOT_NULL(r);
+  TEST_ASSERT_EQUAL_HEX8(n, r->bda[5]);
+  uint8_t a[31], s[31];
+  uint8_t advLen = advData(a, n), rspLen = rspData(s, n);
+  TEST_ASSERT_EQUAL_UINT8(advLen, r->advLen);
+  TEST_ASSERT_EQUAL_UINT8(rspLen, r->rspLen);
+  TEST_ASSERT_EQUAL_MEMORY(a, r->payload, advLen);
+  TEST_ASSERT_EQUAL_MEMORY(s, r->payload + advLen, rspLen);
+}
+
+static void test_interleaved_pairs() {
+  adv(1, ADV_EVT_CONN_ADV, 0);
+  adv(2, ADV_EVT_DISC_ADV, 1);
+  adv(3, ADV_EVT_NON_CONN_ADV, 2);   // not scannable: ready at once
+  const ScanReport* r = merge->next(3);
+  TEST_ASSERT_NOT_NULL(r);
+  TEST_ASSERT_EQUAL_HEX8(3, r->bda[5]);
+  TEST_ASSERT_EQUAL_UINT8(0, r->rspLen);
+  TEST_ASSERT_NULL(merge->next(3));
+
+  rsp(2, 4);
+  rsp(1, 5);
+  checkPair(merge->next(6), 1);
+  r = merge->next(6);
+  checkPair(r, 2);
+  // The event type stays the advertisement's; the RSSI is the latest
+  TEST_ASSERT_EQUAL_UINT8(ADV_EVT_DISC_ADV, r->evtType);
+  TEST_ASSERT_FALSE(advConnectable(r->evtType));
+  TEST_ASSERT_EQUAL_INT(-62, r->rssi);
+  TEST_ASSERT_NULL(merge->next(6));
+
+  const ScanMergeStats& st = merge->stats();
+  TEST_ASSERT_EQUAL_UINT32(5, st.reports);
+  TEST_ASSERT_EQUAL_UINT32(3, st.delivered);
+  TEST_ASSERT_EQUAL_UINT32(2, st.merged);
+  TEST_ASSERT_EQUAL_UINT32(0, st.expired);
+}
+
+static void test_repeats_yield_nothing() {
+  adv(1, ADV_EVT_CONN_ADV, 0);
+  adv(1, ADV_EVT_CONN_ADV, 10);   // same bytes while held
+  rsp(1, 20);
+  checkPair(merge->next(20), 1);
+  for (uint32_t t = 30; t < 1000; t += 10) {
+    adv(1, ADV_EVT_CONN_ADV, t);
+    rsp(1, t + 5);
+    TEST_ASSERT_NULL(merge->next(t + 5));
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, merge->stats().delivered);
+  TEST_ASSERT_EQUAL_UINT32(1 + 2 * 97, merge->stats().repeats);
+}
+
+// An ADV whose response is late goes out alone after the hold, and once
+// more when the response arrives; then the device is settled
+static void test_late_and_missing_responses() {
+  adv(1, ADV_EVT_CONN_ADV, 0);
+  TEST_ASSERT_NULL(merge->next(SCAN_MERGE_HOLD_MS - 1));
+  const ScanReport* r = merge->next(SCAN_MERGE_HOLD_MS);
+  TEST_ASSERT_NOT_NULL(r);
+  TEST_ASSERT_EQUAL_UINT8(0, r->rspLen);
+  TEST_ASSERT_EQUAL_UINT32(1, merge->stats().expired);
+
+  rsp(1, 300);
+  checkPair(merge->next(300), 1);
+  adv(1, ADV_EVT_CONN_ADV, 400);
+  rsp(1, 401);
+  TEST_ASSERT_NULL(merge->next(500));
+
+  // Held reports all go at the end of the scan
+  adv(2, ADV_EVT_CONN_ADV, 600);
+  adv(3, ADV_EVT_CONN_ADV, 601);
+  TEST_ASSERT_NULL(merge->next(602));
+  TEST_ASSERT_NOT_NULL(merge->next(602, true));
+  TEST_ASSERT_NOT_NULL(merge->next(602, true));
+  TEST_ASSERT_NULL(merge->next(602, true));
+}
+
+static void test_passive_and_duplicates() {
+  merge->configure(false, false);
+  adv(1, ADV_EVT_CONN_ADV, 0);
+  TEST_ASSERT_NOT_NULL(merge->next(0));
+  adv(1, ADV_EVT_CONN_ADV, 10);
+  TEST_ASSERT_NULL(merge->next(10));
+
+  // With duplicates every pair comes out again, merged, one parse each
+  merge->clear();
+  merge->configure(true, true);
+  for (uint32_t t = 0; t < 50; t += 10) {
+    adv(2, ADV_EVT_CONN_ADV, t);
+    TEST_ASSERT_NULL(merge->next(t));
+    rsp(2, t + 1);
+    checkPair(merge->next(t + 1), 2);
+    TEST_ASSERT_NULL(merge->next(t + 1));
+  }
+}
+
+// More advertisers waiting than slots: the extra ones are not held
+static void test_overflow_is_ready_at_once() {
+  for (int n = 0; n < SCAN_MERGE_SLOTS; n++) adv(n, ADV_EVT_CONN_ADV, 0);
+  TEST_ASSERT_NULL(merge->next(1));
+  adv(200, ADV_EVT_CONN_ADV, 1);
+  const ScanReport* r = merge->next(1);
+  TEST_ASSERT_NOT_NULL(r);
+  TEST_ASSERT_EQUAL_HEX8(200, r->bda[5]);
+  TEST_ASSERT_NULL(merge->next(1));
+}
+
+// A window in arrival order: every advertiser's ADV and SCAN_RSP
+// interleaved with everyone else's, each pair heard several times. Every
+// device is parsed exactly once, with both halves.
+static void test_one_parse_per_pair() {
+  struct Event {
+    int device;
+    bool response;
+  };
+  Event events[WINDOW_DEVICES * WINDOW_REPEATS * 2];
+  int count = 0;
+  // Each round, a random advertiser sends its next half until all are done
+  srand(7);
+  for (int rep = 0; rep < WINDOW_REPEATS; rep++) {
+    int sent[WINDOW_DEVICES] = {};
+    for (int left = 2 * WINDOW_DEVICES; left > 0; left--) {
+      int d;
+      do d = rand() % WINDOW_DEVICES; while (sent[d] == 2);
+      events[count++] = {d, sent[d]++ == 1};
+    }
+  }
+
+  int parsed[WINDOW_DEVICES] = {};
+  int parses = 0;
+  for (int i = 0; i < count; i++) {
+    uint32_t t = i;
+    if (events[i].response) rsp(events[i].device, t);
+    else adv(events[i].device, ADV_EVT_CONN_ADV, t);
+    while (const ScanReport* r = merge->next(t)) {
+      TEST_ASSERT_TRUE(r->bda[5] < WINDOW_DEVICES);
+      checkPair(r, r->bda[5]);
+      parsed[r->bda[5]]++;
+      parses++;
+    }
+  }
+  TEST_ASSERT_NULL(merge->next(count, true));
+  for (int d = 0; d < WINDOW_DEVICES; d++) TEST_ASSERT_EQUAL_INT(1, parsed[d]);
+  const ScanMergeStats& st = merge->stats();
+  TEST_ASSERT_EQUAL_UINT32(count, st.reports);
+  TEST_ASSERT_EQUAL_UINT32(WINDOW_DEVICES, st.delivered);
+  TEST_ASSERT_EQUAL_UINT32(WINDOW_DEVICES, st.merged);
+  TEST_ASSERT_EQUAL_UINT32(count - 2 * WINDOW_DEVICES, st.repeats);
+  TEST_ASSERT_EQUAL_UINT32(0, st.expired);
+  char msg[80];
+  snprintf(msg, sizeof(msg), "%d reports, %d parses", count, parses);
+  TEST_MESSAGE(msg);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_interleaved_pairs);
+  RUN_TEST(test_repeats_yield_nothing);
+  RUN_TEST(test_late_and_missing_responses);
+  RUN_TEST(test_passive_and_duplicates);
+  RUN_TEST(test_overflow_is_ready_at_once);
+  RUN_TEST(test_one_parse_per_pair);
+  return UNITY_END();
+}
@@ -0,0 +1,216 @@
+// Advertisement parse cache: the hash against the XXH32 reference, cached
+// fields that always match a fresh parse while payloads mutate (an
+// Eddystone beacon rotating UID and TLM frames, its TLM counters ticking),
+// the parse count that leaves, and a duplicate scan benchmarked with and
+// without the cache
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "AdvData.h"
+#include "ScanMerge.h"
+
+#define TLM_REPORTS 3000
+#define BENCH_ADVERTISERS 40
+#define BENCH_REPORTS 400000
+#define BENCH_CHANGE_PERCENT 10
+
+void setUp() {}
+void tearDown() {}
+
+static void test_hash_reference_vectors() {
+  TEST_ASSERT_EQUAL_HEX32(0x02CC5D05, advHash((const uint8_t*)"", 0));
+  TEST_ASSERT_EQUAL_HEX32(0x550D7456, advHash((const uint8_t*)"a", 1));
+  TEST_ASSERT_EQUAL_HEX32(0x32D153FF, advHash((const uint8_t*)"abc", 3));
+  const char* s = "Nobody inspects the spammish repetition";
+  TEST_ASSERT_EQUAL_HEX32(0xE2293B2F, advHash((const uint8_t*)s, strlen(s)));
+
+  // No single-bit flip of a full merged payload keeps its hash
+  uint8_t p[2 * SCAN_MERGE_DATA_MAX];
+  for (size_t i = 0; i < sizeof(p); i++) p[i] = i * 37;
+  uint32_t h = advHash(p, sizeof(p));
+  for (size_t bit = 0; bit < 8 * sizeof(p); bit++) {
+    p[bit / 8] ^= 1 << (bit % 8);
+    TEST_ASSERT_TRUE(advHash(p, sizeof(p)) != h);
+    p[bit / 8] ^= 1 << (bit % 8);
+  }
+}
+
+// Eddystone on service 0xFEAA, name in the scan response. UID frames
+// never change; TLM frames carry a PDU count and uptime that do.
+static size_t eddystone(uint8_t* out, bool tlm, uint32_t advCount, uint32_t uptime) {
+  uint8_t* p = out;
+  *p++ = 2, *p++ = 0x01, *p++ = 0x06;
+  *p++ = 3, *p++ = 0x03, *p++ = 0xAA, *p++ = 0xFE;
+  if (tlm) {
+    *p++ = 17, *p++ = 0x16, *p++ = 0xAA, *p++ = 0xFE;
+    *p++ = 0x20, *p++ = 0x00;
+    *p++ = 0x0B, *p++ = 0xB8;   // 3000 mV
+    *p++ = 0x17, *p++ = 0x80;   // 23.5 C
+    for (int i = 3; i >= 0; i--) *p++ = advCount >> (8 * i);
+    for (int i = 3; i >= 0; i--) *p++ = uptime >> (8 * i);
+  } else {
+    *p++ = 23, *p++ = 0x16, *p++ = 0xAA, *p++ = 0xFE;
+    *p++ = 0x00, *p++ = 0xEB;   // UID, TX power at 0 m
+    for (int i = 0; i < 18; i++) *p++ = 0x40 + i;
+  }
+  const char name[] = "beacon";
+  *p++ = sizeof(name), *p++ = 0x09;
+  memcpy(p, name, sizeof(name) - 1);
+  p += sizeof(name) - 1;
+  return p - out;
+}
+
+static void assertSameFields(const AdvFields& expected, const AdvFields& actual) {
+  TEST_ASSERT_EQUAL_STRING(expected.name, actual.name);
+  TEST_ASSERT_EQUAL_STRING(expected.serviceUUID, actual.serviceUUID);
+  TEST_ASSERT_EQUAL(expected.haveTxPower, actual.haveTxPower);
+  TEST_ASSERT_EQUAL_INT(expected.txPower, actual.txPower);
+}
+
+static void test_rotating_tlm_beacon() {
+  AdvParseCache* cache = new AdvParseCache();
+  const uint8_t beacon[6] = {0xE1, 0xD5, 0, 0, 0, 1};
+  const uint8_t tag[6] = {0xE1, 0xD5, 0, 0, 0, 2};   // the same bytes all along
+  uint8_t p[2 * SCAN_MERGE_DATA_MAX], q[2 * SCAN_MERGE_DATA_MAX];
+  size_t tagLen = eddystone(q, false, 0, 0);
+  uint32_t count = 0, uptime = 0, changes = 0;
+  size_t prevLen = 0;
+  uint8_t prev[sizeof(p)];
+  for (uint32_t i = 0; i < TLM_REPORTS; i++) {
+    // Ten UID frames, then TLM frames; the uptime ticks every tenth report
+    bool tlm = (i / 10) % 2 == 1;
+    if (i % 10 == 0) uptime++;
+    count++;
+    size_t len = eddystone(p, tlm, tlm ? count / 10 : 0, uptime);
+    if (len != prevLen || memcmp(p, prev, len) != 0) changes++;
+    memcpy(prev, p, len);
+    prevLen = len;
+
+    AdvFields fresh = {};
+    advParse(p, len, fresh);
+    const AdvFields& cached = cache->parse(beacon, p, len, i);
+    assertSameFields(fresh, cached);
+    TEST_ASSERT_EQUAL_STRING("beacon", cached.name);
+    TEST_ASSERT_EQUAL_STRING("0000feaa-0000-1000-8000-00805f9b34fb", cached.serviceUUID);
+    cache->parse(tag, q, tagLen, i);
+  }
+  const AdvCacheStats& st = cache->stats();
+  char msg[80];
+  snprintf(msg, sizeof(msg), "%u reports, %u parses", 2 * TLM_REPORTS, st.misses);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL_UINT32(changes + 1, st.misses);
+  TEST_ASSERT_EQUAL_UINT32(2 * TLM_REPORTS - changes - 1, st.hits);
+  delete cache;
+}
+
+// The length is part of the key: an advertisement and the same bytes with
+// a late scan response behind them are parsed separately
+static void test_length_and_eviction() {
+  AdvParseCache* cache = new AdvParseCache();
+  uint8_t p[2 * SCAN_MERGE_DATA_MAX];
+  size_t len = eddystone(p, false, 0, 0);
+  const uint8_t id[6] = {1, 2, 3, 4, 5, 6};
+  TEST_ASSERT_EQUAL_STRING("", cache->parse(id, p, len - 8, 0).name);
+  TEST_ASSERT_EQUAL_STRING("beacon", cache->parse(id, p, len, 1).name);
+  TEST_ASSERT_EQUAL_UINT32(2, cache->stats().misses);
+
+  // Round robin over more advertisers than slots: every lookup misses, and
+  // none returns another device's fields
+  uint8_t bda[6] = {0xAA, 0, 0, 0, 0, 0};
+  for (int round = 0; round < 3; round++) {
+    for (int d = 0; d < ADV_CACHE_SLOTS + 8; d++) {
+      bda[5] = d;
+      uint8_t ad[20] = {7, 0x09};
+      snprintf((char*)ad + 2, 18, "dev%03d", d);
+      uint32_t now = 10 + round * 1000 + d;
+      TEST_ASSERT_EQUAL_STRING((char*)ad + 2, cache->parse(bda, ad, 2 + strlen((char*)ad + 2), now).name);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, cache->stats().hits);
+  TEST_ASSERT_EQUAL_UINT32(3 * (ADV_CACHE_SLOTS + 8) - ADV_CACHE_SLOTS + 1, cache->stats().evictions);
+  delete cache;
+}
+
+// --- Duplicate scan: every report comes out of the merge again ---
+
+struct Advertiser {
+  uint8_t bda[6];
+  uint8_t adv[SCAN_MERGE_DATA_MAX];
+  uint8_t advLen;
+  uint8_t rsp[SCAN_MERGE_DATA_MAX];
+  uint8_t rspLen;
+};
+
+static double duplicateScan(Advertiser* list, bool cached, uint32_t* parses) {
+  static ScanMerge merge;
+  static AdvParseCache cache;
+  static AdvFields fields[BENCH_ADVERTISERS];
+  merge.clear();
+  merge.configure(true, true);
+  cache.clear();
+  srand(1);
+  uint32_t misses = 0;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_REPORTS / 2; i++) {
+    Advertiser& a = list[i % BENCH_ADVERTISERS];
+    if (rand() % 100 < BENCH_CHANGE_PERCENT) a.adv[a.advLen - 1]++;   // a counter in the payload
+    merge.add(a.bda, 0, ADV_EVT_CONN_ADV, -60, a.adv, a.advLen, 0, i);
+    merge.add(a.bda, 0, ADV_EVT_SCAN_RSP, -60, a.rsp, a.rspLen, 0, i);
+    for (const ScanReport* r = merge.next(i); r; r = merge.next(i)) {
+      AdvFields& f = fields[r->bda[5]];
+      if (cached) {
+        f = cache.parse(r->bda, r->payload, r->advLen + r->rspLen, i);
+      } else {
+        memset(&f, 0, sizeof(f));
+        advParse(r->payload, r->advLen + r->rspLen, f);
+        misses++;
+      }
+    }
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  *parses = cached ? cache.stats().misses : misses;
+  return ns / BENCH_REPORTS;
+}
+
+static void test_duplicate_scan_benchmark() {
+  static Advertiser list[BENCH_ADVERTISERS];
+  for (int i = 0; i < BENCH_ADVERTISERS; i++) {
+    Advertiser& a = list[i];
+    memset(&a, 0, sizeof(a));
+    a.bda[0] = 0xC4;
+    a.bda[5] = i;
+    // Flags, TX power, a 128-bit service and manufacturer data
+    uint8_t* p = a.adv;
+    *p++ = 2, *p++ = 0x01, *p++ = 0x06;
+    *p++ = 2, *p++ = 0x0A, *p++ = 0xF4;
+    *p++ = 17, *p++ = 0x07;
+    for (int k = 0; k < 16; k++) *p++ = i * 16 + k;
+    *p++ = 5, *p++ = 0xFF, *p++ = 0x4C, *p++ = 0x00, *p++ = 0x10, *p++ = 0x00;
+    a.advLen = p - a.adv;
+    a.rspLen = 2 + snprintf((char*)a.rsp + 2, sizeof(a.rsp) - 2, "advertiser-%02d", i);
+    a.rsp[0] = a.rspLen - 1;
+    a.rsp[1] = 0x09;
+  }
+  Advertiser copy[BENCH_ADVERTISERS];
+  memcpy(copy, list, sizeof(copy));
+  uint32_t parsedAll, parsedCached;
+  double plain = duplicateScan(copy, false, &parsedAll);
+  memcpy(copy, list, sizeof(copy));
+  double cached = duplicateScan(copy, true, &parsedCached);
+  char msg[120];
+  snprintf(msg, sizeof(msg), "%d advertisers, %d%% changing: %.0f ns/report parsing every one, %.0f ns cached (%u of %u parsed)",
+           BENCH_ADVERTISERS, BENCH_CHANGE_PERCENT, plain, cached, parsedCached, parsedAll);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(parsedCached * 100 < parsedAll * (BENCH_CHANGE_PERCENT + 5));
+  TEST_ASSERT_TRUE(cached < plain);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_hash_reference_vectors);
+  RUN_TEST(test_rotating_tlm_beacon);
+  RUN_TEST(test_length_and_eviction);
+  RUN_TEST(test_duplicate_scan_benchmark);
+  return UNITY_END();
+}
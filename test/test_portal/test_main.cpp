@@ -0,0 +1,383 @@
+// Config portal over real sockets: a minimal HTTP front end stands in for
+// WebServer (request line, Host header, query and form arguments) and
+// hands every request to portalHandle(); settings go through ConfigStore
+// on the host NVS stand-in, so write coalescing is checked end to end
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <map>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "PortalApi.h"
+#include "PortalAssets.h"
+
+#define PORTAL_TEST_ADDRESS "192.168.4.1"
+
+static uint32_t clockMs;
+static int applied;
+
+static void defaults(Config& c) {
+  memset(&c, 0, sizeof(c));
+  c.scanIntervalS = 10;
+  snprintf(c.stream, sizeof(c.stream), "off");
+  snprintf(c.collectorHost, sizeof(c.collectorHost), "192.168.1.10");
+  c.collectorPort = 5005;
+}
+
+class TestHooks : public PortalHooks {
+public:
+  const char* address() override { return PORTAL_TEST_ADDRESS; }
+  void getConfig(Config& out) override { configStore.get(out); }
+  void setConfig(const Config& next) override {
+    configStore.update(next, clockMs);
+    applied++;
+  }
+  int streams(const char** names, int max) override {
+    static const char* const all[] = {"serial", "udp"};
+    int n = max < 2 ? max : 2;
+    for (int i = 0; i < n; i++) names[i] = all[i];
+    return n;
+  }
+  size_t status(char* out, size_t cap) override { return snprintf(out, cap, "{\"ok\":1}"); }
+  // "big" stands for a batch that does not fit the reply buffer
+  size_t changes(const char* table, const char* since, char* out, size_t cap) override {
+    if (strcmp(table, "big") == 0) return cap;
+    if (strcmp(table, "wifi") != 0) return 0;
+    return snprintf(out, cap, "cursor 1:9 since %s\n", since);
+  }
+};
+
+static TestHooks hooks;
+
+// --- HTTP front end, one request per connection ---
+
+static std::string urlDecode(const std::string& s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '+') out += ' ';
+    else if (s[i] == '%' && i + 2 < s.size()) {
+      out += (char)strtol(s.substr(i + 1, 2).c_str(), nullptr, 16);
+      i += 2;
+    } else {
+      out += s[i];
+    }
+  }
+  return out;
+}
+
+// Arguments from the query string and a form body, as WebServer has them
+class SocketRequest : public PortalRequest {
+public:
+  bool isPost = false;
+  std::string uri;
+  std::string hostHeader;
+  std::map<std::string, std::string> args;
+  std::string value;
+
+  bool post() const override { return isPost; }
+  const char* path() const override { return uri.c_str(); }
+  const char* host() const override { return hostHeader.c_str(); }
+  const char* arg(const char* name) override {
+    auto it = args.find(name);
+    if (it == args.end()) return nullptr;
+    value = it->second;
+    return value.c_str();
+  }
+
+  void parseArgs(const std::string& s) {
+    size_t at = 0;
+    while (at < s.size()) {
+      size_t end = s.find('&', at);
+      if (end == std::string::npos) end = s.size();
+      std::string pair = s.substr(at, end - at);
+      size_t eq = pair.find('=');
+      if (eq != std::string::npos) args[urlDecode(pair.substr(0, eq))] = urlDecode(pair.substr(eq + 1));
+      at = end + 1;
+    }
+  }
+};
+
+class PortalServer {
+public:
+  bool start() {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (sockaddr*)&addr, len) != 0 || listen(fd, 4) != 0) return false;
+    getsockname(fd, (sockaddr*)&addr, &len);
+    port = ntohs(addr.sin_port);
+    thread = std::thread([this]() { serve(); });
+    return true;
+  }
+
+  void stop() {
+    shutdown(fd, SHUT_RDWR);
+    close(fd);
+    thread.join();
+  }
+
+  uint16_t port = 0;
+
+private:
+  void serve() {
+    for (;;) {
+      int c = accept(fd, nullptr, nullptr);
+      if (c < 0) break;
+      handle(c);
+      close(c);
+    }
+  }
+
+  void handle(int c) {
+    std::string in;
+    char buf[2048];
+    size_t headerEnd;
+    while ((headerEnd = in.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = recv(c, buf, sizeof(buf), 0);
+      if (n <= 0) return;
+      in.append(buf, n);
+    }
+    SocketRequest req;
+    size_t contentLength = 0;
+    size_t lineEnd = in.find("\r\n");
+    std::string line = in.substr(0, lineEnd);
+    req.isPost = line.compare(0, 5, "POST ") == 0;
+    size_t target = line.find(' ') + 1;
+    std::string uri = line.substr(target, line.find(' ', target) - target);
+    size_t q = uri.find('?');
+    req.uri = uri.substr(0, q);
+    if (q != std::string::npos) req.parseArgs(uri.substr(q + 1));
+    for (size_t at = lineEnd + 2; at < headerEnd;) {
+      size_t end = in.find("\r\n", at);
+      std::string h = in.substr(at, end - at);
+      if (strncasecmp(h.c_str(), "Host: ", 6) == 0) req.hostHeader = h.substr(6);
+      if (strncasecmp(h.c_str(), "Content-Length: ", 16) == 0) contentLength = atoi(h.c_str() + 16);
+      at = end + 2;
+    }
+    while (in.size() < headerEnd + 4 + contentLength) {
+      ssize_t n = recv(c, buf, sizeof(buf), 0);
+      if (n <= 0) return;
+      in.append(buf, n);
+    }
+    req.parseArgs(in.substr(headerEnd + 4, contentLength));
+
+    static char replyBuf[PORTAL_REPLY_MAX];
+    PortalReply r = portalHandle(req, hooks, replyBuf, sizeof(replyBuf));
+    std::string out = "HTTP/1.1 " + std::to_string(r.code) + " X\r\nContent-Type: " + r.type +
+                      "\r\nContent-Length: " + std::to_string(r.len) + "\r\nConnection: close\r\n";
+    if (r.location[0]) out += std::string("Location: ") + r.location + "\r\n";
+    if (r.gzip) out += "Content-Encoding: gzip\r\n";
+    out += "\r\n";
+    out.append((const char*)r.body, r.len);
+    send(c, out.data(), out.size(), 0);
+  }
+
+  int fd = -1;
+  std::thread thread;
+};
+
+static PortalServer server;
+
+struct Response {
+  int code;
+  std::string headers;
+  std::string body;
+};
+
+static Response http(const std::string& request) {
+  int c = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(server.port);
+  TEST_ASSERT_EQUAL_INT(0, connect(c, (sockaddr*)&addr, sizeof(addr)));
+  send(c, request.data(), request.size(), 0);
+  std::string in;
+  char buf[2048];
+  ssize_t n;
+  while ((n = recv(c, buf, sizeof(buf), 0)) > 0) in.append(buf, n);
+  close(c);
+  Response r;
+  r.code = atoi(in.c_str() + 9);
+  size_t end = in.find("\r\n\r\n");
+  r.headers = in.substr(0, end);
+  r.body = in.substr(end + 4);
+  return r;
+}
+
+static Response get(const std::string& uri, const char* host = PORTAL_TEST_ADDRESS) {
+  return http("GET " + uri + " HTTP/1.1\r\nHost: " + host + "\r\n\r\n");
+}
+
+static Response post(const std::string& uri, const std::string& form) {
+  return http("POST " + uri + " HTTP/1.1\r\nHost: " PORTAL_TEST_ADDRESS
+              "\r\nContent-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+              std::to_string(form.size()) + "\r\n\r\n" + form);
+}
+
+void setUp() {
+  configStore.flush();
+  configStoreHostErase();
+  Config c;
+  defaults(c);
+  configStore.begin(c);
+  clockMs = 0;
+  applied = 0;
+}
+
+void tearDown() {}
+
+static void test_assets_and_redirects() {
+  Response r = get("/");
+  TEST_ASSERT_EQUAL_INT(200, r.code);
+  TEST_ASSERT_TRUE(r.headers.find("Content-Encoding: gzip") != std::string::npos);
+  TEST_ASSERT_EQUAL_size_t(PORTAL_ASSETS[0].len, r.body.size());
+  TEST_ASSERT_EQUAL_MEMORY(PORTAL_ASSETS[0].data, r.body.data(), r.body.size());
+  TEST_ASSERT_EQUAL_INT(200, get("/index.html", PORTAL_TEST_ADDRESS ":80").code);
+  TEST_ASSERT_EQUAL_INT(200, get("/", "wscan-a1b2c3.local").code);
+  TEST_ASSERT_EQUAL_INT(404, get("/nothing").code);
+
+  // Captive-portal probes go to the portal
+  r = get("/generate_204", "connectivitycheck.gstatic.com");
+  TEST_ASSERT_EQUAL_INT(302, r.code);
+  TEST_ASSERT_TRUE(r.headers.find("Location: http://" PORTAL_TEST_ADDRESS "/") != std::string::npos);
+  TEST_ASSERT_EQUAL_INT(405, post("/api/status", "").code);
+  TEST_ASSERT_EQUAL_STRING("{\"ok\":1}", get("/api/status").body.c_str());
+}
+
+static void test_config_round_trip() {
+  Response r = post("/api/config",
+                    "scan=30&stream=udp&codec=1&chost=collector.lan&cport=6000"
+                    "&wssid=Home+Net&wpass=s3cret%26pass&rules=r1%3A+any+new+-%3E+alert%0D%0A");
+  TEST_ASSERT_EQUAL_INT(200, r.code);
+  TEST_ASSERT_EQUAL_INT(1, applied);
+  Config c;
+  configStore.get(c);
+  TEST_ASSERT_EQUAL_UINT16(30, c.scanIntervalS);
+  TEST_ASSERT_EQUAL_STRING("udp", c.stream);
+  TEST_ASSERT_TRUE(c.codec);
+  TEST_ASSERT_EQUAL_STRING("collector.lan", c.collectorHost);
+  TEST_ASSERT_EQUAL_UINT16(6000, c.collectorPort);
+  TEST_ASSERT_EQUAL_STRING("Home Net", c.staSsid);
+  TEST_ASSERT_EQUAL_STRING("s3cret&pass", c.staPassword);
+  TEST_ASSERT_EQUAL_STRING("r1: any new -> alert\n", c.rules);
+
+  // Read back without the passwords
+  r = get("/api/config");
+  TEST_ASSERT_EQUAL_INT(200, r.code);
+  TEST_ASSERT_TRUE(r.body.find("\"wssid\":\"Home Net\"") != std::string::npos);
+  TEST_ASSERT_TRUE(r.body.find("\"wpass\":true") != std::string::npos);
+  TEST_ASSERT_TRUE(r.body.find("\"streams\":[\"off\",\"serial\",\"udp\"]") != std::string::npos);
+  TEST_ASSERT_TRUE(r.body.find("\"rules\":\"r1: any new -> alert\\n\"") != std::string::npos);
+  TEST_ASSERT_TRUE(r.body.find("s3cret") == std::string::npos);
+}
+
+// One bad field rejects the whole form
+static void test_bad_fields_change_nothing() {
+  static const char* const bad[] = {
+    "scan=30&chost=bad+host",
+    "scan=4",
+    "stream=bluetooth",
+    "codec=yes",
+    "cport=0",
+    "appass=short",
+    "upurl=ftp%3A%2F%2Fx%2F",
+    "wssid=0123456789012345678901234567890123",
+    "rules=r1%3A+any+new+-%3E+alert%0Ar2%3A+nonsense",
+  };
+  for (const char* form : bad) {
+    Response r = post("/api/config", form);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(400, r.code, form);
+    TEST_ASSERT_TRUE(r.body.find("\"error\":") != std::string::npos);
+  }
+  TEST_ASSERT_TRUE(post("/api/config", bad[8]).body.find("rules line 2") != std::string::npos);
+  TEST_ASSERT_EQUAL_INT(0, applied);
+  Config c;
+  configStore.get(c);
+  TEST_ASSERT_EQUAL_UINT16(10, c.scanIntervalS);
+  TEST_ASSERT_FALSE(configStore.dirty());
+}
+
+static void test_sync_route() {
+  Response r = get("/api/sync?table=wifi&since=3%3A7");
+  TEST_ASSERT_EQUAL_INT(200, r.code);
+  TEST_ASSERT_TRUE(r.headers.find("Content-Type: text/plain") != std::string::npos);
+  TEST_ASSERT_EQUAL_STRING("cursor 1:9 since 3:7\n", r.body.c_str());
+  TEST_ASSERT_EQUAL_STRING("cursor 1:9 since 0\n", get("/api/sync?table=wifi").body.c_str());
+  TEST_ASSERT_EQUAL_INT(400, get("/api/sync").code);
+  TEST_ASSERT_EQUAL_INT(404, get("/api/sync?table=zigbee").code);
+  // Names are cut to the table buffer, not passed on whole
+  TEST_ASSERT_EQUAL_INT(404, get("/api/sync?table=wifiwifiwifi").code);
+  TEST_ASSERT_EQUAL_INT(500, get("/api/sync?table=big").code);
+}
+
+// A burst of submits is one commit of the keys that changed, once the
+// edits settle; a steady stream of edits still commits by the deadline
+static void test_writes_coalesce() {
+  // Loading the defaults writes nothing
+  uint32_t writes = configStoreHostWrites();
+  uint32_t commits = configStore.commits();
+  Config c;
+  defaults(c);
+  configStore.begin(c);
+  TEST_ASSERT_EQUAL_UINT32(writes, configStoreHostWrites());
+
+  clockMs = 0;
+  post("/api/config", "scan=30");
+  clockMs = 500;
+  post("/api/config", "scan=40&cport=6000");
+  clockMs = 1000;
+  post("/api/config", "scan=45");
+  configStore.tick(2000);
+  TEST_ASSERT_EQUAL_UINT32(commits, configStore.commits());
+  configStore.tick(1000 + CONFIG_SETTLE_MS);
+  TEST_ASSERT_EQUAL_UINT32(commits + 1, configStore.commits());
+  TEST_ASSERT_EQUAL_UINT32(writes + 2, configStoreHostWrites());
+
+  // Edits every second never settle: written at the deadline
+  for (clockMs = 5000; clockMs <= 5000 + CONFIG_MAX_DELAY_MS; clockMs += 1000) {
+    post("/api/config", clockMs % 2000 ? "scan=50" : "scan=60");
+    configStore.tick(clockMs);
+  }
+  TEST_ASSERT_EQUAL_UINT32(commits + 2, configStore.commits());
+
+  // Setting what is already stored commits nothing
+  configStore.flush();
+  commits = configStore.commits();
+  writes = configStoreHostWrites();
+  configStore.get(c);
+  configStore.update(c, clockMs);
+  configStore.flush();
+  TEST_ASSERT_EQUAL_UINT32(commits, configStore.commits());
+  TEST_ASSERT_EQUAL_UINT32(writes, configStoreHostWrites());
+
+  // A reboot loads what was committed over the defaults
+  ConfigStore again;
+  Config d;
+  defaults(d);
+  TEST_ASSERT_TRUE(again.begin(d));
+  again.get(d);
+  TEST_ASSERT_EQUAL_UINT16(c.scanIntervalS, d.scanIntervalS);
+  TEST_ASSERT_EQUAL_UINT16(6000, d.collectorPort);
+  TEST_ASSERT_EQUAL_STRING("192.168.1.10", d.collectorHost);
+}
+
+int main() {
+  if (!server.start()) return 1;
+  UNITY_BEGIN();
+  RUN_TEST(test_assets_and_redirects);
+  RUN_TEST(test_config_round_trip);
+  RUN_TEST(test_bad_fields_change_nothing);
+  RUN_TEST(test_sync_route);
+  RUN_TEST(test_writes_coalesce);
+  int failures = UNITY_END();
+  server.stop();
+  return failures;
+}
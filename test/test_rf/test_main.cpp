@@ -0,0 +1,184 @@
+// RF tracker fed synthetic rx_ctrl streams: quantiles that match the exact
+// ones of the samples, a PHY and rate mix in known proportions, old samples
+// fading out by half-lives when the environment changes, and counters that
+// halve early instead of overflowing on a busy channel
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "RfTracker.h"
+
+#define STREAM_SAMPLES 50000
+
+static RfTracker* tracker;
+
+void setUp() {
+  tracker = new RfTracker();
+}
+
+void tearDown() {
+  delete tracker;
+}
+
+static RfSample sample(uint8_t channel, int rssi, int noise) {
+  RfSample s = {};
+  s.channel = channel;
+  s.rssi = rssi;
+  s.noiseFloor = noise;
+  s.sigMode = 1;
+  return s;
+}
+
+// Nearest rank over the samples as the radio's 1 dB bins see them
+static int exact(std::vector<int> v, float q) {
+  for (int& x : v) x = std::min(std::max(x, RF_DBM_MIN), RF_DBM_MAX);
+  std::sort(v.begin(), v.end());
+  size_t rank = (size_t)(q * v.size());
+  if (rank < q * v.size() || rank < 1) rank++;
+  return v[rank - 1];
+}
+
+static void test_quantiles_match_exact() {
+  std::mt19937 rng(4);
+  std::normal_distribution<float> rssi(-65, 9);
+  std::normal_distribution<float> noise(-95, 1.5f);
+  std::vector<int> rs, ns;
+  for (int i = 0; i < STREAM_SAMPLES; i++) {
+    int r = lroundf(rssi(rng));
+    int n = lroundf(noise(rng));
+    if (i % 1000 == 0) r = -128, n = 0;   // a clipped reading, and no noise measurement
+    if (i % 1000 == 500) r = 0;
+    rs.push_back(r);
+    if (n < 0) ns.push_back(n);
+    tracker->add(sample(6, r, n), i / 10);
+  }
+  RfSummary s;
+  TEST_ASSERT_TRUE(tracker->summary(6, STREAM_SAMPLES / 10, s));
+  TEST_ASSERT_EQUAL_UINT32(STREAM_SAMPLES, s.frames);
+  TEST_ASSERT_EQUAL_UINT32(STREAM_SAMPLES, s.weight);
+  TEST_ASSERT_EQUAL_INT(exact(rs, 0.10f), s.rssiP10);
+  TEST_ASSERT_EQUAL_INT(exact(rs, 0.50f), s.rssiP50);
+  TEST_ASSERT_EQUAL_INT(exact(rs, 0.90f), s.rssiP90);
+  TEST_ASSERT_EQUAL_INT(exact(ns, 0.50f), s.noiseP50);
+  TEST_ASSERT_EQUAL_INT(exact(ns, 0.90f), s.noiseP90);
+  char msg[100];
+  snprintf(msg, sizeof(msg), "rssi p10/p50/p90 %d/%d/%d dBm, noise p50/p90 %d/%d dBm",
+           s.rssiP10, s.rssiP50, s.rssiP90, s.noiseP50, s.noiseP90);
+  TEST_MESSAGE(msg);
+
+  // Nothing heard elsewhere, and out-of-range channels are ignored
+  TEST_ASSERT_FALSE(tracker->summary(1, 0, s));
+  tracker->add(sample(0, -50, -90), 0);
+  tracker->add(sample(15, -50, -90), 0);
+  TEST_ASSERT_FALSE(tracker->summary(0, 0, s));
+  TEST_ASSERT_FALSE(tracker->summary(15, 0, s));
+}
+
+// A channel with a legacy 11b beacon source, 11g at 54 and 6 Mbps, and HT
+// at MCS 3 and 7 on 20 and 40 MHz
+static void test_phy_and_rate_mix() {
+  struct Mix {
+    uint8_t sigMode, rate, mcs, cwb;
+    int percent;
+  };
+  const Mix mix[] = {
+    {0, 0, 0, 0, 10},    // 1 Mbps long preamble
+    {0, 7, 0, 0, 5},     // 11 Mbps short preamble
+    {0, 12, 0, 0, 15},   // 54 Mbps
+    {0, 11, 0, 0, 5},    // 6 Mbps
+    {1, 0, 7, 0, 30},
+    {1, 0, 3, 0, 15},
+    {1, 0, 7, 1, 15},
+    {3, 0, 0, 0, 5},
+  };
+  for (int i = 0; i < 20000; i++) {
+    int pick = i % 100;
+    for (const Mix& m : mix) {
+      if (pick < m.percent) {
+        RfSample s = sample(11, -60, -92);
+        s.sigMode = m.sigMode;
+        s.rate = m.rate;
+        s.mcs = m.mcs;
+        s.cwb = m.cwb;
+        tracker->add(s, i);
+        break;
+      }
+      pick -= m.percent;
+    }
+  }
+  RfSummary s;
+  TEST_ASSERT_TRUE(tracker->summary(11, 20000, s));
+  TEST_ASSERT_EQUAL_UINT8(15, s.mixPct[RF_PHY_B]);
+  TEST_ASSERT_EQUAL_UINT8(20, s.mixPct[RF_PHY_G]);
+  TEST_ASSERT_EQUAL_UINT8(45, s.mixPct[RF_PHY_HT20]);
+  TEST_ASSERT_EQUAL_UINT8(15, s.mixPct[RF_PHY_HT40]);
+  TEST_ASSERT_EQUAL_UINT8(5, s.mixPct[RF_PHY_OTHER]);
+  // Legacy 1, 6, 11 and 54 Mbps at 10:5:5:15; the median is 11
+  TEST_ASSERT_EQUAL_UINT8(22, s.legacyRate);
+  TEST_ASSERT_EQUAL_INT(7, s.mcsP50);
+  TEST_ASSERT_EQUAL_STRING("ht40", rfPhyName(RF_PHY_HT40));
+}
+
+// A quiet channel, then an AP switched on next to the scanner: the old
+// distribution fades by half each RF_HALF_LIFE_MS and the new one takes over
+static void test_fade_after_change() {
+  uint32_t t = 0xFFFFFFFF - 90000;   // the clock wraps on the way
+  for (int i = 0; i < 1200; i++, t += 100) tracker->add(sample(1, -85, -96), t);
+  RfSummary s;
+  TEST_ASSERT_TRUE(tracker->summary(1, t, s));
+  TEST_ASSERT_EQUAL_INT(-85, s.rssiP50);
+  uint32_t before = s.weight;
+
+  // Twice the frame rate from the new AP
+  int flippedAfterMs = -1;
+  for (int i = 0; i < 2400; i++) {
+    tracker->add(sample(1, -45, -96), t + i * 50);
+    TEST_ASSERT_TRUE(tracker->summary(1, t + i * 50, s));
+    if (flippedAfterMs < 0 && s.rssiP50 == -45) flippedAfterMs = i * 50;
+  }
+  t += 2400 * 50;
+  // Within one half-life, and what is counted has faded
+  TEST_ASSERT_TRUE(flippedAfterMs > 0 && flippedAfterMs <= RF_HALF_LIFE_MS);
+  TEST_ASSERT_TRUE(tracker->summary(1, t, s));
+  TEST_ASSERT_TRUE(s.weight < before + 2400);
+  char msg[100];
+  snprintf(msg, sizeof(msg), "median moved %d ms after the change; weight %u of %u frames",
+           flippedAfterMs, s.weight, s.frames);
+  TEST_MESSAGE(msg);
+
+  // Silence: the weight keeps halving, the quantiles stay put
+  uint32_t weight = s.weight;
+  TEST_ASSERT_TRUE(tracker->summary(1, t + RF_HALF_LIFE_MS, s));
+  TEST_ASSERT_UINT32_WITHIN(1, weight / 2, s.weight);
+  TEST_ASSERT_EQUAL_UINT32(RF_HALF_LIFE_MS + 50, s.ageMs);
+  TEST_ASSERT_EQUAL_INT(-45, s.rssiP50);
+}
+
+// A sniffer on a busy channel: more frames in a half-life than a counter
+// holds; the channel halves early and keeps its proportions
+static void test_counters_halve_early() {
+  for (uint32_t i = 0; i < 300000; i++) {
+    RfSample s = sample(3, i % 4 == 0 ? -40 : -70, -94);
+    s.sigMode = i % 4 == 0 ? 0 : 1;
+    s.rate = 12;
+    tracker->add(s, i / 100);
+  }
+  RfSummary s;
+  TEST_ASSERT_TRUE(tracker->summary(3, 3000, s));
+  TEST_ASSERT_EQUAL_UINT32(300000, s.frames);
+  TEST_ASSERT_TRUE(s.weight < 0x10000 * 2);
+  TEST_ASSERT_EQUAL_INT(-70, s.rssiP50);
+  TEST_ASSERT_EQUAL_INT(-40, s.rssiP90);
+  TEST_ASSERT_EQUAL_UINT8(25, s.mixPct[RF_PHY_G]);
+  TEST_ASSERT_EQUAL_UINT8(75, s.mixPct[RF_PHY_HT20]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_quantiles_match_exact);
+  RUN_TEST(test_phy_and_rate_mix);
+  RUN_TEST(test_fade_after_change);
+  RUN_TEST(test_counters_halve_early);
+  return UNITY_END();
+}
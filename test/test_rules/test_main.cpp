@@ -0,0 +1,143 @@
+// Rules engine: compiled rules match what their text says, aggregates and
+// rate limits count right, and 50 rules cost under a microsecond per report
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "Rules.h"
+
+#define BENCH_RULES 50
+#define BENCH_REPORTS 200000
+#define BENCH_MAX_NS 1000
+
+static RuleEngine* engine;
+static int fired;
+
+static void onFire(void* ctx, const Rule& rule, const RuleReport& report) {
+  (void)ctx;
+  (void)rule;
+  (void)report;
+  fired++;
+}
+
+void setUp() {
+  engine = new RuleEngine();
+  engine->setHandler(onFire, nullptr);
+  fired = 0;
+}
+
+void tearDown() {
+  delete engine;
+}
+
+static RuleReport report(uint8_t source, int rssi, int channel, bool isNew, bool open) {
+  RuleReport r;
+  memset(&r, 0, sizeof(r));
+  r.source = source;
+  r.f[RF_RSSI] = rssi;
+  r.f[RF_CHANNEL] = channel;
+  r.f[RF_NEW] = isNew;
+  r.f[RF_OPEN] = open;
+  return r;
+}
+
+static void add(const char* text) {
+  const char* error = nullptr;
+  bool ok = engine->add(text, &error);
+  TEST_ASSERT_TRUE_MESSAGE(ok, error ? error : text);
+}
+
+static void test_conditions() {
+  add("close: any new and rssi > -50 -> alert");
+  add("open6: wifi new and open and channel == 6 -> export");
+  add("either: ble rssi < -90 or channel == 3 -> blink");
+
+  TEST_ASSERT_EQUAL_INT(1, engine->evaluate(report(RULE_SRC_BLE, -40, 0, true, false), 20000));
+  TEST_ASSERT_EQUAL_INT(0, engine->evaluate(report(RULE_SRC_BLE, -40, 0, false, false), 40000));
+  TEST_ASSERT_EQUAL_INT(1, engine->evaluate(report(RULE_SRC_WIFI, -70, 6, true, true), 60000));
+  TEST_ASSERT_EQUAL_INT(0, engine->evaluate(report(RULE_SRC_WIFI, -70, 6, true, false), 80000));
+  TEST_ASSERT_EQUAL_INT(0, engine->evaluate(report(RULE_SRC_WIFI, -95, 1, true, false), 100000));
+  TEST_ASSERT_EQUAL_INT(1, engine->evaluate(report(RULE_SRC_BLE, -95, 1, false, false), 120000));
+  TEST_ASSERT_EQUAL_INT(1, engine->evaluate(report(RULE_SRC_BLE, -60, 3, false, false), 140000));
+  TEST_ASSERT_EQUAL_UINT32(RULE_EXPORT, engine->rule(1).actions);
+}
+
+static void test_rejects_bad_text() {
+  const char* error = nullptr;
+  TEST_ASSERT_FALSE(engine->add("bad: wifi rssi >> 3 -> alert", &error));
+  TEST_ASSERT_NOT_NULL(error);
+  TEST_ASSERT_FALSE(RuleEngine::check("nosource: rssi > 3 -> alert", &error));
+  TEST_ASSERT_FALSE(RuleEngine::check("noaction: wifi rssi > 3 ->", &error));
+  TEST_ASSERT_EQUAL_INT(0, engine->size());
+}
+
+// More than 20 new BLE devices within 60 s
+static void test_aggregate_window() {
+  add("burst: ble new count > 20 in 60s -> alert every 60s");
+  RuleReport r = report(RULE_SRC_BLE, -70, 0, true, false);
+  uint32_t now = 0;
+  for (int i = 0; i < 20; i++) TEST_ASSERT_EQUAL_INT(0, engine->evaluate(r, now += 1000));
+  TEST_ASSERT_EQUAL_INT(1, engine->evaluate(r, now += 1000));
+  // Rate limited, then the window has emptied
+  TEST_ASSERT_EQUAL_INT(0, engine->evaluate(r, now += 1000));
+  TEST_ASSERT_EQUAL_UINT32(1, engine->rule(0).suppressed);
+  now += 120000;
+  TEST_ASSERT_EQUAL_INT(0, engine->evaluate(r, now));
+}
+
+static void test_rate_limit() {
+  add("near: any rssi > -50 -> alert every 10s");
+  RuleReport r = report(RULE_SRC_BTC, -30, 0, false, false);
+  TEST_ASSERT_EQUAL_INT(1, engine->evaluate(r, 1000));
+  TEST_ASSERT_EQUAL_INT(0, engine->evaluate(r, 5000));
+  TEST_ASSERT_EQUAL_INT(1, engine->evaluate(r, 11000));
+  TEST_ASSERT_EQUAL_UINT32(3, engine->rule(0).matches);
+  TEST_ASSERT_EQUAL_UINT32(2, engine->rule(0).fires);
+}
+
+static void test_benchmark_50_rules() {
+  static const char* const shapes[] = {
+    "r%d: any new and rssi > -%d -> alert",
+    "r%d: wifi new and open and channel == %d -> alert,export",
+    "r%d: ble rssi > -%d and extra < 0 or security == 3 -> blink",
+    "r%d: btc not new and rssi >= -%d -> export every 30s",
+    "r%d: ble new count > %d in 60s -> alert every 60s",
+  };
+  char text[RULES_TEXT_MAX];
+  for (int i = 0; i < BENCH_RULES; i++) {
+    snprintf(text, sizeof(text), shapes[i % 5], i, 30 + i);
+    add(text);
+  }
+  TEST_ASSERT_EQUAL_INT(BENCH_RULES, engine->size());
+
+  srand(88);
+  static RuleReport reports[1024];
+  static const uint8_t sources[3] = {RULE_SRC_WIFI, RULE_SRC_BLE, RULE_SRC_BTC};
+  for (int i = 0; i < 1024; i++) {
+    reports[i] = report(sources[rand() % 3], -30 - rand() % 70, 1 + rand() % 13, rand() % 8 == 0,
+                        rand() % 4 == 0);
+    reports[i].f[RF_EXTRA] = rand() % 20 - 10;
+    reports[i].f[RF_SECURITY] = rand() % 5;
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < BENCH_REPORTS; i++) engine->evaluate(reports[i % 1024], i);
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  double perReport = ns / BENCH_REPORTS;
+
+  char msg[80];
+  snprintf(msg, sizeof(msg), "%d rules: %.0f ns per report, %d fired", BENCH_RULES, perReport, fired);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(fired > 0);
+  TEST_ASSERT_TRUE(perReport < BENCH_MAX_NS);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_conditions);
+  RUN_TEST(test_rejects_bad_text);
+  RUN_TEST(test_aggregate_window);
+  RUN_TEST(test_rate_limit);
+  RUN_TEST(test_benchmark_50_rules);
+  return UNITY_END();
+}
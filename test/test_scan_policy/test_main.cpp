@@ -0,0 +1,235 @@
+// Selective active scanning simulated window by window against the
+// always-active mode: the SCAN_REQ/SCAN_RSP airtime we cause, the reports
+// the host has to merge and parse (and the CPU time that takes, through
+// the same ScanMerge and advParse path as the GAP callback), and how many
+// windows a device with its name in the scan response stays unnamed.
+// Devices come and go over the run; a whitelist window only hears the
+// devices on the whitelist.
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "ActiveScanPolicy.h"
+#include "ScanMerge.h"
+#include "AdvData.h"
+
+#define SIM_WINDOWS 300          // 2 s windows: ten minutes
+#define SIM_DEVICES 60
+#define SIM_RESIDENTS 30         // there from the start and all along
+#define SIM_ARRIVAL_WINDOWS 10   // one visitor every so many windows
+#define SIM_STAY_WINDOWS 60
+#define ADV_EVENTS 20            // per device and window (100 ms interval)
+#define WINDOW_MS 2000
+
+// 1 Mbit/s legacy PDUs: preamble, access address, header, CRC around the
+// payload, and the 150 us inter-frame space before and after the response
+#define PDU_US(payload) ((1 + 4 + 2 + (payload) + 3) * 8)
+#define SCAN_REQ_US PDU_US(12)
+#define SCAN_RSP_US PDU_US(6 + 31)
+#define T_IFS_US 150
+
+// What a device puts where: its name in the advertisement, its name only
+// in the scan response, or not scannable and never named
+enum Kind { NAMED_ADV, NAMED_RSP, SILENT };
+
+struct Device {
+  uint8_t id[6];
+  Kind kind;
+  int arrives;
+  int leaves;
+  uint8_t adv[31];
+  uint8_t advLen;
+  uint8_t rsp[31];
+  uint8_t rspLen;
+};
+
+static Device devices[SIM_DEVICES];
+
+static void build() {
+  for (int i = 0; i < SIM_DEVICES; i++) {
+    Device& d = devices[i];
+    memset(&d, 0, sizeof(d));
+    d.id[0] = 0xC0;
+    d.id[5] = i;
+    d.kind = i % 5 < 2 ? NAMED_ADV : i % 5 < 4 ? NAMED_RSP : SILENT;
+    d.arrives = i < SIM_RESIDENTS ? 0 : (i - SIM_RESIDENTS) * SIM_ARRIVAL_WINDOWS;
+    d.leaves = i < SIM_RESIDENTS ? SIM_WINDOWS : d.arrives + SIM_STAY_WINDOWS;
+    char name[12];
+    int n = snprintf(name, sizeof(name), "sensor-%02d", i);
+    uint8_t* p = d.adv;
+    *p++ = 2, *p++ = 0x01, *p++ = 0x06;   // flags
+    if (d.kind == NAMED_ADV) {
+      *p++ = n + 1, *p++ = 0x09;
+      memcpy(p, name, n), p += n;
+    } else {
+      *p++ = 3, *p++ = 0x03, *p++ = 0x0F, *p++ = 0x18;   // battery service
+    }
+    d.advLen = p - d.adv;
+    if (d.kind == NAMED_RSP) {
+      d.rsp[0] = n + 1, d.rsp[1] = 0x09;
+      memcpy(d.rsp + 2, name, n);
+      d.rspLen = n + 2;
+    }
+  }
+}
+
+struct Sighting {
+  uint8_t id[6];
+  bool scanResponse;
+  AdvFields adv;
+};
+
+struct Result {
+  uint64_t airtimeUs;     // SCAN_REQ + SCAN_RSP exchanges we caused
+  uint32_t reports;       // to the host, ADVs and SCAN_RSPs
+  double cpuMs;           // merging and parsing them
+  int activeWindows;
+  int worstNameWait;      // windows from arrival to a name, NAMED_RSP devices
+  int worstUnseen;        // windows a present device went unheard
+};
+
+static bool onWhitelist(const ScanPlan& plan, const uint8_t id[6]) {
+  for (int i = 0; i < plan.whitelistCount; i++) {
+    if (memcmp(plan.whitelist[i]->id, id, 6) == 0) return true;
+  }
+  return false;
+}
+
+static Sighting found[SIM_DEVICES];
+static int foundCount;
+
+// As BleScanner's take(): a late scan response adds to the first report
+static void take(const ScanReport* r) {
+  Sighting* s = nullptr;
+  for (int k = 0; k < foundCount && !s; k++) {
+    if (memcmp(found[k].id, r->bda, 6) == 0) s = &found[k];
+  }
+  if (!s) {
+    s = &found[foundCount++];
+    memset(s, 0, sizeof(*s));
+    memcpy(s->id, r->bda, 6);
+  }
+  if (r->rspLen > 0) s->scanResponse = true;
+  advParse(r->payload, r->advLen + r->rspLen, s->adv);
+}
+
+static Result simulate(bool alwaysActive) {
+  static ActiveScanPolicy policy;
+  static ScanMerge merge;
+  policy.clear();
+  Result res = {};
+  int named[SIM_DEVICES], lastHeard[SIM_DEVICES];
+  for (int i = 0; i < SIM_DEVICES; i++) named[i] = -1, lastHeard[i] = devices[i].arrives - 1;
+  std::chrono::steady_clock::duration cpu(0);
+
+  for (int w = 0; w < SIM_WINDOWS; w++) {
+    uint32_t start = w * WINDOW_MS;
+    ScanPlan plan = policy.plan(start);
+    if (alwaysActive) {
+      plan.active = true;
+      plan.whitelistCount = 0;
+    }
+    if (plan.active) res.activeWindows++;
+    merge.clear();
+    merge.configure(plan.active, false);
+    foundCount = 0;
+
+    // Advertising events in time order, every device once per round
+    for (int e = 0; e < ADV_EVENTS; e++) {
+      uint32_t now = start + e * (WINDOW_MS / ADV_EVENTS);
+      for (int i = 0; i < SIM_DEVICES; i++) {
+        Device& d = devices[i];
+        if (w < d.arrives || w >= d.leaves) continue;
+        if (plan.whitelistCount > 0 && !onWhitelist(plan, d.id)) continue;
+        uint8_t evt = d.kind == SILENT ? ADV_EVT_NON_CONN_ADV : ADV_EVT_CONN_ADV;
+        bool answered = plan.active && d.kind != SILENT;
+        if (answered) res.airtimeUs += SCAN_REQ_US + SCAN_RSP_US + 2 * T_IFS_US;
+        res.reports += answered ? 2 : 1;
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        merge.add(d.id, 0, evt, -60, d.adv, d.advLen, 0, now);
+        if (answered) merge.add(d.id, 0, ADV_EVT_SCAN_RSP, -60, d.rsp, d.rspLen, 0, now);
+        for (const ScanReport* r = merge.next(now); r; r = merge.next(now)) take(r);
+        cpu += std::chrono::steady_clock::now() - t0;
+      }
+    }
+    uint32_t end = start + WINDOW_MS;
+    for (const ScanReport* r = merge.next(end, true); r; r = merge.next(end, true)) take(r);
+
+    for (int k = 0; k < foundCount; k++) {
+      const Sighting& s = found[k];
+      const BLEMeta* m = policy.observe(s.id, 0, plan.active, s.scanResponse, s.adv.name, end);
+      int i = s.id[5];
+      lastHeard[i] = w;
+      if (m->name[0] && named[i] < 0) named[i] = w;
+    }
+    for (int i = 0; i < SIM_DEVICES; i++) {
+      if (w < devices[i].arrives || w >= devices[i].leaves) continue;
+      if (w - lastHeard[i] > res.worstUnseen) res.worstUnseen = w - lastHeard[i];
+    }
+  }
+
+  for (int i = 0; i < SIM_DEVICES; i++) {
+    if (devices[i].kind != NAMED_RSP || devices[i].arrives >= SIM_WINDOWS - 4) continue;
+    TEST_ASSERT_TRUE_MESSAGE(named[i] >= 0, "a device was never named");
+    int wait = named[i] - devices[i].arrives + 1;
+    if (wait > res.worstNameWait) res.worstNameWait = wait;
+  }
+  res.cpuMs = std::chrono::duration<double, std::milli>(cpu).count();
+  return res;
+}
+
+void setUp() {
+  build();
+}
+
+void tearDown() {}
+
+static void report(const char* mode, const Result& r) {
+  char msg[160];
+  snprintf(msg, sizeof(msg),
+           "%s: %d/%d active windows, %.1f ms scan airtime, %u reports, %.2f ms CPU, names within %d windows",
+           mode, r.activeWindows, SIM_WINDOWS, r.airtimeUs / 1000.0, r.reports, r.cpuMs, r.worstNameWait);
+  TEST_MESSAGE(msg);
+}
+
+static void test_against_always_active() {
+  Result always = simulate(true);
+  Result selective = simulate(false);
+  report("always active", always);
+  report("selective", selective);
+
+  // Names from scan responses: the first window, or within the next two
+  TEST_ASSERT_EQUAL_INT(1, always.worstNameWait);
+  TEST_ASSERT_TRUE(selective.worstNameWait <= 3);
+  // Targeted windows hide everyone else for a single window at most
+  TEST_ASSERT_EQUAL_INT(0, always.worstUnseen);
+  TEST_ASSERT_TRUE(selective.worstUnseen <= 1);
+
+  // Active windows only around arrivals, so a fraction of the airtime
+  TEST_ASSERT_TRUE(selective.activeWindows < SIM_WINDOWS / 4);
+  TEST_ASSERT_TRUE(selective.airtimeUs * 10 < always.airtimeUs);
+  TEST_ASSERT_TRUE(selective.reports * 10 < always.reports * 7);
+}
+
+// Nobody left to name: every window is passive
+static void test_settled_population_stays_passive() {
+  ActiveScanPolicy policy;
+  const uint8_t id[6] = {1, 2, 3, 4, 5, 6};
+  TEST_ASSERT_FALSE(policy.plan(0).active);
+  policy.observe(id, 0, false, false, nullptr, 0);
+  ScanPlan p = policy.plan(WINDOW_MS);
+  TEST_ASSERT_TRUE(p.active);
+  TEST_ASSERT_EQUAL_INT(1, p.whitelistCount);
+  TEST_ASSERT_FALSE(policy.plan(2 * WINDOW_MS).active);   // a passive one in between
+  // Silent through ACTIVE_ATTEMPTS_MAX active windows: given up
+  for (int i = 0; i < ACTIVE_ATTEMPTS_MAX; i++) policy.observe(id, 0, true, false, nullptr, 3 * WINDOW_MS);
+  for (int w = 4; w < 10; w++) TEST_ASSERT_FALSE(policy.plan(w * WINDOW_MS).active);
+  TEST_ASSERT_EQUAL_UINT32(1, policy.stats().gaveUp);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_against_always_active);
+  RUN_TEST(test_settled_population_stays_passive);
+  return UNITY_END();
+}
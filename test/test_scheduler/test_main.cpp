@@ -0,0 +1,90 @@
+// RadioScheduler simulated round by round: shares follow the weights of
+// the source on screen, neither source waits long, and inquiries that
+// find nothing back off until a discovery snaps them back
+#include <unity.h>
+#include "RadioScheduler.h"
+
+#define SIM_ROUNDS 2400
+
+void setUp() {}
+void tearDown() {}
+
+struct Run {
+  int inquiries;
+  int longestBleGap;       // rounds between two BLE windows
+  int longestInquiryGap;   // rounds between two inquiries
+};
+
+// newDevices is what each inquiry finds, by inquiry number
+static Run simulate(RadioScheduler& s, RadioSlot focus, int rounds, int (*newDevices)(int)) {
+  Run r = {0, 0, 0};
+  int lastBle = -1, lastInquiry = -1;
+  for (int i = 0; i < rounds; i++) {
+    if (s.next(focus) == SLOT_INQUIRY) {
+      if (i - lastInquiry > r.longestInquiryGap) r.longestInquiryGap = i - lastInquiry;
+      lastInquiry = i;
+      s.inquiryDone(newDevices ? newDevices(r.inquiries) : 1);
+      r.inquiries++;
+    } else {
+      if (i - lastBle > r.longestBleGap) r.longestBleGap = i - lastBle;
+      lastBle = i;
+    }
+  }
+  return r;
+}
+
+static int findsNothing(int) { return 0; }
+static int findsFirstTen(int n) { return n < 10 ? 2 : 0; }
+
+static void test_shares_follow_focus() {
+  // Background weight 1 against focus weight 3: a quarter of the rounds
+  RadioScheduler ble;
+  Run r = simulate(ble, SLOT_BLE, SIM_ROUNDS, nullptr);
+  TEST_ASSERT_EQUAL_INT(SIM_ROUNDS / 4, r.inquiries);
+  TEST_ASSERT_EQUAL_INT(4, r.longestInquiryGap);
+  TEST_ASSERT_EQUAL_INT(2, r.longestBleGap);
+
+  RadioScheduler inquiry;
+  r = simulate(inquiry, SLOT_INQUIRY, SIM_ROUNDS, nullptr);
+  TEST_ASSERT_EQUAL_INT(SIM_ROUNDS * 3 / 4, r.inquiries);
+  TEST_ASSERT_EQUAL_INT(4, r.longestBleGap);
+}
+
+static void test_backoff_and_snap_back() {
+  RadioScheduler s;
+  for (int i = 0; i < 5; i++) s.inquiryDone(0);
+  TEST_ASSERT_EQUAL_INT(RadioScheduler::INQUIRY_MAX_BACKOFF, s.inquiryBackoff());
+  s.inquiryDone(3);
+  TEST_ASSERT_EQUAL_INT(1, s.inquiryBackoff());
+
+  // Idle inquiries in the background fall to 1/INQUIRY_MAX_BACKOFF of the
+  // background weight, yet still run
+  RadioScheduler idle;
+  Run r = simulate(idle, SLOT_BLE, SIM_ROUNDS, findsNothing);
+  int weight = RadioScheduler::BACKGROUND_WEIGHT;
+  int total = RadioScheduler::FOCUS_WEIGHT * RadioScheduler::INQUIRY_MAX_BACKOFF + weight;
+  TEST_ASSERT_INT_WITHIN(8, SIM_ROUNDS * weight / total, r.inquiries);
+  TEST_ASSERT_TRUE(r.longestInquiryGap <= total + 1);
+
+  // Discoveries keep the full rate while they last
+  RadioScheduler busy;
+  r = simulate(busy, SLOT_BLE, 40, findsFirstTen);
+  TEST_ASSERT_EQUAL_INT(10, r.inquiries);
+  TEST_ASSERT_EQUAL_INT(4, r.longestInquiryGap);
+}
+
+// On the inquiry screen the backoff does not apply
+static void test_focus_ignores_backoff() {
+  RadioScheduler s;
+  Run r = simulate(s, SLOT_INQUIRY, SIM_ROUNDS, findsNothing);
+  TEST_ASSERT_EQUAL_INT(RadioScheduler::INQUIRY_MAX_BACKOFF, s.inquiryBackoff());
+  TEST_ASSERT_EQUAL_INT(SIM_ROUNDS * 3 / 4, r.inquiries);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_shares_follow_focus);
+  RUN_TEST(test_backoff_and_snap_back);
+  RUN_TEST(test_focus_ignores_backoff);
+  return UNITY_END();
+}
@@ -0,0 +1,175 @@
+// Snap lengths over the frame ring: the default data snaplen keeps every
+// 802.11 MAC header whole, and a benchmark of frames/s and ring depth in
+// frames against the data snaplen, on the sniffer's path: a FrameRecord
+// and the head of the frame pushed in two pieces, drained as the sniffer
+// task does
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "CaptureStorage.h"
+#include "ExportRing.h"
+
+#define POOL_FRAMES 4096
+#define BENCH_FRAMES 1000000
+#define SNAP_MGMT 1024   // management frames whole, as on the device
+
+void setUp() {}
+void tearDown() {}
+
+// MAC header length from the frame control field
+static size_t headerLen(const uint8_t* f) {
+  uint8_t type = (f[0] >> 2) & 3;
+  bool order = f[1] & 0x80;
+  if (type == 0) return 24 + (order ? 4 : 0);
+  size_t n = 24;
+  if ((f[1] & 3) == 3) n += 6;
+  if (f[0] & 0x80) n += 2 + (order ? 4 : 0);   // QoS; HT control needs it
+  return n;
+}
+
+static size_t dataFrame(uint8_t* out, size_t len, bool fourAddr, bool qos, bool htc) {
+  memset(out, 0xEE, len);
+  out[0] = qos ? 0x88 : 0x08;
+  out[1] = (fourAddr ? 0x03 : 0x01) | (htc ? 0x80 : 0);
+  return len;
+}
+
+// Every data header variant, mesh QoS with HT control being the longest,
+// fits FRAME_MAC_HEADER_MAX with nothing left over
+static void test_default_covers_every_header() {
+  uint8_t f[64];
+  size_t longest = 0;
+  for (int v = 0; v < 8; v++) {
+    dataFrame(f, sizeof(f), v & 1, v & 2, v & 4);
+    size_t n = headerLen(f);
+    TEST_ASSERT_TRUE(n <= FRAME_MAC_HEADER_MAX);
+    if (n > longest) longest = n;
+  }
+  TEST_ASSERT_EQUAL_size_t(FRAME_MAC_HEADER_MAX, longest);
+  uint8_t beacon[2] = {0x80, 0x80};
+  TEST_ASSERT_TRUE(headerLen(beacon) < FRAME_MAC_HEADER_MAX);
+
+  // Through the ring: the capture ends exactly at the end of the header,
+  // and the record still carries the on-air length
+  ExportRing* ring = new ExportRing();
+  uint8_t frame[1500];
+  dataFrame(frame, sizeof(frame), true, true, true);
+  frame[FRAME_MAC_HEADER_MAX - 1] = 0x42;   // last byte of HT control
+  FrameRecord rec = {};
+  rec.hdr.len = sizeof(rec) + FRAME_MAC_HEADER_MAX;
+  rec.hdr.type = CAPTURE_WIFI_FRAME;
+  rec.origLen = sizeof(frame);
+  TEST_ASSERT_TRUE(ring->push(&rec, sizeof(rec), frame, FRAME_MAC_HEADER_MAX));
+  uint8_t out[sizeof(FrameRecord) + FRAME_MAC_HEADER_MAX];
+  TEST_ASSERT_TRUE(ring->copyOut(out, sizeof(out)));
+  const FrameRecord* got = (const FrameRecord*)out;
+  TEST_ASSERT_EQUAL_UINT16(sizeof(frame), got->origLen);
+  TEST_ASSERT_EQUAL_size_t(FRAME_MAC_HEADER_MAX, headerLen(out + sizeof(FrameRecord)));
+  TEST_ASSERT_EQUAL_HEX8(0x42, out[sizeof(out) - 1]);
+  TEST_ASSERT_EQUAL_size_t(sizeof(out), ring->pending());
+  delete ring;
+}
+
+// --- Frames/s and ring depth against the data snaplen ---
+
+struct PoolFrame {
+  bool mgmt;
+  uint16_t len;
+};
+
+// A quarter management frames (beacons, probe requests), the rest data:
+// a third small (null data, ACK-sized payloads), the rest full-sized
+static PoolFrame pool[POOL_FRAMES];
+static uint8_t payload[1500];
+
+static void buildPool() {
+  srand(9);
+  for (int i = 0; i < POOL_FRAMES; i++) {
+    PoolFrame& p = pool[i];
+    int kind = rand() % 100;
+    p.mgmt = kind < 25;
+    if (kind < 15) p.len = 220 + rand() % 80;
+    else if (kind < 25) p.len = 60 + rand() % 60;
+    else if (kind < 50) p.len = 26 + rand() % 40;
+    else p.len = 500 + rand() % 1000;
+  }
+  dataFrame(payload, sizeof(payload), true, true, true);
+}
+
+struct SnapResult {
+  double framesPerS;
+  double mbPerS;
+  double depth;      // frames the ring holds at once
+};
+
+static SnapResult bench(uint16_t snapData) {
+  static ExportRing ring;
+  static uint8_t rec[sizeof(FrameRecord) + SNAP_MGMT];
+  ring.clear();
+  uint64_t fills = 0, held = 0, bytes = 0;
+  uint32_t n = 0;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  while (n < BENCH_FRAMES) {
+    // Driver side: push until the ring is full
+    uint32_t inRing = 0;
+    for (;;) {
+      const PoolFrame& p = pool[n % POOL_FRAMES];
+      uint16_t snap = p.mgmt ? SNAP_MGMT : snapData;
+      uint16_t capLen = p.len < snap ? p.len : snap;
+      FrameRecord r;
+      r.hdr.len = sizeof(FrameRecord) + capLen;
+      r.hdr.type = CAPTURE_WIFI_FRAME;
+      r.hdr.reserved = 0;
+      r.hdr.timeMs = n;
+      r.channel = 6;
+      r.rssi = -60;
+      r.rate = 11;
+      r.frameType = p.mgmt ? 0 : 2;
+      r.origLen = p.len;
+      r.reserved = 0;
+      if (!ring.push(&r, sizeof(r), payload, capLen)) break;
+      bytes += r.hdr.len;
+      inRing++;
+      if (++n == BENCH_FRAMES) break;
+    }
+    fills++;
+    held += inRing;
+    // Sniffer task side
+    CaptureRecordHeader hdr;
+    while (ring.copyOut(&hdr, sizeof(hdr))) {
+      ring.copyOut(rec, hdr.len);
+      ring.consume(hdr.len);
+    }
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  SnapResult res;
+  res.framesPerS = BENCH_FRAMES / s;
+  res.mbPerS = bytes / s / 1e6;
+  res.depth = (double)held / fills;
+  return res;
+}
+
+static void test_frames_per_second_vs_snaplen() {
+  buildPool();
+  const uint16_t snaps[] = {FRAME_MAC_HEADER_MAX, 64, 128, 256, 512, 1024};
+  SnapResult results[6];
+  for (int i = 0; i < 6; i++) {
+    results[i] = bench(snaps[i]);
+    char msg[120];
+    snprintf(msg, sizeof(msg), "data snaplen %4u: %5.2f Mframes/s, %6.1f MB/s through the ring, %5.1f frames deep",
+             snaps[i], results[i].framesPerS / 1e6, results[i].mbPerS, results[i].depth);
+    TEST_MESSAGE(msg);
+  }
+  // Depth follows the average record length; the copy volume the rate
+  for (int i = 1; i < 6; i++) TEST_ASSERT_TRUE(results[i].depth < results[i - 1].depth);
+  TEST_ASSERT_TRUE(results[0].depth > 4 * results[5].depth);
+  TEST_ASSERT_TRUE(results[0].framesPerS > results[5].framesPerS);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_default_covers_every_header);
+  RUN_TEST(test_frames_per_second_vs_snaplen);
+  return UNITY_END();
+}
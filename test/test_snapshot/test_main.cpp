@@ -0,0 +1,122 @@
+// EpochSnapshot under concurrent readers; run it in env:native-tsan too,
+// where a version reused while still pinned shows up as a data race
+#include <unity.h>
+#include <thread>
+#include <atomic>
+#include "EpochSnapshot.h"
+
+#define STRESS_PUBLISHES 20000
+#define STRESS_READERS 4
+#define STRESS_MIN_READS 2000
+
+// Plain fields on purpose: only the snapshot protocol keeps them apart
+struct Table {
+  uint32_t version;
+  int count;
+  uint32_t items[32];
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void fill(Table& t, uint32_t version) {
+  t.version = version;
+  t.count = version % 32;
+  for (int i = 0; i < 32; i++) t.items[i] = version * 31 + i;
+}
+
+static bool consistent(const Table& t) {
+  if (t.count != (int)(t.version % 32)) return false;
+  for (int i = 0; i < 32; i++) {
+    if (t.items[i] != t.version * 31 + i) return false;
+  }
+  return true;
+}
+
+static void test_reader_slots_run_out() {
+  EpochSnapshot<Table, 3, 2> snap;
+  EpochSnapshot<Table, 3, 2>::ReadGuard a = snap.read();
+  EpochSnapshot<Table, 3, 2>::ReadGuard b = snap.read();
+  TEST_ASSERT_TRUE((bool)a);
+  TEST_ASSERT_TRUE((bool)b);
+  {
+    EpochSnapshot<Table, 3, 2>::ReadGuard c = snap.read();
+    TEST_ASSERT_FALSE((bool)c);
+  }
+}
+
+// A pinned version is never handed back to the writer
+static void test_pinned_version_is_not_reused() {
+  EpochSnapshot<Table, 2, 4> snap;
+  Table* t = snap.beginWrite();
+  TEST_ASSERT_NOT_NULL(t);
+  fill(*t, 1);
+  snap.publish(t);
+  {
+    EpochSnapshot<Table, 2, 4>::ReadGuard pin = snap.read();
+    TEST_ASSERT_EQUAL_UINT32(1, pin->version);
+    Table* next = snap.beginWrite();
+    TEST_ASSERT_NOT_NULL(next);
+    fill(*next, 2);
+    snap.publish(next);
+    // Version 1 is pinned and version 2 is current: nothing spare
+    TEST_ASSERT_NULL(snap.beginWrite());
+    TEST_ASSERT_TRUE(consistent(*pin));
+  }
+  TEST_ASSERT_NOT_NULL(snap.beginWrite());
+}
+
+static void test_concurrent_readers() {
+  EpochSnapshot<Table> snap;
+  Table* first = snap.beginWrite();
+  fill(*first, 0);
+  snap.publish(first);
+  std::atomic<bool> done(false);
+  std::atomic<uint32_t> torn(0), backwards(0), reads(0);
+
+  std::thread readers[STRESS_READERS];
+  for (int r = 0; r < STRESS_READERS; r++) {
+    readers[r] = std::thread([&]() {
+      uint32_t last = 0;
+      while (!done.load()) {
+        EpochSnapshot<Table>::ReadGuard t = snap.read();
+        if (!t) continue;
+        if (!consistent(*t)) torn++;
+        if (t->version < last) backwards++;
+        last = t->version;
+        reads++;
+        std::this_thread::yield();
+      }
+    });
+  }
+
+  uint32_t published = 0, skipped = 0;
+  // Until the readers, too, got their share (one core runs them in turn)
+  for (uint32_t v = 1; published < STRESS_PUBLISHES || reads.load() < STRESS_MIN_READS; v++) {
+    if (v % 64 == 0) std::this_thread::yield();
+    Table* t = snap.beginWrite();
+    if (!t) {
+      skipped++;   // every spare version pinned: publish later
+      std::this_thread::yield();
+      continue;
+    }
+    fill(*t, v);
+    snap.publish(t);
+    published++;
+  }
+  done = true;
+  for (int r = 0; r < STRESS_READERS; r++) readers[r].join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+  TEST_ASSERT_EQUAL_UINT32(0, backwards.load());
+  EpochSnapshot<Table>::ReadGuard last = snap.read();
+  TEST_ASSERT_TRUE(consistent(*last));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reader_slots_run_out);
+  RUN_TEST(test_pinned_version_is_not_reused);
+  RUN_TEST(test_concurrent_readers);
+  return UNITY_END();
+}
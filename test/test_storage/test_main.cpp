@@ -0,0 +1,108 @@
+// Capture storage on the host stand-in (the raw ring over a file): the
+// ring drops its oldest segment when full, numbering carries on after a
+// reopen, and sustained write throughput per write path. The filesystem
+// engines need the ESP-IDF VFS; `bench storage` measures them on the device.
+#include <unity.h>
+#include <unistd.h>
+#include <chrono>
+#include "CaptureStorage.h"
+
+#define STORAGE_TEST_FILE "storage_test.bin"
+#define STORAGE_TEST_SLOTS 4
+#define BENCH_BYTES (32 * 1024 * 1024)
+#define BENCH_MIN_MBPS 20.0
+
+static CaptureStorage* storage;
+
+void setUp() {
+  unlink(STORAGE_TEST_FILE);
+  storage = newHostCaptureStorage(STORAGE_TEST_FILE, STORAGE_TEST_SLOTS * CAPTURE_SEGMENT_BYTES);
+  TEST_ASSERT_TRUE(storage->begin());
+}
+
+void tearDown() {
+  delete storage;
+  unlink(STORAGE_TEST_FILE);
+}
+
+static SurveyRecord survey(uint32_t n) {
+  SurveyRecord r;
+  r.hdr.len = sizeof(r);
+  r.hdr.type = CAPTURE_BLE_SURVEY;
+  r.hdr.reserved = 0;
+  r.hdr.timeMs = n;
+  memset(r.id, n, 6);
+  r.rssi = -(int)(n % 90);
+  r.extra = 0;
+  return r;
+}
+
+static void test_ring_drops_oldest() {
+  for (uint32_t s = 0; s < 10; s++) {
+    for (uint32_t i = 0; i < 100; i++) {
+      SurveyRecord r = survey(s * 100 + i);
+      TEST_ASSERT_TRUE(storage->append(&r, sizeof(r)));
+    }
+    TEST_ASSERT_TRUE(storage->rotate());
+  }
+  // Four slots: the open segment and the three newest closed ones
+  SegmentInfo segs[8];
+  TEST_ASSERT_EQUAL_INT(3, storage->listSegments(segs, 8));
+  TEST_ASSERT_EQUAL_UINT32(8, segs[0].id);
+  TEST_ASSERT_EQUAL_UINT32(10, segs[2].id);
+  SurveyRecord r;
+  TEST_ASSERT_EQUAL_size_t(sizeof(r), storage->readSegment(10, 99 * sizeof(r), &r, sizeof(r)));
+  TEST_ASSERT_EQUAL_UINT32(999, r.hdr.timeMs);
+  TEST_ASSERT_EQUAL_size_t(0, storage->readSegment(7, 0, &r, sizeof(r)));
+
+  delete storage;
+  storage = newHostCaptureStorage(STORAGE_TEST_FILE, STORAGE_TEST_SLOTS * CAPTURE_SEGMENT_BYTES);
+  TEST_ASSERT_TRUE(storage->begin());
+  TEST_ASSERT_EQUAL_UINT32(12, storage->currentSegment());
+}
+
+// Writes BENCH_BYTES in records of recLen, through append() or straight
+// from the caller's block with appendBlock()
+static double throughput(size_t recLen, bool block) {
+  static uint8_t buf[CAPTURE_BATCH_BYTES];
+  size_t len = block ? sizeof(buf) / recLen * recLen : recLen;
+  for (size_t off = 0; off < len; off += recLen) {
+    CaptureRecordHeader h = {(uint16_t)recLen, CAPTURE_WIFI_FRAME, 0, (uint32_t)off};
+    memset(buf + off, 0x5A, recLen);
+    memcpy(buf + off, &h, sizeof(h));
+  }
+  uint64_t start = storage->bytesWritten();
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (size_t done = 0; done < BENCH_BYTES; done += len) {
+    TEST_ASSERT_TRUE(block ? storage->appendBlock(buf, len) : storage->append(buf, len));
+  }
+  TEST_ASSERT_TRUE(storage->flush());
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return (storage->bytesWritten() - start) / s / (1024 * 1024);
+}
+
+static void test_write_throughput() {
+  static const struct {
+    const char* name;
+    size_t recLen;
+    bool block;
+  } paths[] = {
+    {"survey records", sizeof(SurveyRecord), false},
+    {"frame records", sizeof(FrameRecord) + 128, false},
+    {"4 KB blocks", sizeof(FrameRecord) + 128, true},
+  };
+  for (const auto& p : paths) {
+    double mbps = throughput(p.recLen, p.block);
+    char msg[80];
+    snprintf(msg, sizeof(msg), "%s %s: %.1f MB/s", storage->name(), p.name, mbps);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(mbps > BENCH_MIN_MBPS);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_drops_oldest);
+  RUN_TEST(test_write_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,112 @@
+// Export pump over the loopback transport: everything pushed arrives in
+// order, writes come in whole packets, and a host that stops reading
+// stalls the pump without losing what the ring can hold
+#include <unity.h>
+#include <stdlib.h>
+#include "ExportStream.h"
+
+#define LOOP_CAPACITY 2048
+#define LOOP_DRAIN_PER_MS 256   // faster than the records come in
+#define LOOP_PACKET 64
+#define LOOP_RECORDS 2000
+
+static ExportRing* ring;
+static uint8_t sent[LOOP_RECORDS * 64];
+static size_t sentLen;
+static uint8_t received[LOOP_RECORDS * 64];
+
+void setUp() {
+  ring = new ExportRing();
+  sentLen = 0;
+  memset(received, 0, sizeof(received));
+}
+
+void tearDown() {
+  delete ring;
+}
+
+static bool pushRecord(uint32_t n) {
+  uint8_t rec[64];
+  size_t len = 8 + n % 50;
+  for (size_t i = 0; i < len; i++) rec[i] = n * 13 + i;
+  if (!ring->push(rec, len)) return false;
+  memcpy(sent + sentLen, rec, len);
+  sentLen += len;
+  return true;
+}
+
+static void test_everything_arrives_in_order() {
+  LoopbackTransport loop(LOOP_CAPACITY, LOOP_DRAIN_PER_MS, LOOP_PACKET, received, sizeof(received));
+  ExportPump pump;
+  uint32_t now = 0;
+  uint32_t n = 0;
+  while (n < LOOP_RECORDS || ring->pending() > 0 || loop.drained() < sentLen) {
+    for (int k = 0; k < 5 && n < LOOP_RECORDS; k++) {
+      if (pushRecord(n)) n++;
+    }
+    pump.pump(*ring, loop, now);
+    loop.advance(1);
+    now++;
+    TEST_ASSERT_TRUE(now < 100000);
+  }
+  TEST_ASSERT_EQUAL_size_t(sentLen, loop.drained());
+  TEST_ASSERT_EQUAL_MEMORY(sent, received, sentLen);
+  TEST_ASSERT_EQUAL_UINT32(sentLen, loop.counters.bytes.load());
+  TEST_ASSERT_EQUAL_UINT32(0, ring->droppedRecords());
+}
+
+// A small tail waits for EXPORT_FLUSH_MS, then goes out as it is
+static void test_small_tail_is_held_back() {
+  LoopbackTransport loop(LOOP_CAPACITY, LOOP_DRAIN_PER_MS, LOOP_PACKET, received, sizeof(received));
+  ExportPump pump;
+  pump.pump(*ring, loop, 0);
+  TEST_ASSERT_TRUE(pushRecord(1));
+  TEST_ASSERT_EQUAL_size_t(0, pump.pump(*ring, loop, 1));
+  TEST_ASSERT_EQUAL_size_t(sentLen, pump.pump(*ring, loop, 1 + EXPORT_FLUSH_MS));
+  TEST_ASSERT_EQUAL_size_t(0, ring->pending());
+}
+
+// Batches are cut to whole packets while more is pending
+static void test_writes_are_packet_aligned() {
+  LoopbackTransport loop(LOOP_CAPACITY, LOOP_DRAIN_PER_MS, LOOP_PACKET, received, sizeof(received));
+  ExportPump pump;
+  pump.pump(*ring, loop, 0);
+  while (ring->pending() < EXPORT_MIN_BATCH + LOOP_PACKET / 2) TEST_ASSERT_TRUE(pushRecord(sentLen));
+  size_t n = pump.pump(*ring, loop, 1);
+  TEST_ASSERT_TRUE(n > 0);
+  TEST_ASSERT_EQUAL_size_t(0, n % LOOP_PACKET);
+  TEST_ASSERT_TRUE(ring->pending() > 0);
+}
+
+static void test_paused_host_stalls_the_pump() {
+  LoopbackTransport loop(LOOP_CAPACITY, LOOP_DRAIN_PER_MS, LOOP_PACKET, received, sizeof(received));
+  ExportPump pump;
+  loop.setPaused(true);
+  uint32_t now = 0;
+  uint32_t n = 0;
+  // The transport fills, then the ring, then a record is dropped
+  while (pushRecord(n++)) {
+    pump.pump(*ring, loop, now++);
+    loop.advance(1);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, ring->droppedRecords());
+  TEST_ASSERT_TRUE(loop.counters.stalls.load() > 0);
+  TEST_ASSERT_EQUAL_size_t(0, loop.drained());
+
+  loop.setPaused(false);
+  while (ring->pending() > 0 || loop.drained() < sentLen) {
+    pump.pump(*ring, loop, now++);
+    loop.advance(1);
+    TEST_ASSERT_TRUE(now < 100000);
+  }
+  TEST_ASSERT_EQUAL_MEMORY(sent, received, sentLen);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_everything_arrives_in_order);
+  RUN_TEST(test_small_tail_is_held_back);
+  RUN_TEST(test_writes_are_packet_aligned);
+  RUN_TEST(test_paused_host_stalls_the_pump);
+  return UNITY_END();
+}
@@ -0,0 +1,278 @@
+// Segment upload over real sockets: the host connection stand-in talks to
+// a minimal in-process collection server, which checks the requests and
+// keeps what it was sent
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <vector>
+#include <string>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "SegmentUpload.h"
+
+#define UPLOAD_TEST_FILE "upload_test.bin"
+#define UPLOAD_TEST_SEGMENTS 5
+
+// Collection server, one connection at a time, as tools/upload_server.py
+class TestServer {
+public:
+  std::map<uint32_t, std::string> stored;
+  std::atomic<int> requests;
+  int failNext;   // answer the next PUT with this status instead
+
+  TestServer() : requests(0), failNext(0), fd(-1), port(0), stopping(false) {}
+
+  bool start() {
+    stopping = false;
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (sockaddr*)&addr, len) != 0 || listen(fd, 4) != 0) return false;
+    getsockname(fd, (sockaddr*)&addr, &len);
+    port = ntohs(addr.sin_port);
+    thread = std::thread([this]() { serve(); });
+    return true;
+  }
+
+  void stop() {
+    stopping = true;
+    shutdown(fd, SHUT_RDWR);
+    close(fd);
+    thread.join();
+  }
+
+  uint16_t listenPort() const { return port; }
+
+private:
+  void serve() {
+    while (!stopping) {
+      int c = accept(fd, nullptr, nullptr);
+      if (c < 0) break;
+      handle(c);
+      close(c);
+    }
+  }
+
+  static bool readUntil(int c, std::string& buf, const char* marker) {
+    char tmp[2048];
+    while (buf.find(marker) == std::string::npos) {
+      ssize_t n = recv(c, tmp, sizeof(tmp), 0);
+      if (n <= 0) return false;
+      buf.append(tmp, n);
+    }
+    return true;
+  }
+
+  static void reply(int c, int status, const std::string& body) {
+    char head[128];
+    int n = snprintf(head, sizeof(head), "HTTP/1.1 %d X\r\nContent-Length: %u\r\n\r\n", status,
+                     (unsigned)body.size());
+    send(c, head, n, 0);
+    send(c, body.data(), body.size(), 0);
+  }
+
+  void handle(int c) {
+    std::string buf;
+    if (!readUntil(c, buf, "\r\n\r\n")) return;
+    requests++;
+    char method[8], target[80];
+    if (sscanf(buf.c_str(), "%7s %79s", method, target) != 2) return;
+    if (strcmp(method, "GET") == 0) {
+      uint32_t last = stored.empty() ? 0 : stored.rbegin()->first;
+      reply(c, strcmp(target, "/up/node1/last") == 0 ? 200 : 404, std::to_string(last));
+      return;
+    }
+    unsigned id;
+    if (strcmp(method, "PUT") != 0 || sscanf(target, "/up/node1/%u", &id) != 1 ||
+        buf.find("Transfer-Encoding: chunked\r\n") == std::string::npos) {
+      reply(c, 400, "");
+      return;
+    }
+    // Chunked body
+    std::string body, rest = buf.substr(buf.find("\r\n\r\n") + 4);
+    for (;;) {
+      if (!readUntil(c, rest, "\r\n")) return;
+      size_t size = strtoul(rest.c_str(), nullptr, 16);
+      rest.erase(0, rest.find("\r\n") + 2);
+      while (rest.size() < size + 2) {
+        char tmp[2048];
+        ssize_t n = recv(c, tmp, sizeof(tmp), 0);
+        if (n <= 0) return;
+        rest.append(tmp, n);
+      }
+      if (size == 0) break;
+      body.append(rest, 0, size);
+      rest.erase(0, size + 2);
+    }
+    if (failNext) {
+      reply(c, failNext, "");
+      failNext = 0;
+      return;
+    }
+    stored[id] = body;
+    reply(c, 201, "");
+  }
+
+  int fd;
+  uint16_t port;
+  std::atomic<bool> stopping;
+  std::thread thread;
+};
+
+class TestHooks : public UploadHooks {
+public:
+  uint32_t now() override {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count() + skewMs;
+  }
+  void sleep(uint32_t ms) override { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+  bool online() override { return true; }
+  bool busy() override { return false; }
+  uint32_t skewMs = 0;   // lets a test skip a backoff without waiting it out
+};
+
+static CaptureStorage* storage;
+static TestServer* server;
+
+void setUp() {
+  unlink(UPLOAD_TEST_FILE);
+  storage = newHostCaptureStorage(UPLOAD_TEST_FILE, 16 * CAPTURE_SEGMENT_BYTES);
+  TEST_ASSERT_TRUE(storage->begin());
+  server = new TestServer();
+  TEST_ASSERT_TRUE(server->start());
+}
+
+void tearDown() {
+  server->stop();
+  delete server;
+  delete storage;
+  unlink(UPLOAD_TEST_FILE);
+}
+
+static void writeSegments(int count) {
+  for (int s = 0; s < count; s++) {
+    for (int i = 0; i < 100 + s * 300; i++) {
+      SurveyRecord r;
+      r.hdr.len = sizeof(r);
+      r.hdr.type = CAPTURE_WIFI_SURVEY;
+      r.hdr.reserved = 0;
+      r.hdr.timeMs = i;
+      memset(r.id, s, 6);
+      r.rssi = -i % 100;
+      r.extra = 6;
+      TEST_ASSERT_TRUE(storage->append(&r, sizeof(r)));
+    }
+    TEST_ASSERT_TRUE(storage->rotate());
+  }
+}
+
+static void assertStored(const SegmentInfo& seg) {
+  TEST_ASSERT_TRUE(server->stored.count(seg.id) == 1);
+  const std::string& body = server->stored[seg.id];
+  TEST_ASSERT_EQUAL_size_t(seg.size, body.size());
+  std::vector<uint8_t> want(seg.size);
+  TEST_ASSERT_EQUAL_size_t(seg.size, storage->readSegment(seg.id, 0, want.data(), seg.size));
+  TEST_ASSERT_EQUAL_MEMORY(want.data(), body.data(), seg.size);
+}
+
+static void test_parse_url() {
+  UploadUrl url;
+  TEST_ASSERT_TRUE(parseUploadUrl("http://collector.lan:8080/up/", url));
+  TEST_ASSERT_EQUAL_STRING("collector.lan", url.host);
+  TEST_ASSERT_EQUAL_UINT(8080, url.port);
+  TEST_ASSERT_EQUAL_STRING("/up", url.path);
+  TEST_ASSERT_TRUE(parseUploadUrl("http://10.0.0.2", url));
+  TEST_ASSERT_EQUAL_UINT(80, url.port);
+  TEST_ASSERT_EQUAL_STRING("", url.path);
+  TEST_ASSERT_FALSE(parseUploadUrl("https://host/up", url));
+  TEST_ASSERT_FALSE(parseUploadUrl("http://host:99999/up", url));
+  TEST_ASSERT_FALSE(parseUploadUrl("http://ho st/up", url));
+}
+
+static void test_uploads_every_closed_segment() {
+  writeSegments(UPLOAD_TEST_SEGMENTS);
+  UploadConn* conn = newHostUploadConn();
+  TestHooks hooks;
+  SegmentUploader uploader(*storage, *conn, hooks);
+  char target[40];
+  snprintf(target, sizeof(target), "http://127.0.0.1:%u/up", server->listenPort());
+  UploadUrl url;
+  TEST_ASSERT_TRUE(parseUploadUrl(target, url));
+  uploader.setTarget(url, "node1");
+
+  uploader.run();
+  TEST_ASSERT_TRUE(uploader.synced());
+  SegmentInfo segs[UPLOAD_TEST_SEGMENTS];
+  TEST_ASSERT_EQUAL_INT(UPLOAD_TEST_SEGMENTS, storage->listSegments(segs, UPLOAD_TEST_SEGMENTS));
+  TEST_ASSERT_EQUAL_UINT32(UPLOAD_TEST_SEGMENTS, uploader.stats().segments);
+  TEST_ASSERT_EQUAL_UINT32(segs[UPLOAD_TEST_SEGMENTS - 1].id, uploader.cursor());
+  for (int i = 0; i < UPLOAD_TEST_SEGMENTS; i++) assertStored(segs[i]);
+
+  // Nothing new: only the poll interval passes
+  int before = server->requests;
+  uploader.run();
+  TEST_ASSERT_EQUAL_INT(before, server->requests);
+  delete conn;
+}
+
+// A rejected segment backs off, then the next attempt asks the server
+// where it stands and sends it again
+static void test_failure_backs_off_and_resumes() {
+  writeSegments(2);
+  UploadConn* conn = newHostUploadConn();
+  TestHooks hooks;
+  SegmentUploader uploader(*storage, *conn, hooks);
+  char target[40];
+  snprintf(target, sizeof(target), "http://127.0.0.1:%u/up", server->listenPort());
+  UploadUrl url;
+  TEST_ASSERT_TRUE(parseUploadUrl(target, url));
+  uploader.setTarget(url, "node1");
+
+  server->failNext = 507;
+  TEST_ASSERT_EQUAL_UINT32(UPLOAD_BACKOFF_MIN_MS, uploader.run());
+  TEST_ASSERT_EQUAL_INT(507, uploader.stats().lastStatus);
+  TEST_ASSERT_EQUAL_UINT32(1, uploader.stats().failures);
+  TEST_ASSERT_FALSE(uploader.synced());
+  TEST_ASSERT_TRUE(server->stored.empty());
+
+  hooks.skewMs = UPLOAD_BACKOFF_MIN_MS;
+  uploader.run();
+  TEST_ASSERT_EQUAL_UINT32(2, uploader.stats().segments);
+  TEST_ASSERT_EQUAL_size_t(2, server->stored.size());
+  TEST_ASSERT_EQUAL_UINT32(0, uploader.backoffMs());
+  delete conn;
+}
+
+static void test_server_down() {
+  writeSegments(1);
+  UploadConn* conn = newHostUploadConn();
+  TestHooks hooks;
+  SegmentUploader uploader(*storage, *conn, hooks);
+  UploadUrl url;
+  char target[40];
+  snprintf(target, sizeof(target), "http://127.0.0.1:%u/up", server->listenPort());
+  TEST_ASSERT_TRUE(parseUploadUrl(target, url));
+  server->stop();
+  server->start();   // a new port; the old one refuses
+  uploader.setTarget(url, "node1");
+  TEST_ASSERT_EQUAL_UINT32(UPLOAD_BACKOFF_MIN_MS, uploader.run());
+  TEST_ASSERT_EQUAL_INT(-1, uploader.stats().lastStatus);
+  delete conn;
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_url);
+  RUN_TEST(test_uploads_every_closed_segment);
+  RUN_TEST(test_failure_backs_off_and_resumes);
+  RUN_TEST(test_server_down);
+  return UNITY_END();
+}
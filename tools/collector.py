@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""Collector stand-in for sensor nodes streaming over UDP.
+
+Each datagram is a little-endian uint32 sequence number followed by whole
+capture records (src/CaptureStorage.h): a header of
+    uint16 len, uint8 type, uint8 reserved, uint32 timeMs
+and len - 8 bytes of payload. Prints per-second throughput, record counts
+by type and datagram loss per node. Codec blocks (src/ScanCodec.h) are
+unpacked and counted by the records inside; "x" is the codec ratio.
+
+    python3 tools/collector.py                 # listen on :5005
+    python3 tools/collector.py --mdns          # advertise, auto-register nodes
+    python3 tools/collector.py --bench 5       # local sender, measures the collector
+
+With --mdns the collector advertises _wscan._udp (role=collector), which
+nodes pick up instead of their built-in COLLECTOR_HOST, and registers
+every node it browses (see tools/mdns_lite.py).
+"""
+
+import argparse
+import socket
+import struct
+import threading
+import time
+
+import mdns_lite
+import scancodec
+
+HEADER = struct.Struct("<HBBI")
+TYPES = {1: "wifi", 2: "ble", 3: "btc", 4: "frame", 6: "rule", 8: "rf"}
+RULE_EVENT = struct.Struct("<HBBI6sbB12s")
+
+
+class NodeStats:
+    def __init__(self):
+        self.next_seq = None
+        self.datagrams = 0
+        self.lost = 0
+        self.bytes = 0
+        self.records = {}
+        self.malformed = 0
+        self.packed = 0     # codec block bytes
+        self.unpacked = 0   # record bytes inside them
+
+    def add(self, data):
+        if len(data) < 4:
+            self.malformed += 1
+            return
+        (seq,) = struct.unpack_from("<I", data)
+        if self.next_seq is not None and seq != self.next_seq:
+            self.lost += (seq - self.next_seq) & 0xFFFFFFFF
+        self.next_seq = (seq + 1) & 0xFFFFFFFF
+        self.datagrams += 1
+        self.bytes += len(data)
+
+        off = 4
+        while off + HEADER.size <= len(data):
+            length, rtype, _, _ = HEADER.unpack_from(data, off)
+            if length < HEADER.size or off + length > len(data):
+                self.malformed += 1
+                return
+            if rtype == scancodec.CODEC_BLOCK:
+                self.unpack(data[off:off + length])
+            else:
+                self.count(rtype)
+                if rtype == 6 and length == RULE_EVENT.size:
+                    self.rule_event(data[off:off + length])
+            off += length
+        if off != len(data):
+            self.malformed += 1
+
+    def rule_event(self, rec):
+        _, _, _, t, mac, rssi, _, name = RULE_EVENT.unpack(rec)
+        name = name.split(b"\0")[0].decode(errors="replace")
+        print(f"rule {name} fired: "
+              f"{mac.hex(':')} {rssi} dBm at {t} ms", flush=True)
+
+    def count(self, rtype):
+        name = TYPES.get(rtype, str(rtype))
+        self.records[name] = self.records.get(name, 0) + 1
+
+    def unpack(self, block):
+        try:
+            recs = scancodec.decode_block(block)
+        except ValueError:
+            self.malformed += 1
+            return
+        self.packed += len(block)
+        for rec in recs:
+            self.unpacked += len(rec)
+            self.count(rec[2])
+
+    def ratio(self):
+        return f" x{self.unpacked / self.packed:.2f}" if self.packed else ""
+
+
+class Registry:
+    """Nodes announced over mDNS, keyed by IP"""
+
+    def __init__(self):
+        self.by_ip = {}
+        self.browser = None
+
+    def on_change(self, name):
+        s = self.browser.services().get(name)
+        if not s or not s["ip"] or s["txt"].get("role") != "node":
+            return
+        known = self.by_ip.get(s["ip"])
+        self.by_ip[s["ip"]] = s["txt"]
+        if known is None:
+            txt = s["txt"]
+            print(f"registered node {txt.get('id', '?')} at {s['ip']} "
+                  f"fw {txt.get('fw', '?')} caps {txt.get('caps', '?')}", flush=True)
+
+    def label(self, ip):
+        txt = self.by_ip.get(ip)
+        return f"{ip} [{txt.get('id', '?')} load {txt.get('load', '?')}]" if txt else ip
+
+
+def serve(sock, duration=None, registry=None):
+    nodes = {}
+    start = last = time.monotonic()
+    last_bytes = 0
+    sock.settimeout(0.2)
+    while duration is None or time.monotonic() - start < duration:
+        try:
+            data, addr = sock.recvfrom(2048)
+            nodes.setdefault(addr[0], NodeStats()).add(data)
+        except socket.timeout:
+            pass
+        now = time.monotonic()
+        if now - last >= 1.0:
+            total = sum(n.bytes for n in nodes.values())
+            rate = (total - last_bytes) / (now - last) / 1024
+            last, last_bytes = now, total
+            for ip, n in nodes.items():
+                recs = " ".join(f"{k}={v}" for k, v in sorted(n.records.items()))
+                name = registry.label(ip) if registry else ip
+                print(f"{name}: {rate:8.1f} KB/s  {n.datagrams} dgrams  {n.lost} lost  "
+                      f"{n.malformed} bad{n.ratio()}  {recs}", flush=True)
+    return nodes
+
+
+def bench_sender(port, seconds):
+    """Emulates a node: full datagrams of 16-byte survey records"""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    rec = HEADER.pack(16, 1, 0, 0) + bytes(8)
+    payload = rec * ((1400 - 4) // len(rec))
+    seq = 0
+    end = time.monotonic() + seconds
+    while time.monotonic() < end:
+        sock.sendto(struct.pack("<I", seq) + payload, ("127.0.0.1", port))
+        seq += 1
+        if seq % 64 == 0:
+            time.sleep(0.001)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--port", type=int, default=5005)
+    ap.add_argument("--bench", type=float, metavar="SECONDS",
+                    help="send to ourselves over loopback and report")
+    ap.add_argument("--mdns", action="store_true", help="advertise and browse _wscan._udp")
+    ap.add_argument("--mdns-port", type=int, default=5353, help="15353 for the local stand-in")
+    ap.add_argument("--iface", default="0.0.0.0", help="interface address for mDNS")
+    args = ap.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    sock.bind(("0.0.0.0", args.port))
+    if args.bench:
+        threading.Thread(target=bench_sender, args=(args.port, args.bench), daemon=True).start()
+        nodes = serve(sock, args.bench + 0.5)
+        for ip, n in nodes.items():
+            print(f"{ip}: {n.bytes / args.bench / 1024:.1f} KB/s average, "
+                  f"{n.lost} of {n.datagrams + n.lost} datagrams lost")
+    else:
+        registry = None
+        if args.mdns:
+            registry = Registry()
+            ip = "127.0.0.1" if args.iface == "127.0.0.1" else mdns_lite.local_ip()
+            host = f"wscan-collector-{socket.gethostname().split('.')[0]}"
+            mdns_lite.Responder(host, host, ip, args.port, {"role": "collector"},
+                                args.mdns_port, args.iface).start()
+            registry.browser = mdns_lite.Browser(args.mdns_port, args.iface, registry.on_change)
+            registry.browser.start()
+        print(f"listening on udp/{args.port}", flush=True)
+        serve(sock, registry=registry)
+
+
+if __name__ == "__main__":
+    main()
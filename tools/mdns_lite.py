@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+"""Minimal mDNS (RFC 6762/6763) for _wscan._udp: advertise and browse.
+
+Just enough of the protocol to talk to the ESP-IDF responder on the nodes
+without extra packages: PTR/SRV/TXT/A records, name compression on read,
+answers to PTR queries, unsolicited announcements and goodbyes.
+
+    python3 tools/mdns_lite.py browse              # list nodes/collectors
+    python3 tools/mdns_lite.py node --id test01    # fake node for testing
+
+For a test without touching the LAN's 5353, run both ends with
+--port 15353 --iface 127.0.0.1 (the local multicast stand-in).
+"""
+
+import argparse
+import socket
+import struct
+import threading
+import time
+
+GROUP = "224.0.0.251"
+SERVICE = "_wscan._udp.local"
+TTL = 120
+T_A, T_PTR, T_TXT, T_SRV = 1, 12, 16, 33
+CLASS_IN, CACHE_FLUSH = 1, 0x8000
+
+
+def encode_name(name):
+    out = b""
+    for label in name.rstrip(".").split("."):
+        raw = label.encode()
+        out += bytes([len(raw)]) + raw
+    return out + b"\0"
+
+
+def decode_name(data, off):
+    labels, jumped, end = [], False, off
+    for _ in range(64):
+        n = data[off]
+        if n == 0:
+            off += 1
+            break
+        if n & 0xC0 == 0xC0:
+            ptr = struct.unpack_from("!H", data, off)[0] & 0x3FFF
+            if not jumped:
+                end = off + 2
+            jumped, off = True, ptr
+            continue
+        labels.append(data[off + 1:off + 1 + n].decode(errors="replace"))
+        off += 1 + n
+    return ".".join(labels), (end if jumped else off)
+
+
+def record(name, rtype, rdata, ttl=TTL, flush=False):
+    cls = CLASS_IN | (CACHE_FLUSH if flush else 0)
+    return encode_name(name) + struct.pack("!HHIH", rtype, cls, ttl, len(rdata)) + rdata
+
+
+def txt_rdata(txt):
+    out = b""
+    for k, v in txt.items():
+        item = f"{k}={v}".encode()[:255]
+        out += bytes([len(item)]) + item
+    return out or b"\0"
+
+
+def parse_txt(rdata):
+    items, off = {}, 0
+    while off < len(rdata):
+        n = rdata[off]
+        item = rdata[off + 1:off + 1 + n].decode(errors="replace")
+        off += 1 + n
+        if item:
+            k, _, v = item.partition("=")
+            items[k] = v
+    return items
+
+
+def parse_packet(data):
+    """Returns (is_response, questions, records)"""
+    _, flags, qd, an, ns, ar = struct.unpack_from("!6H", data)
+    off, questions, records = 12, [], []
+    for _ in range(qd):
+        name, off = decode_name(data, off)
+        qtype, _ = struct.unpack_from("!HH", data, off)
+        off += 4
+        questions.append((name.lower(), qtype))
+    for _ in range(an + ns + ar):
+        name, off = decode_name(data, off)
+        rtype, _, ttl, rdlen = struct.unpack_from("!HHIH", data, off)
+        off += 10
+        rdata_off = off
+        off += rdlen
+        if rtype == T_PTR:
+            value = decode_name(data, rdata_off)[0]
+        elif rtype == T_SRV:
+            _, _, port = struct.unpack_from("!HHH", data, rdata_off)
+            value = (port, decode_name(data, rdata_off + 6)[0])
+        elif rtype == T_TXT:
+            value = parse_txt(data[rdata_off:off])
+        elif rtype == T_A and rdlen == 4:
+            value = socket.inet_ntoa(data[rdata_off:off])
+        else:
+            continue
+        records.append((name, rtype, ttl, value))
+    return bool(flags & 0x8000), questions, records
+
+
+def open_socket(port, iface):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, "SO_REUSEPORT"):
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+    sock.bind(("", port))
+    mreq = socket.inet_aton(GROUP) + socket.inet_aton(iface)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(iface))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 255)
+    return sock
+
+
+class Responder:
+    """Advertises one _wscan._udp instance and answers PTR queries"""
+
+    def __init__(self, instance, host, ip, port, txt, mdns_port=5353, iface="0.0.0.0"):
+        self.instance = f"{instance}.{SERVICE}"
+        self.host = f"{host}.local"
+        self.ip, self.port, self.txt = ip, port, dict(txt)
+        self.mdns_port = mdns_port
+        self.sock = open_socket(mdns_port, iface)
+        self.running = True
+
+    def packet(self, ttl=TTL):
+        answers = [
+            record(SERVICE, T_PTR, encode_name(self.instance), ttl),
+            record(self.instance, T_SRV, struct.pack("!HHH", 0, 0, self.port) + encode_name(self.host), ttl, True),
+            record(self.instance, T_TXT, txt_rdata(self.txt), ttl, True),
+            record(self.host, T_A, socket.inet_aton(self.ip), ttl, True),
+        ]
+        return struct.pack("!6H", 0, 0x8400, 0, len(answers), 0, 0) + b"".join(answers)
+
+    def announce(self, ttl=TTL):
+        self.sock.sendto(self.packet(ttl), (GROUP, self.mdns_port))
+
+    def serve(self):
+        self.announce()
+        self.sock.settimeout(0.5)
+        next_announce = time.monotonic() + TTL / 2
+        while self.running:
+            try:
+                data, addr = self.sock.recvfrom(9000)
+                is_response, questions, _ = parse_packet(data)
+                if not is_response and any(q == (SERVICE.lower(), T_PTR) for q in questions):
+                    self.announce()
+            except socket.timeout:
+                pass
+            except (struct.error, IndexError):
+                continue
+            if time.monotonic() >= next_announce:
+                self.announce()
+                next_announce = time.monotonic() + TTL / 2
+        self.announce(0)   # goodbye
+
+    def start(self):
+        threading.Thread(target=self.serve, daemon=True).start()
+        return self
+
+    def stop(self):
+        self.running = False
+
+
+class Browser:
+    """Keeps a TTL-bounded view of every _wscan._udp instance heard"""
+
+    def __init__(self, mdns_port=5353, iface="0.0.0.0", on_change=None):
+        self.mdns_port = mdns_port
+        self.sock = open_socket(mdns_port, iface)
+        self.on_change = on_change
+        self.lock = threading.Lock()
+        self.instances = {}   # name -> dict(port, host, txt, expires)
+        self.hosts = {}       # host -> (ip, expires)
+        self.running = True
+
+    def query(self):
+        q = encode_name(SERVICE) + struct.pack("!HH", T_PTR, CLASS_IN)
+        self.sock.sendto(struct.pack("!6H", 0, 0, 1, 0, 0, 0) + q, (GROUP, self.mdns_port))
+
+    def services(self):
+        """Live instances: name -> dict(ip, port, txt, ttl)"""
+        now, out = time.monotonic(), {}
+        with self.lock:
+            for name, s in self.instances.items():
+                if s["expires"] <= now or "port" not in s:
+                    continue
+                ip = self.hosts.get(s.get("host"), (None, 0))
+                out[name] = {"ip": ip[0] if ip[1] > now else None, "port": s["port"],
+                             "txt": s.get("txt", {}), "ttl": int(s["expires"] - now)}
+        return out
+
+    def handle(self, records):
+        now, changed = time.monotonic(), set()
+        with self.lock:
+            for name, rtype, ttl, value in records:
+                if rtype == T_PTR and name.lower() == SERVICE.lower():
+                    s = self.instances.setdefault(value, {"expires": 0})
+                    s["expires"] = now + ttl
+                    changed.add(value)
+                elif rtype == T_SRV and name in self.instances:
+                    self.instances[name]["port"], self.instances[name]["host"] = value
+                    changed.add(name)
+                elif rtype == T_TXT and name in self.instances:
+                    self.instances[name]["txt"] = value
+                    changed.add(name)
+                elif rtype == T_A:
+                    self.hosts[name] = (value, now + ttl)
+        if self.on_change:
+            for name in changed:
+                self.on_change(name)
+
+    def serve(self):
+        self.sock.settimeout(0.5)
+        next_query = 0
+        while self.running:
+            now = time.monotonic()
+            if now >= next_query:
+                self.query()
+                next_query = now + TTL / 4
+            try:
+                data, _ = self.sock.recvfrom(9000)
+                is_response, _, records = parse_packet(data)
+                if is_response:
+                    self.handle(records)
+            except socket.timeout:
+                pass
+            except (struct.error, IndexError):
+                continue
+
+    def start(self):
+        threading.Thread(target=self.serve, daemon=True).start()
+        return self
+
+    def stop(self):
+        self.running = False
+
+
+def local_ip():
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        s.connect(("10.255.255.255", 1))
+        return s.getsockname()[0]
+    except OSError:
+        return "127.0.0.1"
+    finally:
+        s.close()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("mode", choices=["browse", "node"])
+    ap.add_argument("--port", type=int, default=5353, help="mDNS port (stand-in: 15353)")
+    ap.add_argument("--iface", default="0.0.0.0", help="interface address for multicast")
+    ap.add_argument("--id", default="test01", help="fake node id")
+    args = ap.parse_args()
+
+    if args.mode == "node":
+        ip = "127.0.0.1" if args.iface == "127.0.0.1" else local_ip()
+        txt = {"role": "node", "id": args.id, "fw": "host", "caps": "wifi", "load": 0}
+        Responder(f"wscan-{args.id}", f"wscan-{args.id}", ip, 5006, txt, args.port, args.iface).serve()
+        return
+
+    browser = Browser(args.port, args.iface).start()
+    try:
+        while True:
+            time.sleep(2)
+            for name, s in sorted(browser.services().items()):
+                print(f"{name}: {s['ip']}:{s['port']} ttl {s['ttl']}s {s['txt']}", flush=True)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Block-level firmware delta for OTA updates (format: src/DeltaPatch.h).
+
+    python3 tools/mkdelta.py make old.bin new.bin patch.wdp
+    python3 tools/mkdelta.py apply old.bin patch.wdp out.bin   # host check
+
+The old image is indexed by BLOCK-byte windows at every STRIDE-th offset.
+The new image is scanned byte by byte; each hit is extended forwards and
+backwards into a COPY, and everything between hits becomes ADD literals.
+Code that moved (relinked functions, shifted sections) still copies; only
+bytes that actually changed are sent.
+
+Serve the patch over HTTP and run "ota http://host/patch.wdp" on the node.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+MAGIC = b"WDP1"
+HEADER = struct.Struct("<4sII16s16s")
+OP_END, OP_COPY, OP_ADD = 0, 1, 2
+BLOCK = 32
+STRIDE = 4
+MIN_COPY = 24   # a COPY op costs 9 bytes; shorter matches stay literal
+
+
+def index(old):
+    table = {}
+    for off in range(0, len(old) - BLOCK + 1, STRIDE):
+        table.setdefault(old[off:off + BLOCK], off)
+    return table
+
+
+def diff(old, new):
+    """Yields ("copy", src, length) and ("add", bytes)"""
+    table = index(old)
+    pos = literal = 0
+    while pos + BLOCK <= len(new):
+        src = table.get(new[pos:pos + BLOCK])
+        if src is None:
+            pos += 1
+            continue
+        start, end, send = pos, pos + BLOCK, src + BLOCK
+        while start > literal and src > 0 and new[start - 1] == old[src - 1]:
+            start -= 1
+            src -= 1
+        while end < len(new) and send < len(old) and new[end] == old[send]:
+            end += 1
+            send += 1
+        if end - start < MIN_COPY:
+            pos += 1
+            continue
+        if start > literal:
+            yield ("add", new[literal:start])
+        yield ("copy", src, end - start)
+        pos = literal = end
+    if literal < len(new):
+        yield ("add", new[literal:])
+
+
+def make(old, new):
+    out = [HEADER.pack(MAGIC, len(old), len(new), hashlib.md5(old).digest(),
+                       hashlib.md5(new).digest())]
+    copied = 0
+    for op in diff(old, new):
+        if op[0] == "copy":
+            out.append(struct.pack("<BII", OP_COPY, op[1], op[2]))
+            copied += op[2]
+        else:
+            out.append(struct.pack("<BI", OP_ADD, len(op[1])) + op[1])
+    out.append(bytes([OP_END]))
+    return b"".join(out), copied
+
+
+def apply(old, patch):
+    magic, old_size, new_size, old_md5, new_md5 = HEADER.unpack_from(patch)
+    if magic != MAGIC:
+        raise ValueError("not a delta patch")
+    if old_size != len(old) or hashlib.md5(old).digest() != old_md5:
+        raise ValueError("patch was made for a different image")
+    out, off = bytearray(), HEADER.size
+    while True:
+        op = patch[off]
+        off += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            src, length = struct.unpack_from("<II", patch, off)
+            off += 8
+            out += old[src:src + length]
+        elif op == OP_ADD:
+            (length,) = struct.unpack_from("<I", patch, off)
+            off += 4
+            out += patch[off:off + length]
+            off += length
+        else:
+            raise ValueError(f"bad op {op}")
+    if len(out) != new_size or hashlib.md5(out).digest() != new_md5:
+        raise ValueError("result does not match target hash")
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("mode", choices=["make", "apply"])
+    ap.add_argument("old")
+    ap.add_argument("input", help="new image (make) or patch (apply)")
+    ap.add_argument("output")
+    args = ap.parse_args()
+
+    old = open(args.old, "rb").read()
+    data = open(args.input, "rb").read()
+    if args.mode == "make":
+        patch, copied = make(old, data)
+        open(args.output, "wb").write(patch)
+        print(f"{len(data)} byte image, {copied} copied, patch {len(patch)} bytes "
+              f"({100 * len(patch) / max(len(data), 1):.1f}%)")
+    else:
+        try:
+            open(args.output, "wb").write(apply(old, data))
+        except ValueError as e:
+            sys.exit(f"apply failed: {e}")
+        print("ok")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""Precompresses the config portal pages (portal/) into src/PortalAssets.h.
+
+The portal serves these arrays straight from flash with
+Content-Encoding: gzip, so nothing is compressed or copied at runtime.
+Run after editing anything under portal/ and commit both.
+
+    python3 tools/portal_assets.py
+"""
+
+import gzip
+import os
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCES = [  # (file under portal/, URL path, content type)
+    ("index.html", "/", "text/html"),
+]
+
+
+def main():
+    out = ["// Generated by tools/portal_assets.py from portal/ -- do not edit",
+           "#ifndef PORTAL_ASSETS_H", "#define PORTAL_ASSETS_H", "",
+           "#include <stdint.h>", "#include <stddef.h>", "",
+           "#ifndef PROGMEM", "#define PROGMEM", "#endif", "",
+           "struct PortalAsset {", "  const char* path;", "  const char* type;",
+           "  const uint8_t* data;   // gzip", "  size_t len;", "};", ""]
+    table = []
+    for i, (name, path, ctype) in enumerate(SOURCES):
+        raw = open(os.path.join(ROOT, "portal", name), "rb").read()
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        out.append(f"// {name}: {len(raw)} bytes, {len(data)} gzipped")
+        out.append(f"static const uint8_t PORTAL_ASSET_{i}[] PROGMEM = {{")
+        for off in range(0, len(data), 16):
+            out.append("  " + ", ".join(f"0x{b:02x}" for b in data[off:off + 16]) + ",")
+        out.append("};")
+        out.append("")
+        table.append(f'  {{"{path}", "{ctype}", PORTAL_ASSET_{i}, sizeof(PORTAL_ASSET_{i})}},')
+        print(f"{name}: {len(raw)} -> {len(data)} bytes")
+    out += ["static const PortalAsset PORTAL_ASSETS[] = {"] + table + ["};", "",
+            "#define PORTAL_ASSET_COUNT (sizeof(PORTAL_ASSETS) / sizeof(PORTAL_ASSETS[0]))",
+            "", "#endif", ""]
+    open(os.path.join(ROOT, "src", "PortalAssets.h"), "w").write("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Exercises the config portal (src/PortalApi.h) over HTTP.
+
+    python3 tools/portal_check.py 192.168.4.1          # joined to the portal AP
+    python3 tools/portal_check.py 10.0.0.42 --save     # also round-trips a save
+
+Checks the gzip page, the captive redirect for foreign host names, the
+JSON API and that bad form values are rejected without changing
+anything. --save posts the current settings back unchanged (one NVS
+commit once the store settles), so it is safe on a configured device.
+"""
+
+import argparse
+import gzip
+import http.client
+import json
+import sys
+import urllib.parse
+
+
+class Portal:
+    def __init__(self, host, port):
+        self.host = host
+        self.port = port
+
+    def request(self, method, path, form=None, host=None):
+        conn = http.client.HTTPConnection(self.host, self.port, timeout=10)
+        body = urllib.parse.urlencode(form) if form is not None else None
+        headers = {"Host": host or self.host, "Accept-Encoding": "gzip"}
+        if body is not None:
+            headers["Content-Type"] = "application/x-www-form-urlencoded"
+        conn.request(method, path, body, headers)
+        resp = conn.getresponse()
+        data = resp.read()
+        conn.close()
+        return resp.status, dict((k.lower(), v) for k, v in resp.getheaders()), data
+
+    def config(self):
+        status, _, data = self.request("GET", "/api/config")
+        assert status == 200, status
+        return json.loads(data)
+
+
+def check(name, ok, detail=""):
+    print(f"{'ok  ' if ok else 'FAIL'} {name}{'  ' + detail if detail and not ok else ''}")
+    return ok
+
+
+def run(portal, save):
+    ok = True
+    status, headers, data = portal.request("GET", "/")
+    ok &= check("page is gzip html", status == 200 and headers.get("content-encoding") == "gzip"
+                and b"<form" in gzip.decompress(data), f"{status} {headers}")
+
+    status, headers, _ = portal.request("GET", "/generate_204", host="connectivitycheck.gstatic.com")
+    ok &= check("captive redirect", status == 302
+                and headers.get("location") == f"http://{portal.host}/", f"{status} {headers}")
+
+    before = portal.config()
+    ok &= check("config json", all(k in before for k in ("scan", "stream", "streams", "upurl", "rules")))
+    ok &= check("no passwords in config", before.get("appass") in (True, False)
+                and before.get("wpass") in (True, False))
+
+    status, _, data = portal.request("GET", "/api/status")
+    try:
+        json.loads(data)
+        ok &= check("status json", status == 200)
+    except ValueError:
+        ok &= check("status json", False, repr(data[:80]))
+
+    bad = [{"scan": "2"}, {"scan": "x"}, {"stream": "carrier-pigeon"}, {"cport": "70000"},
+           {"appass": "short"}, {"codec": "yes"}, {"chost": ""}, {"upurl": "https://x/"},
+           {"wpass": "short"},
+           {"rules": "ok: any -> alert\nbroken: wifi rssi >> 3 -> alert"},
+           {"scan": "60", "rules": "x" * 2000}]
+    for form in bad:
+        status, _, data = portal.request("POST", "/api/config", form)
+        reply = json.loads(data) if status == 400 else {}
+        ok &= check(f"rejects {list(form)}", status == 400 and "error" in reply, f"{status} {data[:80]!r}")
+    status, _, data = portal.request("POST", "/api/config", bad[-2])
+    ok &= check("error names the line", b"line 2" in data, repr(data))
+    ok &= check("rejected forms changed nothing", portal.config() == before)
+
+    status, _, _ = portal.request("POST", "/api/status")
+    ok &= check("405 on POST elsewhere", status == 405, str(status))
+    status, _, _ = portal.request("GET", "/nope")
+    ok &= check("404 on unknown path", status == 404, str(status))
+
+    if save:
+        form = {"scan": before["scan"], "stream": before["stream"], "codec": int(before["codec"]),
+                "chost": before["chost"], "cport": before["cport"], "upurl": before["upurl"],
+                "wssid": before["wssid"], "rules": before["rules"]}
+        status, _, data = portal.request("POST", "/api/config", form)
+        ok &= check("save", status == 200 and json.loads(data).get("ok"), repr(data))
+        ok &= check("save round trip", portal.config() == before)
+        crlf = dict(form, rules=before["rules"].replace("\n", "\r\n"))
+        portal.request("POST", "/api/config", crlf)
+        ok &= check("CRLF rules normalised", portal.config()["rules"] == before["rules"])
+    return ok
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("host")
+    ap.add_argument("--port", type=int, default=80)
+    ap.add_argument("--save", action="store_true", help="post the settings back unchanged")
+    args = ap.parse_args()
+    sys.exit(0 if run(Portal(args.host, args.port), args.save) else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,345 @@
+#!/usr/bin/env python3
+"""Host side of the export codec (format: src/ScanCodec.h).
+
+    python3 tools/scancodec.py decode stream.bin plain.bin   # unpack codec blocks
+    python3 tools/scancodec.py bench 00000012.BIN            # ratio/speed on a trace
+    python3 tools/scancodec.py fuzz 00000012.BIN             # decoder robustness
+
+A trace is any file of capture records, e.g. a segment copied off the USB
+drive. bench packs it with the same rules as the node (the output is
+byte-identical to ScanEncoder), unpacks it again and checks the round
+trip; fuzz feeds mutated and truncated blocks to the decoder, which has
+to either reject them or return well-formed records.
+"""
+
+import argparse
+import random
+import struct
+import sys
+import time
+
+HEADER = struct.Struct("<HBBI")
+SURVEY = struct.Struct("<HBBI6sbb")
+FRAME = struct.Struct("<HBBIBbBBHH")
+WIFI_SURVEY, BTC_SURVEY, WIFI_FRAME, CODEC_BLOCK = 1, 3, 4, 5
+VERSION = 1
+BLOCK_BYTES = 1280
+DICT_SIZE = 64
+ADDR_END = 22
+HIT, SAME_TIME, SAME_EXTRA, RSSI_SHIFT = 0x01, 0x02, 0x04, 3
+RSSI_SAME, RSSI_UP, RSSI_DOWN, RSSI_LITERAL = range(4)
+SAME_CHANNEL, SAME_RATE, ADDR_HIT = 0x01, 0x02, 0x04
+
+
+def records(data):
+    off = 0
+    while off + HEADER.size <= len(data):
+        length = HEADER.unpack_from(data, off)[0]
+        if length < HEADER.size or off + length > len(data):
+            break
+        yield data[off:off + length]
+        off += length
+
+
+def varint(v):
+    out = bytearray()
+    while v >= 0x80:
+        out.append(v & 0x7F | 0x80)
+        v >>= 7
+    out.append(v)
+    return out
+
+
+def zigzag(v):
+    v = (v + 2**31) % 2**32 - 2**31
+    return ((v << 1) ^ (v >> 31)) & 0xFFFFFFFF
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+class Encoder:
+    def __init__(self):
+        self.blocks = []
+        self.reset()
+
+    def reset(self):
+        self.body = bytearray()
+        self.count = 0
+        self.first = self.prev_time = 0
+        self.prev_channel = self.prev_rate = 0
+        self.dict = []      # [mac, rssi, extra]
+        self.next = 0
+
+    def mac(self, mac):
+        """Returns (slot, hit) and appends the reference"""
+        for slot, entry in enumerate(self.dict):
+            if entry[0] == mac:
+                self.body.append(slot)
+                return slot, True
+        self.body += mac
+        slot = self.next
+        self.next = (self.next + 1) % DICT_SIZE
+        if slot < len(self.dict):
+            self.dict[slot] = [mac, 0, 0]
+        else:
+            self.dict.append([mac, 0, 0])
+        return slot, False
+
+    def delta(self, t):
+        self.body += varint(zigzag(t - self.prev_time))
+        self.prev_time = t
+
+    def add(self, rec):
+        if HEADER.size + len(self.body) + len(rec) + 8 > HEADER.size + BLOCK_BYTES:
+            if not self.count:
+                raise ValueError("record larger than a block")
+            self.finish()
+        length, rtype, reserved, t = HEADER.unpack_from(rec)
+        if not self.count:
+            self.first = self.prev_time = t
+        op = len(self.body)
+        self.body.append(0)
+        flags = 0
+        if length == SURVEY.size and reserved == 0 and WIFI_SURVEY <= rtype <= BTC_SURVEY:
+            _, _, _, _, mac, rssi, extra = SURVEY.unpack(rec)
+            if t == self.prev_time:
+                flags |= SAME_TIME
+            else:
+                self.delta(t)
+            slot, hit = self.mac(mac)
+            entry = self.dict[slot]
+            code = RSSI_LITERAL
+            if hit and rssi == entry[1]:
+                code = RSSI_SAME
+            elif hit and rssi == entry[1] + 1:
+                code = RSSI_UP
+            elif hit and rssi == entry[1] - 1:
+                code = RSSI_DOWN
+            else:
+                self.body += struct.pack("b", rssi)
+            flags |= code << RSSI_SHIFT | HIT * hit
+            if hit and extra == entry[2]:
+                flags |= SAME_EXTRA
+            else:
+                self.body += struct.pack("b", extra)
+            entry[1], entry[2] = rssi, extra
+            self.body[op] = rtype << 5 | flags
+        elif (rtype == WIFI_FRAME and reserved == 0 and length >= FRAME.size
+              and FRAME.unpack_from(rec)[9] == 0):
+            _, _, _, _, channel, rssi, rate, ftype, orig, _ = FRAME.unpack_from(rec)
+            payload = rec[FRAME.size:]
+            self.delta(t)
+            if channel == self.prev_channel:
+                flags |= SAME_CHANNEL
+            else:
+                self.body.append(channel)
+            self.body += struct.pack("b", rssi)
+            if rate == self.prev_rate:
+                flags |= SAME_RATE
+            else:
+                self.body.append(rate)
+            self.body.append(ftype)
+            self.body += varint(orig) + varint(len(payload))
+            self.prev_channel, self.prev_rate = channel, rate
+            start = 0
+            if len(payload) >= ADDR_END:
+                self.body += payload[:4]
+                for i in range(3):
+                    flags |= ADDR_HIT << i if self.mac(payload[4 + i * 6:10 + i * 6])[1] else 0
+                start = ADDR_END
+            self.body += payload[start:]
+            self.body[op] = WIFI_FRAME << 5 | flags
+        else:
+            self.body += varint(len(rec)) + rec
+            self.prev_time = t
+        self.count += 1
+
+    def finish(self):
+        if self.count:
+            self.blocks.append(HEADER.pack(HEADER.size + len(self.body), CODEC_BLOCK, VERSION,
+                                           self.first) + self.body)
+        self.reset()
+
+
+def encode(data):
+    enc = Encoder()
+    for rec in records(data):
+        enc.add(rec)
+    enc.finish()
+    return enc.blocks
+
+
+class Reader:
+    def __init__(self, data):
+        self.data, self.off = data, HEADER.size
+
+    def byte(self):
+        if self.off >= len(self.data):
+            raise ValueError("truncated block")
+        self.off += 1
+        return self.data[self.off - 1]
+
+    def bytes(self, n):
+        if self.off + n > len(self.data):
+            raise ValueError("truncated block")
+        self.off += n
+        return self.data[self.off - n:self.off]
+
+    def varint(self):
+        v = 0
+        for shift in range(0, 35, 7):
+            b = self.byte()
+            v |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return v & 0xFFFFFFFF
+        raise ValueError("bad varint")
+
+
+def decode_block(block):
+    """Returns the records packed in one CAPTURE_CODEC_BLOCK; ValueError if malformed"""
+    length, rtype, version, first = HEADER.unpack_from(block)
+    if rtype != CODEC_BLOCK or version != VERSION or length != len(block):
+        raise ValueError("not a codec block")
+    r = Reader(block)
+    out, dct, nxt = [], [None] * DICT_SIZE, 0
+    prev_time, prev_channel, prev_rate = first, 0, 0
+
+    def mac(hit):
+        nonlocal nxt
+        if hit:
+            slot = r.byte()
+            if slot >= DICT_SIZE or dct[slot] is None:
+                raise ValueError("bad dictionary index")
+            return slot
+        dct[nxt] = [r.bytes(6), 0, 0]
+        nxt = (nxt + 1) % DICT_SIZE
+        return (nxt - 1) % DICT_SIZE
+
+    def s8(v):
+        return (v + 128) % 256 - 128
+
+    while r.off < len(block):
+        op = r.byte()
+        kind, flags = op >> 5, op & 0x1F
+        if kind == 0:
+            n = r.varint()
+            rec = r.bytes(n)
+            if n < HEADER.size or HEADER.unpack_from(rec)[0] != n:
+                raise ValueError("bad raw record")
+            prev_time = HEADER.unpack_from(rec)[3]
+        elif WIFI_SURVEY <= kind <= BTC_SURVEY:
+            if not flags & SAME_TIME:
+                prev_time = (prev_time + unzigzag(r.varint())) & 0xFFFFFFFF
+            hit = bool(flags & HIT)
+            slot = mac(hit)
+            entry = dct[slot]
+            code = flags >> RSSI_SHIFT
+            if not hit and code != RSSI_LITERAL:
+                raise ValueError("relative RSSI on a new address")
+            if code == RSSI_LITERAL:
+                rssi = s8(r.byte())
+            else:
+                rssi = s8(entry[1] + (code == RSSI_UP) - (code == RSSI_DOWN))
+            extra = entry[2] if flags & SAME_EXTRA else s8(r.byte())
+            entry[1], entry[2] = rssi, extra
+            rec = SURVEY.pack(SURVEY.size, kind, 0, prev_time, entry[0], rssi, extra)
+        elif kind == WIFI_FRAME:
+            prev_time = (prev_time + unzigzag(r.varint())) & 0xFFFFFFFF
+            channel = prev_channel if flags & SAME_CHANNEL else r.byte()
+            rssi = s8(r.byte())
+            rate = prev_rate if flags & SAME_RATE else r.byte()
+            ftype = r.byte()
+            orig = r.varint() & 0xFFFF
+            cap = r.varint()
+            if cap > BLOCK_BYTES:
+                raise ValueError("bad capture length")
+            prev_channel, prev_rate = channel, rate
+            payload = b""
+            if cap >= ADDR_END:
+                payload = r.bytes(4)
+                for i in range(3):
+                    payload += dct[mac(flags & ADDR_HIT << i)][0]
+            payload += r.bytes(cap - len(payload))
+            rec = FRAME.pack(FRAME.size + cap, WIFI_FRAME, 0, prev_time, channel, rssi, rate,
+                             ftype, orig, 0) + payload
+        else:
+            raise ValueError(f"bad op {op:#x}")
+        out.append(bytes(rec))
+    return out
+
+
+def decode_stream(data):
+    """Plain records from a stream of plain and codec records"""
+    for rec in records(data):
+        if rec[2] == CODEC_BLOCK:
+            yield from decode_block(rec)
+        else:
+            yield rec
+
+
+def bench(data):
+    t0 = time.perf_counter()
+    blocks = encode(data)
+    t1 = time.perf_counter()
+    plain = b"".join(r for b in blocks for r in decode_block(b))
+    t2 = time.perf_counter()
+    size = sum(len(b) for b in blocks)
+    types = {}
+    for rec in records(data):
+        types[rec[2]] = types.get(rec[2], 0) + 1
+    print(f"{len(data)} bytes, records by type {types}")
+    print(f"{len(blocks)} blocks, {size} bytes, ratio {len(data) / max(size, 1):.2f}")
+    print(f"encode {len(data) / (t1 - t0) / 1e6:.2f} MB/s, decode {len(data) / (t2 - t1) / 1e6:.2f} "
+          f"MB/s (Python; the node encodes with ScanEncoder)")
+    if plain != b"".join(records(data)):
+        sys.exit("round trip mismatch")
+    print("round trip ok")
+
+
+def fuzz(data, iterations, seed):
+    rnd = random.Random(seed)
+    blocks = encode(data)
+    rejected = 0
+    for _ in range(iterations):
+        b = bytearray(rnd.choice(blocks))
+        for _ in range(rnd.randint(1, 8)):
+            p = rnd.randrange(HEADER.size, len(b))
+            b[p] = rnd.randrange(256) if rnd.random() < 0.5 else b[p] ^ 1 << rnd.randrange(8)
+        if rnd.random() < 0.25:
+            del b[rnd.randrange(HEADER.size, len(b)):]
+            struct.pack_into("<H", b, 0, len(b))
+        try:
+            for rec in decode_block(bytes(b)):
+                n = HEADER.unpack_from(rec)[0]
+                assert n == len(rec) >= HEADER.size, "malformed record out of the decoder"
+        except ValueError:
+            rejected += 1
+    print(f"{iterations} mutated blocks: {rejected} rejected, the rest decoded to valid records")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("mode", choices=["decode", "bench", "fuzz"])
+    ap.add_argument("input")
+    ap.add_argument("output", nargs="?", help="decode: plain record file")
+    ap.add_argument("--iterations", type=int, default=20000)
+    ap.add_argument("--seed", type=int, default=1)
+    args = ap.parse_args()
+
+    data = open(args.input, "rb").read()
+    if args.mode == "decode":
+        try:
+            plain = b"".join(decode_stream(data))
+        except ValueError as e:
+            sys.exit(f"decode failed: {e}")
+        open(args.output or "/dev/stdout", "wb").write(plain)
+    elif args.mode == "bench":
+        bench(data)
+    else:
+        fuzz(data, args.iterations, args.seed)
+
+
+if __name__ == "__main__":
+    main()
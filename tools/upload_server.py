@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Collection server for segment uploads (src/SegmentUpload.h).
+
+    python3 tools/upload_server.py segments/            # listen on :8080
+    python3 tools/upload_server.py segments/ --flaky 0.3   # fault injection
+
+Nodes PUT each closed capture segment to /upload/<node>/<id> with chunked
+transfer encoding and ask GET /upload/<node>/last where to resume. A
+segment is written to <dir>/<node>/<id>.BIN only once its terminating
+chunk has arrived, so a transfer cut off halfway leaves nothing behind
+and /last never counts it. Stored segments are walked record by record
+and a malformed one is reported (and still kept).
+
+--flaky P makes a fraction P of requests fail in one of the ways a site
+link does: a 503, a connection reset before the reply, or a hang-up in
+the middle of the body.
+"""
+
+import argparse
+import os
+import random
+import re
+import struct
+import sys
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+HEADER = struct.Struct("<HBBI")
+PATH = re.compile(r"^/upload/([0-9A-Za-z_-]{1,15})/(last|\d{1,10})$")
+
+
+def check_records(data):
+    """Returns (records, error) for a segment's bytes."""
+    off = records = 0
+    while off + HEADER.size <= len(data):
+        length = HEADER.unpack_from(data, off)[0]
+        if length < HEADER.size or off + length > len(data):
+            break
+        off += length
+        records += 1
+    # The tail of a segment may be erased flash (0xFF) in the raw engine
+    tail = data[off:]
+    if tail and tail.strip(b"\xff"):
+        return records, f"bad record at offset {off}"
+    return records, None
+
+
+class Store:
+    def __init__(self, root):
+        self.root = root
+        self.lock = threading.Lock()
+
+    def last(self, node):
+        folder = os.path.join(self.root, node)
+        ids = [int(n[:-4]) for n in os.listdir(folder) if n.endswith(".BIN")] if os.path.isdir(folder) else []
+        return max(ids, default=0)
+
+    def put(self, node, seg, data):
+        folder = os.path.join(self.root, node)
+        os.makedirs(folder, exist_ok=True)
+        path = os.path.join(folder, f"{seg:08d}.BIN")
+        with self.lock:
+            with open(path + ".part", "wb") as f:
+                f.write(data)
+            os.replace(path + ".part", path)
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    store = None
+    flaky = 0.0
+    quiet = False
+
+    def log_message(self, fmt, *args):
+        if not self.quiet:
+            sys.stderr.write("%s %s\n" % (self.address_string(), fmt % args))
+
+    def reply(self, code, body=b""):
+        self.send_response(code)
+        self.send_header("Content-Length", str(len(body)))
+        self.send_header("Connection", "close")
+        self.end_headers()
+        self.wfile.write(body)
+        self.close_connection = True
+
+    def fault(self):
+        """Maybe fails this request; 'mid' is left for the body reader."""
+        if random.random() >= self.flaky:
+            return None
+        return random.choice(["503", "reset", "mid"])
+
+    def do_GET(self):
+        m = PATH.match(self.path)
+        if not m or m.group(2) != "last":
+            return self.reply(404)
+        if self.fault() in ("503", "reset"):
+            return self.reply(503)
+        self.reply(200, str(self.store.last(m.group(1))).encode())
+
+    def read_chunked(self, hang_up_at):
+        data = bytearray()
+        while True:
+            line = self.rfile.readline(64)
+            if not line.endswith(b"\r\n"):
+                return None
+            size = int(line.split(b";")[0], 16)
+            if size == 0:
+                self.rfile.readline(64)
+                return bytes(data)
+            data += self.rfile.read(size)
+            if self.rfile.read(2) != b"\r\n":
+                return None
+            if hang_up_at is not None and len(data) >= hang_up_at:
+                return None
+
+    def do_PUT(self):
+        m = PATH.match(self.path)
+        if not m or m.group(2) == "last":
+            return self.reply(404)
+        if "chunked" not in self.headers.get("Transfer-Encoding", ""):
+            return self.reply(411)
+        fault = self.fault()
+        if fault == "503":
+            return self.reply(503)
+        node, seg = m.group(1), int(m.group(2))
+        try:
+            data = self.read_chunked(random.randint(1, 200000) if fault == "mid" else None)
+        except (ValueError, ConnectionError):
+            data = None
+        if data is None:
+            self.close_connection = True
+            return
+        if fault == "reset":
+            self.close_connection = True   # stored, but the node never hears so
+        self.store.put(node, seg, data)
+        records, error = check_records(data)
+        if not self.quiet:
+            print(f"{node} #{seg}: {len(data)} bytes, {records} records" + (f", {error}" if error else ""))
+        if fault != "reset":
+            self.reply(201)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("dir")
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--flaky", type=float, default=0.0, help="fraction of requests to fail")
+    ap.add_argument("--seed", type=int)
+    ap.add_argument("--quiet", action="store_true")
+    args = ap.parse_args()
+    if args.seed is not None:
+        random.seed(args.seed)
+    Handler.store = Store(args.dir)
+    Handler.flaky = args.flaky
+    Handler.quiet = args.quiet
+    server = ThreadingHTTPServer((args.bind, args.port), Handler)
+    print(f"upload server on {args.bind}:{args.port}, storing in {args.dir}", flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()